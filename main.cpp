@@ -1,9 +1,11 @@
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "src/brdflut.hpp"
 #include "src/engine.hpp"
 #include "src/ibl.hpp"
 #include "src/util.hpp"
@@ -25,7 +27,6 @@ int main()
     engine.addModel("cube", "data/models/monkey.glb");
     engine.addModel("light", "data/models/gold_cube.glb");
 
-    Model* light{engine.getModel("light")};
     // engine.enableWireframe();
     const std::vector<glm::vec3> spheres{{1.f, 4.f, 2.f}};
 
@@ -35,7 +36,7 @@ int main()
 
     // ----------- IBL ------------ //
     IBLGenerator iblGenerator{&engine};
-    iblGenerator.init("data/skyboxes/clouds.hdr", "data/IBL/clouds/output_iem.hdr", "data/IBL/brdf_lut.png", &engine);
+    iblGenerator.init("data/skyboxes/clouds.hdr", "data/IBL/brdf_lut.rg16f", &engine);
 
     // reset window viewport
     glViewport(0, 0, engine.getWidth(), engine.getHeight());
@@ -54,57 +55,267 @@ int main()
         numbers[randomIndex] = a;
     }
 
+    // bars live in the scene graph, only the two swapped bars are recomputed every frame
+    const auto barTransform{[&numbers](const std::size_t i)
+    {
+        return glm::translate(glm::scale(glm::mat4{1.0f}, {1.0f, static_cast<float>(numbers[i]), 1.0f}),
+                              {static_cast<float>(i) * 3.0f, 0.0f, 0.0f});
+    }};
+    SceneGraph* sceneGraph{engine.getSceneGraph()};
+    const SceneGraphN::Handle barsRoot{
+        sceneGraph->createNode(SceneGraphN::INVALID_HANDLE, glm::scale(glm::mat4{1.0f}, glm::vec3{0.2f}))};
+    std::vector<SceneGraphN::Handle> bars{};
+    bars.reserve(numbers.size());
+    for (std::size_t i{0}; i < numbers.size(); ++i)
+        bars.push_back(sceneGraph->instantiate(engine.getModel("light"), barsRoot, barTransform(i)));
+
+    // wall in front of the first bars, rendered & registered as an occluder
+    const std::vector<glm::mat4> walls{
+        glm::scale(glm::translate(glm::mat4{1.0f}, {3.0f, 1.0f, 1.0f}), {3.0f, 2.0f, 0.2f})};
+    engine.addOccluder("light", walls[0]);
+
+    // spinning props as entities
+    World* world{engine.getWorld()};
+    for (int i{0}; i < 16; ++i)
+    {
+        ComponentsN::Transform transform{};
+        transform.position = {static_cast<float>(i % 4) * 1.5f, 4.0f + static_cast<float>(i / 4) * 1.5f, -4.0f};
+        transform.scale = glm::vec3{0.3f};
+        ComponentsN::RigidBody body{};
+        body.angularVelocity = {0.0f, 1.0f + static_cast<float>(i) * 0.1f, 0.5f};
+        body.useGravity = false;
+        world->create(transform, ComponentsN::Renderable{engine.getModel("light")}, body);
+    }
+
+    // hallway ceiling along the bars: a grid of small point lights & a row of spot lights shining down
+    ClusteredLighting* lighting{engine.getClusteredLighting()};
+    for (int i{0}; i < 64; ++i)
+    {
+        for (int j{0}; j < 8; ++j)
+        {
+            ClusteredLightingN::Light light{};
+            light.position = {static_cast<float>(i), 5.0f, static_cast<float>(j) * 1.5f - 8.0f};
+            light.color = (j % 2 == 0 ? glm::vec3{1.0f, 0.85f, 0.6f} : glm::vec3{0.6f, 0.8f, 1.0f}) * 2.0f;
+            light.range = 2.5f;
+            lighting->addLight(light);
+        }
+
+        ClusteredLightingN::Light spot{};
+        spot.type = ClusteredLightingN::LightType::SPOT;
+        spot.position = {static_cast<float>(i) + 0.5f, 9.0f, 2.0f};
+        spot.color = glm::vec3{1.0f, 0.9f, 0.75f} * 20.0f;
+        spot.range = 12.0f;
+        spot.innerAngle = 0.3f;
+        spot.outerAngle = 0.45f;
+        lighting->addLight(spot);
+    }
+
     int bubbleIndex{0};
+    bool lutBenchmarkKey{false};
+    // K rebuilds the IBL maps from the other sky, a few steps per frame
+    const char* skies[]{"data/skyboxes/clouds.hdr", "data/skyboxes/newport_loft.hdr"};
+    int sky{0};
+    bool skyKey{false};
+    bool passTimingKey{false};
+    bool bloomBenchmarkKey{false};
+    bool dynamicResolutionKey{false};
+    bool temporalAAKey{false};
+    // E toggles auto exposure, C cycles the color grading presets
+    bool autoExposureKey{false};
+    bool gradingKey{false};
+    // P saves the frame & the hdr scene target, V records raw frames
+    bool screenshotKey{false};
+    bool recordKey{false};
+    int screenshot{0};
+    // F picks what the crosshair points at through the scene index
+    bool pickKey{false};
     while (!engine.getQuit())
     {
         // update game state
 
+        // compare frames with & without occlusion culling
+        if (engine.getPressed(GLFW_KEY_B) && !engine.getBenchmarkRunning())
+        {
+            engine.benchmarkOcclusion(600);
+        }
+        // time BRDF LUT generation (blocks, once per key press)
+        if (engine.getPressed(GLFW_KEY_L) != lutBenchmarkKey)
+        {
+            lutBenchmarkKey = !lutBenchmarkKey;
+            if (lutBenchmarkKey)
+                BRDFLutN::benchmark(BRDFLutN::getSettings(BRDFLutN::Quality::HIGH), engine.getJobSystem());
+        }
+
         // bubble sort
         if (numbers[bubbleIndex + 1] < numbers[bubbleIndex])
         {
             std::swap(numbers[bubbleIndex], numbers[bubbleIndex + 1]);
+            sceneGraph->setLocalTransform(bars[bubbleIndex], barTransform(bubbleIndex));
+            sceneGraph->setLocalTransform(bars[bubbleIndex + 1], barTransform(bubbleIndex + 1));
         }
         bubbleIndex++;
         if (bubbleIndex >= numbers.size() - 1)
         {
             bubbleIndex = 0;
         }
-        // do rendering
-        engine.enablePostProcessing();
-        // clear screen
-        engine.clear();
-
-        engine.useShader("texturePBR");
-        engine.setVec3("viewPos", engine.getCameraPosition(), "texturePBR");
-
-        glm::mat4 model{glm::mat4{1.0f}};
-        model = glm::scale(model, glm::vec3{0.2f});
-        engine.setMat4("model", model, "texturePBR");
-        engine.setMat4("view", engine.getViewMatrix(), "texturePBR");
-        engine.setMat4("projection", engine.getProjectionMatrix(), "texturePBR");
-        engine.setMat3("normalMat", engine.getNormalMatrix(model), "texturePBR");
-        engine.setInt("irradianceMap", 10, "texturePBR");
-        glActiveTexture(GL_TEXTURE10);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, iblGenerator.getIrradianceMap());
-        engine.setInt("prefilterMap", 11, "texturePBR");
-        glActiveTexture(GL_TEXTURE11);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, iblGenerator.getPrefilterMap());
-        engine.setInt("brdfLUT", 12, "texturePBR");
-        glActiveTexture(GL_TEXTURE12);
-        glBindTexture(GL_TEXTURE_2D, iblGenerator.getBRDFLutMap());
-
-        for (std::size_t i{0}; i < numbers.size(); ++i)
-        {
-            model = glm::scale(glm::mat4{1.0f}, glm::vec3{0.2f, 0.2f * static_cast<float>(numbers[i]), 0.2f});
-            model = glm::translate(model, {static_cast<float>(i) * 3.0f, 0.0f, 0.0f});
+        if (engine.getPressed(GLFW_KEY_K) != skyKey)
+        {
+            skyKey = !skyKey;
+            if (skyKey && iblGenerator.beginRebuild(skies[1 - sky], &engine))
+                sky = 1 - sky;
+        }
+        iblGenerator.updateRebuild(&engine);
+
+        engine.updateWorld();
+
+        // declare the frame, the render graph culls, orders & times the passes
+        const PostProcessingN::SceneTargets targets{engine.beginRenderGraph()};
+        RenderGraph* renderGraph{engine.getRenderGraph()};
+
+        RenderGraphN::Pass scenePass{};
+        scenePass.name = "scene";
+        scenePass.color = targets.color;
+        scenePass.depth = targets.depth;
+        // the PBR shaders write motion vectors to the second target
+        if (targets.velocity != RenderGraphN::INVALID_RESOURCE)
+            scenePass.extraColors.push_back(targets.velocity);
+        scenePass.clear = true;
+        scenePass.execute = [&](const RenderGraph& graph)
+        {
+            engine.useShader("texturePBR");
+            engine.setVec3("viewPos", engine.getCameraPosition(), "texturePBR");
+
+            glm::mat4 model{glm::mat4{1.0f}};
+            model = glm::scale(model, glm::vec3{0.2f});
             engine.setMat4("model", model, "texturePBR");
-            light->renderPBR(engine.getShader("texturePBR"));
+            engine.setMat4("view", engine.getViewMatrix(), "texturePBR");
+            engine.setMat4("projection", engine.getProjectionMatrix(), "texturePBR");
+            engine.setMat3("normalMat", engine.getNormalMatrix(model), "texturePBR");
+            iblGenerator.bindIrradiance(engine.getShader("texturePBR"));
+            engine.setInt("prefilterMap", 11, "texturePBR");
+            glActiveTexture(GL_TEXTURE11);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, iblGenerator.getPrefilterMap());
+            engine.setInt("brdfLUT", 12, "texturePBR");
+            glActiveTexture(GL_TEXTURE12);
+            glBindTexture(GL_TEXTURE_2D, iblGenerator.getBRDFLutMap());
+            lighting->bind(engine.getShader("texturePBR"), graph.getRegion(targets.color));
+
+            // frustum & occlusion culled rendering
+            engine.renderModelInstances("light", engine.getShader("texturePBR"), walls);
+            engine.renderScene(engine.getShader("texturePBR"));
+            engine.renderEntities(engine.getShader("texturePBR"));
+        };
+        renderGraph->addPass(std::move(scenePass));
+
+        // drawn behind the scene (depth = 1), so it doesn't need to write depth
+        RenderGraphN::Pass skyboxPass{};
+        skyboxPass.name = "skybox";
+        skyboxPass.color = targets.color;
+        skyboxPass.depth = targets.depth;
+        skyboxPass.state.depthWrite = false;
+        skyboxPass.execute = [&](const RenderGraph&) { iblGenerator.renderSkybox(&engine); };
+        renderGraph->addPass(std::move(skyboxPass));
+
+        FrameCapture* frameCapture{engine.getFrameCapture()};
+        if (engine.getPressed(GLFW_KEY_P) != screenshotKey)
+        {
+            screenshotKey = !screenshotKey;
+            if (screenshotKey)
+            {
+                const std::string index{std::to_string(screenshot++)};
+                frameCapture->screenshot("screenshot_" + index + ".png");
+                frameCapture->addCapturePass(*renderGraph, targets.color, "scene_" + index + ".png");
+            }
         }
 
-        iblGenerator.renderSkybox(&engine);
+        engine.executeRenderGraph(targets);
+        // print the smoothed per pass timings
+        if (engine.getPressed(GLFW_KEY_G) != passTimingKey)
+        {
+            passTimingKey = !passTimingKey;
+            if (passTimingKey)
+                renderGraph->printTimings();
+        }
+        // compare the compute & fragment bloom paths
+        if (engine.getPressed(GLFW_KEY_N) != bloomBenchmarkKey)
+        {
+            bloomBenchmarkKey = !bloomBenchmarkKey;
+            if (bloomBenchmarkKey)
+                engine.benchmarkBloom(600);
+        }
+        // toggle dynamic resolution
+        if (engine.getPressed(GLFW_KEY_R) != dynamicResolutionKey)
+        {
+            dynamicResolutionKey = !dynamicResolutionKey;
+            if (dynamicResolutionKey)
+            {
+                PostProcessor* postProcessor{engine.getPostProcessor()};
+                postProcessor->setDynamicResolution(!postProcessor->getDynamicResolution().getEnabled());
+            }
+        }
+        // toggle temporal upscaling
+        if (engine.getPressed(GLFW_KEY_T) != temporalAAKey)
+        {
+            temporalAAKey = !temporalAAKey;
+            if (temporalAAKey)
+            {
+                PostProcessor* postProcessor{engine.getPostProcessor()};
+                if (postProcessor->getTemporalAAEnabled())
+                    postProcessor->disableTemporalAA();
+                else
+                    postProcessor->enableTemporalAA(&engine);
+            }
+        }
 
-        engine.disablePostProcessing();
-        engine.renderPostProcessing();
+        // toggle auto exposure
+        if (engine.getPressed(GLFW_KEY_E) != autoExposureKey)
+        {
+            autoExposureKey = !autoExposureKey;
+            if (autoExposureKey)
+            {
+                PostProcessor* postProcessor{engine.getPostProcessor()};
+                if (postProcessor->getAutoExposureEnabled())
+                    postProcessor->disableAutoExposure();
+                else
+                    postProcessor->enableAutoExposure(&engine);
+            }
+        }
+        // next color grading preset
+        if (engine.getPressed(GLFW_KEY_C) != gradingKey)
+        {
+            gradingKey = !gradingKey;
+            if (gradingKey)
+            {
+                PostProcessor* postProcessor{engine.getPostProcessor()};
+                postProcessor->setColorGrading(ColorGradingN::getNextPreset(postProcessor->getColorGrading()));
+            }
+        }
+        // toggle recording, play back with ffplay -f rawvideo -pixel_format rgba -video_size WxH capture.rgba
+        if (engine.getPressed(GLFW_KEY_V) != recordKey)
+        {
+            recordKey = !recordKey;
+            if (recordKey)
+            {
+                if (frameCapture->getRecording())
+                    frameCapture->stopRecording();
+                else
+                    frameCapture->startRecording("capture.rgba");
+            }
+        }
+
+        if (engine.getPressed(GLFW_KEY_F) != pickKey)
+        {
+            pickKey = !pickKey;
+            BVHN::RayHit hit{};
+            if (pickKey && engine.pick(hit))
+            {
+                if (SceneIndexN::isEntity(hit.userData))
+                    std::cout << "Picked entity " << engine.getIndexedEntity(hit.userData).index;
+                else
+                    std::cout << "Picked scene node " << hit.userData;
+                std::cout << " at " << hit.distance << "\n";
+            }
+        }
 
         // update engine
         engine.displayFrameTime();
@@ -0,0 +1,210 @@
+#include "autoexposure.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "engine.hpp"
+#include "glext.hpp"
+#include "util.hpp"
+
+AutoExposure::AutoExposure(EngineObject* parent) : EngineObject{"AutoExposure", parent} {}
+
+AutoExposure::~AutoExposure() { free(); }
+
+void AutoExposure::free()
+{
+    glDeleteBuffers(1, &m_histogramBuffer);
+    m_histogramBuffer = 0;
+    m_exposure = {};
+    m_historyValid = false;
+    m_init = false;
+}
+
+void AutoExposure::releaseHistory()
+{
+    for (unsigned int& texture : m_exposure)
+    {
+        if (texture != 0)
+            m_pool->releasePersistent(texture);
+        texture = 0;
+    }
+    m_historyValid = false;
+}
+
+bool AutoExposure::init(void* engine, RenderTargetPool* pool)
+{
+    if (m_init)
+        return true;
+
+    const Engine* enginePtr{static_cast<Engine*>(engine)};
+    m_luminanceShader = enginePtr->getShader("exposureLuminance");
+    m_adaptShader = enginePtr->getShader("exposureAdapt");
+    if (m_luminanceShader == nullptr || m_adaptShader == nullptr)
+    {
+        Util::beginError();
+        std::cout << "AUTO_EXPOSURE::INIT::ERROR: Could not find the exposure shaders!";
+        Util::endError();
+        return false;
+    }
+
+    m_luminanceShader->use();
+    m_luminanceShader->setInt("sceneColor", 0);
+    m_adaptShader->use();
+    m_adaptShader->setInt("luminance", 0);
+    m_adaptShader->setInt("previousExposure", 1);
+    glUseProgram(0);
+
+    // only loaded on GL 4.3+, the fragment reduction stays the fallback
+    if (GLExtN::hasCompute())
+    {
+        m_histogramShader = enginePtr->getShader("exposureHistogramCompute");
+        m_averageShader = enginePtr->getShader("exposureAverageCompute");
+    }
+    if (getCompute())
+    {
+        m_histogramShader->use();
+        m_histogramShader->setInt("sceneColor", 0);
+        m_averageShader->use();
+        m_averageShader->setInt("previousExposure", 1);
+        m_averageShader->setInt("exposureImage", 0);
+        glUseProgram(0);
+
+        // the averaging shader clears every bin it reads, so this is the only clear
+        const std::vector<unsigned int> bins(AutoExposureN::HISTOGRAM_BINS, 0);
+        glGenBuffers(1, &m_histogramBuffer);
+        glBindBuffer(GLExtN::SHADER_STORAGE_BUFFER, m_histogramBuffer);
+        glBufferData(GLExtN::SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(bins.size() * sizeof(unsigned int)),
+                     bins.data(), GL_DYNAMIC_COPY);
+        glBindBuffer(GLExtN::SHADER_STORAGE_BUFFER, 0);
+    }
+
+    m_pool = pool;
+    m_init = true;
+    return true;
+}
+
+void AutoExposure::setAdaptUniforms(const Shader* shader, const float deltaTime, const bool historyValid) const
+{
+    shader->setFloat("minLogLuminance", AutoExposureN::MIN_LOG_LUMINANCE);
+    shader->setFloat("logLuminanceRange", AutoExposureN::MAX_LOG_LUMINANCE - AutoExposureN::MIN_LOG_LUMINANCE);
+    shader->setFloat("lowPercentile", AutoExposureN::LOW_PERCENTILE);
+    shader->setFloat("highPercentile", AutoExposureN::HIGH_PERCENTILE);
+    shader->setFloat("keyValue", AutoExposureN::KEY_VALUE);
+    shader->setFloat("minExposure", AutoExposureN::MIN_EXPOSURE);
+    shader->setFloat("maxExposure", AutoExposureN::MAX_EXPOSURE);
+    // frame rate independent share of the way to the target
+    shader->setFloat("adaptBrighten", 1.0f - std::exp(-deltaTime * AutoExposureN::SPEED_BRIGHTEN));
+    shader->setFloat("adaptDarken", 1.0f - std::exp(-deltaTime * AutoExposureN::SPEED_DARKEN));
+    shader->setBool("historyValid", historyValid);
+}
+
+RenderGraphN::Resource AutoExposure::addPasses(RenderGraph& graph, const RenderGraphN::Resource color,
+                                               const float deltaTime, const unsigned int quadVAO)
+{
+    const RenderTargetN::Desc desc{1, 1, AutoExposureN::EXPOSURE_FORMAT};
+    for (unsigned int& texture : m_exposure)
+    {
+        if (texture == 0)
+            texture = m_pool->acquirePersistent(desc);
+    }
+    const RenderGraphN::Resource previous{graph.importTexture("exposureHistory", m_exposure[m_current ^ 1], desc)};
+    const RenderGraphN::Resource output{graph.importTexture("exposure", m_exposure[m_current], desc)};
+    const bool historyValid{m_historyValid};
+
+    if (getCompute())
+    {
+        RenderGraphN::Pass pass{};
+        pass.name = "exposure histogram";
+        pass.reads = {color, previous};
+        pass.writes = {output};
+        pass.execute = [this, color, previous, output, deltaTime, historyValid](const RenderGraph& renderGraph)
+        {
+            const glm::ivec2 region{renderGraph.getRegion(color)};
+            const glm::ivec2 groups{(region + AutoExposureN::HISTOGRAM_GROUP - 1) / AutoExposureN::HISTOGRAM_GROUP};
+            glBindBufferBase(GLExtN::SHADER_STORAGE_BUFFER, 0, m_histogramBuffer);
+
+            m_histogramShader->use();
+            m_histogramShader->setVec2("regionSize", glm::vec2{region});
+            m_histogramShader->setFloat("minLogLuminance", AutoExposureN::MIN_LOG_LUMINANCE);
+            m_histogramShader->setFloat("inverseLogLuminanceRange",
+                                        1.0f / (AutoExposureN::MAX_LOG_LUMINANCE - AutoExposureN::MIN_LOG_LUMINANCE));
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(color));
+            GLExtN::dispatchCompute(static_cast<unsigned int>(groups.x), static_cast<unsigned int>(groups.y), 1);
+
+            // one work group reduces the bins
+            GLExtN::memoryBarrier(GLExtN::SHADER_STORAGE_BARRIER_BIT);
+            m_averageShader->use();
+            setAdaptUniforms(m_averageShader, deltaTime, historyValid);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(previous));
+            GLExtN::bindImageTexture(0, renderGraph.getTexture(output), 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                                     AutoExposureN::EXPOSURE_FORMAT);
+            GLExtN::dispatchCompute(1, 1, 1);
+            // the cleared bins have to land before next frame's histogram adds to them
+            GLExtN::memoryBarrier(GLExtN::SHADER_STORAGE_BARRIER_BIT);
+
+            glBindBufferBase(GLExtN::SHADER_STORAGE_BUFFER, 0, 0);
+            glUseProgram(0);
+            glActiveTexture(GL_TEXTURE0);
+        };
+        graph.addPass(std::move(pass));
+    }
+    else
+    {
+        const RenderGraphN::Resource luminance{graph.createTexture(
+            "exposureLuminance", RenderTargetN::Desc{AutoExposureN::LUMINANCE_SIZE, AutoExposureN::LUMINANCE_SIZE,
+                                                     AutoExposureN::LUMINANCE_FORMAT})};
+
+        RenderGraphN::Pass luminancePass{};
+        luminancePass.name = "exposure luminance";
+        luminancePass.reads = {color};
+        luminancePass.color = luminance;
+        luminancePass.state.depthTest = false;
+        luminancePass.state.depthWrite = false;
+        luminancePass.execute = [this, color, quadVAO](const RenderGraph& renderGraph)
+        {
+            const RenderTargetN::Desc& colorDesc{renderGraph.getDesc(color)};
+            const glm::vec2 textureSize{static_cast<float>(colorDesc.width), static_cast<float>(colorDesc.height)};
+
+            m_luminanceShader->use();
+            m_luminanceShader->setVec2("sceneUVScale", glm::vec2{renderGraph.getRegion(color)} / textureSize);
+            m_luminanceShader->setFloat("gridSize", static_cast<float>(AutoExposureN::LUMINANCE_SIZE));
+            m_luminanceShader->setFloat("minLogLuminance", AutoExposureN::MIN_LOG_LUMINANCE);
+            m_luminanceShader->setFloat("maxLogLuminance", AutoExposureN::MAX_LOG_LUMINANCE);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(color));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
+        };
+        graph.addPass(std::move(luminancePass));
+
+        RenderGraphN::Pass adaptPass{};
+        adaptPass.name = "exposure adapt";
+        adaptPass.reads = {luminance, previous};
+        adaptPass.color = output;
+        adaptPass.state.depthTest = false;
+        adaptPass.state.depthWrite = false;
+        adaptPass.execute = [this, luminance, previous, deltaTime, historyValid,
+                             quadVAO](const RenderGraph& renderGraph)
+        {
+            m_adaptShader->use();
+            setAdaptUniforms(m_adaptShader, deltaTime, historyValid);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(luminance));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(previous));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
+            glActiveTexture(GL_TEXTURE0);
+        };
+        graph.addPass(std::move(adaptPass));
+    }
+
+    m_current ^= 1;
+    m_historyValid = true;
+    return output;
+}
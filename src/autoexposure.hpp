@@ -0,0 +1,87 @@
+// Auto exposure: the composite scales the scene so its average luminance lands on middle grey.
+// With compute shaders one dispatch bins the log luminance of every pixel into a histogram (shared memory atomics,
+// then one global add per bin & work group) and a second one averages it without the darkest & brightest pixels.
+// Without, a fragment pass reduces the scene to a small grid of average log luminance and a second one averages the
+// grid. Either way the exposure adapts toward the new value over time on the gpu and ends up in a 1x1 texture the
+// composite reads, nothing is read back. Two persistent pool targets take turns holding it.
+
+#ifndef AUTO_EXPOSURE_H
+#define AUTO_EXPOSURE_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+
+#include "engine_types.hpp"
+#include "rendergraph.hpp"
+#include "rendertargetpool.hpp"
+#include "shader.hpp"
+
+namespace AutoExposureN
+{
+    constexpr GLenum EXPOSURE_FORMAT{GL_R32F};
+    // fragment path: average log luminance of LUMINANCE_SIZE x LUMINANCE_SIZE tiles of the scene
+    constexpr GLenum LUMINANCE_FORMAT{GL_R16F};
+    constexpr int LUMINANCE_SIZE{32};
+    // compute path: one bin per thread of a HISTOGRAM_GROUP x HISTOGRAM_GROUP work group, bin 0 holds black
+    constexpr int HISTOGRAM_GROUP{16};
+    constexpr int HISTOGRAM_BINS{HISTOGRAM_GROUP * HISTOGRAM_GROUP};
+
+    // log2 luminance the histogram covers
+    constexpr float MIN_LOG_LUMINANCE{-10.0f};
+    constexpr float MAX_LOG_LUMINANCE{6.0f};
+    // share of the darkest & brightest pixels the histogram average leaves out
+    constexpr float LOW_PERCENTILE{0.1f};
+    constexpr float HIGH_PERCENTILE{0.95f};
+
+    // average luminance after exposure (middle grey) & the range of the exposure factor
+    constexpr float KEY_VALUE{0.18f};
+    constexpr float MIN_EXPOSURE{0.0625f};
+    constexpr float MAX_EXPOSURE{16.0f};
+    // adaptation rates per second, eyes adjust to light faster than to the dark
+    constexpr float SPEED_BRIGHTEN{3.0f};
+    constexpr float SPEED_DARKEN{1.0f};
+} // namespace AutoExposureN
+
+class AutoExposure final : public EngineObject
+{
+public:
+    explicit AutoExposure(EngineObject* parent);
+    ~AutoExposure() override;
+
+    bool init(void* engine, RenderTargetPool* pool);
+    // the exposure targets are the pool's, free() leaves them to it
+    void free();
+    // hand the exposure targets back to the pool (while it still exists)
+    void releaseHistory();
+    // jump straight to the next measured exposure (camera cuts)
+    void invalidate() { m_historyValid = false; }
+
+    // measure color (its region) & adapt the exposure deltaTime seconds further, returns the 1x1 exposure
+    RenderGraphN::Resource addPasses(RenderGraph& graph, RenderGraphN::Resource color, float deltaTime,
+                                     unsigned int quadVAO);
+
+    // histogram in compute shaders, otherwise the fragment reduction
+    [[nodiscard]] bool getCompute() const { return m_histogramShader != nullptr && m_averageShader != nullptr; }
+
+private:
+    RenderTargetPool* m_pool{nullptr};
+    bool m_init{false};
+
+    Shader* m_histogramShader{nullptr};
+    Shader* m_averageShader{nullptr};
+    unsigned int m_histogramBuffer{0};
+    Shader* m_luminanceShader{nullptr};
+    Shader* m_adaptShader{nullptr};
+
+    std::array<unsigned int, 2> m_exposure{};
+    // the exposure written this frame, the other one is last frame's
+    std::size_t m_current{0};
+    bool m_historyValid{false};
+
+    // range, percentiles, key & adaptation rates of the averaging shader
+    void setAdaptUniforms(const Shader* shader, float deltaTime, bool historyValid) const;
+};
+
+#endif
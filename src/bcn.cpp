@@ -0,0 +1,634 @@
+#include "bcn.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "glext.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BCN_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr int BLOCK_TEXELS{16};
+    // least squares refinement passes after the principal axis fit
+    constexpr int REFINE_ITERATIONS{2};
+
+    // how far palette entry k lies from the first towards the second endpoint
+    constexpr float BC1_WEIGHTS[4]{0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    constexpr int BC7_WEIGHTS[16]{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    // block texels as floats, one array per channel
+    struct Block
+    {
+        float channels[4][BLOCK_TEXELS]{};
+    };
+
+    Block toBlock(const unsigned char* texels)
+    {
+        Block block{};
+        for (int i{0}; i < BLOCK_TEXELS; ++i)
+        {
+            for (int c{0}; c < 4; ++c)
+                block.channels[c][i] = texels[i * 4 + c];
+        }
+        return block;
+    }
+
+    float clampByte(const float value) { return std::clamp(value, 0.0f, 255.0f); }
+
+    // per channel min & max of the block
+    void getRange(const unsigned char* texels, unsigned char minimum[4], unsigned char maximum[4])
+    {
+#ifdef BCN_SSE
+        __m128i low{_mm_loadu_si128(reinterpret_cast<const __m128i*>(texels))};
+        __m128i high{low};
+        for (int i{1}; i < 4; ++i)
+        {
+            const __m128i row{_mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + i * 16))};
+            low = _mm_min_epu8(low, row);
+            high = _mm_max_epu8(high, row);
+        }
+        // fold the four texels of each register into the lowest one
+        low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+        low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+        high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+        high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        const int packedLow{_mm_cvtsi128_si32(low)};
+        const int packedHigh{_mm_cvtsi128_si32(high)};
+        std::memcpy(minimum, &packedLow, 4);
+        std::memcpy(maximum, &packedHigh, 4);
+#else
+        for (int c{0}; c < 4; ++c)
+        {
+            minimum[c] = 255;
+            maximum[c] = 0;
+            for (int i{0}; i < BLOCK_TEXELS; ++i)
+            {
+                minimum[c] = std::min(minimum[c], texels[i * 4 + c]);
+                maximum[c] = std::max(maximum[c], texels[i * 4 + c]);
+            }
+        }
+#endif
+    }
+
+    // closest palette entry (count is a multiple of 4) for every texel, returns the total squared error
+    float findIndices(const Block& block, const float palette[4][16], const int count, const int firstChannel,
+                      const int numChannels, unsigned char indices[BLOCK_TEXELS])
+    {
+        float total{0.0f};
+        for (int i{0}; i < BLOCK_TEXELS; ++i)
+        {
+            alignas(16) float errors[16]{};
+#ifdef BCN_SSE
+            // four palette entries at a time
+            for (int k{0}; k < count; k += 4)
+            {
+                __m128 error{_mm_setzero_ps()};
+                for (int c{firstChannel}; c < firstChannel + numChannels; ++c)
+                {
+                    const __m128 difference{
+                        _mm_sub_ps(_mm_loadu_ps(&palette[c][k]), _mm_set1_ps(block.channels[c][i]))};
+                    error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+                }
+                _mm_store_ps(&errors[k], error);
+            }
+#else
+            for (int k{0}; k < count; ++k)
+            {
+                for (int c{firstChannel}; c < firstChannel + numChannels; ++c)
+                {
+                    const float difference{palette[c][k] - block.channels[c][i]};
+                    errors[k] += difference * difference;
+                }
+            }
+#endif
+            int best{0};
+            for (int k{1}; k < count; ++k)
+            {
+                if (errors[k] < errors[best])
+                    best = k;
+            }
+            indices[i] = static_cast<unsigned char>(best);
+            total += errors[best];
+        }
+        return total;
+    }
+
+    // endpoints spanning the block along its principal axis
+    void fitAxis(const Block& block, const int firstChannel, const int numChannels, float start[4], float end[4])
+    {
+        const int lastChannel{firstChannel + numChannels};
+
+        float mean[4]{};
+        for (int c{firstChannel}; c < lastChannel; ++c)
+        {
+            for (int i{0}; i < BLOCK_TEXELS; ++i)
+                mean[c] += block.channels[c][i];
+            mean[c] /= BLOCK_TEXELS;
+        }
+
+        float covariance[4][4]{};
+        for (int i{0}; i < BLOCK_TEXELS; ++i)
+        {
+            for (int a{firstChannel}; a < lastChannel; ++a)
+            {
+                for (int b{firstChannel}; b < lastChannel; ++b)
+                    covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+            }
+        }
+
+        // power iteration, starting from the row of the channel that varies most
+        int largest{firstChannel};
+        for (int c{firstChannel}; c < lastChannel; ++c)
+        {
+            if (covariance[c][c] > covariance[largest][largest])
+                largest = c;
+        }
+
+        float axis[4]{};
+        for (int c{firstChannel}; c < lastChannel; ++c)
+            axis[c] = covariance[largest][c];
+
+        float length{0.0f};
+        for (int iteration{0}; iteration < 8; ++iteration)
+        {
+            float next[4]{};
+            for (int a{firstChannel}; a < lastChannel; ++a)
+            {
+                for (int b{firstChannel}; b < lastChannel; ++b)
+                    next[a] += covariance[a][b] * axis[b];
+            }
+
+            length = 0.0f;
+            for (int c{firstChannel}; c < lastChannel; ++c)
+                length += next[c] * next[c];
+            length = std::sqrt(length);
+            if (length < 1e-6f)
+                break;
+            for (int c{firstChannel}; c < lastChannel; ++c)
+                axis[c] = next[c] / length;
+        }
+
+        // flat block
+        if (length < 1e-6f)
+        {
+            for (int c{firstChannel}; c < lastChannel; ++c)
+                start[c] = end[c] = mean[c];
+            return;
+        }
+
+        float minimum{std::numeric_limits<float>::max()};
+        float maximum{std::numeric_limits<float>::lowest()};
+        for (int i{0}; i < BLOCK_TEXELS; ++i)
+        {
+            float t{0.0f};
+            for (int c{firstChannel}; c < lastChannel; ++c)
+                t += (block.channels[c][i] - mean[c]) * axis[c];
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+        }
+
+        for (int c{firstChannel}; c < lastChannel; ++c)
+        {
+            start[c] = clampByte(mean[c] + minimum * axis[c]);
+            end[c] = clampByte(mean[c] + maximum * axis[c]);
+        }
+    }
+
+    // least squares endpoints for fixed indices, false if the system is singular (all texels on one entry)
+    bool solveEndpoints(const Block& block, const int firstChannel, const int numChannels,
+                        const unsigned char indices[BLOCK_TEXELS], const float* weights, float start[4], float end[4])
+    {
+        float aa{0.0f}, ab{0.0f}, bb{0.0f};
+        float ax[4]{}, bx[4]{};
+        for (int i{0}; i < BLOCK_TEXELS; ++i)
+        {
+            const float b{weights[indices[i]]};
+            const float a{1.0f - b};
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c{firstChannel}; c < firstChannel + numChannels; ++c)
+            {
+                ax[c] += a * block.channels[c][i];
+                bx[c] += b * block.channels[c][i];
+            }
+        }
+
+        const float determinant{aa * bb - ab * ab};
+        if (std::abs(determinant) < 1e-6f)
+            return false;
+
+        for (int c{firstChannel}; c < firstChannel + numChannels; ++c)
+        {
+            start[c] = clampByte((ax[c] * bb - bx[c] * ab) / determinant);
+            end[c] = clampByte((bx[c] * aa - ax[c] * ab) / determinant);
+        }
+        return true;
+    }
+
+    // ------ BC1 ------ //
+
+    struct ColorBlock
+    {
+        std::uint16_t color0{0};
+        std::uint16_t color1{0};
+        unsigned char indices[BLOCK_TEXELS]{};
+        float error{0.0f};
+    };
+
+    std::uint16_t pack565(const float color[4])
+    {
+        const auto r{static_cast<std::uint16_t>(std::lround(color[0] * 31.0f / 255.0f))};
+        const auto g{static_cast<std::uint16_t>(std::lround(color[1] * 63.0f / 255.0f))};
+        const auto b{static_cast<std::uint16_t>(std::lround(color[2] * 31.0f / 255.0f))};
+        return static_cast<std::uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    void unpack565(const std::uint16_t color, float out[3])
+    {
+        const int r{color >> 11 & 31};
+        const int g{color >> 5 & 63};
+        const int b{color & 31};
+        out[0] = static_cast<float>(r << 3 | r >> 2);
+        out[1] = static_cast<float>(g << 2 | g >> 4);
+        out[2] = static_cast<float>(b << 3 | b >> 2);
+    }
+
+    ColorBlock quantizeBC1(const Block& block, const float start[4], const float end[4])
+    {
+        ColorBlock result{pack565(start), pack565(end)};
+        // four color mode needs color0 > color1 (equal endpoints only ever use index 0)
+        if (result.color0 < result.color1)
+            std::swap(result.color0, result.color1);
+
+        float first[3]{}, second[3]{};
+        unpack565(result.color0, first);
+        unpack565(result.color1, second);
+
+        float palette[4][16]{};
+        for (int k{0}; k < 4; ++k)
+        {
+            for (int c{0}; c < 3; ++c)
+                palette[c][k] = first[c] + (second[c] - first[c]) * BC1_WEIGHTS[k];
+        }
+        result.error = findIndices(block, palette, 4, 0, 3, result.indices);
+        return result;
+    }
+
+    void encodeColor(const Block& block, unsigned char* out)
+    {
+        float start[4]{}, end[4]{};
+        fitAxis(block, 0, 3, start, end);
+        ColorBlock best{quantizeBC1(block, start, end)};
+
+        for (int iteration{0}; iteration < REFINE_ITERATIONS; ++iteration)
+        {
+            if (!solveEndpoints(block, 0, 3, best.indices, BC1_WEIGHTS, start, end))
+                break;
+            const ColorBlock refined{quantizeBC1(block, start, end)};
+            if (refined.error >= best.error)
+                break;
+            best = refined;
+        }
+
+        std::uint32_t bits{0};
+        for (int i{0}; i < BLOCK_TEXELS; ++i)
+            bits |= static_cast<std::uint32_t>(best.indices[i]) << (i * 2);
+
+        out[0] = static_cast<unsigned char>(best.color0 & 0xFF);
+        out[1] = static_cast<unsigned char>(best.color0 >> 8);
+        out[2] = static_cast<unsigned char>(best.color1 & 0xFF);
+        out[3] = static_cast<unsigned char>(best.color1 >> 8);
+        for (int i{0}; i < 4; ++i)
+            out[4 + i] = static_cast<unsigned char>(bits >> (i * 8) & 0xFF);
+    }
+
+    // ------ BC4 ------ //
+
+    // one channel between its min & max with 8 interpolated values
+    void encodeChannel(const Block& block, const int channel, const unsigned char minimum,
+                       const unsigned char maximum, unsigned char* out)
+    {
+        out[0] = maximum;
+        out[1] = minimum;
+
+        std::uint64_t bits{0};
+        // 8 value mode needs the first endpoint to be larger, a flat block only uses index 0
+        if (maximum > minimum)
+        {
+            float palette[4][16]{};
+            palette[channel][0] = maximum;
+            palette[channel][1] = minimum;
+            for (int k{2}; k < 8; ++k)
+                palette[channel][k] = static_cast<float>((8 - k) * maximum + (k - 1) * minimum) / 7.0f;
+
+            unsigned char indices[BLOCK_TEXELS]{};
+            findIndices(block, palette, 8, channel, 1, indices);
+            for (int i{0}; i < BLOCK_TEXELS; ++i)
+                bits |= static_cast<std::uint64_t>(indices[i]) << (i * 3);
+        }
+
+        for (int i{0}; i < 6; ++i)
+            out[2 + i] = static_cast<unsigned char>(bits >> (i * 8) & 0xFF);
+    }
+
+    // ------ BC7 ------ //
+
+    struct BC7Block
+    {
+        int start[4]{};
+        int end[4]{};
+        int startBit{0};
+        int endBit{0};
+        unsigned char indices[BLOCK_TEXELS]{};
+        float error{0.0f};
+    };
+
+    // 7 bit endpoint plus the p bit (shared by all channels) closest to color
+    void quantizeBC7Endpoint(const float color[4], int quantized[4], int& pBit)
+    {
+        float bestError{std::numeric_limits<float>::max()};
+        for (int bit{0}; bit < 2; ++bit)
+        {
+            int candidate[4]{};
+            float error{0.0f};
+            for (int c{0}; c < 4; ++c)
+            {
+                candidate[c] = std::clamp(static_cast<int>(std::lround((color[c] - bit) * 0.5f)), 0, 127);
+                const float difference{static_cast<float>(candidate[c] * 2 + bit) - color[c]};
+                error += difference * difference;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                pBit = bit;
+                std::copy(candidate, candidate + 4, quantized);
+            }
+        }
+    }
+
+    BC7Block quantizeBC7(const Block& block, const float start[4], const float end[4])
+    {
+        BC7Block result{};
+        quantizeBC7Endpoint(start, result.start, result.startBit);
+        quantizeBC7Endpoint(end, result.end, result.endBit);
+
+        float palette[4][16]{};
+        for (int c{0}; c < 4; ++c)
+        {
+            const int first{result.start[c] * 2 + result.startBit};
+            const int second{result.end[c] * 2 + result.endBit};
+            for (int k{0}; k < 16; ++k)
+                palette[c][k] = static_cast<float>(((64 - BC7_WEIGHTS[k]) * first + BC7_WEIGHTS[k] * second + 32) >> 6);
+        }
+        result.error = findIndices(block, palette, 16, 0, 4, result.indices);
+        return result;
+    }
+
+    // little endian bit stream
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(unsigned char* out) : m_out{out} {}
+
+        void write(const unsigned int value, const int bits)
+        {
+            for (int i{0}; i < bits; ++i, ++m_position)
+                m_out[m_position >> 3] |= static_cast<unsigned char>((value >> i & 1) << (m_position & 7));
+        }
+
+    private:
+        unsigned char* m_out{nullptr};
+        int m_position{0};
+    };
+
+    // single subset rgba with 4 bit indices
+    void encodeBC7Mode6(const Block& block, unsigned char* out)
+    {
+        float weights[16]{};
+        for (int k{0}; k < 16; ++k)
+            weights[k] = static_cast<float>(BC7_WEIGHTS[k]) / 64.0f;
+
+        float start[4]{}, end[4]{};
+        fitAxis(block, 0, 4, start, end);
+        BC7Block best{quantizeBC7(block, start, end)};
+
+        for (int iteration{0}; iteration < REFINE_ITERATIONS; ++iteration)
+        {
+            if (!solveEndpoints(block, 0, 4, best.indices, weights, start, end))
+                break;
+            const BC7Block refined{quantizeBC7(block, start, end)};
+            if (refined.error >= best.error)
+                break;
+            best = refined;
+        }
+
+        // the anchor (first) index is stored without its msb, swap the endpoints if it's set
+        if (best.indices[0] >= 8)
+        {
+            std::swap(best.start, best.end);
+            std::swap(best.startBit, best.endBit);
+            for (unsigned char& index : best.indices)
+                index = static_cast<unsigned char>(15 - index);
+        }
+
+        std::memset(out, 0, 16);
+        BitWriter writer{out};
+        writer.write(1 << 6, 7); // mode 6
+        for (int c{0}; c < 4; ++c)
+        {
+            writer.write(static_cast<unsigned int>(best.start[c]), 7);
+            writer.write(static_cast<unsigned int>(best.end[c]), 7);
+        }
+        writer.write(static_cast<unsigned int>(best.startBit), 1);
+        writer.write(static_cast<unsigned int>(best.endBit), 1);
+        writer.write(best.indices[0], 3);
+        for (int i{1}; i < BLOCK_TEXELS; ++i)
+            writer.write(best.indices[i], 4);
+    }
+
+    void encodeBlock(const BCnN::Format format, const unsigned char* texels, unsigned char* out)
+    {
+        switch (format)
+        {
+        case BCnN::FORMAT_BC1:
+            BCnN::encodeBC1Block(texels, out);
+            break;
+        case BCnN::FORMAT_BC3:
+            BCnN::encodeBC3Block(texels, out);
+            break;
+        case BCnN::FORMAT_BC4:
+            BCnN::encodeBC4Block(texels, out);
+            break;
+        case BCnN::FORMAT_BC5:
+            BCnN::encodeBC5Block(texels, out);
+            break;
+        case BCnN::FORMAT_BC7:
+            BCnN::encodeBC7Block(texels, out);
+            break;
+        }
+    }
+} // namespace
+
+std::size_t BCnN::getBlockBytes(const Format format)
+{
+    return format == FORMAT_BC1 || format == FORMAT_BC4 ? 8 : 16;
+}
+
+std::size_t BCnN::getLevelBytes(const Format format, const int width, const int height)
+{
+    const auto blocksX{static_cast<std::size_t>(std::max(1, (width + 3) / 4))};
+    const auto blocksY{static_cast<std::size_t>(std::max(1, (height + 3) / 4))};
+    return blocksX * blocksY * getBlockBytes(format);
+}
+
+int BCnN::getChannelCount(const Format format)
+{
+    switch (format)
+    {
+    case FORMAT_BC1:
+        return 3;
+    case FORMAT_BC4:
+        return 1;
+    case FORMAT_BC5:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+unsigned int BCnN::getGLFormat(const Format format)
+{
+    switch (format)
+    {
+    case FORMAT_BC1:
+        return GLExtN::COMPRESSED_RGB_S3TC_DXT1;
+    case FORMAT_BC3:
+        return GLExtN::COMPRESSED_RGBA_S3TC_DXT5;
+    case FORMAT_BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case FORMAT_BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case FORMAT_BC7:
+        return GLExtN::COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+bool BCnN::isSupported(const Format format)
+{
+    switch (format)
+    {
+    case FORMAT_BC1:
+    case FORMAT_BC3:
+        return GLExtN::hasS3TC();
+    case FORMAT_BC7:
+        return GLExtN::hasBPTC();
+    default:
+        return true; // rgtc is core since 3.0
+    }
+}
+
+const char* BCnN::getName(const Format format)
+{
+    constexpr const char* names[]{"BC1", "BC3", "BC4", "BC5", "BC7"};
+    return names[format];
+}
+
+BCnN::Format BCnN::chooseFormat(const MeshN::TextureType type, const bool hasAlpha)
+{
+    switch (type)
+    {
+    case MeshN::TEXTURE_NORMAL:
+        return FORMAT_BC5;
+    case MeshN::TEXTURE_AO:
+        return FORMAT_BC4;
+    case MeshN::TEXTURE_ALBEDO:
+    case MeshN::TEXTURE_ORM: // three unrelated channels, BC1 would mix them up
+        return FORMAT_BC7;
+    default:
+        return hasAlpha ? FORMAT_BC3 : FORMAT_BC1;
+    }
+}
+
+void BCnN::encodeBC1Block(const unsigned char* texels, unsigned char* out) { encodeColor(toBlock(texels), out); }
+
+void BCnN::encodeBC3Block(const unsigned char* texels, unsigned char* out)
+{
+    unsigned char minimum[4]{}, maximum[4]{};
+    getRange(texels, minimum, maximum);
+
+    const Block block{toBlock(texels)};
+    encodeChannel(block, 3, minimum[3], maximum[3], out);
+    encodeColor(block, out + 8);
+}
+
+void BCnN::encodeBC4Block(const unsigned char* texels, unsigned char* out)
+{
+    unsigned char minimum[4]{}, maximum[4]{};
+    getRange(texels, minimum, maximum);
+    encodeChannel(toBlock(texels), 0, minimum[0], maximum[0], out);
+}
+
+void BCnN::encodeBC5Block(const unsigned char* texels, unsigned char* out)
+{
+    unsigned char minimum[4]{}, maximum[4]{};
+    getRange(texels, minimum, maximum);
+
+    const Block block{toBlock(texels)};
+    encodeChannel(block, 0, minimum[0], maximum[0], out);
+    encodeChannel(block, 1, minimum[1], maximum[1], out + 8);
+}
+
+void BCnN::encodeBC7Block(const unsigned char* texels, unsigned char* out) { encodeBC7Mode6(toBlock(texels), out); }
+
+std::vector<unsigned char> BCnN::encode(const unsigned char* rgba, const int width, const int height,
+                                        const Format format, JobSystem* jobs)
+{
+    const auto blocksX{static_cast<std::size_t>((width + 3) / 4)};
+    const auto blocksY{static_cast<std::size_t>((height + 3) / 4)};
+    const std::size_t blockBytes{getBlockBytes(format)};
+    std::vector<unsigned char> out(blocksX * blocksY * blockBytes);
+
+    const auto encodeRows{[&](const std::size_t begin, const std::size_t end)
+                          {
+                              unsigned char texels[BLOCK_TEXELS * 4]{};
+                              for (std::size_t blockY{begin}; blockY < end; ++blockY)
+                              {
+                                  for (std::size_t blockX{0}; blockX < blocksX; ++blockX)
+                                  {
+                                      // gather the block, repeating the last row / column past the edge
+                                      for (int y{0}; y < 4; ++y)
+                                      {
+                                          const int sourceY{std::min(static_cast<int>(blockY) * 4 + y, height - 1)};
+                                          for (int x{0}; x < 4; ++x)
+                                          {
+                                              const int sourceX{std::min(static_cast<int>(blockX) * 4 + x, width - 1)};
+                                              std::memcpy(texels + (y * 4 + x) * 4,
+                                                          rgba + (static_cast<std::size_t>(sourceY) * width + sourceX) * 4,
+                                                          4);
+                                          }
+                                      }
+                                      encodeBlock(format, texels, out.data() + (blockY * blocksX + blockX) * blockBytes);
+                                  }
+                              }
+                          }};
+
+    if (jobs != nullptr)
+        jobs->parallelFor(blocksY, ENCODE_GRAIN, encodeRows);
+    else
+        encodeRows(0, blocksY);
+    return out;
+}
@@ -0,0 +1,57 @@
+// Block compression (BCn) encoder.
+// Encodes RGBA8 images into the 4x4 block formats gpus sample directly: BC1 (rgb), BC3 (rgba), BC4 (one channel),
+// BC5 (two channels) and BC7 (rgba, mode 6 only). Endpoints start on the principal axis of each block and are
+// refined with a least squares fit, indices come from an (SSE) exhaustive palette search. Blocks are independent,
+// so block rows are split across the job system. Meant for bake time, not for every frame.
+
+#ifndef BCN_H
+#define BCN_H
+
+#include <cstddef>
+#include <vector>
+
+#include "jobs.hpp"
+#include "mesh.hpp"
+
+namespace BCnN
+{
+    enum Format
+    {
+        FORMAT_BC1 = 0,
+        FORMAT_BC3 = 1,
+        FORMAT_BC4 = 2, // red channel
+        FORMAT_BC5 = 3, // red & green channels
+        FORMAT_BC7 = 4,
+    };
+
+    // block rows per job
+    constexpr std::size_t ENCODE_GRAIN{4};
+
+    [[nodiscard]] std::size_t getBlockBytes(Format format);
+    // bytes of a whole mip level
+    [[nodiscard]] std::size_t getLevelBytes(Format format, int width, int height);
+    // channels the format stores
+    [[nodiscard]] int getChannelCount(Format format);
+    // GL internal format
+    [[nodiscard]] unsigned int getGLFormat(Format format);
+    // whether the current context can sample the format (call after GLExtN::load)
+    [[nodiscard]] bool isSupported(Format format);
+    [[nodiscard]] const char* getName(Format format);
+
+    // normal maps -> BC5, ao maps -> BC4, albedo & ORM maps -> BC7, anything else BC1 / BC3
+    [[nodiscard]] Format chooseFormat(MeshN::TextureType type, bool hasAlpha);
+
+    // 16 rgba texels (row major) in, one block out
+    void encodeBC1Block(const unsigned char* texels, unsigned char* out);
+    void encodeBC3Block(const unsigned char* texels, unsigned char* out);
+    void encodeBC4Block(const unsigned char* texels, unsigned char* out);
+    void encodeBC5Block(const unsigned char* texels, unsigned char* out);
+    void encodeBC7Block(const unsigned char* texels, unsigned char* out);
+
+    // encode a rgba8 image, sizes don't have to be multiples of 4 (edge texels are repeated)
+    // jobs can be nullptr, everything is encoded on the calling thread then
+    std::vector<unsigned char> encode(const unsigned char* rgba, int width, int height, Format format,
+                                      JobSystem* jobs = nullptr);
+} // namespace BCnN
+
+#endif
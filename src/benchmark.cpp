@@ -0,0 +1,86 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+void Benchmark::addSample(const std::string& series, const BenchmarkN::Sample& sample)
+{
+    for (auto& [name, samples] : m_series)
+    {
+        if (name == series)
+        {
+            samples.push_back(sample);
+            return;
+        }
+    }
+    m_series.emplace_back(series, std::vector<BenchmarkN::Sample>{sample});
+}
+
+const std::vector<BenchmarkN::Sample>* Benchmark::findSeries(const std::string& series) const
+{
+    for (const auto& [name, samples] : m_series)
+    {
+        if (name == series)
+            return &samples;
+    }
+    return nullptr;
+}
+
+std::size_t Benchmark::getSampleCount(const std::string& series) const
+{
+    const std::vector<BenchmarkN::Sample>* samples{findSeries(series)};
+    return samples ? samples->size() : 0;
+}
+
+BenchmarkN::Summary Benchmark::summarize(const std::string& series) const
+{
+    BenchmarkN::Summary summary{};
+    const std::vector<BenchmarkN::Sample>* samples{findSeries(series)};
+    if (samples == nullptr || samples->empty())
+        return summary;
+
+    summary.count = samples->size();
+    summary.minCpuMs = (*samples)[0].cpuMs;
+    summary.maxCpuMs = (*samples)[0].cpuMs;
+    for (const BenchmarkN::Sample& sample : *samples)
+    {
+        summary.meanCpuMs += sample.cpuMs;
+        summary.meanGpuMs += sample.gpuMs;
+        summary.meanDrawCalls += static_cast<double>(sample.drawCalls);
+        summary.minCpuMs = std::min(summary.minCpuMs, sample.cpuMs);
+        summary.maxCpuMs = std::max(summary.maxCpuMs, sample.cpuMs);
+    }
+
+    const double count{static_cast<double>(summary.count)};
+    summary.meanCpuMs /= count;
+    summary.meanGpuMs /= count;
+    summary.meanDrawCalls /= count;
+    return summary;
+}
+
+void Benchmark::report() const
+{
+    std::cout << "BENCHMARK: " << m_name << '\n';
+    if (m_series.empty())
+    {
+        std::cout << "  (no samples)\n";
+        return;
+    }
+
+    const BenchmarkN::Summary baseline{summarize(m_series[0].first)};
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto& [name, samples] : m_series)
+    {
+        const BenchmarkN::Summary summary{summarize(name)};
+        std::cout << "  " << std::left << std::setw(24) << name << std::right << " frames: " << summary.count
+                  << " | cpu: " << summary.meanCpuMs << "ms (min " << summary.minCpuMs << ", max " << summary.maxCpuMs
+                  << ") | gpu: " << summary.meanGpuMs << "ms | draws: " << summary.meanDrawCalls;
+        if (&name != &m_series[0].first && baseline.meanCpuMs > 0.0)
+        {
+            std::cout << " | cpu x" << summary.meanCpuMs / baseline.meanCpuMs;
+        }
+        std::cout << '\n';
+    }
+    std::cout << std::defaultfloat;
+}
@@ -0,0 +1,77 @@
+// Small in-engine benchmark recorder: collects per-frame samples into named series and prints a comparison.
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace BenchmarkN
+{
+    struct Sample
+    {
+        double cpuMs{0.0};
+        double gpuMs{0.0};
+        unsigned int drawCalls{0};
+    };
+
+    struct Summary
+    {
+        std::size_t count{0};
+        double meanCpuMs{0.0};
+        double minCpuMs{0.0};
+        double maxCpuMs{0.0};
+        double meanGpuMs{0.0};
+        double meanDrawCalls{0.0};
+    };
+
+    // milliseconds since an arbitrary epoch (steady clock)
+    inline double nowMs()
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // adds the elapsed wall time of its scope to target (in ms)
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(double& target) : m_target{target}, m_start{nowMs()} {}
+        ~ScopedTimer() { m_target += nowMs() - m_start; }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        double& m_target;
+        double m_start;
+    };
+} // namespace BenchmarkN
+
+class Benchmark
+{
+public:
+    explicit Benchmark(std::string name) : m_name{std::move(name)} {}
+
+    void addSample(const std::string& series, const BenchmarkN::Sample& sample);
+
+    [[nodiscard]] BenchmarkN::Summary summarize(const std::string& series) const;
+    [[nodiscard]] std::size_t getSampleCount(const std::string& series) const;
+
+    // print every series, with the relative cpu time & draw calls against the first series
+    void report() const;
+    void clear() { m_series.clear(); }
+
+    [[nodiscard]] const std::string& getName() const { return m_name; }
+
+private:
+    std::string m_name;
+    // kept in insertion order so the first series is the baseline
+    std::vector<std::pair<std::string, std::vector<BenchmarkN::Sample>>> m_series{};
+
+    [[nodiscard]] const std::vector<BenchmarkN::Sample>* findSeries(const std::string& series) const;
+};
+
+#endif
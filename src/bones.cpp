@@ -244,16 +244,18 @@ void BoneAnimation::readHeirarchyData(BonesN::AssimpNodeData& dest, const aiNode
 BoneAnimator::BoneAnimator(BoneAnimation* animation) :
     m_currentAnimation{animation}, m_currentTime{0.0f}
 {
-    m_finalBoneMatrices.reserve(100);
-    for (std::size_t i{0}; i < 100; ++i)
+    m_finalBoneMatrices.reserve(BonesN::MAX_BONES);
+    for (std::size_t i{0}; i < BonesN::MAX_BONES; ++i)
     {
         m_finalBoneMatrices.emplace_back(1.0f);
     }
+    m_previousBoneMatrices = m_finalBoneMatrices;
 }
 
 void BoneAnimator::updateAnimation(const float dt)
 {
     m_deltaTime = dt;
+    m_previousBoneMatrices = m_finalBoneMatrices;
     if (m_currentAnimation)
     {
         m_currentTime += m_currentAnimation->getTicksPerSecond() * dt;
@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include <glm/detail/type_quat.hpp>
 #include <assimp/scene.h>
+#include <cstddef>
 #include <map>
 #include <string>
 #include <vector>
@@ -15,6 +16,9 @@
 
 namespace BonesN
 {
+    // bone matrices of an animator, MAX_BONES of the skinned shader
+    constexpr std::size_t MAX_BONES{100};
+
     struct KeyPosition
     {
         glm::vec3 position;
@@ -130,6 +134,8 @@ public:
     void calculateBoneTransform(const BonesN::AssimpNodeData* node, const glm::mat4& parentTransform);
 
     [[nodiscard]] const std::vector<glm::mat4>& getFinalBoneMatrices() const {return m_finalBoneMatrices;}
+    // the matrices before the last updateAnimation(), for skinned motion vectors
+    [[nodiscard]] const std::vector<glm::mat4>& getPreviousBoneMatrices() const {return m_previousBoneMatrices;}
     
 private:
     BoneAnimation* m_currentAnimation;
@@ -137,6 +143,7 @@ private:
 
     float m_deltaTime{1.0f};
     std::vector<glm::mat4> m_finalBoneMatrices{};
+    std::vector<glm::mat4> m_previousBoneMatrices{};
 };
 
 #endif
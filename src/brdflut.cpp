@@ -0,0 +1,289 @@
+#include "brdflut.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "benchmark.hpp"
+#include "util.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BRDF_LUT_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr double PI{3.14159265358979323846};
+    constexpr char MAGIC[4]{'B', 'R', 'D', 'F'};
+    // magic, version, size, samples
+    constexpr std::size_t HEADER_BYTES{4 + 4 + 4 + 4};
+    constexpr int MAX_SIZE{4096};
+
+    void putU32(std::vector<unsigned char>& bytes, const std::uint32_t value)
+    {
+        for (int i{0}; i < 4; ++i)
+            bytes.push_back(static_cast<unsigned char>(value >> (i * 8)));
+    }
+
+    std::uint32_t getU32(const unsigned char* bytes)
+    {
+        std::uint32_t value{0};
+        for (int i{0}; i < 4; ++i)
+            value |= static_cast<std::uint32_t>(bytes[i]) << (i * 8);
+        return value;
+    }
+
+    float radicalInverse(std::uint32_t bits)
+    {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+
+    // scale & bias sums over samples [begin, count) of the half vector tables
+    void integrate(const float* hx, const float* hz, int begin, const int count, const float vx, const float vz,
+                   const float k, float& scale, float& bias)
+    {
+        // G1(N.V) is the same for every sample, G1(N.L) = N.L / (N.L (1 - k) + k)
+        const float g1V{vz / (vz * (1.0f - k) + k)};
+        for (; begin < count; ++begin)
+        {
+            const float vDotH{vx * hx[begin] + vz * hz[begin]};
+            const float nDotL{2.0f * vDotH * hz[begin] - vz};
+            if (nDotL <= 0.0f)
+                continue;
+
+            const float g{g1V * nDotL / (nDotL * (1.0f - k) + k)};
+            const float gVis{g * vDotH / (hz[begin] * vz)};
+            const float f1{1.0f - vDotH};
+            const float f2{f1 * f1};
+            const float fc{f2 * f2 * f1};
+            scale += (1.0f - fc) * gVis;
+            bias += fc * gVis;
+        }
+    }
+
+    void generateRow(const BRDFLutN::Settings& settings, const int row, const std::vector<float>& cosPhi,
+                     const std::vector<float>& xiY, const bool simd, std::uint16_t* out)
+    {
+        const int count{settings.samples};
+        const float roughness{(static_cast<float>(row) + 0.5f) / static_cast<float>(settings.size)};
+        const float a{roughness * roughness};
+        const float a2{a * a};
+        const float k{a / 2.0f};
+
+        // GGX half vectors of the row in tangent space, V has no y so H.y is never needed
+        std::vector<float> hx(count);
+        std::vector<float> hz(count);
+        for (int i{0}; i < count; ++i)
+        {
+            const float cosTheta{std::sqrt((1.0f - xiY[i]) / (1.0f + (a2 - 1.0f) * xiY[i]))};
+            hx[i] = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta)) * cosPhi[i];
+            hz[i] = cosTheta;
+        }
+
+        for (int x{0}; x < settings.size; ++x)
+        {
+            const float vz{(static_cast<float>(x) + 0.5f) / static_cast<float>(settings.size)};
+            const float vx{std::sqrt(1.0f - vz * vz)};
+            float scale{0.0f};
+            float bias{0.0f};
+            int begin{0};
+#ifdef BRDF_LUT_SSE
+            if (simd)
+            {
+                const __m128 vX{_mm_set1_ps(vx)};
+                const __m128 vZ{_mm_set1_ps(vz)};
+                const __m128 kV{_mm_set1_ps(k)};
+                const __m128 oneMinusK{_mm_set1_ps(1.0f - k)};
+                const __m128 one{_mm_set1_ps(1.0f)};
+                const __m128 two{_mm_set1_ps(2.0f)};
+                const __m128 zero{_mm_setzero_ps()};
+                const __m128 g1V{_mm_set1_ps(vz / (vz * (1.0f - k) + k))};
+                __m128 scales{zero};
+                __m128 biases{zero};
+                for (; begin + 4 <= count; begin += 4)
+                {
+                    const __m128 hX{_mm_loadu_ps(&hx[begin])};
+                    const __m128 hZ{_mm_loadu_ps(&hz[begin])};
+                    const __m128 vDotH{_mm_add_ps(_mm_mul_ps(vX, hX), _mm_mul_ps(vZ, hZ))};
+                    const __m128 nDotL{_mm_sub_ps(_mm_mul_ps(two, _mm_mul_ps(vDotH, hZ)), vZ)};
+                    const __m128 visible{_mm_cmpgt_ps(nDotL, zero)};
+
+                    const __m128 g{_mm_div_ps(_mm_mul_ps(g1V, nDotL), _mm_add_ps(_mm_mul_ps(nDotL, oneMinusK), kV))};
+                    // samples below the horizon may divide by ~0, the mask drops them
+                    const __m128 gVis{
+                        _mm_and_ps(visible, _mm_div_ps(_mm_mul_ps(g, vDotH), _mm_mul_ps(hZ, vZ)))};
+                    const __m128 f1{_mm_sub_ps(one, vDotH)};
+                    const __m128 f2{_mm_mul_ps(f1, f1)};
+                    const __m128 fc{_mm_mul_ps(_mm_mul_ps(f2, f2), f1)};
+                    scales = _mm_add_ps(scales, _mm_mul_ps(_mm_sub_ps(one, fc), gVis));
+                    biases = _mm_add_ps(biases, _mm_mul_ps(fc, gVis));
+                }
+
+                alignas(16) float lanes[4];
+                _mm_store_ps(lanes, scales);
+                scale = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+                _mm_store_ps(lanes, biases);
+                bias = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            }
+#endif
+            integrate(hx.data(), hz.data(), begin, count, vx, vz, k, scale, bias);
+
+            out[x * 2] = glm::packHalf1x16(scale / static_cast<float>(count));
+            out[x * 2 + 1] = glm::packHalf1x16(bias / static_cast<float>(count));
+        }
+    }
+
+    bool isValid(const BRDFLutN::Settings& settings)
+    {
+        return settings.size > 0 && settings.size <= MAX_SIZE && settings.samples > 0;
+    }
+} // namespace
+
+BRDFLutN::Settings BRDFLutN::getSettings(const Quality quality)
+{
+    switch (quality)
+    {
+    case Quality::LOW:
+        return Settings{64, 256};
+    case Quality::HIGH:
+        return Settings{256, 2048};
+    case Quality::MEDIUM:
+    default:
+        return Settings{128, 512};
+    }
+}
+
+std::vector<std::uint16_t> BRDFLutN::generate(const Settings& settings, JobSystem* jobs, const bool simd)
+{
+    if (!isValid(settings))
+        return {};
+
+    // the Hammersley set is shared by every texel, only the lobe width changes per row
+    std::vector<float> cosPhi(settings.samples);
+    std::vector<float> xiY(settings.samples);
+    for (int i{0}; i < settings.samples; ++i)
+    {
+        cosPhi[i] = static_cast<float>(std::cos(2.0 * PI * i / settings.samples));
+        xiY[i] = radicalInverse(static_cast<std::uint32_t>(i));
+    }
+
+    std::vector<std::uint16_t> texels(static_cast<std::size_t>(settings.size) * settings.size * 2);
+    const auto func{[&](const std::size_t begin, const std::size_t end)
+    {
+        for (std::size_t row{begin}; row < end; ++row)
+        {
+            generateRow(settings, static_cast<int>(row), cosPhi, xiY, simd,
+                        &texels[row * static_cast<std::size_t>(settings.size) * 2]);
+        }
+    }};
+    if (jobs != nullptr)
+        jobs->parallelFor(static_cast<std::size_t>(settings.size), ROW_GRAIN, func);
+    else
+        func(0, static_cast<std::size_t>(settings.size));
+    return texels;
+}
+
+bool BRDFLutN::read(const std::string& path, const Settings& settings, std::vector<std::uint16_t>& texels)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file || !isValid(settings))
+        return false;
+
+    unsigned char header[HEADER_BYTES]{};
+    if (!file.read(reinterpret_cast<char*>(header), HEADER_BYTES) || std::memcmp(header, MAGIC, 4) != 0 ||
+        getU32(header + 4) != VERSION || getU32(header + 8) != static_cast<std::uint32_t>(settings.size) ||
+        getU32(header + 12) != static_cast<std::uint32_t>(settings.samples))
+        return false;
+
+    texels.resize(static_cast<std::size_t>(settings.size) * settings.size * 2);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(texels.data()),
+                                       static_cast<std::streamsize>(texels.size() * sizeof(std::uint16_t))));
+}
+
+bool BRDFLutN::write(const std::string& path, const Settings& settings, const std::vector<std::uint16_t>& texels)
+{
+    std::vector<unsigned char> header{MAGIC, MAGIC + 4};
+    putU32(header, VERSION);
+    putU32(header, static_cast<std::uint32_t>(settings.size));
+    putU32(header, static_cast<std::uint32_t>(settings.samples));
+
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+    file.write(reinterpret_cast<const char*>(texels.data()),
+               static_cast<std::streamsize>(texels.size() * sizeof(std::uint16_t)));
+    if (!file)
+    {
+        Util::beginError();
+        std::cout << "BRDF_LUT::WRITE::ERROR: Failed to write `" << path << "`";
+        Util::endError();
+        return false;
+    }
+    return true;
+}
+
+unsigned int BRDFLutN::load(const std::string& path, const Settings& settings, JobSystem* jobs)
+{
+    if (!isValid(settings))
+    {
+        Util::beginError();
+        std::cout << "BRDF_LUT::LOAD::ERROR: Invalid settings (" << settings.size << "x" << settings.size << ", "
+                  << settings.samples << " samples)";
+        Util::endError();
+        return 0;
+    }
+
+    std::vector<std::uint16_t> texels{};
+    if (!read(path, settings, texels))
+    {
+        const double startMs{BenchmarkN::nowMs()};
+        texels = generate(settings, jobs);
+        std::cout << "BRDF_LUT: Generated " << settings.size << 'x' << settings.size << " (" << settings.samples
+                  << " samples) in " << BenchmarkN::nowMs() - startMs << " ms\n";
+        write(path, settings, texels);
+    }
+
+    unsigned int texture{0};
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, settings.size, settings.size, 0, GL_RG, GL_HALF_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void BRDFLutN::benchmark(const Settings& settings, JobSystem* jobs, const int runs)
+{
+    Benchmark benchmark{"BRDF LUT " + std::to_string(settings.size) + "x" + std::to_string(settings.size) + ", " +
+                        std::to_string(settings.samples) + " samples"};
+    const auto addRuns{[&](const std::string& series, JobSystem* seriesJobs, const bool simd)
+    {
+        for (int run{0}; run < runs; ++run)
+        {
+            double ms{0.0};
+            {
+                BenchmarkN::ScopedTimer timer{ms};
+                generate(settings, seriesJobs, simd);
+            }
+            benchmark.addSample(series, BenchmarkN::Sample{ms, 0.0, 0});
+        }
+    }};
+    addRuns("scalar, 1 thread", nullptr, false);
+    addRuns("SSE, 1 thread", nullptr, true);
+    if (jobs != nullptr)
+        addRuns("SSE, " + std::to_string(jobs->getThreadCount() + 1) + " threads", jobs, true);
+    benchmark.report();
+}
@@ -0,0 +1,54 @@
+// Split-sum BRDF integration LUT.
+// For every (N.V, roughness) texel the GGX specular lobe is importance sampled and reduced to the scale & bias
+// applied to F0 (Karis, "Real Shading in Unreal Engine 4"). The LUT is generated on the cpu - rows are split across
+// the job system and 4 samples are evaluated at a time with SSE from per row tables, so the inner loop has no
+// transcendentals - stored as RG16F and cached in a small file, so only the first run (or a new setting) pays.
+
+#ifndef BRDF_LUT_H
+#define BRDF_LUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "jobs.hpp"
+
+namespace BRDFLutN
+{
+    // bump when the file layout or the integral changes
+    constexpr std::uint32_t VERSION{1};
+    // rows per job
+    constexpr std::size_t ROW_GRAIN{4};
+
+    enum class Quality
+    {
+        LOW,
+        MEDIUM,
+        HIGH,
+    };
+
+    struct Settings
+    {
+        int size{128};     // width & height
+        int samples{512};  // GGX samples per texel
+    };
+
+    [[nodiscard]] Settings getSettings(Quality quality);
+
+    // size * size RG halves, N.V along x and roughness along y (bottom row first), like `texture(brdfLUT, uv)` reads
+    // them. jobs can be nullptr, everything runs on the calling thread then
+    std::vector<std::uint16_t> generate(const Settings& settings, JobSystem* jobs = nullptr, bool simd = true);
+
+    // false if the file is missing, damaged or holds other settings
+    bool read(const std::string& path, const Settings& settings, std::vector<std::uint16_t>& texels);
+    bool write(const std::string& path, const Settings& settings, const std::vector<std::uint16_t>& texels);
+
+    // GL_TEXTURE_2D with the cached LUT, generated (and cached) first if needed
+    unsigned int load(const std::string& path, const Settings& settings, JobSystem* jobs = nullptr);
+
+    // print generation times of the scalar & SSE paths on one thread and of the SSE path on every worker
+    void benchmark(const Settings& settings, JobSystem* jobs, int runs = 3);
+} // namespace BRDFLutN
+
+#endif
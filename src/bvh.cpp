@@ -0,0 +1,536 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace
+{
+    float surfaceArea(const CullingN::AABB& box)
+    {
+        const glm::vec3 d{box.max - box.min};
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    bool contains(const CullingN::AABB& outer, const CullingN::AABB& inner)
+    {
+        return glm::all(glm::lessThanEqual(outer.min, inner.min)) &&
+            glm::all(glm::greaterThanEqual(outer.max, inner.max));
+    }
+
+    bool overlaps(const CullingN::AABB& a, const CullingN::AABB& b)
+    {
+        return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::greaterThanEqual(a.max, b.min));
+    }
+
+    // squared distance from point to box (0 if inside)
+    float distance2(const CullingN::AABB& box, const glm::vec3& point)
+    {
+        const glm::vec3 d{glm::max(glm::max(box.min - point, point - box.max), glm::vec3{0.0f})};
+        return glm::dot(d, d);
+    }
+} // namespace
+
+bool BVHN::intersectRayAABB(const Ray& ray, const CullingN::AABB& box, const float maxDistance, float& tMin)
+{
+    tMin = 0.0f;
+    float tMax{maxDistance};
+    for (int i{0}; i < 3; ++i)
+    {
+        if (std::abs(ray.direction[i]) < 1e-8f)
+        {
+            // parallel to slab
+            if (ray.origin[i] < box.min[i] || ray.origin[i] > box.max[i])
+                return false;
+            continue;
+        }
+        const float invD{1.0f / ray.direction[i]};
+        float t0{(box.min[i] - ray.origin[i]) * invD};
+        float t1{(box.max[i] - ray.origin[i]) * invD};
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax)
+            return false;
+    }
+    return true;
+}
+
+DynamicBVH::DynamicBVH()
+{
+    m_nodes.reserve(64);
+    m_stack.reserve(64);
+}
+
+int DynamicBVH::allocateNode()
+{
+    if (m_freeList == BVHN::NULL_NODE)
+    {
+        m_nodes.emplace_back();
+        m_nodes.back().height = 0;
+        return static_cast<int>(m_nodes.size() - 1);
+    }
+
+    // pop from free list
+    const int node{m_freeList};
+    m_freeList = m_nodes[node].parent;
+    m_nodes[node] = BVHN::Node{};
+    m_nodes[node].height = 0;
+    return node;
+}
+
+void DynamicBVH::freeNode(const int node)
+{
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+void DynamicBVH::clear()
+{
+    m_nodes.clear();
+    m_root = BVHN::NULL_NODE;
+    m_freeList = BVHN::NULL_NODE;
+    m_proxyCount = 0;
+}
+
+int DynamicBVH::insert(const CullingN::AABB& box, const unsigned int userData)
+{
+    const int proxy{allocateNode()};
+
+    const glm::vec3 margin{BVHN::AABB_MARGIN};
+    m_nodes[proxy].box = box;
+    m_nodes[proxy].fatBox = CullingN::AABB{box.min - margin, box.max + margin};
+    m_nodes[proxy].userData = userData;
+    m_nodes[proxy].height = 0;
+
+    insertLeaf(proxy);
+    ++m_proxyCount;
+    return proxy;
+}
+
+void DynamicBVH::remove(const int proxy)
+{
+    assert(proxy >= 0 && proxy < static_cast<int>(m_nodes.size()));
+    assert(m_nodes[proxy].isLeaf());
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+    --m_proxyCount;
+}
+
+bool DynamicBVH::move(const int proxy, const CullingN::AABB& box, const glm::vec3& displacement)
+{
+    assert(proxy >= 0 && proxy < static_cast<int>(m_nodes.size()));
+    assert(m_nodes[proxy].isLeaf());
+
+    m_nodes[proxy].box = box;
+
+    // still inside the fat box, nothing to do
+    if (contains(m_nodes[proxy].fatBox, box))
+        return false;
+
+    removeLeaf(proxy);
+
+    // fatten and extend in the direction of motion
+    const glm::vec3 margin{BVHN::AABB_MARGIN};
+    CullingN::AABB fatBox{box.min - margin, box.max + margin};
+    const glm::vec3 d{displacement * BVHN::DISPLACEMENT_MULTIPLIER};
+    fatBox.min += glm::min(d, glm::vec3{0.0f});
+    fatBox.max += glm::max(d, glm::vec3{0.0f});
+    m_nodes[proxy].fatBox = fatBox;
+
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicBVH::insertLeaf(const int leaf)
+{
+    if (m_root == BVHN::NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = BVHN::NULL_NODE;
+        return;
+    }
+
+    // find the best sibling with the surface area heuristic
+    const CullingN::AABB leafBox{m_nodes[leaf].fatBox};
+    int index{m_root};
+    while (!m_nodes[index].isLeaf())
+    {
+        const int child1{m_nodes[index].child1};
+        const int child2{m_nodes[index].child2};
+
+        const float area{surfaceArea(m_nodes[index].fatBox)};
+        const float combinedArea{surfaceArea(CullingN::mergeAABB(m_nodes[index].fatBox, leafBox))};
+
+        // cost of creating a new parent for this node and the new leaf
+        const float cost{2.0f * combinedArea};
+        // minimum cost of pushing the leaf further down the tree
+        const float inheritanceCost{2.0f * (combinedArea - area)};
+
+        auto descendCost{[&](const int child)
+        {
+            const float childArea{surfaceArea(CullingN::mergeAABB(leafBox, m_nodes[child].fatBox))};
+            if (m_nodes[child].isLeaf())
+                return childArea + inheritanceCost;
+            return childArea - surfaceArea(m_nodes[child].fatBox) + inheritanceCost;
+        }};
+
+        const float cost1{descendCost(child1)};
+        const float cost2{descendCost(child2)};
+
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = cost1 < cost2 ? child1 : child2;
+    }
+
+    const int sibling{index};
+
+    // create a new parent
+    const int oldParent{m_nodes[sibling].parent};
+    const int newParent{allocateNode()};
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].fatBox = CullingN::mergeAABB(leafBox, m_nodes[sibling].fatBox);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent != BVHN::NULL_NODE)
+    {
+        if (m_nodes[oldParent].child1 == sibling)
+            m_nodes[oldParent].child1 = newParent;
+        else
+            m_nodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    fixUpwards(m_nodes[leaf].parent);
+}
+
+void DynamicBVH::removeLeaf(const int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = BVHN::NULL_NODE;
+        return;
+    }
+
+    const int parent{m_nodes[leaf].parent};
+    const int grandParent{m_nodes[parent].parent};
+    const int sibling{m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1};
+
+    if (grandParent != BVHN::NULL_NODE)
+    {
+        // connect sibling to grand parent and drop the parent
+        if (m_nodes[grandParent].child1 == parent)
+            m_nodes[grandParent].child1 = sibling;
+        else
+            m_nodes[grandParent].child2 = sibling;
+        m_nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        fixUpwards(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = BVHN::NULL_NODE;
+        freeNode(parent);
+    }
+}
+
+void DynamicBVH::fixUpwards(int index)
+{
+    while (index != BVHN::NULL_NODE)
+    {
+        index = balance(index);
+
+        const int child1{m_nodes[index].child1};
+        const int child2{m_nodes[index].child2};
+
+        m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+        m_nodes[index].fatBox = CullingN::mergeAABB(m_nodes[child1].fatBox, m_nodes[child2].fatBox);
+
+        index = m_nodes[index].parent;
+    }
+}
+
+// rotate the taller child of a up if a is unbalanced
+// a has children b & c, c has children f & g (mirrored when b is taller)
+int DynamicBVH::balance(const int iA)
+{
+    BVHN::Node& a{m_nodes[iA]};
+    if (a.isLeaf() || a.height < 2)
+        return iA;
+
+    const int iB{a.child1};
+    const int iC{a.child2};
+    BVHN::Node& b{m_nodes[iB]};
+    BVHN::Node& c{m_nodes[iC]};
+
+    const int balanceFactor{c.height - b.height};
+
+    // rotate c up
+    if (balanceFactor > 1)
+    {
+        const int iF{c.child1};
+        const int iG{c.child2};
+        BVHN::Node& f{m_nodes[iF]};
+        BVHN::Node& g{m_nodes[iG]};
+
+        // swap a and c
+        c.child1 = iA;
+        c.parent = a.parent;
+        a.parent = iC;
+
+        if (c.parent != BVHN::NULL_NODE)
+        {
+            if (m_nodes[c.parent].child1 == iA)
+                m_nodes[c.parent].child1 = iC;
+            else
+                m_nodes[c.parent].child2 = iC;
+        }
+        else
+        {
+            m_root = iC;
+        }
+
+        // keep the taller of f and g under c
+        if (f.height > g.height)
+        {
+            c.child2 = iF;
+            a.child2 = iG;
+            g.parent = iA;
+            a.fatBox = CullingN::mergeAABB(b.fatBox, g.fatBox);
+            c.fatBox = CullingN::mergeAABB(a.fatBox, f.fatBox);
+            a.height = 1 + std::max(b.height, g.height);
+            c.height = 1 + std::max(a.height, f.height);
+        }
+        else
+        {
+            c.child2 = iG;
+            a.child2 = iF;
+            f.parent = iA;
+            a.fatBox = CullingN::mergeAABB(b.fatBox, f.fatBox);
+            c.fatBox = CullingN::mergeAABB(a.fatBox, g.fatBox);
+            a.height = 1 + std::max(b.height, f.height);
+            c.height = 1 + std::max(a.height, g.height);
+        }
+
+        return iC;
+    }
+
+    // rotate b up
+    if (balanceFactor < -1)
+    {
+        const int iD{b.child1};
+        const int iE{b.child2};
+        BVHN::Node& d{m_nodes[iD]};
+        BVHN::Node& e{m_nodes[iE]};
+
+        // swap a and b
+        b.child1 = iA;
+        b.parent = a.parent;
+        a.parent = iB;
+
+        if (b.parent != BVHN::NULL_NODE)
+        {
+            if (m_nodes[b.parent].child1 == iA)
+                m_nodes[b.parent].child1 = iB;
+            else
+                m_nodes[b.parent].child2 = iB;
+        }
+        else
+        {
+            m_root = iB;
+        }
+
+        if (d.height > e.height)
+        {
+            b.child2 = iD;
+            a.child1 = iE;
+            e.parent = iA;
+            a.fatBox = CullingN::mergeAABB(c.fatBox, e.fatBox);
+            b.fatBox = CullingN::mergeAABB(a.fatBox, d.fatBox);
+            a.height = 1 + std::max(c.height, e.height);
+            b.height = 1 + std::max(a.height, d.height);
+        }
+        else
+        {
+            b.child2 = iE;
+            a.child1 = iD;
+            d.parent = iA;
+            a.fatBox = CullingN::mergeAABB(c.fatBox, d.fatBox);
+            b.fatBox = CullingN::mergeAABB(a.fatBox, e.fatBox);
+            a.height = 1 + std::max(c.height, d.height);
+            b.height = 1 + std::max(a.height, e.height);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
+
+void DynamicBVH::queryFrustum(const CullingN::Frustum& frustum, std::vector<unsigned int>& out) const
+{
+    if (m_root == BVHN::NULL_NODE)
+        return;
+
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty())
+    {
+        const int index{m_stack.back()};
+        m_stack.pop_back();
+
+        const BVHN::Node& node{m_nodes[index]};
+        if (node.isLeaf())
+        {
+            if (CullingN::aabbInFrustum(frustum, node.box))
+                out.push_back(node.userData);
+            continue;
+        }
+        if (!CullingN::aabbInFrustum(frustum, node.fatBox))
+            continue;
+
+        m_stack.push_back(node.child1);
+        m_stack.push_back(node.child2);
+    }
+}
+
+void DynamicBVH::queryAABB(const CullingN::AABB& box, std::vector<unsigned int>& out) const
+{
+    if (m_root == BVHN::NULL_NODE)
+        return;
+
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty())
+    {
+        const int index{m_stack.back()};
+        m_stack.pop_back();
+
+        const BVHN::Node& node{m_nodes[index]};
+        if (node.isLeaf())
+        {
+            if (overlaps(node.box, box))
+                out.push_back(node.userData);
+            continue;
+        }
+        if (!overlaps(node.fatBox, box))
+            continue;
+
+        m_stack.push_back(node.child1);
+        m_stack.push_back(node.child2);
+    }
+}
+
+void DynamicBVH::querySphere(const CullingN::Sphere& sphere, std::vector<unsigned int>& out) const
+{
+    if (m_root == BVHN::NULL_NODE)
+        return;
+
+    const float radius2{sphere.radius * sphere.radius};
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty())
+    {
+        const int index{m_stack.back()};
+        m_stack.pop_back();
+
+        const BVHN::Node& node{m_nodes[index]};
+        if (node.isLeaf())
+        {
+            if (distance2(node.box, sphere.center) <= radius2)
+                out.push_back(node.userData);
+            continue;
+        }
+        if (distance2(node.fatBox, sphere.center) > radius2)
+            continue;
+
+        m_stack.push_back(node.child1);
+        m_stack.push_back(node.child2);
+    }
+}
+
+bool DynamicBVH::raycast(const BVHN::Ray& ray, const float maxDistance, BVHN::RayHit& hit) const
+{
+    if (m_root == BVHN::NULL_NODE)
+        return false;
+
+    float closest{maxDistance};
+    bool found{false};
+
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty())
+    {
+        const int index{m_stack.back()};
+        m_stack.pop_back();
+
+        const BVHN::Node& node{m_nodes[index]};
+        float t;
+        if (node.isLeaf())
+        {
+            if (BVHN::intersectRayAABB(ray, node.box, closest, t))
+            {
+                closest = t;
+                hit = BVHN::RayHit{node.userData, index, t};
+                found = true;
+            }
+            continue;
+        }
+        // prune against the closest hit so far
+        if (!BVHN::intersectRayAABB(ray, node.fatBox, closest, t))
+            continue;
+
+        m_stack.push_back(node.child1);
+        m_stack.push_back(node.child2);
+    }
+
+    return found;
+}
+
+void DynamicBVH::queryNearest(const glm::vec3& point, const unsigned int k, std::vector<unsigned int>& out) const
+{
+    if (m_root == BVHN::NULL_NODE || k == 0)
+        return;
+
+    // best first traversal: pop the node with the closest box, leaves come out in distance order
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue{};
+    queue.emplace(distance2(m_nodes[m_root].fatBox, point), m_root);
+
+    unsigned int found{0};
+    while (!queue.empty() && found < k)
+    {
+        const int index{queue.top().second};
+        queue.pop();
+
+        const BVHN::Node& node{m_nodes[index]};
+        if (node.isLeaf())
+        {
+            // leaves were queued with their tight distance
+            out.push_back(node.userData);
+            ++found;
+            continue;
+        }
+
+        for (const int child : {node.child1, node.child2})
+        {
+            const BVHN::Node& childNode{m_nodes[child]};
+            queue.emplace(distance2(childNode.isLeaf() ? childNode.box : childNode.fatBox, point), child);
+        }
+    }
+}
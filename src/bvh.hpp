@@ -0,0 +1,110 @@
+// Dynamic AABB tree for spatial queries over scene instances.
+// Leaves store a fattened box so small movements don't touch the tree, the tree is kept balanced with rotations.
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "culling.hpp"
+
+namespace BVHN
+{
+    constexpr int NULL_NODE{-1};
+    // how much leaf boxes are fattened (world units)
+    constexpr float AABB_MARGIN{0.1f};
+    // displacement prediction multiplier for moving proxies
+    constexpr float DISPLACEMENT_MULTIPLIER{2.0f};
+
+    struct Ray
+    {
+        glm::vec3 origin{0.0f};
+        glm::vec3 direction{0.0f, 0.0f, -1.0f}; // normalized
+    };
+
+    struct RayHit
+    {
+        unsigned int userData{0};
+        int proxy{NULL_NODE};
+        float distance{0.0f};
+    };
+
+    struct Node
+    {
+        CullingN::AABB fatBox{}; // used for traversal
+        CullingN::AABB box{}; // tight box, leaves only
+
+        unsigned int userData{0};
+
+        // parent for nodes in the tree, next for nodes in the free list
+        int parent{NULL_NODE};
+        int child1{NULL_NODE};
+        int child2{NULL_NODE};
+
+        // leaf = 0, free node = -1
+        int height{-1};
+
+        [[nodiscard]] bool isLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    // slab test, returns entry distance in tMin (0 if origin is inside)
+    [[nodiscard]] bool intersectRayAABB(const Ray& ray, const CullingN::AABB& box, float maxDistance, float& tMin);
+} // namespace BVHN
+
+class DynamicBVH
+{
+public:
+    DynamicBVH();
+
+    // add a proxy, returns proxy id
+    int insert(const CullingN::AABB& box, unsigned int userData);
+    // remove a proxy
+    void remove(int proxy);
+    // update a proxy's bounds, only reinserts if the box left its fat box
+    // returns true if the tree changed
+    bool move(int proxy, const CullingN::AABB& box, const glm::vec3& displacement = glm::vec3{0.0f});
+
+    void clear();
+
+    // queries append the userData of every overlapping proxy to out
+    void queryFrustum(const CullingN::Frustum& frustum, std::vector<unsigned int>& out) const;
+    void queryAABB(const CullingN::AABB& box, std::vector<unsigned int>& out) const;
+    void querySphere(const CullingN::Sphere& sphere, std::vector<unsigned int>& out) const;
+
+    // closest proxy hit by ray within maxDistance
+    bool raycast(const BVHN::Ray& ray, float maxDistance, BVHN::RayHit& hit) const;
+
+    // k closest proxies to point (by distance to their box), sorted nearest first
+    void queryNearest(const glm::vec3& point, unsigned int k, std::vector<unsigned int>& out) const;
+
+    [[nodiscard]] unsigned int getUserData(const int proxy) const { return m_nodes[proxy].userData; }
+    [[nodiscard]] const CullingN::AABB& getAABB(const int proxy) const { return m_nodes[proxy].box; }
+    [[nodiscard]] const CullingN::AABB& getFatAABB(const int proxy) const { return m_nodes[proxy].fatBox; }
+
+    [[nodiscard]] int getHeight() const { return m_root == BVHN::NULL_NODE ? 0 : m_nodes[m_root].height; }
+    [[nodiscard]] unsigned int getProxyCount() const { return m_proxyCount; }
+
+private:
+    std::vector<BVHN::Node> m_nodes{};
+    int m_root{BVHN::NULL_NODE};
+    int m_freeList{BVHN::NULL_NODE};
+    unsigned int m_proxyCount{0};
+
+    // scratch traversal stack (queries are const but reuse the allocation)
+    mutable std::vector<int> m_stack{};
+
+    int allocateNode();
+    void freeNode(int node);
+
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+
+    // AVL style rotation, returns new root of the subtree
+    int balance(int node);
+    // walk up from node refitting boxes and rebalancing
+    void fixUpwards(int node);
+};
+
+#endif
@@ -6,6 +6,7 @@
 #define CAMERA_H
 
 #include <glad/glad.h>
+#include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/glm.hpp>
 
@@ -27,6 +28,8 @@ namespace CameraN
     constexpr float SPEED{15.f};
     constexpr float SENSITIVITY{0.05f};
     constexpr float ZOOM{45.0f};
+    constexpr float NEAR_PLANE{0.1f};
+    constexpr float FAR_PLANE{100000.0f};
 } // namespace CameraN
 
 class Camera final : public EngineObject
@@ -48,6 +51,25 @@ public:
 
     [[nodiscard]] glm::mat4 getViewMatrix() const { return glm::lookAt(m_position, m_position + m_front, m_up); }
 
+    [[nodiscard]] glm::mat4 getProjectionMatrix(const float aspect) const
+    {
+        return glm::perspective(glm::radians(m_zoom), aspect, CameraN::NEAR_PLANE, CameraN::FAR_PLANE);
+    }
+
+    // the projection moved by the jitter, what the scene is rasterized with
+    [[nodiscard]] glm::mat4 getJitteredProjectionMatrix(const float aspect) const
+    {
+        glm::mat4 projection{getProjectionMatrix(aspect)};
+        // x & y of the third column get divided by w = -z, so they shift the whole image in ndc
+        projection[2][0] -= m_jitter.x;
+        projection[2][1] -= m_jitter.y;
+        return projection;
+    }
+
+    // sub-pixel offset of the projection in ndc, set every frame by temporal anti-aliasing
+    void setJitter(const glm::vec2& jitter) { m_jitter = jitter; }
+    [[nodiscard]] glm::vec2 getJitter() const { return m_jitter; }
+
     void processInput(const CameraN::CameraMotion direction, const float deltaTime)
     {
         const float velocity{m_movementSpeed * deltaTime};
@@ -140,6 +162,8 @@ private:
     float m_mouseSensitivity;
     float m_zoom;
 
+    glm::vec2 m_jitter{0.0f};
+
     void updateCameraVectors()
     {
         glm::vec3 front;
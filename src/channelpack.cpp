@@ -0,0 +1,205 @@
+#include "channelpack.hpp"
+
+#include <STB/stb_image.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "bcn.hpp"
+#include "mesh.hpp"
+#include "mipgen.hpp"
+#include "texturecontainer.hpp"
+#include "util.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CHANNEL_PACK_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    struct Image
+    {
+        std::vector<unsigned char> rgba{};
+        int width{0};
+        int height{0};
+    };
+
+    void packRange(const std::array<ChannelPackN::Input, 4>& inputs, std::size_t begin, const std::size_t end,
+                   unsigned char* out)
+    {
+#ifdef CHANNEL_PACK_SSE
+        // channels without an image are constant
+        std::uint32_t fill{0};
+        for (int c{0}; c < 4; ++c)
+        {
+            if (inputs[c].rgba == nullptr)
+                fill |= static_cast<std::uint32_t>(inputs[c].fill) << (c * 8);
+        }
+        const __m128i fillTexels{_mm_set1_epi32(static_cast<int>(fill))};
+        const __m128i mask{_mm_set1_epi32(0xff)};
+        __m128i readShifts[4]{};
+        __m128i writeShifts[4]{};
+        for (int c{0}; c < 4; ++c)
+        {
+            readShifts[c] = _mm_cvtsi32_si128(inputs[c].channel * 8);
+            writeShifts[c] = _mm_cvtsi32_si128(c * 8);
+        }
+
+        for (; begin + 4 <= end; begin += 4)
+        {
+            __m128i texels{fillTexels};
+            for (int c{0}; c < 4; ++c)
+            {
+                if (inputs[c].rgba == nullptr)
+                    continue;
+                __m128i source{_mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[c].rgba + begin * 4))};
+                source = _mm_and_si128(_mm_srl_epi32(source, readShifts[c]), mask);
+                texels = _mm_or_si128(texels, _mm_sll_epi32(source, writeShifts[c]));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + begin * 4), texels);
+        }
+#endif
+        for (; begin < end; ++begin)
+        {
+            for (int c{0}; c < 4; ++c)
+            {
+                const ChannelPackN::Input& input{inputs[c]};
+                out[begin * 4 + c] = input.rgba != nullptr ? input.rgba[begin * 4 + input.channel] : input.fill;
+            }
+        }
+    }
+
+    // nearest texel, so packed channels keep their exact values
+    std::vector<unsigned char> resample(const Image& image, const int width, const int height)
+    {
+        std::vector<unsigned char> result(static_cast<std::size_t>(width) * height * 4);
+        for (int y{0}; y < height; ++y)
+        {
+            const int sourceY{static_cast<int>((static_cast<long long>(y) * 2 + 1) * image.height / (height * 2))};
+            for (int x{0}; x < width; ++x)
+            {
+                const int sourceX{static_cast<int>((static_cast<long long>(x) * 2 + 1) * image.width / (width * 2))};
+                const std::size_t source{static_cast<std::size_t>(sourceY) * image.width + sourceX};
+                const unsigned char* texel{&image.rgba[source * 4]};
+                std::copy(texel, texel + 4, &result[(static_cast<std::size_t>(y) * width + x) * 4]);
+            }
+        }
+        return result;
+    }
+} // namespace
+
+void ChannelPackN::pack(const std::array<Input, 4>& inputs, const std::size_t texelCount, unsigned char* out,
+                        JobSystem* jobs)
+{
+    if (jobs == nullptr)
+    {
+        packRange(inputs, 0, texelCount, out);
+        return;
+    }
+    jobs->parallelFor(texelCount, TEXEL_GRAIN,
+                      [&](const std::size_t begin, const std::size_t end) { packRange(inputs, begin, end, out); });
+}
+
+bool ChannelPackN::packORM(const Source& occlusion, const Source& roughness, const Source& metallic,
+                           std::vector<unsigned char>& rgba, int& width, int& height, JobSystem* jobs)
+{
+    const Source* sources[3]{&occlusion, &roughness, &metallic};
+
+    // maps often share a file, every file is decoded once
+    std::map<std::string, Image> images{};
+    for (const Source* source : sources)
+    {
+        if (source->path.empty() || images.count(source->path) != 0)
+            continue;
+
+        Image& image{images[source->path]};
+        // same orientation as TextureN::loadFromFile / loadFromMemory
+        int numChannels{0};
+        unsigned char* data{nullptr};
+        if (source->data != nullptr)
+        {
+            stbi_set_flip_vertically_on_load(false);
+            data = stbi_load_from_memory(source->data, static_cast<int>(source->size), &image.width, &image.height,
+                                         &numChannels, 4);
+        }
+        else
+        {
+            stbi_set_flip_vertically_on_load(true);
+            data = stbi_load(source->path.c_str(), &image.width, &image.height, &numChannels, 4);
+        }
+        if (!data)
+        {
+            Util::beginError();
+            std::cout << "CHANNEL_PACK::PACK_ORM::ERROR: Failed to load image `" << source->path << "`";
+            Util::endError();
+            return false;
+        }
+        image.rgba.assign(data, data + static_cast<std::size_t>(image.width) * image.height * 4);
+        stbi_image_free(data);
+    }
+    if (images.empty())
+        return false;
+
+    width = 0;
+    height = 0;
+    for (const auto& [path, image] : images)
+    {
+        if (static_cast<long long>(image.width) * image.height > static_cast<long long>(width) * height)
+        {
+            width = image.width;
+            height = image.height;
+        }
+    }
+    for (auto& [path, image] : images)
+    {
+        if (image.width == width && image.height == height)
+            continue;
+        image.rgba = resample(image, width, height);
+        image.width = width;
+        image.height = height;
+    }
+
+    std::array<Input, 4> inputs{};
+    for (int c{0}; c < 3; ++c)
+    {
+        if (!sources[c]->path.empty())
+            inputs[c] = Input{images.at(sources[c]->path).rgba.data(), std::clamp(sources[c]->channel, 0, 3)};
+    }
+    rgba.resize(static_cast<std::size_t>(width) * height * 4);
+    pack(inputs, static_cast<std::size_t>(width) * height, rgba.data(), jobs);
+    return true;
+}
+
+bool ChannelPackN::bakeORM(const Source& occlusion, const Source& roughness, const Source& metallic,
+                           const std::string& outPath, JobSystem* jobs)
+{
+    std::vector<unsigned char> level{};
+    int width{0};
+    int height{0};
+    if (!packORM(occlusion, roughness, metallic, level, width, height, jobs))
+        return false;
+
+    TextureContainerN::Image image{BCnN::chooseFormat(MeshN::TEXTURE_ORM, false), width, height};
+    const std::vector<std::vector<unsigned char>> levels{MipGenN::generate(
+        level.data(), width, height, MipGenN::getOptions(MeshN::TEXTURE_ORM, level.data(), width, height), jobs)};
+    std::size_t compressedBytes{0};
+    for (std::size_t i{0}; i < levels.size(); ++i)
+    {
+        const int levelWidth{std::max(1, width >> i)};
+        const int levelHeight{std::max(1, height >> i)};
+        image.levels.push_back(BCnN::encode(levels[i].data(), levelWidth, levelHeight, image.format, jobs));
+        compressedBytes += image.levels.back().size();
+    }
+
+    if (!TextureContainerN::writeKTX2(outPath, image))
+        return false;
+
+    std::cout << "CHANNEL_PACK::BAKE_ORM: `" << outPath << "` (" << width << 'x' << height << ' '
+              << BCnN::getName(image.format) << ", " << image.levels.size() << " levels, " << compressedBytes / 1024
+              << " KB)\n";
+    return true;
+}
@@ -0,0 +1,54 @@
+// Channel packing.
+// Builds one RGBA image out of single channels of other images - separate occlusion, roughness & metallic maps
+// become an ORM map in the layout glTF uses (occlusion in red, roughness in green, metallic in blue), which is
+// loaded & sampled once instead of once per map. Texels are packed four at a time with SSE2 and split across the
+// job system. Baked ORM maps are written as BC7 .ktx2 files with cpu filtered mips, every texture loader picks
+// those up directly. Without BC7 (and for maps embedded in a model) the packed image is uploaded as RGBA8 instead.
+
+#ifndef CHANNEL_PACK_H
+#define CHANNEL_PACK_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "jobs.hpp"
+
+namespace ChannelPackN
+{
+    // texels per job
+    constexpr std::size_t TEXEL_GRAIN{1 << 16};
+
+    // where an output channel comes from
+    struct Input
+    {
+        const unsigned char* rgba{nullptr}; // nullptr fills the channel with fill
+        int channel{0};
+        unsigned char fill{255};
+    };
+
+    // out[i].c = inputs[c].rgba[i].channel, all images RGBA8 with texelCount texels
+    void pack(const std::array<Input, 4>& inputs, std::size_t texelCount, unsigned char* out,
+              JobSystem* jobs = nullptr);
+
+    // image file & channel, an empty path leaves the channel white (the material factor alone decides)
+    struct Source
+    {
+        std::string path{};
+        int channel{0};
+        // encoded image in memory (embedded textures) read instead of the file, path only tells sources apart
+        const unsigned char* data{nullptr};
+        std::size_t size{0};
+    };
+
+    // pack separate maps into one RGBA8 ORM image, images of different sizes are point sampled to the largest one
+    // files are flipped like TextureN::loadFromFile, images in memory are kept like TextureN::loadFromMemory
+    bool packORM(const Source& occlusion, const Source& roughness, const Source& metallic,
+                 std::vector<unsigned char>& rgba, int& width, int& height, JobSystem* jobs = nullptr);
+    // packORM() and write the result with mips to outPath (BC7 .ktx2)
+    bool bakeORM(const Source& occlusion, const Source& roughness, const Source& metallic, const std::string& outPath,
+                 JobSystem* jobs = nullptr);
+} // namespace ChannelPackN
+
+#endif
@@ -0,0 +1,336 @@
+#include "clusteredlighting.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include <glm/gtc/constants.hpp>
+
+#include "camera.hpp"
+#include "util.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CLUSTERED_LIGHTING_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // exponential slices: every slice is the same factor deeper than the previous one
+    float getSliceDepth(const int slice)
+    {
+        if (slice >= ClusteredLightingN::CLUSTER_Z)
+            return CameraN::FAR_PLANE;
+        return CameraN::NEAR_PLANE *
+            std::pow(ClusteredLightingN::SLICE_FAR / CameraN::NEAR_PLANE,
+                     static_cast<float>(slice) / static_cast<float>(ClusteredLightingN::CLUSTER_Z));
+    }
+
+    int getSlice(const float depth)
+    {
+        if (depth <= CameraN::NEAR_PLANE)
+            return 0;
+        const float slice{std::log(depth / CameraN::NEAR_PLANE) /
+                          std::log(ClusteredLightingN::SLICE_FAR / CameraN::NEAR_PLANE) *
+                          static_cast<float>(ClusteredLightingN::CLUSTER_Z)};
+        return std::min(static_cast<int>(slice), ClusteredLightingN::CLUSTER_Z - 1);
+    }
+} // namespace
+
+// Wronski's bounding sphere of a cone: wide cones are centered on the cap, narrow ones are circumscribed
+CullingN::Sphere ClusteredLightingN::getBounds(const Light& light)
+{
+    if (light.type == LightType::POINT)
+        return CullingN::Sphere{light.position, light.range};
+
+    const float angle{std::min(light.outerAngle, glm::pi<float>() * 0.5f)};
+    const float cosAngle{std::cos(angle)};
+    const glm::vec3 direction{glm::normalize(light.direction)};
+    if (angle > glm::pi<float>() * 0.25f)
+        return CullingN::Sphere{light.position + direction * (light.range * cosAngle), light.range * std::sin(angle)};
+
+    const float radius{light.range / (2.0f * cosAngle)};
+    return CullingN::Sphere{light.position + direction * radius, radius};
+}
+
+int ClusteredLightingN::testSphere(const ClusterBounds4& bounds, const CullingN::Sphere& sphere)
+{
+#ifdef CLUSTERED_LIGHTING_SSE
+    // squared distance from the center to each box, per axis max(min - c, 0) + max(c - max, 0)
+    const __m128 zero{_mm_setzero_ps()};
+    const __m128 x{_mm_set1_ps(sphere.center.x)};
+    const __m128 y{_mm_set1_ps(sphere.center.y)};
+    const __m128 z{_mm_set1_ps(sphere.center.z)};
+    const __m128 dx{_mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(bounds.minX.data()), x), zero),
+                               _mm_max_ps(_mm_sub_ps(x, _mm_loadu_ps(bounds.maxX.data())), zero))};
+    const __m128 dy{_mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(bounds.minY.data()), y), zero),
+                               _mm_max_ps(_mm_sub_ps(y, _mm_loadu_ps(bounds.maxY.data())), zero))};
+    const __m128 dz{_mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(bounds.minZ.data()), z), zero),
+                               _mm_max_ps(_mm_sub_ps(z, _mm_loadu_ps(bounds.maxZ.data())), zero))};
+    const __m128 distance{_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz))};
+    return _mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(sphere.radius * sphere.radius)));
+#else
+    int mask{0};
+    for (int lane{0}; lane < 4; ++lane)
+    {
+        const glm::vec3 boxMin{bounds.minX[lane], bounds.minY[lane], bounds.minZ[lane]};
+        const glm::vec3 boxMax{bounds.maxX[lane], bounds.maxY[lane], bounds.maxZ[lane]};
+        const glm::vec3 closest{glm::clamp(sphere.center, boxMin, boxMax)};
+        const glm::vec3 offset{sphere.center - closest};
+        if (glm::dot(offset, offset) <= sphere.radius * sphere.radius)
+            mask |= 1 << lane;
+    }
+    return mask;
+#endif
+}
+
+ClusteredLighting::ClusteredLighting(EngineObject* parent) : EngineObject{"ClusteredLighting", parent}
+{
+    m_clusterLights.resize(ClusteredLightingN::CLUSTER_COUNT);
+}
+
+ClusteredLighting::~ClusteredLighting() { free(); }
+
+void ClusteredLighting::free()
+{
+    glDeleteTextures(static_cast<GLsizei>(m_textures.size()), m_textures.data());
+    glDeleteBuffers(static_cast<GLsizei>(m_buffers.size()), m_buffers.data());
+    m_textures = {};
+    m_buffers = {};
+    m_clusterBounds.clear();
+    m_projection = glm::mat4{0.0f};
+}
+
+std::size_t ClusteredLighting::addLight(const ClusteredLightingN::Light& light)
+{
+    if (m_lights.size() >= ClusteredLightingN::MAX_LIGHTS)
+    {
+        Util::beginError();
+        std::cout << "CLUSTERED_LIGHTING::ADD_LIGHT::ERROR: Light limit of " << ClusteredLightingN::MAX_LIGHTS
+                  << " reached!";
+        Util::endError();
+        return ClusteredLightingN::MAX_LIGHTS;
+    }
+    m_lights.push_back(light);
+    return m_lights.size() - 1;
+}
+
+void ClusteredLighting::createBuffers()
+{
+    glGenBuffers(static_cast<GLsizei>(m_buffers.size()), m_buffers.data());
+    glGenTextures(static_cast<GLsizei>(m_textures.size()), m_textures.data());
+
+    constexpr std::array<GLenum, 3> formats{GL_RGBA32F, GL_RG32UI, GL_R16UI};
+    for (std::size_t i{0}; i < m_buffers.size(); ++i)
+    {
+        // the texture keeps pointing at the buffer when upload() respecifies its storage
+        glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], m_buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::buildClusterBounds(const glm::mat4& projection)
+{
+    using namespace ClusteredLightingN;
+
+    // rays through the tile corners, scaled to z = -1
+    const glm::mat4 inverseProjection{glm::inverse(projection)};
+    std::vector<glm::vec3> corners((CLUSTER_X + 1) * (CLUSTER_Y + 1));
+    for (int y{0}; y <= CLUSTER_Y; ++y)
+    {
+        for (int x{0}; x <= CLUSTER_X; ++x)
+        {
+            const glm::vec2 ndc{static_cast<float>(x) / CLUSTER_X * 2.0f - 1.0f,
+                                static_cast<float>(y) / CLUSTER_Y * 2.0f - 1.0f};
+            const glm::vec4 point{inverseProjection * glm::vec4{ndc, -1.0f, 1.0f}};
+            const glm::vec3 view{glm::vec3{point} / point.w};
+            corners[y * (CLUSTER_X + 1) + x] = view / -view.z;
+        }
+    }
+
+    m_clusterBounds.assign(CLUSTER_COUNT / 4, ClusterBounds4{});
+    for (int slice{0}; slice < CLUSTER_Z; ++slice)
+    {
+        const float nearDepth{getSliceDepth(slice)};
+        const float farDepth{getSliceDepth(slice + 1)};
+        for (int tile{0}; tile < SLICE_CLUSTERS; ++tile)
+        {
+            const int x{tile % CLUSTER_X};
+            const int y{tile / CLUSTER_X};
+            glm::vec3 boxMin{std::numeric_limits<float>::max()};
+            glm::vec3 boxMax{std::numeric_limits<float>::lowest()};
+            for (const int corner : {y * (CLUSTER_X + 1) + x, y * (CLUSTER_X + 1) + x + 1,
+                                     (y + 1) * (CLUSTER_X + 1) + x, (y + 1) * (CLUSTER_X + 1) + x + 1})
+            {
+                for (const float depth : {nearDepth, farDepth})
+                {
+                    boxMin = glm::min(boxMin, corners[corner] * depth);
+                    boxMax = glm::max(boxMax, corners[corner] * depth);
+                }
+            }
+
+            const int cluster{slice * SLICE_CLUSTERS + tile};
+            ClusterBounds4& bounds{m_clusterBounds[cluster / 4]};
+            const int lane{cluster % 4};
+            bounds.minX[lane] = boxMin.x;
+            bounds.minY[lane] = boxMin.y;
+            bounds.minZ[lane] = boxMin.z;
+            bounds.maxX[lane] = boxMax.x;
+            bounds.maxY[lane] = boxMax.y;
+            bounds.maxZ[lane] = boxMax.z;
+        }
+    }
+    m_projection = projection;
+}
+
+void ClusteredLighting::update(const glm::mat4& view, const glm::mat4& projection, JobSystem* jobs)
+{
+    using namespace ClusteredLightingN;
+
+    if (m_buffers[0] == 0)
+        createBuffers();
+    // the boxes only depend on the projection (fov, aspect)
+    if (projection != m_projection)
+        buildClusterBounds(projection);
+
+    m_worldBounds.clear();
+    for (const Light& light : m_lights)
+        m_worldBounds.push_back(getBounds(light));
+    m_visible.clear();
+    CullingN::cullSpheres(CullingN::extractFrustum(projection * view), m_worldBounds, m_visible);
+
+    // view space bounds & the slices each visible light spans (view space looks down -z)
+    m_viewBounds.clear();
+    m_sliceRanges.clear();
+    for (const unsigned int index : m_visible)
+    {
+        const CullingN::Sphere& bounds{m_worldBounds[index]};
+        const glm::vec3 center{view * glm::vec4{bounds.center, 1.0f}};
+        m_viewBounds.push_back(CullingN::Sphere{center, bounds.radius});
+        m_sliceRanges.push_back({getSlice(-center.z - bounds.radius), getSlice(-center.z + bounds.radius)});
+    }
+
+    if (jobs != nullptr)
+    {
+        jobs->parallelFor(CLUSTER_Z, 1,
+                          [this](const std::size_t begin, const std::size_t end)
+                          {
+                              for (std::size_t slice{begin}; slice < end; ++slice)
+                                  assignSlice(static_cast<int>(slice));
+                          });
+    }
+    else
+    {
+        for (int slice{0}; slice < CLUSTER_Z; ++slice)
+            assignSlice(slice);
+    }
+
+    upload();
+}
+
+void ClusteredLighting::assignSlice(const int slice)
+{
+    using namespace ClusteredLightingN;
+
+    const std::size_t firstCluster{static_cast<std::size_t>(slice) * SLICE_CLUSTERS};
+    for (std::size_t cluster{firstCluster}; cluster < firstCluster + SLICE_CLUSTERS; ++cluster)
+        m_clusterLights[cluster].clear();
+
+    for (std::size_t light{0}; light < m_viewBounds.size(); ++light)
+    {
+        if (slice < m_sliceRanges[light][0] || slice > m_sliceRanges[light][1])
+            continue;
+
+        for (std::size_t group{firstCluster / 4}; group < (firstCluster + SLICE_CLUSTERS) / 4; ++group)
+        {
+            const int mask{testSphere(m_clusterBounds[group], m_viewBounds[light])};
+            if (mask == 0)
+                continue;
+            for (int lane{0}; lane < 4; ++lane)
+            {
+                std::vector<std::uint16_t>& lights{m_clusterLights[group * 4 + lane]};
+                if ((mask & (1 << lane)) && lights.size() < MAX_CLUSTER_LIGHTS)
+                    lights.push_back(static_cast<std::uint16_t>(light));
+            }
+        }
+    }
+}
+
+void ClusteredLighting::upload()
+{
+    using namespace ClusteredLightingN;
+
+    // visible lights only, in the order the index lists refer to them
+    m_lightData.clear();
+    m_lightData.reserve(m_visible.size() * LIGHT_TEXELS * 4);
+    for (const unsigned int index : m_visible)
+    {
+        const Light& light{m_lights[index]};
+        // angular falloff is saturate(cos * scale + offset), points always get 1
+        float spotScale{0.0f};
+        float spotOffset{1.0f};
+        glm::vec3 direction{0.0f, -1.0f, 0.0f};
+        if (light.type == LightType::SPOT)
+        {
+            const float cosInner{std::cos(light.innerAngle)};
+            const float cosOuter{std::cos(light.outerAngle)};
+            spotScale = 1.0f / std::max(cosInner - cosOuter, 0.0001f);
+            spotOffset = -cosOuter * spotScale;
+            direction = glm::normalize(light.direction);
+        }
+        m_lightData.insert(m_lightData.end(), {light.position.x, light.position.y, light.position.z, light.range,
+                                               light.color.r, light.color.g, light.color.b, spotScale, direction.x,
+                                               direction.y, direction.z, spotOffset});
+    }
+
+    m_grid.clear();
+    m_indices.clear();
+    for (const std::vector<std::uint16_t>& lights : m_clusterLights)
+    {
+        m_grid.push_back(static_cast<unsigned int>(m_indices.size()));
+        m_grid.push_back(static_cast<unsigned int>(lights.size()));
+        m_indices.insert(m_indices.end(), lights.begin(), lights.end());
+    }
+
+    // new storage every frame so the driver doesn't wait for last frame's draws
+    const auto uploadBuffer{[](const unsigned int buffer, const std::size_t bytes, const void* data)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(std::max<std::size_t>(bytes, 16)), nullptr,
+                     GL_STREAM_DRAW);
+        if (bytes > 0)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(bytes), data);
+    }};
+    uploadBuffer(m_buffers[0], m_lightData.size() * sizeof(float), m_lightData.data());
+    uploadBuffer(m_buffers[1], m_grid.size() * sizeof(unsigned int), m_grid.data());
+    uploadBuffer(m_buffers[2], m_indices.size() * sizeof(std::uint16_t), m_indices.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::bind(const Shader* shader, const glm::ivec2 renderSize) const
+{
+    using namespace ClusteredLightingN;
+
+    // slice = log2(depth) * scale + bias, the inverse of getSliceDepth()
+    const float logRange{std::log2(SLICE_FAR / CameraN::NEAR_PLANE)};
+    shader->setInt("lightData", FIRST_UNIT);
+    shader->setInt("clusterGrid", FIRST_UNIT + 1);
+    shader->setInt("clusterIndices", FIRST_UNIT + 2);
+    shader->setBool("clusteredLights", m_buffers[0] != 0 && !m_visible.empty());
+    shader->setVec2("clusterTileScale", glm::vec2{CLUSTER_X, CLUSTER_Y} / glm::vec2{glm::max(renderSize, 1)});
+    shader->setFloat("clusterSliceScale", static_cast<float>(CLUSTER_Z) / logRange);
+    shader->setFloat("clusterSliceBias",
+                     -static_cast<float>(CLUSTER_Z) * std::log2(CameraN::NEAR_PLANE) / logRange);
+
+    for (std::size_t i{0}; i < m_textures.size(); ++i)
+    {
+        glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + FIRST_UNIT + i));
+        glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
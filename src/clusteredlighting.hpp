@@ -0,0 +1,136 @@
+// Clustered forward lighting for scenes with hundreds to thousands of point & spot lights.
+// The view frustum is split into CLUSTER_X x CLUSTER_Y screen tiles and CLUSTER_Z depth slices that get exponentially
+// deeper, so clusters near & far have similar proportions. Every frame the lights are frustum culled, each depth slice
+// goes to a worker that tests its candidate lights against 4 cluster boxes at a time (SSE) and the per cluster lists
+// are packed into one compact index list. Lights, cluster ranges & indices are uploaded to buffer textures (core
+// since GL 3.1, SSBOs would need 4.3), so a fragment only loops over the lights of its own cluster.
+
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "culling.hpp"
+#include "engine_types.hpp"
+#include "jobs.hpp"
+#include "shader.hpp"
+
+namespace ClusteredLightingN
+{
+    constexpr int CLUSTER_X{16};
+    constexpr int CLUSTER_Y{9};
+    constexpr int CLUSTER_Z{24};
+    constexpr int SLICE_CLUSTERS{CLUSTER_X * CLUSTER_Y};
+    constexpr int CLUSTER_COUNT{SLICE_CLUSTERS * CLUSTER_Z};
+    static_assert(SLICE_CLUSTERS % 4 == 0, "clusters are tested 4 at a time");
+
+    // the slices cover [NEAR_PLANE, SLICE_FAR], the last one reaches on to the far plane
+    constexpr float SLICE_FAR{300.0f};
+
+    // indices are 16 bit
+    constexpr std::size_t MAX_LIGHTS{4096};
+    // lights a single cluster keeps, the rest are dropped (bounds the shader loop)
+    constexpr std::size_t MAX_CLUSTER_LIGHTS{256};
+
+    // (position, range), (color, spot scale), (direction, spot offset)
+    constexpr int LIGHT_TEXELS{3};
+    // lights, cluster ranges & indices, clear of the material (0 - 8) & IBL (11, 12) units
+    constexpr int FIRST_UNIT{13};
+
+    enum class LightType
+    {
+        POINT,
+        SPOT,
+    };
+
+    struct Light
+    {
+        LightType type{LightType::POINT};
+        glm::vec3 position{0.0f};
+        // linear radiance at 1 unit, color times intensity
+        glm::vec3 color{1.0f};
+        // distance at which the light has faded out completely
+        float range{10.0f};
+        // spot lights only, half angles of the full & the faded out cone in radians
+        glm::vec3 direction{0.0f, -1.0f, 0.0f};
+        float innerAngle{0.3f};
+        float outerAngle{0.5f};
+    };
+
+    // sphere around everything the light reaches, the smallest one around the cone for spot lights
+    [[nodiscard]] CullingN::Sphere getBounds(const Light& light);
+
+    // view space boxes of 4 neighbouring clusters of a slice, one lane each
+    struct ClusterBounds4
+    {
+        std::array<float, 4> minX{};
+        std::array<float, 4> minY{};
+        std::array<float, 4> minZ{};
+        std::array<float, 4> maxX{};
+        std::array<float, 4> maxY{};
+        std::array<float, 4> maxZ{};
+    };
+
+    // bit i is set if the sphere touches box i
+    [[nodiscard]] int testSphere(const ClusterBounds4& bounds, const CullingN::Sphere& sphere);
+} // namespace ClusteredLightingN
+
+class ClusteredLighting final : public EngineObject
+{
+public:
+    explicit ClusteredLighting(EngineObject* parent);
+    ~ClusteredLighting() override;
+
+    void free();
+
+    // returns the light's index, MAX_LIGHTS once full
+    std::size_t addLight(const ClusteredLightingN::Light& light);
+    // lights can be changed in place, update() picks it up
+    [[nodiscard]] ClusteredLightingN::Light& getLight(const std::size_t index) { return m_lights[index]; }
+    [[nodiscard]] std::size_t getLightCount() const { return m_lights.size(); }
+    void clearLights() { m_lights.clear(); }
+
+    // assign the lights to the clusters of this (unjittered) view & upload the lists, spread over jobs if given
+    void update(const glm::mat4& view, const glm::mat4& projection, JobSystem* jobs = nullptr);
+    // set the units & slice constants of shader and bind the buffers, renderSize = pixels the scene is drawn to
+    void bind(const Shader* shader, glm::ivec2 renderSize) const;
+
+    // lights that passed frustum culling & entries of the index list last update
+    [[nodiscard]] std::size_t getVisibleLightCount() const { return m_visible.size(); }
+    [[nodiscard]] std::size_t getIndexCount() const { return m_indices.size(); }
+
+private:
+    std::vector<ClusteredLightingN::Light> m_lights{};
+
+    // cluster boxes of m_projection, SLICE_CLUSTERS / 4 per slice
+    std::vector<ClusteredLightingN::ClusterBounds4> m_clusterBounds{};
+    glm::mat4 m_projection{0.0f};
+
+    // per update: world bounds of every light, the visible ones in view space & the slices they span
+    std::vector<CullingN::Sphere> m_worldBounds{};
+    std::vector<unsigned int> m_visible{};
+    std::vector<CullingN::Sphere> m_viewBounds{};
+    std::vector<std::array<int, 2>> m_sliceRanges{};
+    // light lists of every cluster (a slice is only touched by one job), then packed for upload
+    std::vector<std::vector<std::uint16_t>> m_clusterLights{};
+    std::vector<unsigned int> m_grid{};
+    std::vector<std::uint16_t> m_indices{};
+    std::vector<float> m_lightData{};
+
+    // lights, grid & indices, each a buffer with a buffer texture on top
+    std::array<unsigned int, 3> m_buffers{};
+    std::array<unsigned int, 3> m_textures{};
+
+    void createBuffers();
+    // view space boxes from the tile corners on the near & far plane of each slice
+    void buildClusterBounds(const glm::mat4& projection);
+    void assignSlice(int slice);
+    void upload();
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "colorgrading.hpp"
+
+#include <cmath>
+#include <iostream>
+
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+
+ColorGradingN::Grade ColorGradingN::getGrade(const Preset preset)
+{
+    Grade grade{};
+    switch (preset)
+    {
+    case Preset::WARM:
+        grade.balance = glm::vec3{1.06f, 1.0f, 0.9f};
+        grade.lift = glm::vec3{0.02f, 0.01f, 0.0f};
+        grade.saturation = 1.05f;
+        break;
+    case Preset::COOL:
+        grade.balance = glm::vec3{0.92f, 0.98f, 1.08f};
+        grade.lift = glm::vec3{0.0f, 0.01f, 0.03f};
+        grade.saturation = 0.95f;
+        break;
+    case Preset::CONTRAST:
+        grade.gamma = glm::vec3{0.95f};
+        grade.contrast = 1.2f;
+        grade.saturation = 1.15f;
+        break;
+    case Preset::BLEACH_BYPASS:
+        grade.gain = glm::vec3{1.05f};
+        grade.contrast = 1.3f;
+        grade.saturation = 0.5f;
+        break;
+    case Preset::NOIR:
+        grade.gamma = glm::vec3{0.9f};
+        grade.contrast = 1.25f;
+        grade.saturation = 0.0f;
+        break;
+    case Preset::NEUTRAL:
+    default:
+        break;
+    }
+    return grade;
+}
+
+const char* ColorGradingN::getName(const Preset preset)
+{
+    switch (preset)
+    {
+    case Preset::WARM:
+        return "warm";
+    case Preset::COOL:
+        return "cool";
+    case Preset::CONTRAST:
+        return "contrast";
+    case Preset::BLEACH_BYPASS:
+        return "bleach bypass";
+    case Preset::NOIR:
+        return "noir";
+    case Preset::NEUTRAL:
+    default:
+        return "neutral";
+    }
+}
+
+ColorGradingN::Preset ColorGradingN::getNextPreset(const Preset preset)
+{
+    return static_cast<Preset>((static_cast<int>(preset) + 1) % PRESET_COUNT);
+}
+
+glm::vec3 ColorGradingN::apply(const Grade& grade, const glm::vec3& color)
+{
+    glm::vec3 result{color * grade.balance};
+
+    // lift raises the shadows & leaves white alone, gain scales, gamma bends the midtones
+    result = grade.gain * (result + grade.lift * (1.0f - result));
+    result = glm::pow(glm::max(result, glm::vec3{0.0f}), 1.0f / glm::max(grade.gamma, glm::vec3{0.01f}));
+
+    result = (result - 0.5f) * grade.contrast + 0.5f;
+
+    const float luma{glm::dot(result, glm::vec3{0.2126f, 0.7152f, 0.0722f})};
+    result = glm::mix(glm::vec3{luma}, result, grade.saturation);
+
+    return glm::clamp(result, glm::vec3{0.0f}, glm::vec3{1.0f});
+}
+
+std::vector<float> ColorGradingN::bakeLUT(const Grade& grade, const int size)
+{
+    if (size < 2)
+        return {};
+
+    const std::size_t count{static_cast<std::size_t>(size)};
+    std::vector<float> lattice(count * count * count * 3);
+    const float scale{1.0f / static_cast<float>(size - 1)};
+    std::size_t index{0};
+    for (int b{0}; b < size; ++b)
+    {
+        for (int g{0}; g < size; ++g)
+        {
+            for (int r{0}; r < size; ++r)
+            {
+                const glm::vec3 color{apply(grade, glm::vec3{static_cast<float>(r), static_cast<float>(g),
+                                                             static_cast<float>(b)} * scale)};
+                lattice[index++] = color.r;
+                lattice[index++] = color.g;
+                lattice[index++] = color.b;
+            }
+        }
+    }
+    return lattice;
+}
+
+ColorGrading::ColorGrading(EngineObject* parent) : EngineObject{"ColorGrading", parent} {}
+
+ColorGrading::~ColorGrading() { free(); }
+
+void ColorGrading::free()
+{
+    glDeleteTextures(1, &m_LUT);
+    m_LUT = 0;
+    m_preset = ColorGradingN::Preset::NEUTRAL;
+}
+
+void ColorGrading::setPreset(const ColorGradingN::Preset preset)
+{
+    m_preset = preset;
+    if (preset == ColorGradingN::Preset::NEUTRAL)
+        return;
+
+    const std::vector<float> lattice{ColorGradingN::bakeLUT(ColorGradingN::getGrade(preset))};
+    if (m_LUT == 0)
+    {
+        glGenTextures(1, &m_LUT);
+        glBindTexture(GL_TEXTURE_3D, m_LUT);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_3D, m_LUT);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage3D(GL_TEXTURE_3D, 0, static_cast<int>(ColorGradingN::LUT_FORMAT), ColorGradingN::LUT_SIZE,
+                 ColorGradingN::LUT_SIZE, ColorGradingN::LUT_SIZE, 0, GL_RGB, GL_FLOAT, lattice.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    std::cout << "COLOR_GRADING::SET_PRESET: Baked " << ColorGradingN::getName(preset) << " LUT\n";
+}
@@ -0,0 +1,79 @@
+// Color grading through a 3D LUT.
+// A preset is a handful of grading operations (white balance, lift / gamma / gain, contrast, saturation) that are
+// evaluated on the cpu for every lattice point of a LUT_SIZE^3 cube when the preset changes. The composite then
+// grades every pixel of its tone mapped, gamma encoded color with a single trilinear lookup, however many operations
+// the preset has.
+
+#ifndef COLOR_GRADING_H
+#define COLOR_GRADING_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "engine_types.hpp"
+#include "glm/vec3.hpp"
+
+namespace ColorGradingN
+{
+    // lattice points per axis, trilinear filtering in between is smooth enough for gentle grades
+    constexpr int LUT_SIZE{32};
+    constexpr GLenum LUT_FORMAT{GL_RGB16F};
+
+    enum class Preset
+    {
+        NEUTRAL,
+        WARM,
+        COOL,
+        CONTRAST,
+        BLEACH_BYPASS,
+        NOIR,
+    };
+    constexpr int PRESET_COUNT{6};
+
+    // applied in this order to display referred color
+    struct Grade
+    {
+        // per channel white balance gain
+        glm::vec3 balance{1.0f};
+        // shadows, midtones & highlights
+        glm::vec3 lift{0.0f};
+        glm::vec3 gamma{1.0f};
+        glm::vec3 gain{1.0f};
+        // around mid grey
+        float contrast{1.0f};
+        float saturation{1.0f};
+    };
+
+    [[nodiscard]] Grade getGrade(Preset preset);
+    [[nodiscard]] const char* getName(Preset preset);
+    [[nodiscard]] Preset getNextPreset(Preset preset);
+
+    // grade a color in [0, 1]
+    [[nodiscard]] glm::vec3 apply(const Grade& grade, const glm::vec3& color);
+    // size^3 RGB lattice points, red varies fastest, then green, then blue
+    [[nodiscard]] std::vector<float> bakeLUT(const Grade& grade, int size = LUT_SIZE);
+} // namespace ColorGradingN
+
+class ColorGrading final : public EngineObject
+{
+public:
+    explicit ColorGrading(EngineObject* parent);
+    ~ColorGrading() override;
+
+    void free();
+
+    // bake the preset's LUT & upload it, NEUTRAL skips the lookup altogether
+    void setPreset(ColorGradingN::Preset preset);
+    [[nodiscard]] ColorGradingN::Preset getPreset() const { return m_preset; }
+    [[nodiscard]] bool getEnabled() const { return m_preset != ColorGradingN::Preset::NEUTRAL && m_LUT != 0; }
+
+    // GL_TEXTURE_3D, 0 before the first preset other than NEUTRAL
+    [[nodiscard]] unsigned int getLUT() const { return m_LUT; }
+
+private:
+    ColorGradingN::Preset m_preset{ColorGradingN::Preset::NEUTRAL};
+    unsigned int m_LUT{0};
+};
+
+#endif
@@ -0,0 +1,45 @@
+// Built in ECS components, their systems are registered by Engine::createWorld().
+
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "bones.hpp"
+#include "model.hpp"
+
+namespace ComponentsN
+{
+    struct Transform
+    {
+        glm::vec3 position{0.0f};
+        glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+        glm::vec3 scale{1.0f};
+        glm::mat4 matrix{1.0f}; // world matrix, rebuilt by the transform system
+    };
+
+    struct Renderable
+    {
+        const Model* model{nullptr};
+    };
+
+    struct RigidBody
+    {
+        glm::vec3 velocity{0.0f};
+        glm::vec3 angularVelocity{0.0f}; // axis * radians per second
+        float inverseMass{1.0f}; // 0 for static bodies
+        float linearDamping{0.05f};
+        bool useGravity{true};
+    };
+
+    struct Animator
+    {
+        BoneAnimator* animator{nullptr}; // not owned
+        float speed{1.0f};
+    };
+
+    constexpr glm::vec3 GRAVITY{0.0f, -9.81f, 0.0f};
+} // namespace ComponentsN
+
+#endif
@@ -0,0 +1,147 @@
+#include "culling.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+CullingN::AABB CullingN::mergeAABB(const AABB& a, const AABB& b)
+{
+    return AABB{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+// Arvo's method: project the box extents onto the rotated axes
+CullingN::AABB CullingN::transformAABB(const AABB& box, const glm::mat4& transform)
+{
+    const glm::vec3 center{(box.min + box.max) * 0.5f};
+    const glm::vec3 extents{(box.max - box.min) * 0.5f};
+
+    const glm::vec3 worldCenter{transform * glm::vec4{center, 1.0f}};
+    glm::vec3 worldExtents{0.0f};
+    for (int i{0}; i < 3; ++i)
+    {
+        worldExtents[i] = std::abs(transform[0][i]) * extents.x + std::abs(transform[1][i]) * extents.y +
+            std::abs(transform[2][i]) * extents.z;
+    }
+
+    return AABB{worldCenter - worldExtents, worldCenter + worldExtents};
+}
+
+CullingN::Sphere CullingN::transformSphere(const Sphere& sphere, const glm::mat4& transform)
+{
+    // non-uniform scale: use the largest axis so the sphere stays conservative
+    const float scaleX{glm::length(glm::vec3{transform[0]})};
+    const float scaleY{glm::length(glm::vec3{transform[1]})};
+    const float scaleZ{glm::length(glm::vec3{transform[2]})};
+    const float maxScale{std::max(scaleX, std::max(scaleY, scaleZ))};
+
+    return Sphere{glm::vec3{transform * glm::vec4{sphere.center, 1.0f}}, sphere.radius * maxScale};
+}
+
+// Gribb & Hartmann plane extraction
+CullingN::Frustum CullingN::extractFrustum(const glm::mat4& viewProjection)
+{
+    // glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const glm::vec4 row0{viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]};
+    const glm::vec4 row1{viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]};
+    const glm::vec4 row2{viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]};
+    const glm::vec4 row3{viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]};
+
+    Frustum frustum{};
+    frustum.planes[0] = row3 + row0; // left
+    frustum.planes[1] = row3 - row0; // right
+    frustum.planes[2] = row3 + row1; // bottom
+    frustum.planes[3] = row3 - row1; // top
+    frustum.planes[4] = row3 + row2; // near
+    frustum.planes[5] = row3 - row2; // far
+
+    // normalize so plane distances are in world units (needed for sphere radius tests)
+    for (glm::vec4& plane : frustum.planes)
+    {
+        const float length{glm::length(glm::vec3{plane})};
+        if (length > 0.0f)
+            plane /= length;
+    }
+
+    return frustum;
+}
+
+bool CullingN::sphereInFrustum(const Frustum& frustum, const Sphere& sphere)
+{
+    for (const glm::vec4& plane : frustum.planes)
+    {
+        if (glm::dot(glm::vec3{plane}, sphere.center) + plane.w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+bool CullingN::aabbInFrustum(const Frustum& frustum, const AABB& box)
+{
+    for (const glm::vec4& plane : frustum.planes)
+    {
+        // furthest corner along the plane normal
+        const glm::vec3 positive{plane.x >= 0.0f ? box.max.x : box.min.x, plane.y >= 0.0f ? box.max.y : box.min.y,
+                                 plane.z >= 0.0f ? box.max.z : box.min.z};
+        if (glm::dot(glm::vec3{plane}, positive) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void CullingN::cullSpheres(const Frustum& frustum, const std::vector<Sphere>& spheres,
+                           std::vector<unsigned int>& visible)
+{
+    std::size_t i{0};
+
+#ifdef CULLING_SSE
+    // splat plane components once
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p{0}; p < 6; ++p)
+    {
+        planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+        planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+
+    const float* data{reinterpret_cast<const float*>(spheres.data())};
+    for (; i + 4 <= spheres.size(); i += 4)
+    {
+        // load 4 spheres {x, y, z, r} and transpose to SoA
+        __m128 x{_mm_loadu_ps(data + i * 4 + 0)};
+        __m128 y{_mm_loadu_ps(data + i * 4 + 4)};
+        __m128 z{_mm_loadu_ps(data + i * 4 + 8)};
+        __m128 r{_mm_loadu_ps(data + i * 4 + 12)};
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+        const __m128 negRadius{_mm_sub_ps(_mm_setzero_ps(), r)};
+
+        // lanes stay set while the sphere is inside every plane
+        __m128 inside{_mm_castsi128_ps(_mm_set1_epi32(-1))};
+        for (int p{0}; p < 6; ++p)
+        {
+            const __m128 dist{_mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+                _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]))};
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negRadius));
+        }
+
+        const int mask{_mm_movemask_ps(inside)};
+        for (int lane{0}; lane < 4; ++lane)
+        {
+            if (mask & (1 << lane))
+                visible.push_back(static_cast<unsigned int>(i + lane));
+        }
+    }
+#endif
+
+    // remainder (or everything without SSE)
+    for (; i < spheres.size(); ++i)
+    {
+        if (sphereInFrustum(frustum, spheres[i]))
+            visible.push_back(static_cast<unsigned int>(i));
+    }
+}
@@ -0,0 +1,51 @@
+// Bounding volumes and view-frustum culling.
+
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace CullingN
+{
+    // axis aligned bounding box
+    struct AABB
+    {
+        glm::vec3 min{0.0f};
+        glm::vec3 max{0.0f};
+    };
+
+    // bounding sphere
+    // NOTE: laid out as {x, y, z, r} so batches of 4 can be loaded straight into SIMD registers
+    struct Sphere
+    {
+        glm::vec3 center{0.0f};
+        float radius{0.0f};
+    };
+
+    // frustum planes as (normal, distance), normals point into the frustum
+    struct Frustum
+    {
+        glm::vec4 planes[6]{};
+    };
+
+    // merge two boxes
+    [[nodiscard]] AABB mergeAABB(const AABB& a, const AABB& b);
+
+    // transform local space bounds to world space
+    [[nodiscard]] AABB transformAABB(const AABB& box, const glm::mat4& transform);
+    [[nodiscard]] Sphere transformSphere(const Sphere& sphere, const glm::mat4& transform);
+
+    // extract normalized frustum planes from a (projection * view) matrix
+    [[nodiscard]] Frustum extractFrustum(const glm::mat4& viewProjection);
+
+    // single volume tests (true if at least partially inside)
+    [[nodiscard]] bool sphereInFrustum(const Frustum& frustum, const Sphere& sphere);
+    [[nodiscard]] bool aabbInFrustum(const Frustum& frustum, const AABB& box);
+
+    // test spheres against the frustum 4 at a time, appends indices of visible spheres to visible
+    void cullSpheres(const Frustum& frustum, const std::vector<Sphere>& spheres, std::vector<unsigned int>& visible);
+} // namespace CullingN
+
+#endif
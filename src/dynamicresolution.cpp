@@ -0,0 +1,60 @@
+#include "dynamicresolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void DynamicResolution::update(const double gpuMs)
+{
+    if (!m_enabled || gpuMs <= 0.0 || m_targetMs <= 0.0)
+        return;
+
+    // positive with headroom left, the controller runs in velocity form so clamping the output can't wind it up
+    const double error{(m_targetMs - gpuMs) / m_targetMs};
+    const double minArea{static_cast<double>(DynamicResolutionN::MIN_SCALE) * DynamicResolutionN::MIN_SCALE};
+    const double maxArea{static_cast<double>(m_maxScale) * m_maxScale};
+    m_area += DynamicResolutionN::PROPORTIONAL_GAIN * (error - m_previousError) +
+              DynamicResolutionN::INTEGRAL_GAIN * error;
+    m_area = std::clamp(m_area, minArea, maxArea);
+    m_previousError = error;
+
+    const float scale{static_cast<float>(std::sqrt(m_area))};
+    if (std::abs(scale - m_scale) < DynamicResolutionN::SCALE_STEP * DynamicResolutionN::SCALE_HYSTERESIS)
+        return;
+    const float steps{std::round(scale / DynamicResolutionN::SCALE_STEP)};
+    m_scale = std::clamp(steps * DynamicResolutionN::SCALE_STEP, DynamicResolutionN::MIN_SCALE, m_maxScale);
+}
+
+void DynamicResolution::reset()
+{
+    m_area = static_cast<double>(m_maxScale) * m_maxScale;
+    m_previousError = 0.0;
+    m_scale = m_maxScale;
+}
+
+void DynamicResolution::setMaxScale(const float maxScale)
+{
+    m_maxScale = std::clamp(maxScale, DynamicResolutionN::MIN_SCALE, DynamicResolutionN::MAX_SCALE);
+    if (!m_enabled || m_scale > m_maxScale)
+        reset();
+}
+
+void DynamicResolution::setEnabled(const bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled)
+        reset();
+}
+
+float DynamicResolution::getSharpness() const
+{
+    const float range{m_maxScale - DynamicResolutionN::MIN_SCALE};
+    if (range <= 0.0f)
+        return 0.0f;
+    return DynamicResolutionN::MAX_SHARPNESS * (m_maxScale - m_scale) / range;
+}
+
+glm::ivec2 DynamicResolution::getSize(const int width, const int height) const
+{
+    return glm::ivec2{std::max(static_cast<int>(std::lround(static_cast<float>(width) * m_scale)), 1),
+                      std::max(static_cast<int>(std::lround(static_cast<float>(height) * m_scale)), 1)};
+}
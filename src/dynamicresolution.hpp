@@ -0,0 +1,61 @@
+// Dynamic resolution: picks the fraction of the window the scene is rendered at from the measured gpu frame time.
+// A PI controller works on the rendered area (the cost of most passes grows with the pixel count) toward a target
+// frame time. The scale it hands out moves in steps with some hysteresis, so targets that follow it (bloom mips) are
+// only reallocated when a step is crossed.
+
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include "glm/ext/vector_int2.hpp"
+
+namespace DynamicResolutionN
+{
+    constexpr float MIN_SCALE{0.5f};
+    constexpr float MAX_SCALE{1.0f};
+    // the scale is applied in steps, a step is only taken once the controller is this far past it
+    constexpr float SCALE_STEP{0.05f};
+    constexpr float SCALE_HYSTERESIS{0.75f};
+
+    constexpr double DEFAULT_TARGET_MS{1000.0 / 60.0};
+    // gains on the relative frame time error, the gpu time arrives a few frames late so they are kept low
+    constexpr double PROPORTIONAL_GAIN{0.2};
+    constexpr double INTEGRAL_GAIN{0.03};
+
+    // sharpening of the upscale at MIN_SCALE, none at full resolution
+    constexpr float MAX_SHARPNESS{0.6f};
+} // namespace DynamicResolutionN
+
+class DynamicResolution
+{
+public:
+    // one controller step per frame, gpuMs of 0 (no measurement yet) is ignored
+    void update(double gpuMs);
+    // back to the highest scale
+    void reset();
+
+    void setEnabled(bool enabled);
+    [[nodiscard]] bool getEnabled() const { return m_enabled; }
+    // highest scale handed out (temporal upscaling lowers it), also the scale while disabled
+    void setMaxScale(float maxScale);
+    [[nodiscard]] float getMaxScale() const { return m_maxScale; }
+    void setTargetMs(double targetMs) { m_targetMs = targetMs; }
+    [[nodiscard]] double getTargetMs() const { return m_targetMs; }
+
+    // applied scale of both axes
+    [[nodiscard]] float getScale() const { return m_scale; }
+    [[nodiscard]] float getSharpness() const;
+    // rendered size for a width x height window, at least 1x1
+    [[nodiscard]] glm::ivec2 getSize(int width, int height) const;
+
+private:
+    bool m_enabled{true};
+    double m_targetMs{DynamicResolutionN::DEFAULT_TARGET_MS};
+    float m_maxScale{DynamicResolutionN::MAX_SCALE};
+
+    // controller output (scale squared) & the error of the previous step
+    double m_area{1.0};
+    double m_previousError{0.0};
+    float m_scale{DynamicResolutionN::MAX_SCALE};
+};
+
+#endif
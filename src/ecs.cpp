@@ -0,0 +1,298 @@
+#include "ecs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+#include "util.hpp"
+
+namespace
+{
+    // fixed size so lookups never race with registration on other threads
+    ECSN::ComponentInfo g_componentInfos[ECSN::MAX_COMPONENTS]{};
+    std::atomic<std::size_t> g_componentCount{0};
+
+    std::size_t alignUp(const std::size_t value, const std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+} // namespace
+
+// ------ Components ------ //
+
+std::size_t ECSN::registerComponent(const ComponentInfo& info)
+{
+    const std::size_t id{g_componentCount.fetch_add(1)};
+    if (id >= MAX_COMPONENTS)
+    {
+        Util::beginError();
+        std::cout << "ECS::REGISTER_COMPONENT::ERROR: More than " << MAX_COMPONENTS << " component types, `"
+                  << info.name << "` can't be registered!";
+        Util::endError();
+        std::abort();
+    }
+    g_componentInfos[id] = info;
+    return id;
+}
+
+const ECSN::ComponentInfo& ECSN::getComponentInfo(const std::size_t id) { return g_componentInfos[id]; }
+
+// ------ Archetype ------ //
+
+ECSN::Archetype::Archetype(const Signature& signature) : m_signature{signature}
+{
+    std::size_t rowSize{0};
+    std::size_t padding{0};
+    for (std::size_t i{0}; i < MAX_COMPONENTS; ++i)
+    {
+        if (!signature.test(i))
+            continue;
+        m_components.push_back(i);
+        rowSize += getComponentInfo(i).size;
+        padding += getComponentInfo(i).align;
+    }
+
+    // as many rows as fit with every array aligned (entities without components just get a large chunk)
+    m_capacity = rowSize > 0 ? std::max<std::size_t>(1, (CHUNK_BYTES - padding) / rowSize) : CHUNK_BYTES / 8;
+
+    std::size_t offset{0};
+    for (const std::size_t component : m_components)
+    {
+        const ComponentInfo& info{getComponentInfo(component)};
+        offset = alignUp(offset, info.align);
+        m_offsets[component] = offset;
+        offset += info.size * m_capacity;
+    }
+}
+
+ECSN::Archetype::~Archetype()
+{
+    for (const Chunk& chunk : m_chunks)
+    {
+        for (const std::size_t component : m_components)
+        {
+            const ComponentInfo& info{getComponentInfo(component)};
+            for (std::size_t row{0}; row < chunk.count; ++row)
+                info.destroy(getComponent(chunk, component, row));
+        }
+    }
+}
+
+std::size_t ECSN::Archetype::getEntityCount() const
+{
+    std::size_t count{0};
+    for (const Chunk& chunk : m_chunks)
+        count += chunk.count;
+    return count;
+}
+
+void* ECSN::Archetype::getComponent(const Chunk& chunk, const std::size_t component, const std::size_t row) const
+{
+    return chunk.data + m_offsets[component] + getComponentInfo(component).size * row;
+}
+
+std::pair<std::size_t, std::size_t> ECSN::Archetype::allocate(const Entity entity)
+{
+    // only the last chunk can have free rows
+    if (m_chunks.empty() || m_chunks.back().count == m_capacity)
+    {
+        Chunk& chunk{m_chunks.emplace_back()};
+        const std::size_t bytes{m_components.empty() ? 0 : CHUNK_BYTES};
+        chunk.memory = std::make_unique<std::byte[]>(bytes + CHUNK_ALIGNMENT);
+        chunk.data = reinterpret_cast<std::byte*>(
+            alignUp(reinterpret_cast<std::uintptr_t>(chunk.memory.get()), CHUNK_ALIGNMENT));
+        chunk.entities.reserve(m_capacity);
+    }
+
+    Chunk& chunk{m_chunks.back()};
+    chunk.entities.push_back(entity);
+    return {m_chunks.size() - 1, chunk.count++};
+}
+
+ECSN::Entity ECSN::Archetype::removeRow(const std::size_t chunkIndex, const std::size_t row)
+{
+    Chunk& chunk{m_chunks[chunkIndex]};
+    Chunk& last{m_chunks.back()};
+    const std::size_t lastRow{last.count - 1};
+    const bool isLast{&chunk == &last && row == lastRow};
+
+    for (const std::size_t component : m_components)
+    {
+        const ComponentInfo& info{getComponentInfo(component)};
+        void* hole{getComponent(chunk, component, row)};
+        info.destroy(hole);
+        if (!isLast)
+        {
+            // keep arrays dense by moving the last entity into the hole
+            void* source{getComponent(last, component, lastRow)};
+            info.moveConstruct(hole, source);
+            info.destroy(source);
+        }
+    }
+
+    Entity moved{NULL_ENTITY};
+    if (!isLast)
+    {
+        moved = last.entities[lastRow];
+        chunk.entities[row] = moved;
+    }
+    last.entities.pop_back();
+    --last.count;
+
+    if (last.count == 0)
+        m_chunks.pop_back();
+    return moved;
+}
+
+// ------ Command Buffer ------ //
+
+void ECSN::CommandBuffer::destroy(const Entity entity)
+{
+    push([entity](World& world) { world.destroy(entity); });
+}
+
+void ECSN::CommandBuffer::push(std::function<void(World&)> command)
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_commands.push_back(std::move(command));
+}
+
+void ECSN::CommandBuffer::playback(World& world)
+{
+    std::vector<std::function<void(World&)>> commands{};
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        commands.swap(m_commands);
+    }
+
+    // commands may record new commands, those run next playback
+    for (std::function<void(World&)>& command : commands)
+        command(world);
+}
+
+// ------ World ------ //
+
+World::World(EngineObject* parent, JobSystem* jobs) : EngineObject{"World", parent}, m_jobs{jobs} {}
+
+void World::destroy(const ECSN::Entity entity)
+{
+    if (!isAlive(entity))
+        return;
+
+    Record& record{m_records[entity.index]};
+    const ECSN::Entity moved{record.archetype->removeRow(record.chunk, record.row)};
+    if (moved != ECSN::NULL_ENTITY)
+        relocate(moved, record.chunk, record.row);
+
+    // bump generation so stale handles stop resolving
+    record.archetype = nullptr;
+    ++record.generation;
+    m_freeEntities.push_back(entity.index);
+    --m_entityCount;
+}
+
+bool World::isAlive(const ECSN::Entity entity) const
+{
+    return entity.index < m_records.size() && m_records[entity.index].archetype != nullptr &&
+           m_records[entity.index].generation == entity.generation;
+}
+
+void World::addSystem(const std::string& name, std::function<void(World&, float)> update)
+{
+    m_systems.push_back(ECSN::System{name, std::move(update)});
+}
+
+void World::update(const float dt)
+{
+    for (ECSN::System& system : m_systems)
+        system.update(*this, dt);
+
+    m_commands.playback(*this);
+}
+
+ECSN::Archetype* World::getArchetype(const ECSN::Signature& signature)
+{
+    const auto it{m_archetypeLookup.find(signature)};
+    if (it != m_archetypeLookup.end())
+        return it->second;
+
+    ECSN::Archetype* archetype{m_archetypes.emplace_back(std::make_unique<ECSN::Archetype>(signature)).get()};
+    m_archetypeLookup.emplace(signature, archetype);
+    return archetype;
+}
+
+const std::vector<ECSN::Archetype*>& World::query(const ECSN::Signature& signature)
+{
+    // only archetypes created since the last query have to be tested
+    QueryCache& cache{m_queries[signature]};
+    for (; cache.checked < m_archetypes.size(); ++cache.checked)
+    {
+        ECSN::Archetype* archetype{m_archetypes[cache.checked].get()};
+        if ((archetype->getSignature() & signature) == signature)
+            cache.archetypes.push_back(archetype);
+    }
+    return cache.archetypes;
+}
+
+ECSN::Entity World::allocateEntity()
+{
+    ++m_entityCount;
+    if (!m_freeEntities.empty())
+    {
+        const std::uint32_t index{m_freeEntities.back()};
+        m_freeEntities.pop_back();
+        return ECSN::Entity{index, m_records[index].generation};
+    }
+
+    m_records.emplace_back();
+    return ECSN::Entity{static_cast<std::uint32_t>(m_records.size() - 1), 0};
+}
+
+void World::moveEntity(const ECSN::Entity entity, const std::size_t component, const bool adding)
+{
+    Record& record{m_records[entity.index]};
+    ECSN::Archetype* source{record.archetype};
+
+    // follow the cached transition, or find the target archetype once
+    std::unordered_map<std::size_t, ECSN::Archetype*>& edges{adding ? source->addEdges : source->removeEdges};
+    ECSN::Archetype* target{nullptr};
+    const auto edge{edges.find(component)};
+    if (edge != edges.end())
+    {
+        target = edge->second;
+    }
+    else
+    {
+        ECSN::Signature signature{source->getSignature()};
+        signature.set(component, adding);
+        target = getArchetype(signature);
+        edges.emplace(component, target);
+    }
+
+    const auto [chunk, row]{target->allocate(entity)};
+    const ECSN::Chunk& sourceChunk{source->getChunks()[record.chunk]};
+    for (const std::size_t shared : target->getComponents())
+    {
+        if (source->hasComponent(shared))
+        {
+            ECSN::getComponentInfo(shared).moveConstruct(target->getComponent(target->getChunks()[chunk], shared, row),
+                                                         source->getComponent(sourceChunk, shared, record.row));
+        }
+    }
+
+    // moved from components are destroyed with the old row
+    const ECSN::Entity moved{source->removeRow(record.chunk, record.row)};
+    if (moved != ECSN::NULL_ENTITY)
+        relocate(moved, record.chunk, record.row);
+
+    record.archetype = target;
+    record.chunk = chunk;
+    record.row = row;
+}
+
+void World::relocate(const ECSN::Entity moved, const std::size_t chunk, const std::size_t row)
+{
+    m_records[moved.index].chunk = chunk;
+    m_records[moved.index].row = row;
+}
@@ -0,0 +1,363 @@
+// Archetype based entity component system.
+// Entities with the same set of components share an archetype, which stores every component type in its own
+// dense array inside fixed size chunks. Queries cache the archetypes they match, and iterate (optionally in
+// parallel on the job system) chunk by chunk.
+//
+// Structural changes (create, destroy, add, remove) move entities between archetypes, so they must not happen
+// while iterating - record them in the world's CommandBuffer instead, which is played back after the systems ran.
+
+#ifndef ECS_H
+#define ECS_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "engine_types.hpp"
+#include "jobs.hpp"
+
+class World;
+
+namespace ECSN
+{
+    constexpr std::size_t MAX_COMPONENTS{64};
+    // bytes of component data per chunk
+    constexpr std::size_t CHUNK_BYTES{16 * 1024};
+    constexpr std::size_t CHUNK_ALIGNMENT{64};
+
+    using Signature = std::bitset<MAX_COMPONENTS>;
+
+    struct Entity
+    {
+        std::uint32_t index{0xFFFFFFFF};
+        std::uint32_t generation{0};
+
+        bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const Entity& other) const { return !(*this == other); }
+    };
+
+    constexpr Entity NULL_ENTITY{};
+
+    // type erased component operations
+    struct ComponentInfo
+    {
+        const char* name{nullptr};
+        std::size_t size{0};
+        std::size_t align{0};
+        void (*moveConstruct)(void* destination, void* source){nullptr};
+        void (*destroy)(void* component){nullptr};
+    };
+
+    // assigns the next free component id, ids are process wide
+    std::size_t registerComponent(const ComponentInfo& info);
+    [[nodiscard]] const ComponentInfo& getComponentInfo(std::size_t id);
+
+    template <typename T>
+    std::size_t componentID()
+    {
+        static_assert(std::is_move_constructible_v<T>, "components have to be move constructible");
+        static const std::size_t id{registerComponent(ComponentInfo{
+            typeid(T).name(), sizeof(T), alignof(T),
+            [](void* destination, void* source) { new (destination) T{std::move(*static_cast<T*>(source))}; },
+            [](void* component) { static_cast<T*>(component)->~T(); }})};
+        return id;
+    }
+
+    template <typename... Ts>
+    Signature makeSignature()
+    {
+        Signature signature{};
+        (signature.set(componentID<Ts>()), ...);
+        return signature;
+    }
+
+    struct Chunk
+    {
+        std::unique_ptr<std::byte[]> memory{};
+        std::byte* data{nullptr}; // memory aligned to CHUNK_ALIGNMENT
+        std::vector<Entity> entities{};
+        std::size_t count{0};
+    };
+
+    // all entities with exactly the same components
+    class Archetype
+    {
+    public:
+        explicit Archetype(const Signature& signature);
+        // destroys the components of remaining entities
+        ~Archetype();
+
+        Archetype(const Archetype&) = delete;
+        Archetype& operator=(const Archetype&) = delete;
+
+        [[nodiscard]] const Signature& getSignature() const { return m_signature; }
+        [[nodiscard]] std::size_t getCapacity() const { return m_capacity; }
+        [[nodiscard]] std::vector<Chunk>& getChunks() { return m_chunks; }
+        [[nodiscard]] const std::vector<Chunk>& getChunks() const { return m_chunks; }
+        [[nodiscard]] std::size_t getEntityCount() const;
+
+        [[nodiscard]] bool hasComponent(const std::size_t component) const { return m_signature.test(component); }
+        [[nodiscard]] const std::vector<std::size_t>& getComponents() const { return m_components; }
+
+        // address of a component inside a chunk
+        [[nodiscard]] void* getComponent(const Chunk& chunk, std::size_t component, std::size_t row) const;
+
+        template <typename T>
+        [[nodiscard]] T* getColumn(const Chunk& chunk) const
+        {
+            return reinterpret_cast<T*>(chunk.data + m_offsets[componentID<T>()]);
+        }
+
+        // reserve a row for an entity (components are left unconstructed), returns {chunk, row}
+        std::pair<std::size_t, std::size_t> allocate(Entity entity);
+        // destroy the row's components and fill the hole with the last entity, returns the moved entity (or null)
+        Entity removeRow(std::size_t chunk, std::size_t row);
+
+        // cached archetype transitions
+        std::unordered_map<std::size_t, Archetype*> addEdges{};
+        std::unordered_map<std::size_t, Archetype*> removeEdges{};
+
+    private:
+        Signature m_signature{};
+        std::vector<std::size_t> m_components{};
+        std::size_t m_offsets[MAX_COMPONENTS]{}; // byte offset of every component array inside a chunk
+        std::size_t m_capacity{0};
+
+        std::vector<Chunk> m_chunks{};
+    };
+
+    // records structural changes to apply later, safe to use from several jobs at once
+    class CommandBuffer
+    {
+    public:
+        template <typename... Ts>
+        void create(Ts... components)
+        {
+            // generic lambdas, World is still incomplete here
+            push([components = std::make_tuple(std::move(components)...)](auto& world) mutable
+                 { std::apply([&world](auto&... values) { world.create(std::move(values)...); }, components); });
+        }
+
+        void destroy(Entity entity);
+
+        template <typename T>
+        void add(Entity entity, T component)
+        {
+            push([entity, component = std::move(component)](auto& world) mutable
+                 { world.template add<T>(entity, std::move(component)); });
+        }
+
+        template <typename T>
+        void remove(Entity entity)
+        {
+            push([entity](auto& world) { world.template remove<T>(entity); });
+        }
+
+        // apply & clear recorded commands in recording order
+        void playback(World& world);
+
+        [[nodiscard]] bool empty() const { return m_commands.empty(); }
+
+    private:
+        std::mutex m_mutex{};
+        std::vector<std::function<void(World&)>> m_commands{};
+
+        void push(std::function<void(World&)> command);
+    };
+
+    struct System
+    {
+        std::string name{};
+        std::function<void(World&, float)> update{};
+    };
+} // namespace ECSN
+
+class World final : public EngineObject
+{
+public:
+    // jobs can be nullptr, parallel queries then run on the calling thread
+    explicit World(EngineObject* parent, JobSystem* jobs = nullptr);
+
+    // ------ Entities ------ //
+
+    template <typename... Ts>
+    ECSN::Entity create(Ts... components)
+    {
+        ECSN::Archetype* archetype{getArchetype(ECSN::makeSignature<Ts...>())};
+        const ECSN::Entity entity{allocateEntity()};
+        const auto [chunk, row]{archetype->allocate(entity)};
+        (new (archetype->getComponent(archetype->getChunks()[chunk], ECSN::componentID<Ts>(), row))
+             Ts{std::move(components)},
+         ...);
+        m_records[entity.index] = Record{archetype, chunk, row, entity.generation};
+        return entity;
+    }
+
+    void destroy(ECSN::Entity entity);
+    [[nodiscard]] bool isAlive(ECSN::Entity entity) const;
+
+    // add or replace a component
+    template <typename T>
+    void add(const ECSN::Entity entity, T component)
+    {
+        if (!isAlive(entity))
+            return;
+
+        const std::size_t id{ECSN::componentID<T>()};
+        if (m_records[entity.index].archetype->hasComponent(id))
+        {
+            *get<T>(entity) = std::move(component);
+            return;
+        }
+
+        moveEntity(entity, id, true);
+        const Record& record{m_records[entity.index]};
+        new (record.archetype->getComponent(record.archetype->getChunks()[record.chunk], id, record.row))
+            T{std::move(component)};
+    }
+
+    template <typename T>
+    void remove(const ECSN::Entity entity)
+    {
+        if (!isAlive(entity))
+            return;
+
+        const std::size_t id{ECSN::componentID<T>()};
+        if (m_records[entity.index].archetype->hasComponent(id))
+            moveEntity(entity, id, false);
+    }
+
+    // nullptr if the entity doesn't have the component
+    template <typename T>
+    [[nodiscard]] T* get(const ECSN::Entity entity)
+    {
+        if (!isAlive(entity))
+            return nullptr;
+
+        const Record& record{m_records[entity.index]};
+        const std::size_t id{ECSN::componentID<T>()};
+        if (!record.archetype->hasComponent(id))
+            return nullptr;
+        return static_cast<T*>(
+            record.archetype->getComponent(record.archetype->getChunks()[record.chunk], id, record.row));
+    }
+
+    template <typename T>
+    [[nodiscard]] bool has(const ECSN::Entity entity) const
+    {
+        return isAlive(entity) && m_records[entity.index].archetype->hasComponent(ECSN::componentID<T>());
+    }
+
+    [[nodiscard]] std::size_t getEntityCount() const { return m_entityCount; }
+    [[nodiscard]] std::size_t getArchetypeCount() const { return m_archetypes.size(); }
+
+    // ------ Queries ------ //
+
+    // func(Entity, Ts&...) for every entity with at least the components Ts
+    template <typename... Ts, typename F>
+    void each(F&& func)
+    {
+        for (ECSN::Archetype* archetype : query(ECSN::makeSignature<Ts...>()))
+        {
+            for (ECSN::Chunk& chunk : archetype->getChunks())
+                eachInChunk<Ts...>(*archetype, chunk, func);
+        }
+    }
+
+    // like each(), chunks are split across the job system (structural changes only through the command buffer)
+    template <typename... Ts, typename F>
+    void parallelEach(F&& func)
+    {
+        m_chunkScratch.clear();
+        for (ECSN::Archetype* archetype : query(ECSN::makeSignature<Ts...>()))
+        {
+            for (ECSN::Chunk& chunk : archetype->getChunks())
+                m_chunkScratch.emplace_back(archetype, &chunk);
+        }
+
+        if (m_jobs == nullptr)
+        {
+            for (const auto& [archetype, chunk] : m_chunkScratch)
+                eachInChunk<Ts...>(*archetype, *chunk, func);
+            return;
+        }
+
+        m_jobs->parallelFor(m_chunkScratch.size(), 1,
+                            [this, &func](const std::size_t begin, const std::size_t end)
+                            {
+                                for (std::size_t i{begin}; i < end; ++i)
+                                    eachInChunk<Ts...>(*m_chunkScratch[i].first, *m_chunkScratch[i].second, func);
+                            });
+    }
+
+    // ------ Systems ------ //
+
+    // systems run in registration order every update()
+    void addSystem(const std::string& name, std::function<void(World&, float)> update);
+    // run systems, then apply deferred structural changes
+    void update(float dt);
+
+    [[nodiscard]] ECSN::CommandBuffer& getCommandBuffer() { return m_commands; }
+    [[nodiscard]] JobSystem* getJobSystem() const { return m_jobs; }
+
+private:
+    struct Record
+    {
+        ECSN::Archetype* archetype{nullptr};
+        std::size_t chunk{0};
+        std::size_t row{0};
+        std::uint32_t generation{0};
+    };
+
+    // archetypes matching a query signature, extended as new archetypes appear
+    struct QueryCache
+    {
+        std::vector<ECSN::Archetype*> archetypes{};
+        std::size_t checked{0}; // number of world archetypes already tested
+    };
+
+    JobSystem* m_jobs{nullptr};
+
+    std::vector<std::unique_ptr<ECSN::Archetype>> m_archetypes{};
+    std::unordered_map<ECSN::Signature, ECSN::Archetype*> m_archetypeLookup{};
+    std::unordered_map<ECSN::Signature, QueryCache> m_queries{};
+
+    std::vector<Record> m_records{}; // indexed by entity index
+    std::vector<std::uint32_t> m_freeEntities{};
+    std::size_t m_entityCount{0};
+
+    std::vector<ECSN::System> m_systems{};
+    ECSN::CommandBuffer m_commands{};
+
+    std::vector<std::pair<ECSN::Archetype*, ECSN::Chunk*>> m_chunkScratch{};
+
+    ECSN::Archetype* getArchetype(const ECSN::Signature& signature);
+    const std::vector<ECSN::Archetype*>& query(const ECSN::Signature& signature);
+
+    ECSN::Entity allocateEntity();
+    // move an entity to the archetype with component added or removed, moving the shared components
+    void moveEntity(ECSN::Entity entity, std::size_t component, bool adding);
+    // point the record of an entity moved by Archetype::removeRow at its new row
+    void relocate(ECSN::Entity moved, std::size_t chunk, std::size_t row);
+
+    template <typename... Ts, typename F>
+    static void eachInChunk(const ECSN::Archetype& archetype, ECSN::Chunk& chunk, F& func)
+    {
+        const std::tuple<Ts*...> columns{archetype.getColumn<Ts>(chunk)...};
+        for (std::size_t row{0}; row < chunk.count; ++row)
+            func(chunk.entities[row], std::get<Ts*>(columns)[row]...);
+    }
+};
+
+#endif
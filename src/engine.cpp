@@ -10,10 +10,12 @@
 #include "shapes.hpp"
 using json = nlohmann::json;
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
 #include "engine.hpp"
+#include "glext.hpp"
 #include "util.hpp"
 
 Engine::Engine() : EngineObject{"Engine"}
@@ -67,6 +69,8 @@ bool Engine::init(const int width, const int height, const char* title)
     }
 
     std::cout << "ENGINE::INIT: Successfully initialized GLAD!\n";
+    // entry points newer than the glad profile (used when the driver has them)
+    GLExtN::load(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
     // create view port
     m_window->createViewPort();
@@ -82,6 +86,15 @@ bool Engine::init(const int width, const int height, const char* title)
 
     // ----- create objects ----- //
 
+    // create job system
+    if (!createJobSystem())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create JobSystem!";
+        Util::endError();
+        return false;
+    }
+
     // create IOHandler
     if (!createIOHandler())
     {
@@ -119,6 +132,51 @@ bool Engine::init(const int width, const int height, const char* title)
     }
     loadShaders(); // load verified shaders
 
+    // create texture cache (shared by texture manager, models & IBL)
+    if (!createTextureCache())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create TextureCache!";
+        Util::endError();
+        return false;
+    }
+
+    // stream async texture loads
+    if (!createTextureUploader())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create TextureUploader!";
+        Util::endError();
+        return false;
+    }
+
+    // stream mips of compressed textures
+    if (!createTextureStreamer())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create TextureStreamer!";
+        Util::endError();
+        return false;
+    }
+
+    // texture array pages for packed materials
+    if (!createMaterialArrays())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create MaterialArrays!";
+        Util::endError();
+        return false;
+    }
+
+    // shared materials of all models
+    if (!createMaterialLibrary())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create MaterialLibrary!";
+        Util::endError();
+        return false;
+    }
+
     // create texture manager
     if (!createTextureManager())
     {
@@ -153,6 +211,47 @@ bool Engine::init(const int width, const int height, const char* title)
         return false;
     }
 
+    if (!createSceneGraph())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create SceneGraph!";
+        Util::endError();
+        return false;
+    }
+
+    if (!createWorld())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create World!";
+        Util::endError();
+        return false;
+    }
+
+    if (!createOcclusionCuller())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create OcclusionCuller!";
+        Util::endError();
+        return false;
+    }
+
+    if (!createRenderTargetPool())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create RenderTargetPool!";
+        Util::endError();
+        return false;
+    }
+
+    if (!createRenderGraph())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create RenderGraph!";
+        Util::endError();
+        return false;
+    }
+    m_renderGraph->init(m_renderTargetPool);
+
     if (!createPostProcessor())
     {
         Util::beginError();
@@ -160,9 +259,25 @@ bool Engine::init(const int width, const int height, const char* title)
         Util::endError();
         return false;
     }
-    m_postProcessor->init(getWidth(), getHeight());
+    m_postProcessor->init(getWidth(), getHeight(), m_renderTargetPool);
     m_postProcessor->enableBloom(this);
 
+    if (!createFrameCapture())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create FrameCapture!";
+        Util::endError();
+        return false;
+    }
+
+    if (!createClusteredLighting())
+    {
+        Util::beginError();
+        std::cout << "ENGINE::INIT::ERROR: Failed to create ClusteredLighting!";
+        Util::endError();
+        return false;
+    }
+
     std::cout << "ENGINE::INIT: Successfully created components!\n";
 
     return true;
@@ -173,6 +288,32 @@ void Engine::update()
 {
     // update delta time
     m_clock->update();
+
+    // record last frame for the occlusion benchmark, alternating occlusion culling every frame
+    if (m_benchmarkFrames > 0)
+    {
+        m_benchmark.addSample(m_occlusionCullingEnabled ? "occlusion on" : "occlusion off",
+                              BenchmarkN::Sample{m_frameStats.cullTimeMs + m_frameStats.submitTimeMs, 0.0,
+                                                 m_frameStats.drawCalls});
+        m_occlusionCullingEnabled = !m_occlusionCullingEnabled;
+        if (--m_benchmarkFrames == 0)
+        {
+            m_benchmark.report();
+            m_occlusionCullingEnabled = m_benchmarkRestoreOcclusion;
+        }
+    }
+
+    // finish some pending texture uploads
+    m_textureUploader->update();
+    // hand finished frame readbacks to the writer
+    m_frameCapture->update();
+
+    // hand every render target back & free the ones that went unused
+    m_renderTargetPool->endFrame();
+
+    // start a new frame of stats
+    m_frameStats = StatsN::FrameStats{};
+    m_occlusionRendered = false;
     // check for esc
     m_iohandler->update();
     m_window->setQuit(m_iohandler->getQuit());
@@ -199,6 +340,12 @@ void Engine::update()
             m_camera->processInput(CameraN::CameraMotion::RIGHT, getDeltaTime());
         }
     }
+
+    // load the mips last frame asked for, then set up the view for this frame's requests
+    m_textureStreamer->update(getDeltaTime());
+    m_textureStreamer->setView(getCameraPosition(), glm::radians(m_camera->getZoom()), getHeight());
+    // material units may have been reused outside of mesh draws (uploads & streaming bind textures too)
+    m_materialLibrary->invalidateBindings();
 }
 
 // ------ Window ------ //
@@ -244,6 +391,9 @@ void Engine::displayFrameTime()
 
     std::stringstream ss{};
     ss << "Frame time: " << static_cast<int>(avgFrameTime * 1000.f) << "ms";
+    ss << " | Draws: " << m_frameStats.drawCalls << " | Visible: " << m_frameStats.visibleInstances
+       << " | Culled: " << m_frameStats.culledInstances << " | Occluded: " << m_frameStats.occludedInstances
+       << " | Streamed: " << m_textureStreamer->getResidentBytes() / (1024 * 1024) << "MB";
     m_window->setTitle(ss.str().c_str());
 }
 
@@ -303,6 +453,23 @@ float Engine::getDeltaTime() const { return m_clock->getDeltaTime(); }
 // get time from clock
 float Engine::getTime() const { return m_clock->getTime(); }
 
+// ------ Jobs ------ //
+
+bool Engine::createJobSystem()
+{
+    if (m_jobSystem != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_JOB_SYSTEM::ERROR: Job system already exists at `" << m_jobSystem << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_jobSystem = new JobSystem{this};
+    m_arena->addObject(m_jobSystem);
+    return true;
+}
+
 // ------ Shader Manager ------ //
 bool Engine::createShaderManager()
 {
@@ -412,6 +579,28 @@ bool Engine::checkShaders()
         std::cout << "Found custom shader *" << name << "* at {vert: " << vertPath << ", frag: " << fragPath << "}\n";
     }
 
+    // compute shaders (optional, only loaded when the context has compute)
+    if (data.contains("compute"))
+    {
+        for (const auto& shader : data["compute"])
+        {
+            std::string name{shader["name"]};
+            std::string compPath{"shaders/" + std::string(shader["shader"]["comp"])};
+
+            if (!Util::fileExists(compPath))
+            {
+                Util::beginError();
+                std::cout << "ENGINE::CHECK_SHADERS::ERROR: Could not find compute shader for *" << name << "* at: `"
+                          << compPath << "`!";
+                Util::endError();
+                file.close();
+                return false;
+            }
+
+            std::cout << "Found compute shader *" << name << "* at {comp: " << compPath << "}\n";
+        }
+    }
+
     // close fstream
     file.close();
     // set flag
@@ -448,6 +637,16 @@ void Engine::loadShaders()
         std::string fragPath{"shaders/" + std::string(shader["shader"]["frag"])};
         addShader(name, fragPath.c_str(), vertPath.c_str());
     }
+    // compute shaders, users fall back to their fragment paths without them
+    if (data.contains("compute") && GLExtN::hasCompute())
+    {
+        for (const auto& shader : data["compute"])
+        {
+            std::string name{shader["name"]};
+            std::string compPath{"shaders/" + std::string(shader["shader"]["comp"])};
+            m_shaderManager->addComputeShader(name, compPath.c_str(), m_arena);
+        }
+    }
 
     m_loadedShaders = true;
 }
@@ -566,6 +765,87 @@ void Engine::setMat4(const std::string& name, const glm::mat4& value, const std:
 
 
 // ------ Texture Manager ------ //
+bool Engine::createTextureCache()
+{
+    if (m_textureCache != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_TEXTURE_CACHE::ERROR: Texture cache already exists at `" << m_textureCache << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_textureCache = new TextureCache{this};
+    m_arena->addObject(m_textureCache);
+    return true;
+}
+
+bool Engine::createTextureUploader()
+{
+    if (m_textureUploader != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_TEXTURE_UPLOADER::ERROR: Texture uploader already exists at `" << m_textureUploader
+                  << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_textureUploader = new TextureUploader{this, m_jobSystem};
+    m_arena->addObject(m_textureUploader);
+    m_textureCache->setUploader(m_textureUploader);
+    return true;
+}
+
+bool Engine::createTextureStreamer()
+{
+    if (m_textureStreamer != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_TEXTURE_STREAMER::ERROR: Texture streamer already exists at `" << m_textureStreamer
+                  << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_textureStreamer = new TextureStreamer{this, m_jobSystem};
+    m_arena->addObject(m_textureStreamer);
+    m_textureCache->setStreamer(m_textureStreamer);
+    return true;
+}
+
+bool Engine::createMaterialArrays()
+{
+    if (m_materialArrays != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_MATERIAL_ARRAYS::ERROR: Material arrays already exist at `" << m_materialArrays
+                  << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_materialArrays = new MaterialArrays{this, m_jobSystem};
+    m_arena->addObject(m_materialArrays);
+    return true;
+}
+
+bool Engine::createMaterialLibrary()
+{
+    if (m_materialLibrary != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_MATERIAL_LIBRARY::ERROR: Material library already exists at `"
+                  << m_materialLibrary << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_materialLibrary = new MaterialLibrary{this, m_textureCache, m_materialArrays};
+    m_arena->addObject(m_materialLibrary);
+    return true;
+}
+
 bool Engine::createTextureManager()
 {
     if (m_textureManager != nullptr)
@@ -577,7 +857,7 @@ bool Engine::createTextureManager()
         return false;
     }
     // allocate memory for texture manager
-    m_textureManager = new TextureManager{this};
+    m_textureManager = new TextureManager{this, m_textureCache};
     // add texture manager to arena
     m_arena->addObject(m_textureManager);
     return true;
@@ -721,12 +1001,72 @@ glm::mat4 Engine::getViewMatrix() const { return m_camera->getViewMatrix(); }
 
 glm::mat4 Engine::getProjectionMatrix() const
 {
-    return glm::perspective(glm::radians(m_camera->getZoom()),
-                            static_cast<float>(getWidth()) / static_cast<float>(getHeight()), 0.1f, 100000.0f);
+    return m_camera->getJitteredProjectionMatrix(static_cast<float>(getWidth()) / static_cast<float>(getHeight()));
+}
+
+glm::mat4 Engine::getUnjitteredProjectionMatrix() const
+{
+    return m_camera->getProjectionMatrix(static_cast<float>(getWidth()) / static_cast<float>(getHeight()));
+}
+
+void Engine::setVelocityUniforms(const Shader* shader) const
+{
+    shader->setMat4("currentViewProjection", m_viewProjection);
+    shader->setMat4("previousViewProjection", m_previousViewProjection);
+}
+
+void Engine::setBoneUniforms(const Shader* shader, const BoneAnimator& animator)
+{
+    const std::vector<glm::mat4>& current{animator.getFinalBoneMatrices()};
+    const std::vector<glm::mat4>& previous{animator.getPreviousBoneMatrices()};
+    shader->setMat4Array("finalBonesMatrices", current.data(),
+                         static_cast<int>(std::min(current.size(), BonesN::MAX_BONES)));
+    shader->setMat4Array("previousBonesMatrices", previous.data(),
+                         static_cast<int>(std::min(previous.size(), BonesN::MAX_BONES)));
 }
 
 glm::vec3 Engine::getCameraPosition() const { return m_camera->getPosition(); }
 
+CullingN::Frustum Engine::getFrustum() const
+{
+    return CullingN::extractFrustum(getProjectionMatrix() * getViewMatrix());
+}
+
+BVHN::Ray Engine::getCursorRay() const
+{
+    int windowWidth, windowHeight;
+    glfwGetWindowSize(m_window->getWindow(), &windowWidth, &windowHeight);
+
+    // cursor is disabled while the camera is enabled, so pick through the crosshair
+    if (m_cameraEnabled)
+    {
+        return getScreenRay(static_cast<float>(windowWidth) * 0.5f, static_cast<float>(windowHeight) * 0.5f);
+    }
+
+    double cursorX, cursorY;
+    glfwGetCursorPos(m_window->getWindow(), &cursorX, &cursorY);
+    return getScreenRay(static_cast<float>(cursorX), static_cast<float>(cursorY));
+}
+
+BVHN::Ray Engine::getScreenRay(const float x, const float y) const
+{
+    // window coordinates can differ from framebuffer size on high dpi displays
+    int windowWidth, windowHeight;
+    glfwGetWindowSize(m_window->getWindow(), &windowWidth, &windowHeight);
+
+    const glm::vec2 ndc{2.0f * x / static_cast<float>(windowWidth) - 1.0f,
+                        1.0f - 2.0f * y / static_cast<float>(windowHeight)};
+
+    // unproject near and far points
+    const glm::mat4 invViewProjection{glm::inverse(getUnjitteredProjectionMatrix() * getViewMatrix())};
+    glm::vec4 nearPoint{invViewProjection * glm::vec4{ndc, -1.0f, 1.0f}};
+    glm::vec4 farPoint{invViewProjection * glm::vec4{ndc, 1.0f, 1.0f}};
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    return BVHN::Ray{glm::vec3{nearPoint}, glm::normalize(glm::vec3{farPoint - nearPoint})};
+}
+
 glm::mat4 Engine::getNormalMatrix(const glm::mat4& model) const { return glm::transpose(glm::inverse(model)); }
 
 void Engine::setCameraEnabled(const bool value)
@@ -747,7 +1087,7 @@ bool Engine::createModelManager()
         return false;
     }
 
-    m_modelManager = new ModelManager{this};
+    m_modelManager = new ModelManager{this, m_textureCache, m_materialLibrary, m_jobSystem};
     m_arena->addObject(m_modelManager);
     return true;
 }
@@ -766,6 +1106,532 @@ void Engine::renderModel(const std::string& name, const Shader* shader) const
 
 bool Engine::modelExists(const std::string& name) const { return m_modelManager->modelExists(name); }
 
+unsigned int Engine::bakeModelTextures(const std::string& name) const
+{
+    const Model* model{m_modelManager->getModel(name)};
+    return model != nullptr ? model->bakeTextures(m_jobSystem) : 0;
+}
+
+unsigned int Engine::packModelMaterials(const std::string& name) const
+{
+    Model* model{m_modelManager->getModel(name)};
+    return model != nullptr ? model->packMaterials() : 0;
+}
+
+void Engine::cullInstances(const Model* model, const std::vector<glm::mat4>& transforms,
+                           std::vector<unsigned int>& visible)
+{
+    visible.clear();
+    if (model == nullptr)
+        return;
+
+    BenchmarkN::ScopedTimer timer{m_frameStats.cullTimeMs};
+
+    // world space bounding spheres
+    m_cullSpheres.resize(transforms.size());
+    for (std::size_t i{0}; i < transforms.size(); ++i)
+    {
+        m_cullSpheres[i] = CullingN::transformSphere(model->getBoundingSphere(), transforms[i]);
+    }
+
+    CullingN::cullSpheres(getFrustum(), m_cullSpheres, visible);
+
+    m_frameStats.visibleInstances += static_cast<unsigned int>(visible.size());
+    m_frameStats.culledInstances += static_cast<unsigned int>(transforms.size() - visible.size());
+
+    if (!m_occlusionCullingEnabled || !m_occlusionCuller->hasOccluders())
+        return;
+
+    const std::size_t frustumVisible{visible.size()};
+    visible.erase(std::remove_if(visible.begin(), visible.end(),
+                                 [this, model, &transforms](const unsigned int index)
+                                 { return isOccluded(CullingN::transformAABB(model->getAABB(), transforms[index])); }),
+                  visible.end());
+
+    const unsigned int occluded{static_cast<unsigned int>(frustumVisible - visible.size())};
+    m_frameStats.occludedInstances += occluded;
+    m_frameStats.visibleInstances -= occluded;
+}
+
+void Engine::renderModelInstances(const std::string& name, const Shader* shader,
+                                  const std::vector<glm::mat4>& transforms)
+{
+    renderModelInstances(getModel(name), shader, transforms);
+}
+
+void Engine::renderModelInstances(const Model* model, const Shader* shader, const std::vector<glm::mat4>& transforms)
+{
+    if (model == nullptr || shader == nullptr)
+        return;
+
+    cullInstances(model, transforms, m_visibleInstances);
+
+    BenchmarkN::ScopedTimer timer{m_frameStats.submitTimeMs};
+    // a model drawn more than once a frame continues where its previous batch ended
+    InstanceHistory& history{m_instanceHistory[model]};
+    const std::size_t historyOffset{history.current.size()};
+    history.current.insert(history.current.end(), transforms.begin(), transforms.end());
+
+    const CullingN::Frustum frustum{getFrustum()};
+    shader->use();
+    for (const unsigned int index : m_visibleInstances)
+    {
+        const std::size_t previous{historyOffset + index};
+        shader->setMat4("model", transforms[index]);
+        shader->setMat4("previousModel",
+                        previous < history.previous.size() ? history.previous[previous] : transforms[index]);
+        shader->setMat3("normalMat", getNormalMatrix(transforms[index]));
+        m_frameStats.drawCalls += model->renderPBR(shader, transforms[index], frustum);
+        requestTextureMips(model, -1, transforms[index]);
+    }
+}
+
+// ------ Scene Graph ------ //
+
+bool Engine::createSceneGraph()
+{
+    if (m_sceneGraph != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_SCENE_GRAPH::ERROR: Scene graph already exists at `" << m_sceneGraph << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_sceneGraph = new SceneGraph{this};
+    m_arena->addObject(m_sceneGraph);
+    return true;
+}
+
+void Engine::updateSceneGraph() const { m_sceneGraph->update(m_jobSystem); }
+
+void Engine::renderScene(const Shader* shader)
+{
+    if (shader == nullptr)
+        return;
+
+    updateSceneGraph();
+
+    const std::vector<glm::mat4>& world{m_sceneGraph->getWorldTransforms()};
+    const std::vector<glm::mat4>& previousWorld{m_sceneGraph->getPreviousWorldTransforms()};
+    const std::vector<SceneGraphN::Renderable>& renderables{m_sceneGraph->getRenderables()};
+
+    {
+        BenchmarkN::ScopedTimer timer{m_frameStats.cullTimeMs};
+
+        // gather world space bounds of every renderable node
+        m_cullSpheres.clear();
+        m_sceneNodes.clear();
+        for (std::size_t i{0}; i < renderables.size(); ++i)
+        {
+            const SceneGraphN::Renderable& renderable{renderables[i]};
+            if (renderable.model == nullptr)
+                continue;
+
+            const CullingN::Sphere& sphere{renderable.node >= 0
+                                               ? renderable.model->getNodes()[renderable.node].boundingSphere
+                                               : renderable.model->getBoundingSphere()};
+            m_cullSpheres.push_back(CullingN::transformSphere(sphere, world[i]));
+            m_sceneNodes.push_back(static_cast<unsigned int>(i));
+        }
+
+        CullingN::cullSpheres(getFrustum(), m_cullSpheres, m_visibleInstances);
+        m_frameStats.visibleInstances += static_cast<unsigned int>(m_visibleInstances.size());
+        m_frameStats.culledInstances += static_cast<unsigned int>(m_cullSpheres.size() - m_visibleInstances.size());
+
+        // map back to dense scene graph indices, dropping occluded nodes
+        std::size_t count{0};
+        for (const unsigned int visible : m_visibleInstances)
+        {
+            const unsigned int index{m_sceneNodes[visible]};
+            if (m_occlusionCullingEnabled && m_occlusionCuller->hasOccluders())
+            {
+                const SceneGraphN::Renderable& renderable{renderables[index]};
+                const CullingN::AABB& box{renderable.node >= 0 ? renderable.model->getNodes()[renderable.node].aabb
+                                                               : renderable.model->getAABB()};
+                if (isOccluded(CullingN::transformAABB(box, world[index])))
+                {
+                    ++m_frameStats.occludedInstances;
+                    --m_frameStats.visibleInstances;
+                    continue;
+                }
+            }
+            m_visibleInstances[count++] = index;
+        }
+        m_visibleInstances.resize(count);
+    }
+
+    BenchmarkN::ScopedTimer timer{m_frameStats.submitTimeMs};
+    const CullingN::Frustum frustum{getFrustum()};
+    shader->use();
+    for (const unsigned int index : m_visibleInstances)
+    {
+        const SceneGraphN::Renderable& renderable{renderables[index]};
+        shader->setMat4("model", world[index]);
+        shader->setMat4("previousModel", index < previousWorld.size() ? previousWorld[index] : world[index]);
+        shader->setMat3("normalMat", getNormalMatrix(world[index]));
+        if (renderable.node >= 0)
+        {
+            renderable.model->renderNodePBR(shader, renderable.node);
+            ++m_frameStats.drawCalls;
+        }
+        else
+        {
+            m_frameStats.drawCalls += renderable.model->renderPBR(shader, world[index], frustum);
+        }
+        requestTextureMips(renderable.model, renderable.node, world[index]);
+    }
+}
+
+void Engine::requestTextureMips(const Model* model, const int node, const glm::mat4& transform) const
+{
+    const std::vector<Mesh>& meshes{model->getMeshes()};
+    if (node >= 0)
+    {
+        for (const unsigned int mesh : model->getNodes()[node].meshes)
+            m_textureStreamer->request(meshes[mesh], transform);
+    }
+    else
+    {
+        for (const Mesh& mesh : meshes)
+            m_textureStreamer->request(mesh, transform);
+    }
+}
+
+// ------ World ------ //
+
+bool Engine::createWorld()
+{
+    if (m_world != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_WORLD::ERROR: World already exists at `" << m_world << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_world = new World{this, m_jobSystem};
+    m_arena->addObject(m_world);
+
+    // built in systems
+    m_world->addSystem("rigid bodies", [](World& world, const float dt)
+    {
+        world.parallelEach<ComponentsN::Transform, ComponentsN::RigidBody>(
+            [dt](ECSN::Entity, ComponentsN::Transform& transform, ComponentsN::RigidBody& body)
+            {
+                if (body.inverseMass <= 0.0f)
+                    return;
+
+                if (body.useGravity)
+                    body.velocity += ComponentsN::GRAVITY * dt;
+                body.velocity *= std::max(0.0f, 1.0f - body.linearDamping * dt);
+                transform.position += body.velocity * dt;
+
+                const float angle{glm::length(body.angularVelocity) * dt};
+                if (angle > 0.0f)
+                {
+                    transform.rotation = glm::normalize(
+                        glm::angleAxis(angle, glm::normalize(body.angularVelocity)) * transform.rotation);
+                }
+            });
+    });
+    // animations share bone state, so animators run on this thread
+    m_world->addSystem("animators", [](World& world, const float dt)
+    {
+        world.each<ComponentsN::Animator>(
+            [dt](ECSN::Entity, ComponentsN::Animator& animator)
+            {
+                if (animator.animator != nullptr)
+                    animator.animator->updateAnimation(dt * animator.speed);
+            });
+    });
+    m_world->addSystem("transforms", [](World& world, float)
+    {
+        world.parallelEach<ComponentsN::Transform>(
+            [](ECSN::Entity, ComponentsN::Transform& transform)
+            {
+                transform.matrix = glm::translate(glm::mat4{1.0f}, transform.position) *
+                                   glm::mat4_cast(transform.rotation) * glm::scale(glm::mat4{1.0f}, transform.scale);
+            });
+    });
+    return true;
+}
+
+void Engine::updateWorld() const { m_world->update(getDeltaTime()); }
+
+void Engine::renderEntities(const Shader* shader, const Shader* skinnedShader)
+{
+    // batch world matrices per model, then cull & draw every batch like instances
+    for (auto& [model, transforms] : m_entityBatches)
+        transforms.clear();
+
+    m_world->each<ComponentsN::Transform, ComponentsN::Renderable>(
+        [this, skinnedShader](const ECSN::Entity entity, const ComponentsN::Transform& transform,
+                              const ComponentsN::Renderable& renderable)
+        {
+            if (renderable.model == nullptr ||
+                (skinnedShader != nullptr && m_world->has<ComponentsN::Animator>(entity)))
+                return;
+            m_entityBatches[renderable.model].push_back(transform.matrix);
+        });
+
+    for (const auto& [model, transforms] : m_entityBatches)
+    {
+        if (!transforms.empty())
+            renderModelInstances(model, shader, transforms);
+    }
+
+    if (skinnedShader == nullptr)
+        return;
+
+    // every animated entity has a pose of its own
+    m_world->each<ComponentsN::Transform, ComponentsN::Renderable, ComponentsN::Animator>(
+        [this, skinnedShader](ECSN::Entity, const ComponentsN::Transform& transform,
+                              const ComponentsN::Renderable& renderable, const ComponentsN::Animator& animator)
+        {
+            if (renderable.model == nullptr || animator.animator == nullptr)
+                return;
+            skinnedShader->use();
+            setBoneUniforms(skinnedShader, *animator.animator);
+            m_skinnedInstance.assign(1, transform.matrix);
+            renderModelInstances(renderable.model, skinnedShader, m_skinnedInstance);
+        });
+}
+
+// ------ Occlusion Culling ------ //
+
+bool Engine::createOcclusionCuller()
+{
+    if (m_occlusionCuller != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_OCCLUSION_CULLER::ERROR: Occlusion culler already exists at `"
+                  << m_occlusionCuller << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_occlusionCuller = new OcclusionCuller{this};
+    m_arena->addObject(m_occlusionCuller);
+    return true;
+}
+
+int Engine::addOccluder(const std::string& modelName, const glm::mat4& transform) const
+{
+    const Model* model{getModel(modelName)};
+    if (model == nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::ADD_OCCLUDER::ERROR: Model `" << modelName << "` does not exist!";
+        Util::endError();
+        return -1;
+    }
+    return m_occlusionCuller->addOccluder(model, transform);
+}
+
+void Engine::clearOccluders() const { m_occlusionCuller->clearOccluders(); }
+
+bool Engine::isOccluded(const CullingN::AABB& worldBox)
+{
+    // rasterize occluders once per frame, on first use
+    if (!m_occlusionRendered)
+    {
+        m_occlusionCuller->render(getProjectionMatrix() * getViewMatrix(), m_jobSystem);
+        m_occlusionRendered = true;
+    }
+    return !m_occlusionCuller->testAABB(worldBox);
+}
+
+void Engine::benchmarkOcclusion(const unsigned int frames)
+{
+    if (m_benchmarkFrames > 0 || frames == 0)
+        return;
+
+    m_benchmark.clear();
+    m_benchmarkRestoreOcclusion = m_occlusionCullingEnabled;
+    // start with occlusion off so it is the baseline series
+    m_occlusionCullingEnabled = false;
+    m_benchmarkFrames = frames;
+    std::cout << "ENGINE::BENCHMARK_OCCLUSION: Recording " << frames << " frames\n";
+}
+
+// ------ Scene Index ------ //
+
+namespace
+{
+    // fat boxes absorb small moves, the displacement lets fast movers get a box stretched along their motion
+    void syncProxy(DynamicBVH& index, SceneIndexN::Proxy& proxy, const CullingN::AABB& box, const unsigned int userData)
+    {
+        if (proxy.proxy == BVHN::NULL_NODE)
+        {
+            proxy.proxy = index.insert(box, userData);
+            return;
+        }
+        const CullingN::AABB& previous{index.getAABB(proxy.proxy)};
+        index.move(proxy.proxy, box, (box.min + box.max - previous.min - previous.max) * 0.5f);
+    }
+
+    template <typename Key>
+    void removeStale(DynamicBVH& index, std::unordered_map<Key, SceneIndexN::Proxy>& proxies, const unsigned int stamp)
+    {
+        for (auto it{proxies.begin()}; it != proxies.end();)
+        {
+            if (it->second.stamp == stamp)
+            {
+                ++it;
+                continue;
+            }
+            index.remove(it->second.proxy);
+            it = proxies.erase(it);
+        }
+    }
+} // namespace
+
+void Engine::updateSceneIndex()
+{
+    ++m_sceneIndexStamp;
+
+    // scene graph renderables, world transforms as of this update
+    updateSceneGraph();
+    const std::vector<glm::mat4>& world{m_sceneGraph->getWorldTransforms()};
+    const std::vector<SceneGraphN::Renderable>& renderables{m_sceneGraph->getRenderables()};
+    for (std::size_t i{0}; i < renderables.size(); ++i)
+    {
+        const SceneGraphN::Renderable& renderable{renderables[i]};
+        if (renderable.model == nullptr)
+            continue;
+
+        const CullingN::AABB& box{renderable.node >= 0 ? renderable.model->getNodes()[renderable.node].aabb
+                                                       : renderable.model->getAABB()};
+        const SceneGraphN::Handle handle{m_sceneGraph->getHandle(i)};
+        SceneIndexN::Proxy& proxy{m_nodeProxies[handle]};
+        proxy.stamp = m_sceneIndexStamp;
+        syncProxy(m_sceneIndex, proxy, CullingN::transformAABB(box, world[i]), handle);
+    }
+
+    // renderable entities, matrices as of the last updateWorld()
+    m_world->each<ComponentsN::Transform, ComponentsN::Renderable>(
+        [this](const ECSN::Entity entity, const ComponentsN::Transform& transform,
+               const ComponentsN::Renderable& renderable)
+        {
+            if (renderable.model == nullptr)
+                return;
+
+            SceneIndexN::Proxy& proxy{m_entityProxies[entity.index]};
+            proxy.generation = entity.generation;
+            proxy.stamp = m_sceneIndexStamp;
+            syncProxy(m_sceneIndex, proxy, CullingN::transformAABB(renderable.model->getAABB(), transform.matrix),
+                      entity.index | SceneIndexN::ENTITY_BIT);
+        });
+
+    // destroyed nodes & entities, or ones that stopped rendering
+    removeStale(m_sceneIndex, m_nodeProxies, m_sceneIndexStamp);
+    removeStale(m_sceneIndex, m_entityProxies, m_sceneIndexStamp);
+}
+
+ECSN::Entity Engine::getIndexedEntity(const unsigned int userData) const
+{
+    if (!SceneIndexN::isEntity(userData))
+        return ECSN::NULL_ENTITY;
+
+    const auto it{m_entityProxies.find(userData & ~SceneIndexN::ENTITY_BIT)};
+    if (it == m_entityProxies.end())
+        return ECSN::NULL_ENTITY;
+    const ECSN::Entity entity{it->first, it->second.generation};
+    return m_world->isAlive(entity) ? entity : ECSN::NULL_ENTITY;
+}
+
+bool Engine::pick(BVHN::RayHit& hit, const float maxDistance)
+{
+    // nodes or entities may have moved since beginRenderGraph()
+    updateSceneIndex();
+    return m_sceneIndex.raycast(getCursorRay(), maxDistance, hit);
+}
+
+// ------ Render Targets ------ //
+
+bool Engine::createRenderTargetPool()
+{
+    if (m_renderTargetPool != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_RENDER_TARGET_POOL::ERROR: Render target pool already exists at `"
+                  << m_renderTargetPool << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_renderTargetPool = new RenderTargetPool{this};
+    m_arena->addObject(m_renderTargetPool);
+    return true;
+}
+
+bool Engine::createRenderGraph()
+{
+    if (m_renderGraph != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_RENDER_GRAPH::ERROR: Render graph already exists at `" << m_renderGraph << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_renderGraph = new RenderGraph{this};
+    m_arena->addObject(m_renderGraph);
+    return true;
+}
+
+PostProcessingN::SceneTargets Engine::beginRenderGraph()
+{
+    m_renderGraph->reset(getWidth(), getHeight());
+
+    // what was drawn last frame is where things were
+    m_sceneGraph->storePreviousTransforms();
+    for (auto it{m_instanceHistory.begin()}; it != m_instanceHistory.end();)
+    {
+        InstanceHistory& history{it->second};
+        history.previous.swap(history.current);
+        history.current.clear();
+        it = history.previous.empty() ? m_instanceHistory.erase(it) : std::next(it);
+    }
+
+    m_postProcessor->updateResolution(m_renderGraph->getGpuFrameMs());
+    m_camera->setJitter(m_postProcessor->nextJitter());
+
+    m_previousViewProjection = m_viewProjection;
+    m_viewProjection = getUnjitteredProjectionMatrix() * getViewMatrix();
+    if (m_firstRenderGraph)
+    {
+        m_previousViewProjection = m_viewProjection;
+        m_firstRenderGraph = false;
+    }
+    m_postProcessor->setCameraMatrices(m_viewProjection, m_previousViewProjection);
+    // every shader writing motion vectors, the per draw uniforms are set where they're drawn
+    for (const char* name : {"texturePBR", "animationPBR"})
+    {
+        if (!shaderExists(name))
+            continue;
+        const Shader* shader{getShader(name)};
+        shader->use();
+        setVelocityUniforms(shader);
+    }
+    glUseProgram(0);
+    m_postProcessor->setDeltaTime(getDeltaTime());
+    updateSceneIndex();
+    // the jitter stays within a pixel, the clusters are built for the unjittered projection
+    m_clusteredLighting->update(getViewMatrix(), getUnjitteredProjectionMatrix(), m_jobSystem);
+
+    return m_postProcessor->addSceneTargets(*m_renderGraph);
+}
+
+void Engine::executeRenderGraph(const PostProcessingN::SceneTargets& targets) const
+{
+    m_postProcessor->addPasses(*m_renderGraph, targets, getShader("bloomSS"));
+    m_renderGraph->execute();
+    // the finished frame, before anything else draws into the default framebuffer
+    m_frameCapture->captureFrame(getWidth(), getHeight());
+}
+
 // ------ Post Processor ------ //
 
 bool Engine::createPostProcessor()
@@ -784,13 +1650,51 @@ bool Engine::createPostProcessor()
     return true;
 }
 
-void Engine::enablePostProcessing() const { m_postProcessor->enable(); }
+void Engine::updatePostProcessor(const int width, const int height) { m_postProcessor->generate(width, height); }
 
-void Engine::disablePostProcessing() const { m_postProcessor->disable(); }
+void Engine::benchmarkBloom(const unsigned int frames) const
+{
+    if (m_renderGraph->getBenchmarkRunning() || frames == 0)
+        return;
 
-void Engine::renderPostProcessing() const { m_postProcessor->render(getShader("bloomSS")); }
+    if (m_postProcessor->benchmarkBloom(frames))
+        m_renderGraph->benchmark(frames + frames % 2);
+}
 
-void Engine::updatePostProcessor(const int width, const int height) { m_postProcessor->generate(width, height, static_cast<void*>(this)); }
+// ------ Frame Capture ------ //
+
+bool Engine::createFrameCapture()
+{
+    if (m_frameCapture != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_FRAME_CAPTURE::ERROR: Frame capture already exists at `" << m_frameCapture << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_frameCapture = new FrameCapture{this};
+    m_arena->addObject(m_frameCapture);
+    return true;
+}
+
+// ------ Clustered Lighting ------ //
+
+bool Engine::createClusteredLighting()
+{
+    if (m_clusteredLighting != nullptr)
+    {
+        Util::beginError();
+        std::cout << "ENGINE::CREATE_CLUSTERED_LIGHTING::ERROR: Clustered lighting already exists at `"
+                  << m_clusteredLighting << "`";
+        Util::endError();
+        return false;
+    }
+
+    m_clusteredLighting = new ClusteredLighting{this};
+    m_arena->addObject(m_clusteredLighting);
+    return true;
+}
 
 
 // ------ Arena ------ //
@@ -3,18 +3,55 @@
 
 #include <glad/glad.h>
 
+#include <cstdint>
+#include <unordered_map>
+
 #include "arena.hpp"
+#include "benchmark.hpp"
+#include "bvh.hpp"
 #include "camera.hpp"
 #include "clock.hpp"
+#include "clusteredlighting.hpp"
+#include "components.hpp"
+#include "culling.hpp"
+#include "ecs.hpp"
 #include "engine_types.hpp"
+#include "framecapture.hpp"
 #include "iohandler.hpp"
+#include "jobs.hpp"
+#include "material.hpp"
+#include "materialarray.hpp"
 #include "model.hpp"
+#include "occlusion.hpp"
 #include "postprocessing.hpp"
+#include "rendergraph.hpp"
+#include "rendertargetpool.hpp"
+#include "scenegraph.hpp"
 #include "shader.hpp"
 #include "shapes.hpp"
+#include "stats.hpp"
 #include "texture.hpp"
+#include "texturecache.hpp"
+#include "texturestream.hpp"
+#include "textureupload.hpp"
 #include "window.hpp"
 
+namespace SceneIndexN
+{
+    // userData of scene index proxies: scene graph handles as they are, entity indices with ENTITY_BIT set
+    constexpr unsigned int ENTITY_BIT{0x80000000};
+
+    [[nodiscard]] inline bool isEntity(const unsigned int userData) { return (userData & ENTITY_BIT) != 0; }
+
+    // proxy of a renderable, stamp = last sync that saw it
+    struct Proxy
+    {
+        int proxy{BVHN::NULL_NODE};
+        std::uint32_t generation{0};
+        unsigned int stamp{0};
+    };
+} // namespace SceneIndexN
+
 class Engine final : public EngineObject
 {
 public:
@@ -46,6 +83,10 @@ public:
 
     void displayFrameTime();
 
+    // render stats for the current frame (reset in update())
+    [[nodiscard]] StatsN::FrameStats& getFrameStats() { return m_frameStats; }
+    [[nodiscard]] const StatsN::FrameStats& getFrameStats() const { return m_frameStats; }
+
     // ------ IOHandler ------ //
 
     // create iohandler for keyboard input
@@ -67,6 +108,12 @@ public:
     // get time since start from clock in milliseconds
     [[nodiscard]] float getTime() const;
 
+    // ------ Jobs ------ //
+
+    // create worker thread pool
+    bool createJobSystem();
+    [[nodiscard]] JobSystem* getJobSystem() const { return m_jobSystem; }
+
     // ------ Shaders ------ //
 
     // create shader manager
@@ -110,6 +157,17 @@ public:
 
     // ------ Textures ------ //
 
+    bool createTextureCache();
+    [[nodiscard]] TextureCache* getTextureCache() const { return m_textureCache; }
+    bool createTextureUploader();
+    [[nodiscard]] TextureUploader* getTextureUploader() const { return m_textureUploader; }
+    bool createTextureStreamer();
+    [[nodiscard]] TextureStreamer* getTextureStreamer() const { return m_textureStreamer; }
+    bool createMaterialArrays();
+    [[nodiscard]] MaterialArrays* getMaterialArrays() const { return m_materialArrays; }
+    bool createMaterialLibrary();
+    [[nodiscard]] MaterialLibrary* getMaterialLibrary() const { return m_materialLibrary; }
+
     bool createTextureManager();
     [[nodiscard]] TextureManager* getTextureManager() const { return m_textureManager; }
 
@@ -141,11 +199,27 @@ public:
     bool createCamera();
     [[nodiscard]] Camera* getCamera() const { return m_camera; }
 
-    // view & perspective matrices getters
+    // view & perspective matrices getters, the projection is jittered while temporal AA is on
     [[nodiscard]] glm::mat4 getViewMatrix() const;
     [[nodiscard]] glm::mat4 getProjectionMatrix() const;
+    [[nodiscard]] glm::mat4 getUnjitteredProjectionMatrix() const;
+    // unjittered view projection of this & the last frame (motion vectors), updated by beginRenderGraph()
+    [[nodiscard]] const glm::mat4& getViewProjection() const { return m_viewProjection; }
+    [[nodiscard]] const glm::mat4& getPreviousViewProjection() const { return m_previousViewProjection; }
+    // set both on a shader writing motion vectors, beginRenderGraph() does it for the PBR shaders
+    void setVelocityUniforms(const Shader* shader) const;
+    // upload this & the previous frame's pose of animator to a skinned shader (animationPBR)
+    static void setBoneUniforms(const Shader* shader, const BoneAnimator& animator);
     [[nodiscard]] glm::vec3 getCameraPosition() const;
 
+    // frustum planes from the current view & projection matrices
+    [[nodiscard]] CullingN::Frustum getFrustum() const;
+
+    // world space ray through the cursor (screen center while the camera captures the mouse)
+    [[nodiscard]] BVHN::Ray getCursorRay() const;
+    // world space ray through window coordinates (pixels, origin top left)
+    [[nodiscard]] BVHN::Ray getScreenRay(float x, float y) const;
+
     // get normal mat from model mat
     [[nodiscard]] glm::mat4 getNormalMatrix(const glm::mat4& model) const;
 
@@ -162,22 +236,108 @@ public:
     [[nodiscard]] Model* getModel(const std::string& name) const;
     void renderModel(const std::string& name, const Shader* shader) const;
     [[nodiscard]] bool modelExists(const std::string& name) const;
+    // bake block compressed versions of a model's textures (offline step, used from the next load on)
+    unsigned int bakeModelTextures(const std::string& name) const;
+    // move a model's materials into texture array pages (see MaterialArrays), returns number of meshes packed
+    unsigned int packModelMaterials(const std::string& name) const;
+
+    // frustum cull instances of model, fills visible with indices into transforms and updates frame stats
+    void cullInstances(const Model* model, const std::vector<glm::mat4>& transforms,
+                       std::vector<unsigned int>& visible);
+    // cull, then render the visible instances (sets `model` and `normalMat` uniforms)
+    void renderModelInstances(const std::string& name, const Shader* shader, const std::vector<glm::mat4>& transforms);
+    void renderModelInstances(const Model* model, const Shader* shader, const std::vector<glm::mat4>& transforms);
+
+    // ------ Scene Graph ------ //
+
+    bool createSceneGraph();
+    [[nodiscard]] SceneGraph* getSceneGraph() const { return m_sceneGraph; }
+
+    // recompute dirty world transforms on the job system
+    void updateSceneGraph() const;
+    // update the scene graph, then cull & render every renderable node with its world transform
+    void renderScene(const Shader* shader);
+
+    // ------ World ------ //
+
+    // create the entity world with the built in rigid body, animator & transform systems
+    bool createWorld();
+    [[nodiscard]] World* getWorld() const { return m_world; }
+
+    // run world systems with the frame's delta time
+    void updateWorld() const;
+    // cull & render every entity with a Transform and a Renderable, entities with an Animator are drawn one by one
+    // with their pose if a skinned shader is given
+    void renderEntities(const Shader* shader, const Shader* skinnedShader = nullptr);
+
+    // ------ Occlusion Culling ------ //
+
+    bool createOcclusionCuller();
+    [[nodiscard]] OcclusionCuller* getOcclusionCuller() const { return m_occlusionCuller; }
+
+    // test frustum visible instances against occluders in cullInstances()
+    void setOcclusionCullingEnabled(bool value) { m_occlusionCullingEnabled = value; }
+    [[nodiscard]] bool getOcclusionCullingEnabled() const { return m_occlusionCullingEnabled; }
+
+    // register an instance of a model as an occluder, returns the occluder index
+    int addOccluder(const std::string& modelName, const glm::mat4& transform) const;
+    void clearOccluders() const;
+
+    // alternate occlusion culling on & off for the next frames and print cpu time & draw counts of both
+    void benchmarkOcclusion(unsigned int frames);
+    [[nodiscard]] bool getBenchmarkRunning() const { return m_benchmarkFrames > 0; }
+
+    // ------ Scene Index ------ //
+
+    // spatial index over scene instances (culling, picking, gameplay queries), one proxy per scene graph renderable
+    // & renderable entity, see SceneIndexN for their userData
+    [[nodiscard]] DynamicBVH& getSceneIndex() { return m_sceneIndex; }
+    [[nodiscard]] const DynamicBVH& getSceneIndex() const { return m_sceneIndex; }
+    // insert, move & remove proxies to match the scene graph & the world, once per frame in beginRenderGraph()
+    void updateSceneIndex();
+    // entity of an entity proxy's userData, NULL_ENTITY if it is gone
+    [[nodiscard]] ECSN::Entity getIndexedEntity(unsigned int userData) const;
+
+    // raycast the (synced) scene index from the cursor, returns false if nothing was hit
+    bool pick(BVHN::RayHit& hit, float maxDistance = 1000.0f);
+
+    // ------ Render Targets ------ //
+
+    bool createRenderTargetPool();
+    [[nodiscard]] RenderTargetPool* getRenderTargetPool() const { return m_renderTargetPool; }
+
+    bool createRenderGraph();
+    [[nodiscard]] RenderGraph* getRenderGraph() const { return m_renderGraph; }
+
+    // start declaring this frame's passes, pick the dynamic resolution scale & the camera jitter, make last frame's
+    // transforms the previous ones & build the light clusters, returns the hdr targets the scene passes draw into
+    PostProcessingN::SceneTargets beginRenderGraph();
+    // add the post processing passes, then compile & run the frame
+    void executeRenderGraph(const PostProcessingN::SceneTargets& targets) const;
 
     // ------ Post Processor ------ //
 
     bool createPostProcessor();
     [[nodiscard]] PostProcessor* getPostProcessor() const { return m_postProcessor; }
 
-    // enable and disable rendering to post processor
-    void enablePostProcessing() const;
-    void disablePostProcessing() const;
-
-    // render post processor with screen shader
-    void renderPostProcessing() const;
-
     // update framebuffer
     void updatePostProcessor(int width, int height);
 
+    // alternate the compute & fragment bloom paths for the next frames & print the pass timings of both
+    void benchmarkBloom(unsigned int frames) const;
+
+    // ------ Frame Capture ------ //
+
+    bool createFrameCapture();
+    // screenshots, recordings & captures of render graph targets, read back without stalling the frame
+    [[nodiscard]] FrameCapture* getFrameCapture() const { return m_frameCapture; }
+
+    // ------ Clustered Lighting ------ //
+
+    bool createClusteredLighting();
+    // point & spot lights of the PBR shaders, assigned to the clusters of the view in beginRenderGraph()
+    [[nodiscard]] ClusteredLighting* getClusteredLighting() const { return m_clusteredLighting; }
+
     // ------ Arena ------ //
 
     // Arena operations
@@ -205,26 +365,76 @@ private:
 
     // managers
     ShaderManager* m_shaderManager{nullptr};
+    TextureCache* m_textureCache{nullptr};
+    TextureUploader* m_textureUploader{nullptr};
+    TextureStreamer* m_textureStreamer{nullptr};
+    MaterialArrays* m_materialArrays{nullptr};
+    MaterialLibrary* m_materialLibrary{nullptr};
     TextureManager* m_textureManager{nullptr};
     ShapeManager* m_shapeManager{nullptr};
     ModelManager* m_modelManager{nullptr};
 
     // other components
+    RenderTargetPool* m_renderTargetPool{nullptr};
+    RenderGraph* m_renderGraph{nullptr};
     PostProcessor* m_postProcessor{nullptr};
+    FrameCapture* m_frameCapture{nullptr};
+    ClusteredLighting* m_clusteredLighting{nullptr};
+    JobSystem* m_jobSystem{nullptr};
+    OcclusionCuller* m_occlusionCuller{nullptr};
+    SceneGraph* m_sceneGraph{nullptr};
+    World* m_world{nullptr};
+    DynamicBVH m_sceneIndex{};
+    std::unordered_map<SceneGraphN::Handle, SceneIndexN::Proxy> m_nodeProxies{};
+    // by entity index
+    std::unordered_map<std::uint32_t, SceneIndexN::Proxy> m_entityProxies{};
+    unsigned int m_sceneIndexStamp{0};
 
     // camera stuff
     Camera* m_camera{nullptr};
     float m_camLastX{};
     float m_camLastY{};
 
+    // unjittered view projections for motion vectors
+    glm::mat4 m_viewProjection{1.0f};
+    glm::mat4 m_previousViewProjection{1.0f};
+    bool m_firstRenderGraph{true};
+
     // flags
     bool m_checkedShaders{false}; // shaders.json checked
     bool m_loadedShaders{false}; // shaders loaded
     bool m_camFirstMouse{true}; // first mouse movement
     bool m_cameraEnabled{false}; // camera enabled
+    bool m_occlusionCullingEnabled{true}; // occlusion culling enabled
+    bool m_occlusionRendered{false}; // occluders rasterized this frame
 
     // miscallaneous stuff
     std::vector<float> m_deltaTimes{};
+    StatsN::FrameStats m_frameStats{};
+
+    // scratch buffers for instance culling (reused every frame)
+    std::vector<CullingN::Sphere> m_cullSpheres{};
+    std::vector<unsigned int> m_visibleInstances{};
+    std::vector<unsigned int> m_sceneNodes{}; // scene graph index of every gathered sphere
+    std::map<const Model*, std::vector<glm::mat4>> m_entityBatches{}; // entity world matrices per model
+    std::vector<glm::mat4> m_skinnedInstance{}; // world matrix of the animated entity being drawn
+    // instance world matrices drawn per model last & this frame in draw order, previousModel of the motion vectors
+    struct InstanceHistory
+    {
+        std::vector<glm::mat4> previous{};
+        std::vector<glm::mat4> current{};
+    };
+    std::map<const Model*, InstanceHistory> m_instanceHistory{};
+
+    // occlusion benchmark state
+    Benchmark m_benchmark{"Occlusion culling"};
+    unsigned int m_benchmarkFrames{0};
+    bool m_benchmarkRestoreOcclusion{true};
+
+    // test against occluders, rasterizing them first if needed this frame
+    [[nodiscard]] bool isOccluded(const CullingN::AABB& worldBox);
+    // report the drawn meshes of model (or one of its nodes) to the texture streamer
+    void requestTextureMips(const Model* model, int node, const glm::mat4& transform) const;
 };
 
 #endif
@@ -0,0 +1,446 @@
+#include "framecapture.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "util.hpp"
+
+namespace
+{
+    // deflate stored blocks hold at most this many bytes
+    constexpr std::size_t STORED_BLOCK_BYTES{65535};
+
+    std::uint32_t crc32(const unsigned char* data, const std::size_t size, std::uint32_t crc = 0xFFFFFFFFu)
+    {
+        static const std::array<std::uint32_t, 256> table{[]
+        {
+            std::array<std::uint32_t, 256> result{};
+            for (std::uint32_t i{0}; i < 256; ++i)
+            {
+                std::uint32_t c{i};
+                for (int bit{0}; bit < 8; ++bit)
+                    c = (c & 1u) != 0 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                result[i] = c;
+            }
+            return result;
+        }()};
+
+        for (std::size_t i{0}; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+        return crc;
+    }
+
+    std::uint32_t adler32(const unsigned char* data, const std::size_t size)
+    {
+        std::uint32_t a{1};
+        std::uint32_t b{0};
+        for (std::size_t i{0}; i < size; ++i)
+        {
+            a = (a + data[i]) % 65521u;
+            b = (b + a) % 65521u;
+        }
+        return b << 16 | a;
+    }
+
+    void putBigEndian(std::vector<unsigned char>& out, const std::uint32_t value)
+    {
+        out.push_back(static_cast<unsigned char>(value >> 24));
+        out.push_back(static_cast<unsigned char>(value >> 16));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    // length, type, data & the crc of type + data
+    void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data)
+    {
+        std::vector<unsigned char> chunk{};
+        chunk.reserve(data.size() + 12);
+        putBigEndian(chunk, static_cast<std::uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        putBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4) ^ 0xFFFFFFFFu);
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+
+    std::FILE* openStream(const std::string& path, bool& pipe)
+    {
+        pipe = !path.empty() && path[0] == '|';
+#ifdef _WIN32
+        return pipe ? _popen(path.c_str() + 1, "wb") : std::fopen(path.c_str(), "wb");
+#else
+        return pipe ? popen(path.c_str() + 1, "w") : std::fopen(path.c_str(), "wb");
+#endif
+    }
+
+    void closeStream(std::FILE* stream, const bool pipe)
+    {
+#ifdef _WIN32
+        pipe ? _pclose(stream) : std::fclose(stream);
+#else
+        pipe ? pclose(stream) : std::fclose(stream);
+#endif
+    }
+} // namespace
+
+bool FrameCaptureN::writePNG(const std::string& path, const unsigned char* pixels, const int width, const int height)
+{
+    std::ofstream file{path, std::ios::binary};
+    if (!file || width <= 0 || height <= 0)
+    {
+        Util::beginError();
+        std::cout << "FRAME_CAPTURE::WRITE_PNG::ERROR: Could not write `" << path << "`";
+        Util::endError();
+        return false;
+    }
+
+    constexpr unsigned char signature[]{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    // 8 bits per channel, RGBA, no interlacing
+    std::vector<unsigned char> header{};
+    putBigEndian(header, static_cast<std::uint32_t>(width));
+    putBigEndian(header, static_cast<std::uint32_t>(height));
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    writeChunk(file, "IHDR", header);
+
+    // every row starts with its filter type (none)
+    const std::size_t rowBytes{static_cast<std::size_t>(width) * 4};
+    std::vector<unsigned char> rows(static_cast<std::size_t>(height) * (rowBytes + 1));
+    for (std::size_t y{0}; y < static_cast<std::size_t>(height); ++y)
+    {
+        rows[y * (rowBytes + 1)] = 0;
+        std::memcpy(&rows[y * (rowBytes + 1) + 1], pixels + y * rowBytes, rowBytes);
+    }
+
+    // zlib stream of stored blocks, compressing is left to whoever archives the images
+    std::vector<unsigned char> data{0x78, 0x01};
+    data.reserve(rows.size() + rows.size() / STORED_BLOCK_BYTES * 5 + 11);
+    for (std::size_t offset{0}; offset < rows.size(); offset += STORED_BLOCK_BYTES)
+    {
+        const std::size_t size{std::min(STORED_BLOCK_BYTES, rows.size() - offset)};
+        const bool last{offset + size >= rows.size()};
+        data.push_back(last ? 1 : 0);
+        data.push_back(static_cast<unsigned char>(size));
+        data.push_back(static_cast<unsigned char>(size >> 8));
+        data.push_back(static_cast<unsigned char>(~size));
+        data.push_back(static_cast<unsigned char>(~size >> 8));
+        data.insert(data.end(), rows.begin() + static_cast<std::ptrdiff_t>(offset),
+                    rows.begin() + static_cast<std::ptrdiff_t>(offset + size));
+    }
+    putBigEndian(data, adler32(rows.data(), rows.size()));
+    writeChunk(file, "IDAT", data);
+    writeChunk(file, "IEND", {});
+
+    return static_cast<bool>(file);
+}
+
+FrameCapture::FrameCapture(EngineObject* parent) : EngineObject{"FrameCapture", parent}
+{
+    glGenFramebuffers(1, &m_FBO);
+    m_writer = std::thread{&FrameCapture::writerLoop, this};
+}
+
+FrameCapture::~FrameCapture()
+{
+    stopRecording();
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_condition.notify_one();
+    m_writer.join();
+
+    for (const Buffer& buffer : m_freeBuffers)
+        glDeleteBuffers(1, &buffer.PBO);
+    glDeleteFramebuffers(1, &m_FBO);
+}
+
+void FrameCapture::screenshot(const std::string& path) { m_screenshotPath = path; }
+
+void FrameCapture::startRecording(const std::string& path)
+{
+    stopRecording();
+    m_readbacks.push_back(Readback{Buffer{}, nullptr, FrameCaptureN::Frame{FrameCaptureN::Task::OPEN_STREAM, path}});
+    m_recording = true;
+}
+
+void FrameCapture::stopRecording()
+{
+    if (!m_recording)
+        return;
+    m_readbacks.push_back(Readback{Buffer{}, nullptr, FrameCaptureN::Frame{FrameCaptureN::Task::CLOSE_STREAM}});
+    m_recording = false;
+}
+
+void FrameCapture::captureFrame(const int width, const int height)
+{
+    if ((m_screenshotPath.empty() && !m_recording) || width <= 0 || height <= 0)
+        return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    if (!m_screenshotPath.empty())
+    {
+        readPixels(FrameCaptureN::Frame{FrameCaptureN::Task::PNG, m_screenshotPath, width, height});
+        m_screenshotPath.clear();
+    }
+    if (m_recording)
+        readPixels(FrameCaptureN::Frame{FrameCaptureN::Task::RAW, "", width, height});
+}
+
+void FrameCapture::addCapturePass(RenderGraph& graph, const RenderGraphN::Resource resource, const std::string& path)
+{
+    const RenderTargetN::Desc& desc{graph.getDesc(resource)};
+    if (resource <= RenderGraphN::BACKBUFFER || RenderTargetN::isDepthFormat(desc.internalFormat) || desc.samples > 0)
+    {
+        Util::beginError();
+        std::cout << "FRAME_CAPTURE::ADD_CAPTURE_PASS::ERROR: Only single sampled color targets can be captured!";
+        Util::endError();
+        return;
+    }
+
+    RenderGraphN::Pass pass{};
+    pass.name = "capture";
+    pass.reads = {resource};
+    pass.sideEffects = true;
+    pass.execute = [this, resource, path](const RenderGraph& renderGraph)
+    {
+        const glm::ivec2 region{renderGraph.getRegion(resource)};
+
+        GLint previous{0};
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               renderGraph.getTexture(resource), 0);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        readPixels(FrameCaptureN::Frame{FrameCaptureN::Task::PNG, path, region.x, region.y});
+        // the pool may delete the texture, don't keep it attached
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previous));
+    };
+    graph.addPass(std::move(pass));
+}
+
+void FrameCapture::update()
+{
+    while (!m_readbacks.empty() && finishOldest(0))
+    {
+    }
+}
+
+void FrameCapture::flush()
+{
+    while (!m_readbacks.empty())
+    {
+        if (finishOldest(FrameCaptureN::FENCE_TIMEOUT))
+            continue;
+
+        Util::beginError();
+        std::cout << "FRAME_CAPTURE::FLUSH::ERROR: Gave up waiting for a readback!";
+        Util::endError();
+        dropOldest();
+    }
+
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_written.wait(lock, [this] { return m_frames.empty() && !m_writing; });
+}
+
+void FrameCapture::readPixels(FrameCaptureN::Frame frame)
+{
+    const GLsizeiptr size{static_cast<GLsizeiptr>(frame.width) * frame.height * 4};
+    const Buffer buffer{acquireBuffer(size)};
+
+    // returns right away, the copy lands in the buffer whenever the gpu gets there
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.PBO);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, frame.width, frame.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_readbacks.push_back(Readback{buffer, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(frame)});
+}
+
+FrameCapture::Buffer FrameCapture::acquireBuffer(const GLsizeiptr size)
+{
+    // ring is full, the oldest readback is a few frames old by now
+    while (m_freeBuffers.empty() && m_bufferCount >= FrameCaptureN::RING_SLOTS && !m_readbacks.empty())
+    {
+        if (finishOldest(FrameCaptureN::FENCE_TIMEOUT))
+            continue;
+
+        // a fence that fails or never signals would stall every frame from here on
+        Util::beginError();
+        std::cout << "FRAME_CAPTURE::ACQUIRE_BUFFER::ERROR: Gave up waiting for a readback, dropped its frame!";
+        Util::endError();
+        dropOldest();
+    }
+
+    Buffer buffer{};
+    if (m_freeBuffers.empty())
+    {
+        glGenBuffers(1, &buffer.PBO);
+        ++m_bufferCount;
+    }
+    else
+    {
+        buffer = m_freeBuffers.back();
+        m_freeBuffers.pop_back();
+    }
+
+    if (buffer.size < size)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.PBO);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        buffer.size = size;
+    }
+    return buffer;
+}
+
+bool FrameCapture::finishOldest(const GLuint64 timeout)
+{
+    Readback& readback{m_readbacks.front()};
+    if (readback.fence != nullptr)
+    {
+        const GLenum status{glClientWaitSync(readback.fence, timeout > 0 ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout)};
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+            return false;
+    }
+
+    // keep the copy in the ring while the writer is behind, unless asked to wait
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        if (m_frames.size() >= FrameCaptureN::MAX_QUEUED_FRAMES)
+        {
+            if (timeout == 0)
+                return false;
+            m_written.wait(lock, [this] { return m_frames.size() < FrameCaptureN::MAX_QUEUED_FRAMES; });
+        }
+    }
+
+    FrameCaptureN::Frame frame{std::move(readback.frame)};
+    bool mapped{true};
+    if (readback.buffer.PBO != 0)
+    {
+        glDeleteSync(readback.fence);
+
+        // gl rows start at the bottom
+        const std::size_t rowBytes{static_cast<std::size_t>(frame.width) * 4};
+        const std::size_t height{static_cast<std::size_t>(frame.height)};
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.PBO);
+        const auto* source{static_cast<const unsigned char*>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(rowBytes * height), GL_MAP_READ_BIT))};
+        mapped = source != nullptr;
+        if (mapped)
+        {
+            frame.pixels.resize(rowBytes * height);
+            for (std::size_t y{0}; y < height; ++y)
+                std::memcpy(&frame.pixels[y * rowBytes], source + (height - 1 - y) * rowBytes, rowBytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        m_freeBuffers.push_back(readback.buffer);
+    }
+    m_readbacks.pop_front();
+
+    if (!mapped)
+    {
+        Util::beginError();
+        std::cout << "FRAME_CAPTURE::FINISH_OLDEST::ERROR: Could not map a readback, dropped the frame!";
+        Util::endError();
+        return true;
+    }
+    queueFrame(std::move(frame));
+    return true;
+}
+
+void FrameCapture::dropOldest()
+{
+    Readback& readback{m_readbacks.front()};
+    if (readback.buffer.PBO != 0)
+    {
+        glDeleteSync(readback.fence);
+        m_freeBuffers.push_back(readback.buffer);
+    }
+    m_readbacks.pop_front();
+}
+
+void FrameCapture::queueFrame(FrameCaptureN::Frame frame)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_frames.push_back(std::move(frame));
+    }
+    m_condition.notify_one();
+}
+
+void FrameCapture::writerLoop()
+{
+    std::FILE* stream{nullptr};
+    bool pipe{false};
+
+    while (true)
+    {
+        FrameCaptureN::Frame frame{};
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_condition.wait(lock, [this] { return m_stop || !m_frames.empty(); });
+            if (m_frames.empty())
+                break;
+            frame = std::move(m_frames.front());
+            m_frames.pop_front();
+            m_writing = true;
+        }
+
+        switch (frame.task)
+        {
+        case FrameCaptureN::Task::PNG:
+            if (FrameCaptureN::writePNG(frame.path, frame.pixels.data(), frame.width, frame.height))
+                std::cout << "FRAME_CAPTURE::WRITE: Saved `" << frame.path << "`\n";
+            break;
+        case FrameCaptureN::Task::RAW:
+            if (stream != nullptr &&
+                std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), stream) != frame.pixels.size())
+            {
+                Util::beginError();
+                std::cout << "FRAME_CAPTURE::WRITE::ERROR: Recording stream failed, closed it!";
+                Util::endError();
+                closeStream(stream, pipe);
+                stream = nullptr;
+            }
+            break;
+        case FrameCaptureN::Task::OPEN_STREAM:
+            if (stream != nullptr)
+                closeStream(stream, pipe);
+            stream = openStream(frame.path, pipe);
+            if (stream == nullptr)
+            {
+                Util::beginError();
+                std::cout << "FRAME_CAPTURE::WRITE::ERROR: Could not open `" << frame.path << "` for recording!";
+                Util::endError();
+            }
+            break;
+        case FrameCaptureN::Task::CLOSE_STREAM:
+            if (stream != nullptr)
+                closeStream(stream, pipe);
+            stream = nullptr;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_writing = false;
+        }
+        m_written.notify_all();
+    }
+
+    if (stream != nullptr)
+        closeStream(stream, pipe);
+}
@@ -0,0 +1,131 @@
+// Frame capture for screenshots, golden images & recorded replays.
+// Reading pixels straight into client memory waits for the gpu to finish the frame, so captures are copied into a
+// ring of pixel pack buffers instead and fenced. A few frames later, once the fence has passed, the buffer is mapped
+// without waiting and its copy goes to a writer thread that encodes png files or streams raw frames to a file or the
+// stdin of a command (ffmpeg). Captures stay in submission order, so a stream is opened, written & closed in order.
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine_types.hpp"
+#include "rendergraph.hpp"
+
+namespace FrameCaptureN
+{
+    // readbacks in flight, capturing with all of them busy waits for the oldest
+    constexpr std::size_t RING_SLOTS{4};
+    // frames waiting for the writer before finished readbacks are left in the ring (the disk can't keep up)
+    constexpr std::size_t MAX_QUEUED_FRAMES{8};
+    // wait for a readback fence at most this long (ns)
+    constexpr GLuint64 FENCE_TIMEOUT{1000000000};
+
+    enum class Task
+    {
+        PNG,
+        // rows of the open stream
+        RAW,
+        OPEN_STREAM,
+        CLOSE_STREAM,
+    };
+
+    // pixels are RGBA8 rows from the top
+    struct Frame
+    {
+        Task task{Task::PNG};
+        std::string path{};
+        int width{0};
+        int height{0};
+        std::vector<unsigned char> pixels{};
+    };
+
+    // 8 bit RGBA png with stored (uncompressed) deflate blocks, rows from the top
+    bool writePNG(const std::string& path, const unsigned char* pixels, int width, int height);
+} // namespace FrameCaptureN
+
+class FrameCapture final : public EngineObject
+{
+public:
+    explicit FrameCapture(EngineObject* parent);
+    // writes everything captured so far
+    ~FrameCapture() override;
+
+    // save the next frame to path as png
+    void screenshot(const std::string& path);
+    // write every frame as raw RGBA8 rows from the top to path, or to the stdin of the command after a leading '|'
+    // (e.g. "|ffmpeg -f rawvideo -pix_fmt rgba -s 640x480 -i - out.mp4"), the window size must not change meanwhile
+    void startRecording(const std::string& path);
+    void stopRecording();
+    [[nodiscard]] bool getRecording() const { return m_recording; }
+
+    // read back the default framebuffer if a screenshot or the recording wants it, call once the frame is drawn
+    void captureFrame(int width, int height);
+    // read back the region of a color target once its writers are done & save it as png (hdr values are clamped)
+    void addCapturePass(RenderGraph& graph, RenderGraphN::Resource resource, const std::string& path);
+
+    // hand readbacks whose fence has passed to the writer, never waits, call once per frame
+    void update();
+    // block until everything captured so far is written
+    void flush();
+
+    // captures read back or still waiting for the gpu
+    [[nodiscard]] std::size_t getPendingCount() const { return m_readbacks.size(); }
+
+private:
+    struct Buffer
+    {
+        unsigned int PBO{0};
+        GLsizeiptr size{0};
+    };
+
+    // stream tasks have no buffer
+    struct Readback
+    {
+        Buffer buffer{};
+        GLsync fence{nullptr};
+        FrameCaptureN::Frame frame{};
+    };
+
+    // framebuffer capture passes attach their target to
+    unsigned int m_FBO{0};
+    // pixel pack buffers not in flight
+    std::vector<Buffer> m_freeBuffers{};
+    std::size_t m_bufferCount{0};
+    // submission order, streams are opened & closed in here too
+    std::deque<Readback> m_readbacks{};
+
+    std::string m_screenshotPath{};
+    bool m_recording{false};
+
+    // writer thread
+    std::thread m_writer{};
+    std::mutex m_mutex{};
+    std::condition_variable m_condition{};
+    // signaled whenever the writer finished a frame
+    std::condition_variable m_written{};
+    std::deque<FrameCaptureN::Frame> m_frames{};
+    bool m_writing{false};
+    bool m_stop{false};
+
+    // copy width x height pixels from the bound read framebuffer into a buffer of the ring
+    void readPixels(FrameCaptureN::Frame frame);
+    // a free pixel pack buffer of at least size bytes, waits for the oldest readback if the ring is full
+    Buffer acquireBuffer(GLsizeiptr size);
+    // map the oldest readback, queue its frame & recycle the buffer, false if its fence didn't pass within timeout
+    bool finishOldest(GLuint64 timeout);
+    // give up on the oldest readback, recycles its buffer
+    void dropOldest();
+    void queueFrame(FrameCaptureN::Frame frame);
+    void writerLoop();
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "glext.hpp"
+
+#include <cstring>
+#include <iostream>
+
+GLExtN::PFNTEXSTORAGE2D GLExtN::texStorage2D{nullptr};
+GLExtN::PFNBUFFERSTORAGE GLExtN::bufferStorage{nullptr};
+GLExtN::PFNDISPATCHCOMPUTE GLExtN::dispatchCompute{nullptr};
+GLExtN::PFNBINDIMAGETEXTURE GLExtN::bindImageTexture{nullptr};
+GLExtN::PFNMEMORYBARRIER GLExtN::memoryBarrier{nullptr};
+
+namespace
+{
+    bool g_s3tc{false};
+    bool g_bptc{false};
+
+    bool supportsVersion(const int major, const int minor)
+    {
+        GLint contextMajor{0}, contextMinor{0};
+        glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+        glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+        return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+    }
+} // namespace
+
+bool GLExtN::hasExtension(const char* name)
+{
+    GLint count{0};
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i{0}; i < count; ++i)
+    {
+        const char* extension{reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)))};
+        if (extension != nullptr && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+void GLExtN::load(const GLADloadproc getProcAddress)
+{
+    // only trust the pointers if the version or extension says so, some drivers hand out stubs
+    if (supportsVersion(4, 2) || hasExtension("GL_ARB_texture_storage"))
+        texStorage2D = reinterpret_cast<PFNTEXSTORAGE2D>(getProcAddress("glTexStorage2D"));
+    if (supportsVersion(4, 4) || hasExtension("GL_ARB_buffer_storage"))
+        bufferStorage = reinterpret_cast<PFNBUFFERSTORAGE>(getProcAddress("glBufferStorage"));
+    // compute shaders are compiled as #version 430, so the context itself has to be 4.3
+    if (supportsVersion(4, 3))
+    {
+        dispatchCompute = reinterpret_cast<PFNDISPATCHCOMPUTE>(getProcAddress("glDispatchCompute"));
+        bindImageTexture = reinterpret_cast<PFNBINDIMAGETEXTURE>(getProcAddress("glBindImageTexture"));
+        memoryBarrier = reinterpret_cast<PFNMEMORYBARRIER>(getProcAddress("glMemoryBarrier"));
+    }
+
+    // compressed formats
+    g_s3tc = hasExtension("GL_EXT_texture_compression_s3tc");
+    g_bptc = supportsVersion(4, 2) || hasExtension("GL_ARB_texture_compression_bptc");
+
+    std::cout << "GLEXT::LOAD: texture storage " << (hasTexStorage() ? "yes" : "no") << ", buffer storage "
+              << (hasBufferStorage() ? "yes" : "no") << ", compute " << (hasCompute() ? "yes" : "no") << ", s3tc " << (hasS3TC() ? "yes" : "no") << ", bptc "
+              << (hasBPTC() ? "yes" : "no") << '\n';
+}
+
+bool GLExtN::hasTexStorage() { return texStorage2D != nullptr; }
+
+bool GLExtN::hasBufferStorage() { return bufferStorage != nullptr; }
+
+bool GLExtN::hasCompute()
+{
+    return dispatchCompute != nullptr && bindImageTexture != nullptr && memoryBarrier != nullptr;
+}
+
+bool GLExtN::hasS3TC() { return g_s3tc; }
+
+bool GLExtN::hasBPTC() { return g_bptc; }
@@ -0,0 +1,57 @@
+// Post GL 4.0 entry points.
+// The bundled glad only loads core 4.0, and the context is 4.1 (macOS caps there), so newer functions are
+// loaded at runtime when the driver exposes them. Callers check the has*() flags and fall back otherwise.
+
+#ifndef GLEXT_H
+#define GLEXT_H
+
+#include <glad/glad.h>
+
+namespace GLExtN
+{
+    // GL 4.4 / ARB_buffer_storage
+    constexpr GLbitfield MAP_PERSISTENT_BIT{0x0040};
+    constexpr GLbitfield MAP_COHERENT_BIT{0x0080};
+
+    // EXT_texture_compression_s3tc (BC1 / BC3)
+    constexpr GLenum COMPRESSED_RGB_S3TC_DXT1{0x83F0};
+    constexpr GLenum COMPRESSED_RGBA_S3TC_DXT5{0x83F3};
+    // GL 4.2 / ARB_texture_compression_bptc (BC7)
+    constexpr GLenum COMPRESSED_RGBA_BPTC_UNORM{0x8E8C};
+
+    // GL 4.3 / ARB_compute_shader, GL 4.2 / ARB_shader_image_load_store
+    constexpr GLenum COMPUTE_SHADER{0x91B9};
+    constexpr GLbitfield TEXTURE_FETCH_BARRIER_BIT{0x0008};
+    constexpr GLbitfield SHADER_IMAGE_ACCESS_BARRIER_BIT{0x0020};
+    constexpr GLbitfield FRAMEBUFFER_BARRIER_BIT{0x0400};
+    // GL 4.3 / ARB_shader_storage_buffer_object (part of every compute capable context)
+    constexpr GLenum SHADER_STORAGE_BUFFER{0x90D2};
+    constexpr GLbitfield SHADER_STORAGE_BARRIER_BIT{0x2000};
+
+    using PFNTEXSTORAGE2D = void(APIENTRYP)(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width,
+                                             GLsizei height);
+    using PFNBUFFERSTORAGE = void(APIENTRYP)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+    using PFNDISPATCHCOMPUTE = void(APIENTRYP)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+    using PFNBINDIMAGETEXTURE = void(APIENTRYP)(GLuint unit, GLuint texture, GLint level, GLboolean layered,
+                                                 GLint layer, GLenum access, GLenum format);
+    using PFNMEMORYBARRIER = void(APIENTRYP)(GLbitfield barriers);
+
+    extern PFNTEXSTORAGE2D texStorage2D;
+    extern PFNBUFFERSTORAGE bufferStorage;
+    extern PFNDISPATCHCOMPUTE dispatchCompute;
+    extern PFNBINDIMAGETEXTURE bindImageTexture;
+    extern PFNMEMORYBARRIER memoryBarrier;
+
+    // load everything the current context supports, call after glad
+    void load(GLADloadproc getProcAddress);
+
+    [[nodiscard]] bool hasExtension(const char* name);
+    [[nodiscard]] bool hasTexStorage();
+    [[nodiscard]] bool hasBufferStorage();
+    // compute shaders with image load / store, false on macOS (4.1 is the newest context there)
+    [[nodiscard]] bool hasCompute();
+    [[nodiscard]] bool hasS3TC();
+    [[nodiscard]] bool hasBPTC();
+} // namespace GLExtN
+
+#endif
@@ -3,12 +3,83 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "ibl.hpp"
+#include "benchmark.hpp"
+#include "brdflut.hpp"
 #include "engine.hpp"
 #include "engine_types.hpp"
+#include "iblcache.hpp"
+#include "sphericalharmonics.hpp"
 #include "util.hpp"
 #include "texture.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // skybox dimensions
+    constexpr GLsizei ENV_SIZE{512};
+    // prefilter map size & roughness levels
+    constexpr GLsizei PREFILTER_SIZE{128};
+    constexpr int PREFILTER_LEVELS{5};
+    // GGX samples per prefilter texel by level, the lower environment mips they read make up for the rest
+    constexpr int PREFILTER_SAMPLES[PREFILTER_LEVELS]{1, 32, 64, 96, 128};
+
+    // upload, 6 environment faces, environment mips, 6 faces of every prefilter level
+    constexpr int STEP_ENV_FACES{1};
+    constexpr int STEP_ENV_MIPS{STEP_ENV_FACES + 6};
+    constexpr int STEP_PREFILTER{STEP_ENV_MIPS + 1};
+    constexpr int STEP_COUNT{STEP_PREFILTER + PREFILTER_LEVELS * 6};
+
+    glm::mat4 getCaptureView(const int face)
+    {
+        constexpr glm::vec3 targets[6]{{1.0f, 0.0f, 0.0f},  {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+                                       {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f},  {0.0f, 0.0f, -1.0f}};
+        constexpr glm::vec3 ups[6]{{0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f},
+                                   {0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}};
+        return glm::lookAt(glm::vec3{0.0f}, targets[face], ups[face]);
+    }
+
+    // texel samples a step renders, what its gpu time is estimated from
+    double getStepUnits(const int step)
+    {
+        if (step < STEP_ENV_FACES)
+            return 0.0;
+        if (step < STEP_ENV_MIPS)
+            return static_cast<double>(ENV_SIZE) * ENV_SIZE;
+        if (step < STEP_PREFILTER)
+            return static_cast<double>(ENV_SIZE) * ENV_SIZE * 2.0; // 6 faces of 1/3 texel per base texel
+        const int level{(step - STEP_PREFILTER) / 6};
+        const double size{static_cast<double>(PREFILTER_SIZE >> level)};
+        return size * size * PREFILTER_SAMPLES[level];
+    }
+
+    unsigned int createCubemap(const GLsizei size, const bool mipmaps)
+    {
+        unsigned int texture{0};
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        for (unsigned int i{0}; i < 6; ++i)
+        {
+            // NOTE: 16F values for tex
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // allocate the chain
+        if (mipmaps)
+            glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        return texture;
+    }
+} // namespace
 
 IBLGenerator::IBLGenerator(EngineObject* parent) :
     EngineObject{"IBL", parent}
@@ -20,182 +91,336 @@ IBLGenerator::~IBLGenerator() { free(); }
 // free cube resources
 void IBLGenerator::free()
 {
+    if (m_back)
+    {
+        // the worker still writes into the back set
+        if (m_jobs != nullptr)
+            m_jobs->wait(m_back->decoded);
+        glDeleteTextures(1, &m_back->hdrTexture);
+        glDeleteTextures(1, &m_back->envCubemap);
+        glDeleteTextures(1, &m_back->prefilterMap);
+        glDeleteRenderbuffers(1, &m_back->captureRBO);
+        glDeleteFramebuffers(1, &m_back->captureFBO);
+        m_back.reset();
+    }
+    for (const StepQuery& query : m_stepQueries)
+        m_freeQueries.push_back(query.query);
+    m_stepQueries.clear();
+    glDeleteQueries(static_cast<GLsizei>(m_freeQueries.size()), m_freeQueries.data());
+    m_freeQueries.clear();
+
+    glDeleteTextures(1, &m_envCubemap);
+    glDeleteTextures(1, &m_prefilterMap);
     glDeleteBuffers(1, &m_cubeVBO);
     glDeleteVertexArrays(1, &m_cubeVAO);
+    glDeleteBuffers(1, &m_irradianceUBO);
+    glDeleteTextures(1, &m_brdfLutMap);
 }
 
-void IBLGenerator::init(const char* hdrPath, const char* iemPath, const char* brdfLutPath, void* engine)
+void IBLGenerator::init(const char* hdrPath, const char* brdfLutPath, void* engine,
+                        const BRDFLutN::Quality brdfLutQuality)
 {
-    // load textures
-    bool success;
-    m_hdrTexture = TextureN::loadHDRMap(hdrPath, &success);
-    if (!success)
+    const Engine* enginePtr {static_cast<Engine*>(engine)};
+    m_jobs = enginePtr->getJobSystem();
+
+    m_brdfLutMap = BRDFLutN::load(brdfLutPath, BRDFLutN::getSettings(brdfLutQuality), m_jobs);
+    if (m_brdfLutMap == 0)
     {
         Util::beginError();
-        std::cout << "IBL::INIT::ERROR: Failed to load environment map!" << std::endl;
+        std::cout << "IBL::INIT::ERROR: Failed to create BRDF LUT!" << std::endl;
         Util::endError();
     }
 
-    m_irradianceTexture = TextureN::loadHDRMap(iemPath, &success);
-    if (!success)
+    // maps of an earlier run with the same sources, shaders & sizes
+    const double startMs{BenchmarkN::nowMs()};
+    const std::string cachePath{std::string{hdrPath} + ".iblcache"};
+    std::vector<int> sizes{ENV_SIZE, PREFILTER_SIZE, PREFILTER_LEVELS};
+    sizes.insert(sizes.end(), std::begin(PREFILTER_SAMPLES), std::end(PREFILTER_SAMPLES));
+    const std::uint64_t cacheKey{IBLCacheN::getKey(
+        {hdrPath, "shaders/cubeMap.vert", "shaders/erCubeMapConvert.frag", "shaders/prefilter.frag"}, sizes)};
+    std::vector<IBLCacheN::Cubemap> maps{};
+    std::vector<float> values{};
+    if (IBLCacheN::read(cachePath, cacheKey, maps, values) && maps.size() == 2 &&
+        values.size() == SHN::COEFFICIENT_COUNT * 3)
     {
-        Util::beginError();
-        std::cout << "IBL::INIT::ERROR: Failed to load irradiance texture!" << std::endl;
-        Util::endError();
+        m_envCubemap = IBLCacheN::upload(maps[0]);
+        m_prefilterMap = IBLCacheN::upload(maps[1]);
+        SHN::Irradiance irradiance{};
+        for (int i{0}; i < SHN::COEFFICIENT_COUNT; ++i)
+            irradiance[i] = glm::vec3{values[i * 3], values[i * 3 + 1], values[i * 3 + 2]};
+        setIrradiance(irradiance);
+        std::cout << "Loaded IBL maps from `" << cachePath << "` in " << BenchmarkN::nowMs() - startMs << " ms\n";
+        return;
     }
 
-    m_brdfLutMap = TextureN::loadFromFile(brdfLutPath, nullptr, nullptr, nullptr, &success);
-    if (!success)
+    // every step at once
+    m_back = std::make_unique<BackSet>();
+    decode(*m_back, hdrPath, m_jobs);
+    if (!advance(engine, -1.0f))
     {
-        Util::beginError();
-        std::cout << "IBL::INIT::ERROR: Failed to load BRDF LUT path!" << std::endl;
-        Util::endError();
+        setIrradiance(SHN::Irradiance{});
+        return;
     }
 
-    // skybox dimensions
-    constexpr GLsizei sbWidth{512};
-    constexpr GLsizei sbHeight{512};
-    // prefilter map size
-    constexpr GLsizei pmremSize{128};
-    // irradiance map size
-    constexpr GLsizei irSize{32};
-    // shader uniforms
-    const glm::mat4 captureProjection{glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f)};
-    const glm::mat4 captureViews[]{
-        glm::lookAt(glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{1.0f, 0.0f, 0.0f}, glm::vec3{0.0f, -1.0f, 0.0f}),
-        glm::lookAt(glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{-1.0f, 0.0f, 0.0f}, glm::vec3{0.0f, -1.0f, 0.0f}),
-        glm::lookAt(glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{0.0f, 1.0f, 0.0f}, glm::vec3{0.0f, 0.0f, 1.0f}),
-        glm::lookAt(glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{0.0f, -1.0f, 0.0f}, glm::vec3{0.0f, 0.0f, -1.0f}),
-        glm::lookAt(glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{0.0f, 0.0f, 1.0f}, glm::vec3{0.0f, -1.0f, 0.0f}),
-        glm::lookAt(glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{0.0f, 0.0f, -1.0f}, glm::vec3{0.0f, -1.0f, 0.0f})};
-    
-    const Engine* enginePtr {static_cast<Engine*>(engine)};
-
-    // generate framebuffer to capture skybox cubemap
-    unsigned int captureFBO, captureRBO;
-    glGenFramebuffers(1, &captureFBO);
-    glGenRenderbuffers(1, &captureRBO);
+    // every mip the maps have (glGenerateMipmap filled the whole chain)
+    const auto getLevels{[](const int size) { return static_cast<int>(std::log2(size)) + 1; }};
+    maps = {IBLCacheN::download(m_envCubemap, ENV_SIZE, getLevels(ENV_SIZE)),
+            IBLCacheN::download(m_prefilterMap, PREFILTER_SIZE, getLevels(PREFILTER_SIZE))};
+    values.clear();
+    for (const glm::vec3& coefficient : m_irradiance)
+        values.insert(values.end(), {coefficient.r, coefficient.g, coefficient.b});
+    if (IBLCacheN::write(cachePath, cacheKey, maps, values))
+    {
+        std::cout << "Generated IBL maps in " << BenchmarkN::nowMs() - startMs << " ms, cached to `" << cachePath
+                  << "`\n";
+    }
+}
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, sbWidth, sbHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
+bool IBLGenerator::beginRebuild(const std::string& hdrPath, void* engine)
+{
+    if (m_back)
+        return false;
 
-    // generate cubemap color textures
-    glGenTextures(1, &m_envCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
-    for (unsigned int i{0}; i < 6; ++i)
+    m_jobs = static_cast<Engine*>(engine)->getJobSystem();
+    m_back = std::make_unique<BackSet>();
+    if (m_jobs == nullptr)
     {
-        // NOTE: 16F values for tex
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, sbWidth, sbHeight, 0, GL_RGB, GL_FLOAT, nullptr);
+        decode(*m_back, hdrPath, nullptr);
+        return true;
     }
+    BackSet* back{m_back.get()};
+    JobSystem* jobs{m_jobs};
+    m_jobs->submit([back, hdrPath, jobs] { decode(*back, hdrPath, jobs); }, &m_back->decoded,
+                   JobsN::Priority::BACKGROUND);
+    return true;
+}
 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+bool IBLGenerator::updateRebuild(void* engine, const float budgetMs)
+{
+    readStepQueries();
+    return advance(engine, std::max(budgetMs, 0.0f));
+}
 
-    // convert HDR environment map to cubemap equivalent
-    enginePtr->useShader("erCubeMapConvert");
-    enginePtr->setMat4("projection", captureProjection, "erCubeMapConvert");
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_hdrTexture);
-    enginePtr->setInt("equirectangularMap", 0, "erCubeMapConvert");
+float IBLGenerator::getRebuildProgress() const
+{
+    return m_back ? static_cast<float>(m_back->step) / static_cast<float>(STEP_COUNT) : 1.0f;
+}
 
-    glViewport(0, 0, sbWidth, sbHeight);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i{0}; i < 6; ++i)
+void IBLGenerator::decode(BackSet& back, const std::string& hdrPath, JobSystem* jobs)
+{
+    // halves for the capture, floats for the SH projection
+    const double startMs{BenchmarkN::nowMs()};
+    if (!RadianceN::load(hdrPath, back.hdr, RadianceN::OUTPUT_HALF | RadianceN::OUTPUT_FLOAT, jobs))
     {
-        enginePtr->setMat4("view", captureViews[i], "erCubeMapConvert");
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_envCubemap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // render 1x1 cube
-        renderCube();
+        Util::beginError();
+        std::cout << "IBL::DECODE::ERROR: Failed to load environment map `" << hdrPath << "`";
+        Util::endError();
+        back.hdr = {};
+        return;
     }
+    const double shStartMs{BenchmarkN::nowMs()};
+    back.irradiance = SHN::projectEquirect(back.hdr.floats.data(), back.hdr.width, back.hdr.height, jobs);
+    back.hdr.floats = {};
+    std::cout << "Decoded `" << hdrPath << "` (" << back.hdr.width << 'x' << back.hdr.height << ") in "
+              << shStartMs - startMs << " ms, projected diffuse SH in " << BenchmarkN::nowMs() - shStartMs
+              << " ms\n";
+}
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+bool IBLGenerator::advance(const void* engine, const float budgetMs)
+{
+    if (!m_back || !m_back->decoded.done())
+        return false;
+    if (m_back->step == 0 && m_back->hdr.halves.empty())
+    {
+        // decoding failed, keep the current set
+        m_back.reset();
+        return false;
+    }
 
-    // diffuse irradiance map
-    glGenTextures(1, &m_irradianceMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_irradianceMap);
-    for (unsigned int i{0}; i < 6; ++i)
+    const auto* enginePtr{static_cast<const Engine*>(engine)};
+    double spentMs{0.0};
+    while (m_back->step < STEP_COUNT)
     {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, irSize, irSize, 0, GL_RGB, GL_FLOAT, nullptr);
+        const double units{getStepUnits(m_back->step)};
+        const double estimateMs{units * m_msPerUnit};
+        if (budgetMs >= 0.0f && spentMs > 0.0 && spentMs + estimateMs > budgetMs)
+            break;
+
+        // time it to correct the estimate
+        const bool timed{budgetMs >= 0.0f && units > 0.0};
+        StepQuery query{0, units};
+        if (timed)
+        {
+            if (m_freeQueries.empty())
+                glGenQueries(1, &query.query);
+            else
+            {
+                query.query = m_freeQueries.back();
+                m_freeQueries.pop_back();
+            }
+            glBeginQuery(GL_TIME_ELAPSED, query.query);
+        }
+        runStep(engine, *m_back);
+        if (timed)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            m_stepQueries.push_back(query);
+        }
+
+        spentMs += estimateMs;
+        ++m_back->step;
     }
 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // reset window viewport
+    glViewport(0, 0, enginePtr->getWidth(), enginePtr->getHeight());
+    if (m_back->step < STEP_COUNT)
+        return false;
 
-    // convert irradiance texture to cube map equivalent
-    enginePtr->useShader("erCubeMapConvert");
-    enginePtr->setMat4("projection", captureProjection, "erCubeMapConvert");
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_irradianceTexture);
-    enginePtr->setInt("equirectangularMap", 0, "erCubeMapConvert");
+    swapBackSet();
+    return true;
+}
+
+void IBLGenerator::runStep(const void* engine, BackSet& back)
+{
+    const auto* enginePtr{static_cast<const Engine*>(engine)};
+    const glm::mat4 captureProjection{glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f)};
+    const int step{back.step};
 
-    glViewport(0, 0, irSize, irSize);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, irSize, irSize);
-    for (unsigned int i{0}; i < 6; ++i)
+    if (step < STEP_ENV_FACES)
     {
-        enginePtr->setMat4("view", captureViews[i], "erCubeMapConvert");
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_irradianceMap,
-                               0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        back.hdrTexture = RadianceN::upload(back.hdr);
+        back.hdr = {};
+
+        back.envCubemap = createCubemap(ENV_SIZE, false);
+        back.prefilterMap = createCubemap(PREFILTER_SIZE, true);
+
+        // depth sized for the largest face, smaller faces only use a corner
+        glGenFramebuffers(1, &back.captureFBO);
+        glGenRenderbuffers(1, &back.captureRBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, back.captureFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, back.captureRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, ENV_SIZE, ENV_SIZE);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, back.captureRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        return;
+    }
 
-        renderCube();
+    if (step == STEP_ENV_MIPS)
+    {
+        // the prefilter steps sample these
+        glBindTexture(GL_TEXTURE_CUBE_MAP, back.envCubemap);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        glDeleteTextures(1, &back.hdrTexture);
+        back.hdrTexture = 0;
+        return;
     }
 
-    glGenTextures(1, &m_prefilterMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_prefilterMap);
-    for (unsigned int i{0}; i < 6; ++i)
+    glBindFramebuffer(GL_FRAMEBUFFER, back.captureFBO);
+    glActiveTexture(GL_TEXTURE0);
+    if (step < STEP_ENV_MIPS)
+    {
+        // convert HDR environment map to cubemap equivalent, one face
+        const int face{step - STEP_ENV_FACES};
+        enginePtr->useShader("erCubeMapConvert");
+        enginePtr->setMat4("projection", captureProjection, "erCubeMapConvert");
+        enginePtr->setMat4("view", getCaptureView(face), "erCubeMapConvert");
+        enginePtr->setInt("equirectangularMap", 0, "erCubeMapConvert");
+        glBindTexture(GL_TEXTURE_2D, back.hdrTexture);
+
+        glViewport(0, 0, ENV_SIZE, ENV_SIZE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+                               back.envCubemap, 0);
+    }
+    else
     {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, pmremSize, pmremSize, 0, GL_RGB, GL_FLOAT, nullptr);
+        // one face of one roughness level
+        const int level{(step - STEP_PREFILTER) / 6};
+        const int face{(step - STEP_PREFILTER) % 6};
+        const GLsizei size{PREFILTER_SIZE >> level};
+        enginePtr->useShader("prefilterMap");
+        enginePtr->setMat4("projection", captureProjection, "prefilterMap");
+        enginePtr->setMat4("view", getCaptureView(face), "prefilterMap");
+        enginePtr->setInt("environmentMap", 0, "prefilterMap");
+        enginePtr->setFloat("roughness", static_cast<float>(level) / static_cast<float>(PREFILTER_LEVELS - 1),
+                            "prefilterMap");
+        enginePtr->setInt("sampleCount", PREFILTER_SAMPLES[level], "prefilterMap");
+        enginePtr->setFloat("envResolution", static_cast<float>(ENV_SIZE), "prefilterMap");
+        glBindTexture(GL_TEXTURE_CUBE_MAP, back.envCubemap);
+
+        glViewport(0, 0, size, size);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+                               back.prefilterMap, level);
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // render 1x1 cube
+    renderCube();
+}
 
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+void IBLGenerator::swapBackSet()
+{
+    glDeleteRenderbuffers(1, &m_back->captureRBO);
+    glDeleteFramebuffers(1, &m_back->captureFBO);
+
+    glDeleteTextures(1, &m_envCubemap);
+    glDeleteTextures(1, &m_prefilterMap);
+    m_envCubemap = m_back->envCubemap;
+    m_prefilterMap = m_back->prefilterMap;
+    setIrradiance(m_back->irradiance);
+    m_back.reset();
+}
 
-    enginePtr->useShader("prefilterMap");
-    enginePtr->setInt("environmentMap", 0, "prefilterMap");
-    enginePtr->setMat4("projection", captureProjection, "prefilterMap");
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
+void IBLGenerator::readStepQueries()
+{
+    while (!m_stepQueries.empty())
+    {
+        const StepQuery query{m_stepQueries.front()};
+        GLint available{0};
+        glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 ns{0};
+        glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &ns);
+        m_msPerUnit = m_msPerUnit * 0.75 + static_cast<double>(ns) / 1.0e6 / query.units * 0.25;
+        m_freeQueries.push_back(query.query);
+        m_stepQueries.pop_front();
+    }
+}
 
-    constexpr unsigned int maxLevels{5};
-    for (unsigned int mip{0}; mip < maxLevels; ++mip)
+void IBLGenerator::bindIrradiance(const Shader* shader)
+{
+    const unsigned int program{shader->getShaderID()};
+    if (m_programs.count(program) == 0)
     {
-        const unsigned int mipWidth{static_cast<unsigned int>(pmremSize * std::pow(0.5, mip))};
-        const unsigned int mipHeight{static_cast<unsigned int>(pmremSize * std::pow(0.5, mip))};
-        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
-
-        const float roughness{static_cast<float>(mip) / static_cast<float>(maxLevels - 1)};
-        enginePtr->setFloat("roughness", roughness, "prefilterMap");
-        for (unsigned int i{0}; i < 6; ++i)
-        {
-            enginePtr->setMat4("view", captureViews[i], "prefilterMap");
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                                   m_prefilterMap, mip);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            renderCube();
-        }
+        const GLuint block{glGetUniformBlockIndex(program, "IrradianceSH")};
+        if (block != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, block, SHN::BUFFER_BINDING);
+        m_programs.insert(program);
     }
+    glBindBufferBase(GL_UNIFORM_BUFFER, SHN::BUFFER_BINDING, m_irradianceUBO);
+}
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void IBLGenerator::setIrradiance(const SHN::Irradiance& irradiance)
+{
+    m_irradiance = irradiance;
+    glm::vec4 data[SHN::COEFFICIENT_COUNT]{};
+    for (int i{0}; i < SHN::COEFFICIENT_COUNT; ++i)
+        data[i] = glm::vec4{irradiance[i], 0.0f};
 
-    // reset window viewport
-    glViewport(0, 0, enginePtr->getWidth(), enginePtr->getHeight());
+    if (m_irradianceUBO == 0)
+    {
+        glGenBuffers(1, &m_irradianceUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_irradianceUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(data), data, GL_DYNAMIC_DRAW);
+    }
+    else
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_irradianceUBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), data);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void IBLGenerator::renderSkybox(void* engine)
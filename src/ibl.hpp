@@ -1,10 +1,24 @@
 // IBL implementation
+// The environment cubemap & prefilter map are built in steps (capture one face, mip the cubemap, prefilter one face
+// of one mip) into a back set, while the diffuse SH is projected on a worker. init runs every step at once, a
+// rebuild runs as many steps per frame as fit into a gpu time budget and swaps the finished set in at once.
 #ifndef IBL_H
 #define IBL_H
 
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include <glm/glm.hpp>
 
+#include "brdflut.hpp"
 #include "engine_types.hpp"
+#include "jobs.hpp"
+#include "radiance.hpp"
+#include "shader.hpp"
+#include "sphericalharmonics.hpp"
 
 class IBLGenerator : public EngineObject
 {
@@ -12,8 +26,25 @@ public:
     explicit IBLGenerator(EngineObject* parent);
     ~IBLGenerator() override;
 
-    // initialize sampler maps
-    void init(const char* hdrPath, const char* iemPath, const char* brdfLutPath, void* engine);
+    // initialize sampler maps & diffuse SH, reloaded from `<hdrPath>.iblcache` when nothing they depend on changed
+    // the BRDF LUT is generated once per quality setting and cached at brdfLutPath
+    void init(const char* hdrPath, const char* brdfLutPath, void* engine,
+              BRDFLutN::Quality brdfLutQuality = BRDFLutN::Quality::MEDIUM);
+
+    // rebuild maps & SH from another HDR over the next frames, the current set stays in use until the new one is
+    // complete. false if a rebuild is already running
+    bool beginRebuild(const std::string& hdrPath, void* engine);
+    // advance a running rebuild by the steps that fit into budgetMs of gpu time (at least one), call once per frame
+    // before rendering. true when the new set was swapped in
+    bool updateRebuild(void* engine, float budgetMs = 1.0f);
+    [[nodiscard]] bool isRebuilding() const { return m_back != nullptr; }
+    // 0 to 1
+    [[nodiscard]] float getRebuildProgress() const;
+
+    // make the diffuse SH available to shader (in use) through the `IrradianceSH` block
+    void bindIrradiance(const Shader* shader);
+    // relight with new coefficients, e.g. projected from another sky
+    void setIrradiance(const SHN::Irradiance& irradiance);
 
     // render envCubemap as a skybox
     void renderSkybox(void* engine);
@@ -21,32 +52,65 @@ public:
     void renderCube();
 
     // getters
-    [[nodiscard]] unsigned int getHDRTexture() const {return m_hdrTexture;}
-    [[nodiscard]] unsigned int getIrradianceTexture() const {return m_irradianceTexture;}
-    
+    [[nodiscard]] const SHN::Irradiance& getIrradiance() const {return m_irradiance;}
     [[nodiscard]] unsigned int getEnvCubemap() const {return m_envCubemap;}
-    [[nodiscard]] unsigned int getIrradianceMap() const {return m_irradianceMap;}
     [[nodiscard]] unsigned int getPrefilterMap() const {return m_prefilterMap;}
     [[nodiscard]] unsigned int getBRDFLutMap() const {return m_brdfLutMap;}
 
 private:
-    // we only need environment and irradiance textures
-    // prefilter map is autogenerated (due to mipmap levels)
-    unsigned int m_hdrTexture{0};
-    unsigned int m_irradianceTexture{0};
-    unsigned int m_brdfLutMap{0}; // for specular IBL
+    // the environment map is only needed while generating, prefilter map is autogenerated (due to mipmap levels)
+    unsigned int m_brdfLutMap{0}; // for specular IBL, RG16F
 
     // samplers
     unsigned int m_envCubemap{0};
-    unsigned int m_irradianceMap{0};
     unsigned int m_prefilterMap{0};
 
+    // diffuse irradiance, std140 vec4 per coefficient
+    SHN::Irradiance m_irradiance{};
+    unsigned int m_irradianceUBO{0};
+    std::unordered_set<unsigned int> m_programs{}; // block binding assigned
+
     unsigned int m_cubeVAO{0};
     unsigned int m_cubeVBO{0};
 
+    // maps being built, swapped with the current ones when every step ran
+    struct BackSet
+    {
+        // HDR decode & SH projection, on a worker for rebuilds
+        JobsN::Counter decoded{};
+        RadianceN::Image hdr{}; // halves until uploaded
+        SHN::Irradiance irradiance{};
+
+        unsigned int hdrTexture{0};
+        unsigned int envCubemap{0};
+        unsigned int prefilterMap{0};
+        unsigned int captureFBO{0};
+        unsigned int captureRBO{0};
+        int step{0};
+    };
+    std::unique_ptr<BackSet> m_back{};
+    JobSystem* m_jobs{nullptr};
+
+    // gpu time of rebuild steps, read back a few frames later to refine the cost estimate
+    struct StepQuery
+    {
+        unsigned int query{0};
+        double units{0.0};
+    };
+    std::deque<StepQuery> m_stepQueries{};
+    std::vector<unsigned int> m_freeQueries{};
+    double m_msPerUnit{1.0e-6}; // gpu ms per texel sample
+
     // generate cube VAO & VBO
     void initCube();
     void free(); // free cube resources
+
+    static void decode(BackSet& back, const std::string& hdrPath, JobSystem* jobs);
+    // run steps until budgetMs (< 0: all of them) is used up, swaps the set in when done
+    bool advance(const void* engine, float budgetMs);
+    void runStep(const void* engine, BackSet& back);
+    void swapBackSet();
+    void readStepQueries();
 };
 
 #endif
@@ -0,0 +1,198 @@
+#include "iblcache.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "texturecache.hpp"
+#include "util.hpp"
+
+namespace
+{
+    constexpr char MAGIC[4]{'I', 'B', 'L', 'C'};
+    // magic, version, key, map count, value count
+    constexpr std::size_t HEADER_BYTES{4 + 4 + 8 + 4 + 4};
+    // size & levels of every map
+    constexpr std::size_t MAP_BYTES{4 + 4};
+    // a 2^16 cubemap would already be absurd
+    constexpr std::uint32_t MAX_SIZE{1 << 16};
+    constexpr std::uint32_t MAX_VALUES{1 << 16};
+
+    void putU32(std::vector<unsigned char>& bytes, const std::uint32_t value)
+    {
+        for (int i{0}; i < 4; ++i)
+            bytes.push_back(static_cast<unsigned char>(value >> (i * 8)));
+    }
+
+    std::uint32_t getU32(const unsigned char* bytes)
+    {
+        std::uint32_t value{0};
+        for (int i{0}; i < 4; ++i)
+            value |= static_cast<std::uint32_t>(bytes[i]) << (i * 8);
+        return value;
+    }
+
+    std::size_t getTexelCount(const IBLCacheN::Cubemap& map)
+    {
+        std::size_t count{0};
+        for (int level{0}; level < map.levels; ++level)
+            count += IBLCacheN::getFaceTexels(map.size, level) * 6;
+        return count;
+    }
+} // namespace
+
+std::size_t IBLCacheN::getFaceTexels(const int size, const int level)
+{
+    const auto width{static_cast<std::size_t>(std::max(1, size >> level))};
+    return width * width;
+}
+
+std::uint64_t IBLCacheN::getKey(const std::vector<std::string>& files, const std::vector<int>& values)
+{
+    std::vector<std::uint64_t> hashes{};
+    for (const std::string& path : files)
+    {
+        std::ifstream file{path, std::ios::binary};
+        const std::vector<char> bytes{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        hashes.push_back(TextureCacheN::hashBytes(bytes.data(), bytes.size()));
+    }
+    for (const int value : values)
+        hashes.push_back(static_cast<std::uint64_t>(value));
+    hashes.push_back(VERSION);
+    return TextureCacheN::hashBytes(hashes.data(), hashes.size() * sizeof(std::uint64_t));
+}
+
+bool IBLCacheN::read(const std::string& path, const std::uint64_t key, std::vector<Cubemap>& maps,
+                     std::vector<float>& values)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+        return false;
+
+    unsigned char header[HEADER_BYTES]{};
+    if (!file.read(reinterpret_cast<char*>(header), HEADER_BYTES) || std::memcmp(header, MAGIC, 4) != 0 ||
+        getU32(header + 4) != VERSION)
+        return false;
+    const std::uint64_t fileKey{getU32(header + 8) | static_cast<std::uint64_t>(getU32(header + 12)) << 32};
+    if (fileKey != key)
+        return false;
+
+    const std::uint32_t valueCount{getU32(header + 20)};
+    if (valueCount > MAX_VALUES)
+        return false;
+    values.resize(valueCount);
+    if (!file.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(valueCount * sizeof(float))))
+        return false;
+
+    maps.assign(getU32(header + 16), Cubemap{});
+    for (Cubemap& map : maps)
+    {
+        unsigned char info[MAP_BYTES]{};
+        if (!file.read(reinterpret_cast<char*>(info), MAP_BYTES))
+            return false;
+        const std::uint32_t size{getU32(info)};
+        const std::uint32_t levels{getU32(info + 4)};
+        if (size == 0 || size > MAX_SIZE || levels == 0 || levels > 32)
+            return false;
+        map.size = static_cast<int>(size);
+        map.levels = static_cast<int>(levels);
+    }
+    for (Cubemap& map : maps)
+    {
+        map.texels.resize(getTexelCount(map) * 3);
+        if (!file.read(reinterpret_cast<char*>(map.texels.data()),
+                       static_cast<std::streamsize>(map.texels.size() * sizeof(std::uint16_t))))
+            return false;
+    }
+    return true;
+}
+
+bool IBLCacheN::write(const std::string& path, const std::uint64_t key, const std::vector<Cubemap>& maps,
+                      const std::vector<float>& values)
+{
+    std::vector<unsigned char> header{MAGIC, MAGIC + 4};
+    putU32(header, VERSION);
+    putU32(header, static_cast<std::uint32_t>(key));
+    putU32(header, static_cast<std::uint32_t>(key >> 32));
+    putU32(header, static_cast<std::uint32_t>(maps.size()));
+    putU32(header, static_cast<std::uint32_t>(values.size()));
+    header.insert(header.end(), reinterpret_cast<const unsigned char*>(values.data()),
+                  reinterpret_cast<const unsigned char*>(values.data() + values.size()));
+    for (const Cubemap& map : maps)
+    {
+        putU32(header, static_cast<std::uint32_t>(map.size));
+        putU32(header, static_cast<std::uint32_t>(map.levels));
+    }
+
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+    for (const Cubemap& map : maps)
+    {
+        file.write(reinterpret_cast<const char*>(map.texels.data()),
+                   static_cast<std::streamsize>(map.texels.size() * sizeof(std::uint16_t)));
+    }
+    if (!file)
+    {
+        Util::beginError();
+        std::cout << "IBL_CACHE::WRITE::ERROR: Failed to write `" << path << "`";
+        Util::endError();
+        return false;
+    }
+    return true;
+}
+
+IBLCacheN::Cubemap IBLCacheN::download(const unsigned int texture, const int size, const int levels)
+{
+    Cubemap map{size, levels};
+    map.texels.resize(getTexelCount(map) * 3);
+
+    // rows of small levels aren't 4 byte aligned
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    std::uint16_t* texels{map.texels.data()};
+    for (int level{0}; level < levels; ++level)
+    {
+        for (int face{0}; face < 6; ++face)
+        {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, GL_HALF_FLOAT, texels);
+            texels += getFaceTexels(size, level) * 3;
+        }
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    return map;
+}
+
+unsigned int IBLCacheN::upload(const Cubemap& map)
+{
+    unsigned int texture{0};
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    const std::uint16_t* texels{map.texels.data()};
+    for (int level{0}; level < map.levels; ++level)
+    {
+        const int width{std::max(1, map.size >> level)};
+        for (int face{0}; face < 6; ++face)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB16F, width, width, 0, GL_RGB,
+                         GL_HALF_FLOAT, texels);
+            texels += getFaceTexels(map.size, level) * 3;
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, map.levels - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
+                    map.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    return texture;
+}
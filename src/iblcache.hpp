@@ -0,0 +1,46 @@
+// IBL precompute cache.
+// The environment & prefilter cubemaps IBLGenerator renders at startup are read back once and written (every mip of
+// every face, as RGB half floats) into a single file next to the source HDR, together with a few floats computed on
+// the cpu (the irradiance SH coefficients). The file is keyed by a hash of the source image, the shaders that
+// produced the maps and the map sizes, so editing any of them quietly regenerates it. Later runs upload the stored
+// levels directly and never touch the HDR file.
+
+#ifndef IBL_CACHE_H
+#define IBL_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace IBLCacheN
+{
+    // bump when the file layout changes
+    constexpr std::uint32_t VERSION{2};
+
+    struct Cubemap
+    {
+        int size{0};
+        int levels{0};
+        // RGB halves, level by level, faces in GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+        std::vector<std::uint16_t> texels{};
+    };
+
+    // texels of one face of a level
+    [[nodiscard]] std::size_t getFaceTexels(int size, int level);
+
+    // hash of the files' contents (missing files count as empty) & values
+    [[nodiscard]] std::uint64_t getKey(const std::vector<std::string>& files, const std::vector<int>& values);
+
+    // false if the file is missing, damaged or was written for another key
+    bool read(const std::string& path, std::uint64_t key, std::vector<Cubemap>& maps, std::vector<float>& values);
+    bool write(const std::string& path, std::uint64_t key, const std::vector<Cubemap>& maps,
+               const std::vector<float>& values);
+
+    // read back all levels of a GL_TEXTURE_CUBE_MAP
+    Cubemap download(unsigned int texture, int size, int levels);
+    // new GL_TEXTURE_CUBE_MAP with the stored levels (RGB16F, clamped, trilinear if it has mips)
+    unsigned int upload(const Cubemap& map);
+} // namespace IBLCacheN
+
+#endif
@@ -0,0 +1,138 @@
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+JobSystem::JobSystem(EngineObject* parent, unsigned int numThreads) : EngineObject{"JobSystem", parent}
+{
+    if (numThreads == 0)
+    {
+        const unsigned int hardwareThreads{std::thread::hardware_concurrency()};
+        numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_workers.reserve(numThreads);
+    for (unsigned int i{0}; i < numThreads; ++i)
+    {
+        m_workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+
+    std::cout << "JOB_SYSTEM: Started " << numThreads << " worker threads\n";
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_condition.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::submit(std::function<void()> func, JobsN::Counter* counter, const JobsN::Priority priority)
+{
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        (priority == JobsN::Priority::BACKGROUND ? m_background : m_queue)
+            .push_back(JobsN::Job{std::move(func), counter});
+    }
+    m_condition.notify_one();
+}
+
+void JobSystem::wait(const JobsN::Counter& counter)
+{
+    while (!counter.done())
+    {
+        // help out instead of spinning
+        if (!runOne(counter))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(const std::size_t count, const std::size_t grain,
+                            const std::function<void(std::size_t, std::size_t)>& func)
+{
+    if (count == 0)
+        return;
+
+    // aim for a few chunks per thread so uneven chunks balance out
+    const std::size_t threads{m_workers.size() + 1};
+    const std::size_t chunk{std::max(std::max<std::size_t>(grain, 1), (count + threads * 4 - 1) / (threads * 4))};
+
+    // run small workloads inline
+    if (chunk >= count)
+    {
+        func(0, count);
+        return;
+    }
+
+    JobsN::Counter counter{};
+    for (std::size_t begin{chunk}; begin < count; begin += chunk)
+    {
+        const std::size_t end{std::min(begin + chunk, count)};
+        submit([&func, begin, end] { func(begin, end); }, &counter);
+    }
+
+    // first chunk on the calling thread
+    func(0, chunk);
+    wait(counter);
+}
+
+void JobSystem::workerLoop()
+{
+    while (true)
+    {
+        JobsN::Job job{};
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_condition.wait(lock, [this] { return m_stop || !m_queue.empty() || !m_background.empty(); });
+            if (m_stop && m_queue.empty() && m_background.empty())
+                return;
+
+            std::deque<JobsN::Job>& queue{m_queue.empty() ? m_background : m_queue};
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        execute(job);
+    }
+}
+
+bool JobSystem::runOne(const JobsN::Counter& counter)
+{
+    JobsN::Job job{};
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (!m_queue.empty())
+        {
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        else
+        {
+            // other background jobs are left to the workers, they can take far longer than the wait
+            const auto it{std::find_if(m_background.begin(), m_background.end(),
+                                       [&counter](const JobsN::Job& queued) { return queued.counter == &counter; })};
+            if (it == m_background.end())
+                return false;
+            job = std::move(*it);
+            m_background.erase(it);
+        }
+    }
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(JobsN::Job& job)
+{
+    job.func();
+    if (job.counter)
+        job.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,80 @@
+// Simple job system: a fixed pool of worker threads pulling from a shared queue.
+// Waiting threads help run queued jobs, so jobs can wait on other jobs without deadlocking. Long background loads
+// (image decodes, disk reads) go into a second queue that workers only take from when the first one is empty and
+// that waiting threads leave alone, unless the job belongs to the counter they wait on, so a frame never ends up
+// running a whole decode or waiting behind one.
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "engine_types.hpp"
+
+namespace JobsN
+{
+    // tracks a group of jobs, wait on it with JobSystem::wait()
+    struct Counter
+    {
+        std::atomic<int> pending{0};
+
+        [[nodiscard]] bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+    };
+
+    enum class Priority
+    {
+        // per frame work that is waited on right away (parallelFor)
+        NORMAL,
+        // loads that are polled for or only waited on when flushing
+        BACKGROUND,
+    };
+
+    struct Job
+    {
+        std::function<void()> func;
+        Counter* counter{nullptr};
+    };
+} // namespace JobsN
+
+class JobSystem final : public EngineObject
+{
+public:
+    // numThreads = 0 uses hardware concurrency - 1 (the main thread helps while waiting)
+    explicit JobSystem(EngineObject* parent, unsigned int numThreads = 0);
+    ~JobSystem() override;
+
+    // queue a job, counter (optional) is incremented now and decremented when the job finishes
+    void submit(std::function<void()> func, JobsN::Counter* counter = nullptr,
+                JobsN::Priority priority = JobsN::Priority::NORMAL);
+
+    // block until counter reaches zero, running normal jobs & counter's own background jobs in the meantime
+    void wait(const JobsN::Counter& counter);
+
+    // split [0, count) into chunks of at least grain items and run func(begin, end) on each, blocks until done
+    void parallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& func);
+
+    // number of worker threads (excluding the calling thread)
+    [[nodiscard]] unsigned int getThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+private:
+    std::vector<std::thread> m_workers{};
+    std::deque<JobsN::Job> m_queue{};
+    std::deque<JobsN::Job> m_background{};
+    std::mutex m_mutex{};
+    std::condition_variable m_condition{};
+    bool m_stop{false};
+
+    void workerLoop();
+    // pop and run a normal job or a background job of counter, returns false if there was none
+    bool runOne(const JobsN::Counter& counter);
+    static void execute(JobsN::Job& job);
+};
+
+#endif
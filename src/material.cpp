@@ -0,0 +1,173 @@
+#include "material.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "util.hpp"
+
+namespace
+{
+    constexpr const char* MAP_NAMES[MaterialN::SLOT_COUNT]{"albedoMap", "aoMap", "ormMap", "normalMap"};
+    constexpr const char* BLOCK_NAME{"MaterialFactors"};
+} // namespace
+
+Material::Material(const std::vector<MeshN::Texture>& textures, const MaterialN::Factors& factors, const int index) :
+    m_factors{factors}, m_index{index}
+{
+    m_slots.fill(-1);
+    for (const MeshN::Texture& texture : textures)
+    {
+        if (texture.type >= MaterialN::SLOT_COUNT || m_slots[texture.type] >= 0)
+            continue;
+        m_slots[texture.type] = static_cast<int>(m_textures.size());
+        m_textures.push_back(texture);
+    }
+}
+
+const MeshN::Texture* Material::getTexture(const MeshN::TextureType slot) const
+{
+    return slot < MaterialN::SLOT_COUNT && m_slots[slot] >= 0 ? &m_textures[m_slots[slot]] : nullptr;
+}
+
+void Material::setPacked(const int material)
+{
+    m_packed = material;
+    // the pages hold a copy, drop the cache references so unshared textures are freed
+    m_textures.clear();
+    m_slots.fill(-1);
+}
+
+MaterialLibrary::MaterialLibrary(EngineObject* parent, TextureCache* cache, MaterialArrays* arrays) :
+    EngineObject{"MaterialLibrary", parent}, m_cache{cache}, m_arrays{arrays}
+{
+    GLint alignment{0};
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+    m_stride = (sizeof(MaterialN::Factors) + alignment - 1) / alignment * alignment;
+
+    glGenBuffers(1, &m_UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_stride * MaterialN::MAX_MATERIALS), nullptr,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    m_default = create({}, MaterialN::Factors{});
+    invalidateBindings();
+}
+
+MaterialLibrary::~MaterialLibrary() { glDeleteBuffers(1, &m_UBO); }
+
+std::shared_ptr<Material> MaterialLibrary::create(const std::vector<MeshN::Texture>& textures,
+                                                  const MaterialN::Factors& factors)
+{
+    const std::string key{getKey(textures, factors)};
+    if (const auto it{m_lookup.find(key)}; it != m_lookup.end())
+        return it->second;
+
+    if (m_materials.size() >= MaterialN::MAX_MATERIALS)
+    {
+        Util::beginError();
+        std::cout << "MATERIAL_LIBRARY::CREATE::ERROR: Out of material slots (" << MaterialN::MAX_MATERIALS
+                  << "), using the default material";
+        Util::endError();
+        return m_default;
+    }
+
+    const int index{static_cast<int>(m_materials.size())};
+    auto material{std::make_shared<Material>(textures, factors, index)};
+    m_materials.push_back(material);
+    m_lookup.emplace(key, material);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(index * m_stride), sizeof(MaterialN::Factors), &factors);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return material;
+}
+
+void MaterialLibrary::bind(const Shader* shader, const Material* material)
+{
+    const unsigned int program{shader->getShaderID()};
+    if (m_programs.count(program) == 0)
+        setupProgram(program);
+    if (material == m_boundMaterial && program == m_boundProgram)
+        return;
+
+    if (material != m_boundMaterial)
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, MaterialN::BUFFER_BINDING, m_UBO,
+                          static_cast<GLintptr>(material->getIndex() * m_stride), sizeof(MaterialN::Factors));
+    }
+    m_boundMaterial = material;
+    m_boundProgram = program;
+
+    if (m_arrays != nullptr)
+        m_arrays->bind(shader, material->getPacked());
+    if (material->getPacked() >= 0)
+        return;
+
+    // unused slots are white, so the factors alone decide (flat normal for normal maps)
+    bool bound{false};
+    for (int slot{0}; slot < MaterialN::SLOT_COUNT; ++slot)
+    {
+        const MeshN::Texture* texture{material->getTexture(static_cast<MeshN::TextureType>(slot))};
+        // cached textures bind a placeholder while they're still streaming in
+        unsigned int id{texture != nullptr ? (texture->ref ? texture->ref->getBindable() : texture->id)
+                                           : m_cache->getPlaceholder(slot == MeshN::TEXTURE_NORMAL
+                                                                         ? MeshN::TEXTURE_NORMAL
+                                                                         : MeshN::TEXTURE_ALBEDO)};
+        if (id == m_boundTextures[slot])
+            continue;
+
+        glActiveTexture(GL_TEXTURE0 + slot);
+        glBindTexture(GL_TEXTURE_2D, id);
+        m_boundTextures[slot] = id;
+        bound = true;
+    }
+    if (bound)
+        glActiveTexture(GL_TEXTURE0);
+}
+
+void MaterialLibrary::invalidateBindings()
+{
+    m_boundProgram = 0;
+    m_boundMaterial = nullptr;
+    m_boundTextures.fill(0);
+    if (m_arrays != nullptr)
+        m_arrays->invalidateBindings();
+}
+
+void MaterialLibrary::setupProgram(const unsigned int program)
+{
+    const GLuint block{glGetUniformBlockIndex(program, BLOCK_NAME)};
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, block, MaterialN::BUFFER_BINDING);
+
+    for (int slot{0}; slot < MaterialN::SLOT_COUNT; ++slot)
+        glUniform1i(glGetUniformLocation(program, MAP_NAMES[slot]), slot);
+    // 2D maps until the arrays say otherwise
+    glUniform1i(glGetUniformLocation(program, "materialIndex"), -1);
+    m_programs.insert(program);
+}
+
+std::string MaterialLibrary::getKey(const std::vector<MeshN::Texture>& textures, const MaterialN::Factors& factors)
+{
+    // the texture of every slot (Material keeps the first one) & the raw factors
+    std::array<const MeshN::Texture*, MaterialN::SLOT_COUNT> slots{};
+    for (const MeshN::Texture& texture : textures)
+    {
+        if (texture.type < MaterialN::SLOT_COUNT && slots[texture.type] == nullptr)
+            slots[texture.type] = &texture;
+    }
+
+    std::string key{};
+    for (const MeshN::Texture* texture : slots)
+    {
+        if (texture != nullptr)
+            key += texture->ref ? texture->ref->key : std::to_string(texture->id);
+        key += '\n';
+    }
+    key.append(reinterpret_cast<const char*>(&factors), sizeof(factors));
+    return key;
+}
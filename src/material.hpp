@@ -0,0 +1,113 @@
+// Shared PBR materials.
+// A material is one texture per slot (albedo, ao, ORM, normal) plus scalar factors, and every mesh with the same
+// textures & factors shares one instance. Factors live in slices of a single uniform buffer that are switched with
+// glBindBufferRange, the 2D maps sit on fixed units that are assigned once per shader program - changing materials
+// is a handful of binds and consecutive draws with the same material bind nothing. Materials packed into
+// MaterialArrays switch pages through the arrays instead of binding 2D maps.
+
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "engine_types.hpp"
+#include "materialarray.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "texturecache.hpp"
+
+namespace MaterialN
+{
+    // 2D map units 0 to SLOT_COUNT - 1, in MeshN::TextureType order
+    constexpr int SLOT_COUNT{MeshN::TEXTURE_NONE};
+    // slices of the factor buffer
+    constexpr int MAX_MATERIALS{1024};
+    constexpr unsigned int BUFFER_BINDING{2};
+
+    // std140 layout of `MaterialFactors` in the PBR shaders, multiplied with the maps
+    struct Factors
+    {
+        glm::vec4 baseColor{1.0f};
+        float metallic{0.0f};
+        float roughness{1.0f};
+        float normalScale{1.0f};
+        float occlusionInORM{0.0f}; // 1: occlusion is the ORM map's red channel, 0: the ao map's
+    };
+} // namespace MaterialN
+
+class Material
+{
+public:
+    // one texture per slot, later textures of a slot are ignored
+    Material(const std::vector<MeshN::Texture>& textures, const MaterialN::Factors& factors, int index);
+
+    // nullptr for unused slots
+    [[nodiscard]] const MeshN::Texture* getTexture(MeshN::TextureType slot) const;
+    [[nodiscard]] const std::vector<MeshN::Texture>& getTextures() const { return m_textures; }
+    [[nodiscard]] const MaterialN::Factors& getFactors() const { return m_factors; }
+    // slice of the factor buffer
+    [[nodiscard]] int getIndex() const { return m_index; }
+
+    // draw through a MaterialArrays material from now on, the 2D textures are released
+    void setPacked(int material);
+    // -1 if not packed
+    [[nodiscard]] int getPacked() const { return m_packed; }
+
+private:
+    std::vector<MeshN::Texture> m_textures{};
+    std::array<int, MaterialN::SLOT_COUNT> m_slots{}; // index into m_textures, -1 for unused slots
+    MaterialN::Factors m_factors{};
+    int m_index{0};
+    int m_packed{-1};
+};
+
+class MaterialLibrary final : public EngineObject
+{
+public:
+    // unused slots bind cache placeholders, arrays can be nullptr
+    MaterialLibrary(EngineObject* parent, TextureCache* cache, MaterialArrays* arrays);
+    ~MaterialLibrary() override;
+
+    // material with textures & factors, shared with every earlier request for the same ones
+    // returns the default material when the factor buffer is full
+    std::shared_ptr<Material> create(const std::vector<MeshN::Texture>& textures, const MaterialN::Factors& factors);
+    // white, non metallic & fully rough
+    [[nodiscard]] const std::shared_ptr<Material>& getDefault() const { return m_default; }
+
+    // make material current for the next draw with shader (in use)
+    void bind(const Shader* shader, const Material* material);
+    // forget what is bound (something else may have used the units, also resets the arrays)
+    void invalidateBindings();
+
+    [[nodiscard]] MaterialArrays* getArrays() const { return m_arrays; }
+    [[nodiscard]] std::size_t getMaterialCount() const { return m_materials.size(); }
+
+private:
+    TextureCache* m_cache{nullptr};
+    MaterialArrays* m_arrays{nullptr};
+    unsigned int m_UBO{0};
+    std::size_t m_stride{0}; // slice size, rounded up to the buffer offset alignment
+
+    std::vector<std::shared_ptr<Material>> m_materials{}; // by slice
+    std::unordered_map<std::string, std::shared_ptr<Material>> m_lookup{};
+    std::shared_ptr<Material> m_default{};
+
+    std::unordered_set<unsigned int> m_programs{};
+    unsigned int m_boundProgram{0};
+    const Material* m_boundMaterial{nullptr};
+    std::array<unsigned int, MaterialN::SLOT_COUNT> m_boundTextures{};
+
+    void setupProgram(unsigned int program);
+    [[nodiscard]] static std::string getKey(const std::vector<MeshN::Texture>& textures,
+                                            const MaterialN::Factors& factors);
+};
+
+#endif
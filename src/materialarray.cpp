@@ -0,0 +1,327 @@
+#include "materialarray.hpp"
+
+#include <glad/glad.h>
+#include <STB/stb_image.h>
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+#include <utility>
+
+#include "bcn.hpp"
+#include "mipgen.hpp"
+#include "texture.hpp"
+#include "texturecontainer.hpp"
+#include "util.hpp"
+
+namespace
+{
+    constexpr const char* ARRAY_NAMES[MaterialArrayN::SLOT_COUNT]{"albedoArray", "aoArray", "ormArray",
+                                                                  "normalArray"};
+
+    // texture file on its way into a page layer
+    struct LayerImage
+    {
+        bool loaded{false};
+        bool compressed{false};
+        BCnN::Format format{BCnN::FORMAT_BC1}; // compressed images only, RGBA8 otherwise
+        int width{0};
+        int height{0};
+        std::vector<std::vector<unsigned char>> levels{}; // base level first
+        int page{-1};
+        int layer{-1};
+    };
+
+    unsigned int getGLFormat(const LayerImage& image)
+    {
+        return image.compressed ? BCnN::getGLFormat(image.format) : GL_RGBA8;
+    }
+
+    bool loadLayerImage(const std::string& path, const MeshN::TextureType type, JobSystem* jobs, LayerImage& image)
+    {
+        const bool isContainer{TextureContainerN::isContainerPath(path)};
+        const std::string compressedPath{isContainer ? path : TextureN::getBakedPath(path, type)};
+        if (isContainer || Util::fileExists(compressedPath))
+        {
+            TextureContainerN::Image container{};
+            if (TextureContainerN::load(compressedPath, container) && BCnN::isSupported(container.format))
+            {
+                image.compressed = true;
+                image.format = container.format;
+                image.width = container.width;
+                image.height = container.height;
+                image.levels = std::move(container.levels);
+                return true;
+            }
+            if (isContainer)
+                return false;
+        }
+
+        // same orientation as TextureN::loadFromFile
+        stbi_set_flip_vertically_on_load(true);
+        int numChannels{0};
+        unsigned char* data{stbi_load(path.c_str(), &image.width, &image.height, &numChannels, 4)};
+        if (!data)
+            return false;
+
+        std::vector<unsigned char> level{data, data + static_cast<std::size_t>(image.width) * image.height * 4};
+        stbi_image_free(data);
+        image.compressed = false;
+        image.levels = MipGenN::generate(level.data(), image.width, image.height,
+                                         MipGenN::getOptions(type, level.data(), image.width, image.height), jobs);
+        return true;
+    }
+} // namespace
+
+MaterialArrays::MaterialArrays(EngineObject* parent, JobSystem* jobs) :
+    EngineObject{"MaterialArrays", parent}, m_jobs{jobs}
+{
+    constexpr std::size_t bytes{MaterialArrayN::MAX_MATERIALS * 4 * sizeof(int)};
+
+    glGenBuffers(1, &m_UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+    glBufferData(GL_UNIFORM_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MaterialArrayN::BUFFER_BINDING, m_UBO);
+
+    invalidateBindings();
+}
+
+MaterialArrays::~MaterialArrays()
+{
+    for (const MaterialArrayN::Page& page : m_pages)
+        glDeleteTextures(1, &page.id);
+    glDeleteBuffers(1, &m_UBO);
+}
+
+std::vector<int> MaterialArrays::pack(const std::vector<MaterialArrayN::Source>& sources)
+{
+    // every distinct texture once
+    std::map<std::pair<std::string, int>, LayerImage> images{};
+    for (const MaterialArrayN::Source& source : sources)
+    {
+        for (int slot{0}; slot < MaterialArrayN::SLOT_COUNT; ++slot)
+        {
+            const std::string& path{source.paths[slot]};
+            if (path.empty() || images.count({path, slot}) != 0)
+                continue;
+
+            LayerImage& image{images[{path, slot}]};
+            image.loaded = loadLayerImage(path, static_cast<MeshN::TextureType>(slot), m_jobs, image);
+            if (!image.loaded)
+            {
+                Util::beginError();
+                std::cout << "MATERIAL_ARRAYS::PACK::ERROR: Failed to load `" << path << "`";
+                Util::endError();
+            }
+        }
+    }
+
+    // same type, format, size & mip count share pages
+    std::map<std::tuple<int, unsigned int, int, int, int>, std::vector<LayerImage*>> groups{};
+    for (auto& [key, image] : images)
+    {
+        if (!image.loaded)
+            continue;
+        const auto levels{static_cast<int>(image.levels.size())};
+        groups[{key.second, getGLFormat(image), image.width, image.height, levels}].push_back(&image);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (const auto& [key, group] : groups)
+    {
+        const auto& [type, format, width, height, levels] {key};
+        const bool compressed{group.front()->compressed};
+        const BCnN::Format compressedFormat{group.front()->format};
+
+        for (std::size_t begin{0}; begin < group.size(); begin += MaterialArrayN::MAX_PAGE_LAYERS)
+        {
+            MaterialArrayN::Page page{};
+            page.type = static_cast<MeshN::TextureType>(type);
+            page.format = format;
+            page.width = width;
+            page.height = height;
+            page.levels = levels;
+            page.layers = static_cast<int>(
+                std::min<std::size_t>(MaterialArrayN::MAX_PAGE_LAYERS, group.size() - begin));
+
+            glGenTextures(1, &page.id);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, page.id);
+            for (int level{0}; level < levels; ++level)
+            {
+                const int levelWidth{std::max(1, width >> level)};
+                const int levelHeight{std::max(1, height >> level)};
+                if (compressed)
+                {
+                    const std::size_t bytes{BCnN::getLevelBytes(compressedFormat, levelWidth, levelHeight) *
+                                            page.layers};
+                    glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight, page.layers, 0,
+                                           static_cast<GLsizei>(bytes), nullptr);
+                    page.bytes += bytes;
+                }
+                else
+                {
+                    glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, levelWidth, levelHeight, page.layers, 0, GL_RGBA,
+                                 GL_UNSIGNED_BYTE, nullptr);
+                    page.bytes += static_cast<std::size_t>(levelWidth) * levelHeight * 4 * page.layers;
+                }
+            }
+
+            const int pageIndex{static_cast<int>(m_pages.size())};
+            for (int layer{0}; layer < page.layers; ++layer)
+            {
+                LayerImage& image{*group[begin + layer]};
+                for (int level{0}; level < static_cast<int>(image.levels.size()); ++level)
+                {
+                    const int levelWidth{std::max(1, width >> level)};
+                    const int levelHeight{std::max(1, height >> level)};
+                    if (image.compressed)
+                    {
+                        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1,
+                                                  format, static_cast<GLsizei>(image.levels[level].size()),
+                                                  image.levels[level].data());
+                    }
+                    else
+                    {
+                        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1, GL_RGBA,
+                                        GL_UNSIGNED_BYTE, image.levels[level].data());
+                    }
+                }
+                image.page = pageIndex;
+                image.layer = layer;
+                // the pixels aren't needed anymore
+                image.levels = {};
+            }
+
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                            levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            std::cout << "Packed " << page.layers << ' ' << width << 'x' << height << ' '
+                      << (compressed ? BCnN::getName(compressedFormat) : "RGBA8") << " layers into material page "
+                      << pageIndex << '\n';
+            m_pages.push_back(page);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    // bindings of the new pages' unit are stale now
+    invalidateBindings();
+
+    std::vector<int> indices{};
+    indices.reserve(sources.size());
+    for (const MaterialArrayN::Source& source : sources)
+    {
+        MaterialArrayN::Material material{};
+        material.pages.fill(-1);
+        material.layers.fill(-1);
+        bool complete{true};
+        for (int slot{0}; slot < MaterialArrayN::SLOT_COUNT; ++slot)
+        {
+            if (source.paths[slot].empty())
+                continue;
+            const LayerImage& image{images.at({source.paths[slot], slot})};
+            complete &= image.page >= 0;
+            material.pages[slot] = image.page;
+            material.layers[slot] = image.layer;
+        }
+        if (!complete)
+        {
+            indices.push_back(-1);
+            continue;
+        }
+
+        std::array<int, MaterialArrayN::SLOT_COUNT * 2> key{};
+        std::copy(material.pages.begin(), material.pages.end(), key.begin());
+        std::copy(material.layers.begin(), material.layers.end(), key.begin() + MaterialArrayN::SLOT_COUNT);
+        if (const auto it{m_materialIndices.find(key)}; it != m_materialIndices.end())
+        {
+            indices.push_back(it->second);
+            continue;
+        }
+
+        if (m_materials.size() >= MaterialArrayN::MAX_MATERIALS)
+        {
+            Util::beginError();
+            std::cout << "MATERIAL_ARRAYS::PACK::ERROR: Out of material slots (" << MaterialArrayN::MAX_MATERIALS
+                      << ")";
+            Util::endError();
+            indices.push_back(-1);
+            continue;
+        }
+
+        const int index{static_cast<int>(m_materials.size())};
+        m_materials.push_back(material);
+        m_materialIndices.emplace(key, index);
+        writeMaterial(index);
+        indices.push_back(index);
+    }
+    return indices;
+}
+
+void MaterialArrays::bind(const Shader* shader, const int material)
+{
+    const unsigned int program{shader->getShaderID()};
+    auto it{m_programs.find(program)};
+    if (it == m_programs.end())
+    {
+        setupProgram(program);
+        it = m_programs.find(program);
+    }
+    glUniform1i(it->second, material);
+    if (material < 0)
+        return;
+
+    // only pages that differ from the previous material
+    const MaterialArrayN::Material& data{m_materials[material]};
+    bool bound{false};
+    for (int slot{0}; slot < MaterialArrayN::SLOT_COUNT; ++slot)
+    {
+        const int page{data.pages[slot]};
+        if (page < 0 || page == m_boundPages[slot])
+            continue;
+
+        glActiveTexture(GL_TEXTURE0 + MaterialArrayN::FIRST_UNIT + slot);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_pages[page].id);
+        m_boundPages[slot] = page;
+        bound = true;
+    }
+    if (bound)
+        glActiveTexture(GL_TEXTURE0);
+}
+
+void MaterialArrays::invalidateBindings() { m_boundPages.fill(-1); }
+
+std::size_t MaterialArrays::getResidentBytes() const
+{
+    std::size_t bytes{0};
+    for (const MaterialArrayN::Page& page : m_pages)
+        bytes += page.bytes;
+    return bytes;
+}
+
+void MaterialArrays::setupProgram(const unsigned int program)
+{
+    const GLuint block{glGetUniformBlockIndex(program, "Materials")};
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, block, MaterialArrayN::BUFFER_BINDING);
+
+    // the 2D maps are on the units below the pages, so the two sampler types never share a unit
+    for (int slot{0}; slot < MaterialArrayN::SLOT_COUNT; ++slot)
+        glUniform1i(glGetUniformLocation(program, ARRAY_NAMES[slot]), MaterialArrayN::FIRST_UNIT + slot);
+    m_programs[program] = glGetUniformLocation(program, "materialIndex");
+}
+
+void MaterialArrays::writeMaterial(const int index)
+{
+    const MaterialArrayN::Material& material{m_materials[index]};
+    int data[4]{};
+    for (int slot{0}; slot < MaterialArrayN::SLOT_COUNT; ++slot)
+        data[slot] = material.layers[slot];
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(index * sizeof(data)), sizeof(data), data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
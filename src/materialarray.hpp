@@ -0,0 +1,99 @@
+// Packed PBR materials.
+// Material textures with the same type, size, format & mip count are copied into the layers of shared
+// GL_TEXTURE_2D_ARRAY pages, and every material becomes a row of layer indices in a uniform buffer. Meshes using
+// packed materials only switch the `materialIndex` uniform between draws - pages are rebound when a material lives
+// on different pages than the previous one, sampler units & the buffer are set up once per shader.
+// Baked (or .ktx2 / .dds) textures are packed as they are, other images as RGBA8 with cpu filtered mips.
+
+#ifndef MATERIAL_ARRAY_H
+#define MATERIAL_ARRAY_H
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "engine_types.hpp"
+#include "jobs.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+
+namespace MaterialArrayN
+{
+    // one array per material type (albedo, ao, ORM, normal)
+    constexpr int SLOT_COUNT{MeshN::TEXTURE_NONE};
+    // materials in the uniform buffer, each takes an ivec4 (see `Materials` in the PBR shaders)
+    constexpr int MAX_MATERIALS{256};
+    // pages are bound to FIRST_UNIT + slot, clear of the 2D maps (MaterialLibrary) & the IBL maps
+    constexpr int FIRST_UNIT{5};
+    constexpr unsigned int BUFFER_BINDING{1};
+    // layers of a single page, larger groups are split
+    constexpr int MAX_PAGE_LAYERS{64};
+
+    // texture files of a material, empty paths for unused slots
+    struct Source
+    {
+        std::array<std::string, SLOT_COUNT> paths{};
+    };
+
+    struct Page
+    {
+        unsigned int id{0}; // gl texture
+        MeshN::TextureType type{MeshN::TEXTURE_NONE};
+        unsigned int format{0}; // gl internal format
+        int width{0};
+        int height{0};
+        int levels{0};
+        int layers{0};
+        std::size_t bytes{0};
+    };
+
+    // page & layer of every slot, -1 for unused slots (sampled as the slot's neutral value)
+    struct Material
+    {
+        std::array<int, SLOT_COUNT> pages{};
+        std::array<int, SLOT_COUNT> layers{};
+    };
+} // namespace MaterialArrayN
+
+class MaterialArrays final : public EngineObject
+{
+public:
+    // jobs filters the mips of uncompressed images (can be nullptr)
+    MaterialArrays(EngineObject* parent, JobSystem* jobs);
+    ~MaterialArrays() override;
+
+    // pack a batch of materials (all textures of a model at once keeps pages dense)
+    // returns the material index of every source, -1 where a texture couldn't be loaded or no index is left
+    std::vector<int> pack(const std::vector<MaterialArrayN::Source>& sources);
+
+    // make material current for the next draw with shader (in use), -1 switches the shader back to its 2D maps
+    // (MaterialLibrary::bind calls this when the material changes)
+    void bind(const Shader* shader, int material);
+    // forget which pages are bound (something else may have used the units)
+    void invalidateBindings();
+
+    [[nodiscard]] std::size_t getMaterialCount() const { return m_materials.size(); }
+    [[nodiscard]] std::size_t getPageCount() const { return m_pages.size(); }
+    [[nodiscard]] std::size_t getResidentBytes() const;
+
+private:
+    JobSystem* m_jobs{nullptr};
+    unsigned int m_UBO{0};
+    std::vector<MaterialArrayN::Page> m_pages{};
+    std::vector<MaterialArrayN::Material> m_materials{};
+    // identical materials share an index
+    std::map<std::array<int, MaterialArrayN::SLOT_COUNT * 2>, int> m_materialIndices{};
+
+    // per program: location of `materialIndex` (programs are set up on first use)
+    std::unordered_map<unsigned int, int> m_programs{};
+    std::array<int, MaterialArrayN::SLOT_COUNT> m_boundPages{};
+
+    void setupProgram(unsigned int program);
+    // upload a material's layer indices
+    void writeMaterial(int index);
+};
+
+#endif
@@ -2,11 +2,16 @@
 #include <cstddef>
 #include <glad/glad.h>
 #include "mikktspace.h"
+#include "material.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <utility>
 
 Mesh::Mesh(const std::vector<MeshN::Vertex>& vertices, const std::vector<unsigned int>& indices,
-           const std::vector<MeshN::Texture>& textures) : m_vertices{vertices}, m_indices{indices}, m_textures{textures}
+           std::shared_ptr<Material> material) :
+    m_vertices{vertices}, m_indices{indices}, m_material{std::move(material)}
 {
     // mikktspace.h callbacks
     m_SMT_iface.m_getNumFaces = SMTGetNumFaces;
@@ -18,6 +23,8 @@ Mesh::Mesh(const std::vector<MeshN::Vertex>& vertices, const std::vector<unsigne
 
     m_SMT_context.m_pInterface = &m_SMT_iface;
 
+    computeBounds();
+    computeUVDensity();
     setupMesh();
 }
 
@@ -28,53 +35,18 @@ void Mesh::render(const Shader* shader) const
     glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()), GL_UNSIGNED_INT, nullptr);
 }
 
-void Mesh::renderPBR(const Shader* pbrShader) const
+void Mesh::renderPBR(const Shader* pbrShader, MaterialLibrary* materials) const
 {
     pbrShader->use();
-    std::string textureType;
-
-    for (int i{0}; i < m_textures.size(); ++i)
-    {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, m_textures[i].id);
-
-        switch (m_textures[i].type)
-        {
-        case MeshN::TEXTURE_ALBEDO:
-            textureType = "albedoMap";
-            break;
-        case MeshN::TEXTURE_AO:
-            textureType = "aoMap";
-            break;
-        case MeshN::TEXTURE_METALLIC:
-            textureType = "metallicMap";
-            break;
-        case MeshN::TEXTURE_ROUGHNESS:
-            textureType = "roughnessMap";
-            break;
-        case MeshN::TEXTURE_NORMAL:
-            textureType = "normalMap";
-            break;
-        default:
-            textureType = "unknown";
-            break;
-        }
-
-        // don't render unknown texture
-        if (textureType == "unknown")
-            continue;
-
-        pbrShader->setInt(textureType, i);
-    }
+    materials->bind(pbrShader, m_material.get());
 
     glBindVertexArray(m_VAO);
     glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()), GL_UNSIGNED_INT, nullptr);
-
-    // reset
     glBindVertexArray(0);
-    glActiveTexture(GL_TEXTURE0);
 }
 
+const std::vector<MeshN::Texture>& Mesh::getTextures() const { return m_material->getTextures(); }
+
 void Mesh::free() const
 {
     glDeleteVertexArrays(1, &m_VAO);
@@ -128,6 +100,51 @@ void Mesh::setupMesh()
     std::cout << "Loaded mesh: " << m_vertices.size() << " vertices, " << m_indices.size() << " indices" << std::endl;
 }
 
+// calculate local space AABB and bounding sphere from vertex positions
+void Mesh::computeBounds()
+{
+    if (m_vertices.empty())
+        return;
+
+    m_aabb.min = m_vertices[0].position;
+    m_aabb.max = m_vertices[0].position;
+    for (const MeshN::Vertex& vertex : m_vertices)
+    {
+        m_aabb.min = glm::min(m_aabb.min, vertex.position);
+        m_aabb.max = glm::max(m_aabb.max, vertex.position);
+    }
+
+    // sphere around box center, radius from the furthest vertex (tighter than the half diagonal)
+    m_boundingSphere.center = (m_aabb.min + m_aabb.max) * 0.5f;
+    float maxDist2{0.0f};
+    for (const MeshN::Vertex& vertex : m_vertices)
+    {
+        const glm::vec3 d{vertex.position - m_boundingSphere.center};
+        maxDist2 = std::max(maxDist2, glm::dot(d, d));
+    }
+    m_boundingSphere.radius = std::sqrt(maxDist2);
+}
+
+// sqrt of uv area over surface area, so a texture of size s covers about s * density texels per unit
+void Mesh::computeUVDensity()
+{
+    double uvArea{0.0};
+    double area{0.0};
+    for (std::size_t i{0}; i + 2 < m_indices.size(); i += 3)
+    {
+        const MeshN::Vertex& a{m_vertices[m_indices[i]]};
+        const MeshN::Vertex& b{m_vertices[m_indices[i + 1]]};
+        const MeshN::Vertex& c{m_vertices[m_indices[i + 2]]};
+
+        area += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+        const glm::vec2 uvB{b.texCoords - a.texCoords};
+        const glm::vec2 uvC{c.texCoords - a.texCoords};
+        uvArea += std::abs(uvB.x * uvC.y - uvB.y * uvC.x);
+    }
+
+    m_uvDensity = area > 0.0 ? static_cast<float>(std::sqrt(uvArea / area)) : 0.0f;
+}
+
 void Mesh::calcTangents()
 {
     m_SMT_context.m_pUserData = this;
@@ -1,8 +1,11 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include "culling.hpp"
 #include "shader.hpp"
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -10,6 +13,14 @@
 
 #define MAX_BONE_INFLUENCE 4
 
+class Material;
+class MaterialLibrary;
+
+namespace TextureCacheN
+{
+    struct Entry;
+} // namespace TextureCacheN
+
 namespace MeshN
 {
     struct Vertex
@@ -27,10 +38,9 @@ namespace MeshN
     {
         TEXTURE_ALBEDO = 0,
         TEXTURE_AO = 1,
-        TEXTURE_METALLIC = 2,
-        TEXTURE_ROUGHNESS = 3,
-        TEXTURE_NORMAL = 4,
-        TEXTURE_NONE = 5,
+        TEXTURE_ORM = 2, // occlusion (r), roughness (g) & metallic (b), sampled per channel like glTF packs them
+        TEXTURE_NORMAL = 3,
+        TEXTURE_NONE = 4,
     };
 
     struct Texture
@@ -39,6 +49,7 @@ namespace MeshN
         TextureType type;
         std::string path;
         bool embedded;
+        std::shared_ptr<const TextureCacheN::Entry> ref{}; // keeps the cached gl texture alive
     };
 
     struct BoneInfo
@@ -51,11 +62,13 @@ namespace MeshN
 class Mesh
 {
 public:
+    // material is shared with other meshes (see MaterialLibrary)
     Mesh(const std::vector<MeshN::Vertex>& vertices, const std::vector<unsigned int>& indices,
-         const std::vector<MeshN::Texture>& textures);
+         std::shared_ptr<Material> material);
 
     void render(const Shader* shader) const;
-    void renderPBR(const Shader* pbrShader) const;
+    // binds the material (only if it isn't bound already) and draws
+    void renderPBR(const Shader* pbrShader, MaterialLibrary* materials) const;
 
     void free() const;
 
@@ -64,20 +77,36 @@ public:
     [[nodiscard]] const std::vector<MeshN::Vertex>& getVertices() const { return m_vertices; }
     [[nodiscard]] MeshN::Vertex* getVertex(const int index) { return &m_vertices[index]; }
     [[nodiscard]] const std::vector<unsigned int>& getIndices() const { return m_indices; }
+    // textures of the material (empty once it's packed)
+    [[nodiscard]] const std::vector<MeshN::Texture>& getTextures() const;
+
+    // local space bounds, computed at load
+    [[nodiscard]] const CullingN::AABB& getAABB() const { return m_aabb; }
+    [[nodiscard]] const CullingN::Sphere& getBoundingSphere() const { return m_boundingSphere; }
+    // average uv units per local space unit (0 without uvs), texture streaming picks mips with it
+    [[nodiscard]] float getUVDensity() const { return m_uvDensity; }
+
+    [[nodiscard]] const std::shared_ptr<Material>& getMaterial() const { return m_material; }
 
 private:
     std::vector<MeshN::Vertex> m_vertices;
     std::vector<unsigned int> m_indices;
-    std::vector<MeshN::Texture> m_textures;
+    std::shared_ptr<Material> m_material;
 
     unsigned int m_VAO{};
     unsigned int m_VBO{};
     unsigned int m_EBO{};
 
+    CullingN::AABB m_aabb{};
+    CullingN::Sphere m_boundingSphere{};
+    float m_uvDensity{0.0f};
+
     SMikkTSpaceContext m_SMT_context{};
     SMikkTSpaceInterface m_SMT_iface{};
 
     void setupMesh();
+    void computeBounds();
+    void computeUVDensity();
 
     // SMikkT callbacks
     static int SMTGetVertexIndex(const SMikkTSpaceContext* context, int iFace, int iVert);
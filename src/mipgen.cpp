@@ -0,0 +1,334 @@
+#include "mipgen.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define MIPGEN_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    constexpr float PI{3.14159265359f};
+    // maps with fewer alpha values between these count as alpha tested
+    constexpr int PARTIAL_ALPHA_MIN{16};
+    constexpr int PARTIAL_ALPHA_MAX{239};
+    constexpr float ALPHA_TESTED_SHARE{0.1f};
+    constexpr float ALPHA_TESTED_CUTOFF{0.5f};
+    // binary search steps for the coverage preserving alpha scale
+    constexpr int COVERAGE_ITERATIONS{12};
+    constexpr float MAX_ALPHA_SCALE{4.0f};
+    constexpr int LINEAR_TO_SRGB_SIZE{4096};
+
+    // source texels & weights of every destination texel along one axis
+    struct Axis
+    {
+        int taps{0};
+        std::vector<int> indices{}; // already wrapped
+        std::vector<float> weights{};
+    };
+
+    // modified bessel function of the first kind, power series (converges fast for the window's arguments)
+    float besselI0(const float x)
+    {
+        float sum{1.0f};
+        float term{1.0f};
+        for (int k{1}; k < 20; ++k)
+        {
+            const float factor{x * 0.5f / static_cast<float>(k)};
+            term *= factor * factor;
+            sum += term;
+        }
+        return sum;
+    }
+
+    // x in [-1, 1]
+    float kaiser(const float x)
+    {
+        const float t{1.0f - x * x};
+        if (t <= 0.0f)
+            return 0.0f;
+        return besselI0(MipGenN::KAISER_ALPHA * std::sqrt(t)) / besselI0(MipGenN::KAISER_ALPHA);
+    }
+
+    float sinc(const float x)
+    {
+        if (std::abs(x) < 1e-5f)
+            return 1.0f;
+        return std::sin(PI * x) / (PI * x);
+    }
+
+    Axis makeAxis(const int source, const int destination)
+    {
+        const float scale{static_cast<float>(source) / static_cast<float>(destination)};
+        // axes that don't shrink (1 texel wide images) are copied
+        const bool shrinks{destination < source};
+        const float support{shrinks ? MipGenN::FILTER_RADIUS * scale : 0.5f};
+
+        Axis axis{};
+        axis.taps = static_cast<int>(std::ceil(support * 2.0f)) + 1;
+        axis.indices.resize(static_cast<std::size_t>(destination) * axis.taps);
+        axis.weights.resize(axis.indices.size());
+        for (int i{0}; i < destination; ++i)
+        {
+            const float center{(static_cast<float>(i) + 0.5f) * scale};
+            const int first{static_cast<int>(std::floor(center - support))};
+            float sum{0.0f};
+            for (int k{0}; k < axis.taps; ++k)
+            {
+                const int j{first + k};
+                // distance in destination texels
+                const float t{(static_cast<float>(j) + 0.5f - center) / scale};
+                float weight{0.0f};
+                if (shrinks)
+                    weight = std::abs(t) < MipGenN::FILTER_RADIUS ? sinc(t) * kaiser(t / MipGenN::FILTER_RADIUS) : 0.0f;
+                else
+                    weight = std::abs(t) < 0.5f ? 1.0f : 0.0f;
+
+                const std::size_t tap{static_cast<std::size_t>(i) * axis.taps + k};
+                axis.indices[tap] = (j % source + source) % source;
+                axis.weights[tap] = weight;
+                sum += weight;
+            }
+            for (int k{0}; k < axis.taps; ++k)
+                axis.weights[static_cast<std::size_t>(i) * axis.taps + k] /= sum;
+        }
+        return axis;
+    }
+
+    // weighted sum of rgba texels at source + index * stride
+    void filterTexel(const float* source, const int* indices, const float* weights, const int taps,
+                     const std::size_t stride, float* out)
+    {
+#ifdef MIPGEN_SSE
+        __m128 sum{_mm_setzero_ps()};
+        for (int k{0}; k < taps; ++k)
+        {
+            const __m128 texel{_mm_loadu_ps(source + indices[k] * stride)};
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), texel));
+        }
+        _mm_storeu_ps(out, sum);
+#else
+        float sum[4]{};
+        for (int k{0}; k < taps; ++k)
+        {
+            const float* texel{source + indices[k] * stride};
+            for (int c{0}; c < 4; ++c)
+                sum[c] += weights[k] * texel[c];
+        }
+        std::copy(sum, sum + 4, out);
+#endif
+    }
+
+    void runRows(JobSystem* jobs, const std::size_t rows, const std::function<void(std::size_t, std::size_t)>& func)
+    {
+        if (jobs != nullptr)
+            jobs->parallelFor(rows, MipGenN::ROW_GRAIN, func);
+        else
+            func(0, rows);
+    }
+
+    float srgbToLinear(const float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSRGB(const float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    const std::array<float, 256>& getLinearTable()
+    {
+        static const std::array<float, 256> table{[]
+        {
+            std::array<float, 256> values{};
+            for (int i{0}; i < 256; ++i)
+                values[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+            return values;
+        }()};
+        return table;
+    }
+
+    const std::array<unsigned char, LINEAR_TO_SRGB_SIZE>& getSRGBTable()
+    {
+        static const std::array<unsigned char, LINEAR_TO_SRGB_SIZE> table{[]
+        {
+            std::array<unsigned char, LINEAR_TO_SRGB_SIZE> values{};
+            for (int i{0}; i < LINEAR_TO_SRGB_SIZE; ++i)
+            {
+                const float srgb{linearToSRGB(static_cast<float>(i) / (LINEAR_TO_SRGB_SIZE - 1))};
+                values[i] = static_cast<unsigned char>(std::lround(srgb * 255.0f));
+            }
+            return values;
+        }()};
+        return table;
+    }
+
+    std::vector<float> toFloat(const unsigned char* rgba, const std::size_t count, const MipGenN::Options& options)
+    {
+        const std::array<float, 256>& linear{getLinearTable()};
+        std::vector<float> texels(count * 4);
+        for (std::size_t i{0}; i < count * 4; ++i)
+        {
+            const bool color{i % 4 != 3};
+            texels[i] = options.srgb && color ? linear[rgba[i]] : static_cast<float>(rgba[i]) / 255.0f;
+        }
+        return texels;
+    }
+
+    std::vector<unsigned char> toBytes(const std::vector<float>& texels, const MipGenN::Options& options,
+                                       const float alphaScale)
+    {
+        const std::array<unsigned char, LINEAR_TO_SRGB_SIZE>& srgb{getSRGBTable()};
+        std::vector<unsigned char> bytes(texels.size());
+        for (std::size_t i{0}; i < texels.size(); ++i)
+        {
+            const bool color{i % 4 != 3};
+            // the sinc lobes ring past the input range
+            const float value{std::clamp(color ? texels[i] : texels[i] * alphaScale, 0.0f, 1.0f)};
+            if (options.srgb && color)
+                bytes[i] = srgb[static_cast<std::size_t>(std::lround(value * (LINEAR_TO_SRGB_SIZE - 1)))];
+            else
+                bytes[i] = static_cast<unsigned char>(std::lround(value * 255.0f));
+        }
+        return bytes;
+    }
+
+    void renormalize(std::vector<float>& texels)
+    {
+        for (std::size_t i{0}; i < texels.size(); i += 4)
+        {
+            float normal[3]{};
+            float length{0.0f};
+            for (int c{0}; c < 3; ++c)
+            {
+                normal[c] = texels[i + c] * 2.0f - 1.0f;
+                length += normal[c] * normal[c];
+            }
+            length = std::sqrt(length);
+            if (length <= 0.0f)
+                continue;
+            for (int c{0}; c < 3; ++c)
+                texels[i + c] = normal[c] / length * 0.5f + 0.5f;
+        }
+    }
+
+    // share of texels whose scaled alpha passes the cutoff
+    float getCoverage(const std::vector<float>& texels, const float cutoff, const float scale)
+    {
+        std::size_t passed{0};
+        for (std::size_t i{3}; i < texels.size(); i += 4)
+            passed += texels[i] * scale >= cutoff;
+        return static_cast<float>(passed) / static_cast<float>(texels.size() / 4);
+    }
+
+    // smallest alpha scale that brings the coverage up to target (coverage grows with the scale)
+    float findAlphaScale(const std::vector<float>& texels, const float cutoff, const float target)
+    {
+        float low{0.0f};
+        float high{MAX_ALPHA_SCALE};
+        for (int i{0}; i < COVERAGE_ITERATIONS; ++i)
+        {
+            const float middle{(low + high) * 0.5f};
+            if (getCoverage(texels, cutoff, middle) < target)
+                low = middle;
+            else
+                high = middle;
+        }
+        return high;
+    }
+} // namespace
+
+MipGenN::Options MipGenN::getOptions(const MeshN::TextureType type, const unsigned char* rgba, const int width,
+                                     const int height)
+{
+    Options options{};
+    options.srgb = type == MeshN::TEXTURE_ALBEDO;
+    options.normalMap = type == MeshN::TEXTURE_NORMAL;
+    if (type != MeshN::TEXTURE_ALBEDO)
+        return options;
+
+    const std::size_t count{static_cast<std::size_t>(width) * height};
+    std::size_t partial{0};
+    bool translucent{false};
+    for (std::size_t i{0}; i < count; ++i)
+    {
+        const unsigned char alpha{rgba[i * 4 + 3]};
+        translucent |= alpha < 255;
+        partial += alpha >= PARTIAL_ALPHA_MIN && alpha <= PARTIAL_ALPHA_MAX;
+    }
+    // blended alpha has to keep its values, only cutouts are corrected
+    if (translucent && static_cast<float>(partial) < ALPHA_TESTED_SHARE * static_cast<float>(count))
+        options.alphaCutoff = ALPHA_TESTED_CUTOFF;
+    return options;
+}
+
+std::vector<std::vector<unsigned char>> MipGenN::generate(const unsigned char* rgba, int width, int height,
+                                                          const Options& options, JobSystem* jobs)
+{
+    std::vector<std::vector<unsigned char>> levels{};
+    const std::size_t count{static_cast<std::size_t>(width) * height};
+    levels.emplace_back(rgba, rgba + count * 4);
+
+    std::vector<float> current{toFloat(rgba, count, options)};
+    const float coverage{options.alphaCutoff >= 0.0f ? getCoverage(current, options.alphaCutoff, 1.0f) : 0.0f};
+
+    while (width > 1 || height > 1)
+    {
+        const int levelWidth{std::max(1, width / 2)};
+        const int levelHeight{std::max(1, height / 2)};
+        const Axis axisX{makeAxis(width, levelWidth)};
+        const Axis axisY{makeAxis(height, levelHeight)};
+
+        // horizontal pass over every source row
+        std::vector<float> rows(static_cast<std::size_t>(levelWidth) * height * 4);
+        runRows(jobs, static_cast<std::size_t>(height),
+                [&](const std::size_t begin, const std::size_t end)
+                {
+                    for (std::size_t y{begin}; y < end; ++y)
+                    {
+                        const float* source{&current[y * width * 4]};
+                        for (int x{0}; x < levelWidth; ++x)
+                        {
+                            const std::size_t tap{static_cast<std::size_t>(x) * axisX.taps};
+                            filterTexel(source, &axisX.indices[tap], &axisX.weights[tap], axisX.taps, 4,
+                                        &rows[(y * levelWidth + x) * 4]);
+                        }
+                    }
+                });
+
+        // vertical pass
+        std::vector<float> next(static_cast<std::size_t>(levelWidth) * levelHeight * 4);
+        runRows(jobs, static_cast<std::size_t>(levelHeight),
+                [&](const std::size_t begin, const std::size_t end)
+                {
+                    for (std::size_t y{begin}; y < end; ++y)
+                    {
+                        const std::size_t tap{y * axisY.taps};
+                        for (int x{0}; x < levelWidth; ++x)
+                        {
+                            filterTexel(&rows[static_cast<std::size_t>(x) * 4], &axisY.indices[tap],
+                                        &axisY.weights[tap], axisY.taps, static_cast<std::size_t>(levelWidth) * 4,
+                                        &next[(y * levelWidth + x) * 4]);
+                        }
+                    }
+                });
+
+        if (options.normalMap)
+            renormalize(next);
+
+        // the scale only touches the stored level, the next one filters the unscaled alpha
+        const float alphaScale{options.alphaCutoff >= 0.0f ? findAlphaScale(next, options.alphaCutoff, coverage)
+                                                           : 1.0f};
+        levels.push_back(toBytes(next, options, alphaScale));
+
+        current = std::move(next);
+        width = levelWidth;
+        height = levelHeight;
+    }
+    return levels;
+}
@@ -0,0 +1,42 @@
+// Offline mip chain generation.
+// Every level is filtered from the previous one with a separable Kaiser windowed sinc that wraps at the edges like
+// the GL_REPEAT samplers. sRGB color maps are averaged in linear light, normal maps are renormalized per texel and
+// alpha tested maps keep the alpha coverage of the base level, so cutouts don't thin out in the distance. Levels are
+// kept as floats until they're written, rows are split across the job system and taps are applied to whole RGBA
+// texels with SSE. The texture baker stores the result, so baked textures never build mips at runtime.
+
+#ifndef MIPGEN_H
+#define MIPGEN_H
+
+#include <cstddef>
+#include <vector>
+
+#include "jobs.hpp"
+#include "mesh.hpp"
+
+namespace MipGenN
+{
+    // filter half width in destination texels, a 2:1 reduction reads 12 source texels per axis
+    constexpr float FILTER_RADIUS{3.0f};
+    // Kaiser window shape, higher is smoother with less ringing
+    constexpr float KAISER_ALPHA{4.0f};
+    // rows per job
+    constexpr std::size_t ROW_GRAIN{16};
+
+    struct Options
+    {
+        bool srgb{false};
+        bool normalMap{false};
+        float alphaCutoff{-1.0f}; // >= 0 keeps the coverage of alpha >= cutoff constant
+    };
+
+    // albedo is sRGB (and alpha tested if its alpha is mostly on or off), normal maps are renormalized
+    [[nodiscard]] Options getOptions(MeshN::TextureType type, const unsigned char* rgba, int width, int height);
+
+    // rgba8 levels down to 1x1, base level (a copy of rgba) first
+    // jobs can be nullptr, everything runs on the calling thread then
+    std::vector<std::vector<unsigned char>> generate(const unsigned char* rgba, int width, int height,
+                                                     const Options& options, JobSystem* jobs = nullptr);
+} // namespace MipGenN
+
+#endif
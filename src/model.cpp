@@ -2,22 +2,29 @@
 // Created by Jens Kromdijk on 23/06/25.
 //
 
-#include <STB/stb_image.h>
 #include <assimp/postprocess.h>
 #include <glad/glad.h>
 #include <mikktspace.h>
 
+#include "assimp/GltfMaterial.h"
 #include "assimp/material.h"
+#include "bcn.hpp"
+#include "channelpack.hpp"
 #include "mesh.hpp"
 #include "model.hpp"
 #include "texture.hpp"
+#include "texturecontainer.hpp"
 #include "util.hpp"
 
+#include <algorithm>
+#include <set>
 #include <sstream>
 #include <string>
 
-Model::Model(const std::string& name, EngineObject* parent) :
-    EngineObject{("MODEL " + name).c_str(), parent}, m_modelName{name}
+Model::Model(const std::string& name, EngineObject* parent, TextureCache* textureCache, MaterialLibrary* materials,
+             JobSystem* jobs) :
+    EngineObject{("MODEL " + name).c_str(), parent}, m_modelName{name}, m_textureCache{textureCache},
+    m_materialLibrary{materials}, m_jobs{jobs}
 {
 }
 
@@ -41,10 +48,35 @@ void Model::renderPBR(const Shader* pbrShader) const
 {
     for (std::size_t i{0}; i < m_meshes.size(); ++i)
     {
-        m_meshes[i].renderPBR(pbrShader);
+        m_meshes[i].renderPBR(pbrShader, m_materialLibrary);
     }
 }
 
+void Model::renderNodePBR(const Shader* pbrShader, const int node) const
+{
+    for (const unsigned int mesh : m_nodes[node].meshes)
+    {
+        m_meshes[mesh].renderPBR(pbrShader, m_materialLibrary);
+    }
+}
+
+unsigned int Model::renderPBR(const Shader* pbrShader, const glm::mat4& model, const CullingN::Frustum& frustum) const
+{
+    unsigned int drawn{0};
+    for (std::size_t i{0}; i < m_meshes.size(); ++i)
+    {
+        // single mesh models were already tested per instance
+        if (m_meshes.size() > 1 &&
+            !CullingN::sphereInFrustum(frustum, CullingN::transformSphere(m_meshes[i].getBoundingSphere(), model)))
+        {
+            continue;
+        }
+        m_meshes[i].renderPBR(pbrShader, m_materialLibrary);
+        ++drawn;
+    }
+    return drawn;
+}
+
 bool Model::loadModel(const std::string& path)
 {
     // check if model already exists
@@ -74,7 +106,14 @@ bool Model::loadModel(const std::string& path)
     }
 
     directory = path.substr(0, path.find_last_of('/'));
+    // materials first, meshes share them
+    m_materials.clear();
+    for (unsigned int i{0}; i < scene->mNumMaterials; ++i)
+    {
+        m_materials.push_back(loadMaterial(scene, scene->mMaterials[i]));
+    }
     processNode(scene->mRootNode, scene);
+    computeBounds();
 
     // overkill log
     int numVertices{};
@@ -107,28 +146,73 @@ bool Model::loadModel(const std::string& path)
     return true;
 }
 
-void Model::processNode(const aiNode* node, const aiScene* scene)
+void Model::processNode(const aiNode* node, const aiScene* scene, const int parent)
 {
+    // keep the hierarchy so scene graphs can instantiate it
+    const int index{static_cast<int>(m_nodes.size())};
+    ModelN::Node& modelNode{m_nodes.emplace_back()};
+    modelNode.name = node->mName.C_Str();
+    // assimp matrices are row major
+    modelNode.transform = glm::transpose(Util::convertMatrixGLM(node->mTransformation));
+    modelNode.parent = parent;
+
     for (std::size_t i{0}; i < node->mNumMeshes; ++i)
     {
         // node->mMeshes is a list of indices for scene->mMeshes
         const aiMesh* mesh{scene->mMeshes[node->mMeshes[i]]};
 
-        m_meshes.emplace_back(processMesh(mesh, scene));
+        m_nodes[index].meshes.push_back(static_cast<unsigned int>(m_meshes.size()));
+        m_meshes.emplace_back(processMesh(mesh));
     }
 
     // repeat recursively for all children
     for (std::size_t i{0}; i < node->mNumChildren; ++i)
     {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, index);
+    }
+}
+
+// combine mesh bounds into node & model bounds
+void Model::computeBounds()
+{
+    for (ModelN::Node& node : m_nodes)
+    {
+        if (node.meshes.empty())
+            continue;
+
+        node.aabb = m_meshes[node.meshes[0]].getAABB();
+        for (const unsigned int mesh : node.meshes)
+        {
+            node.aabb = CullingN::mergeAABB(node.aabb, m_meshes[mesh].getAABB());
+        }
+        node.boundingSphere.center = (node.aabb.min + node.aabb.max) * 0.5f;
+        node.boundingSphere.radius = glm::length(node.aabb.max - node.boundingSphere.center);
+    }
+
+    if (m_meshes.empty())
+        return;
+
+    m_aabb = m_meshes[0].getAABB();
+    for (const Mesh& mesh : m_meshes)
+    {
+        m_aabb = CullingN::mergeAABB(m_aabb, mesh.getAABB());
+    }
+
+    // sphere around the merged box that still encloses every mesh sphere
+    m_boundingSphere.center = (m_aabb.min + m_aabb.max) * 0.5f;
+    m_boundingSphere.radius = 0.0f;
+    for (const Mesh& mesh : m_meshes)
+    {
+        const CullingN::Sphere& sphere{mesh.getBoundingSphere()};
+        m_boundingSphere.radius = std::max(m_boundingSphere.radius,
+                                           glm::length(sphere.center - m_boundingSphere.center) + sphere.radius);
     }
 }
 
-Mesh Model::processMesh(const aiMesh* mesh, const aiScene* scene)
+Mesh Model::processMesh(const aiMesh* mesh)
 {
     std::vector<MeshN::Vertex> vertices{};
     std::vector<unsigned int> indices{};
-    std::vector<MeshN::Texture> textures{};
 
     for (std::size_t i{0}; i < mesh->mNumVertices; ++i)
     {
@@ -175,30 +259,92 @@ Mesh Model::processMesh(const aiMesh* mesh, const aiScene* scene)
     // extractBoneWeights(vertices, mesh, scene);
 
     // materials
-    aiMaterial* material{scene->mMaterials[mesh->mMaterialIndex]};
+    if (mesh->mMaterialIndex >= m_materials.size())
+        return Mesh{vertices, indices, m_materialLibrary->getDefault()};
+    return Mesh{vertices, indices, m_materials[mesh->mMaterialIndex]};
+}
+
+std::shared_ptr<Material> Model::loadMaterial(const aiScene* scene, const aiMaterial* mat)
+{
+    std::vector<MeshN::Texture> textures{};
+    MaterialN::Factors factors{};
+
+    const auto getPath{[mat](const aiTextureType type)
+    {
+        aiString str;
+        return mat->GetTextureCount(type) > 0 && mat->Get(AI_MATKEY_TEXTURE(type, 0), str) == AI_SUCCESS
+                   ? std::string{str.C_Str()}
+                   : std::string{};
+    }};
 
-    // use custom glTF Material Output node in blender for ambient occlusion texture
-    std::vector<MeshN::Texture> aoMaps{
-        loadMaterialTextures(scene, material, aiTextureType_LIGHTMAP, MeshN::TEXTURE_AO)};
-    textures.insert(textures.end(), aoMaps.begin(), aoMaps.end());
     // albedo texture
-    std::vector<MeshN::Texture> albedoMaps{
-        loadMaterialTextures(scene, material, aiTextureType_BASE_COLOR, MeshN::TEXTURE_ALBEDO)};
+    std::vector<MeshN::Texture> albedoMaps{loadMaterialTextures(scene, mat, aiTextureType_BASE_COLOR,
+                                                                MeshN::TEXTURE_ALBEDO)};
     textures.insert(textures.end(), albedoMaps.begin(), albedoMaps.end());
-    // metallic texture (b-channel of metallic-roughness texture)
-    std::vector<MeshN::Texture> metallicMaps{
-        loadMaterialTextures(scene, material, aiTextureType_METALNESS, MeshN::TEXTURE_METALLIC)};
-    textures.insert(textures.end(), metallicMaps.begin(), metallicMaps.end());
-    // roughness texture (g-channel)
-    std::vector<MeshN::Texture> roughnessMaps{
-        loadMaterialTextures(scene, material, aiTextureType_GLTF_METALLIC_ROUGHNESS, MeshN::TEXTURE_ROUGHNESS)};
-    textures.insert(textures.end(), roughnessMaps.begin(), roughnessMaps.end());
     // normal map texture
-    std::vector<MeshN::Texture> normalMaps{
-        loadMaterialTextures(scene, material, aiTextureType_NORMALS, MeshN::TEXTURE_NORMAL)};
+    std::vector<MeshN::Texture> normalMaps{loadMaterialTextures(scene, mat, aiTextureType_NORMALS,
+                                                                MeshN::TEXTURE_NORMAL)};
     textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 
-    return Mesh{vertices, indices, textures};
+    // gltf keeps metallic (b) & roughness (g) in one image, which assimp also reports as the metalness & roughness
+    // textures - it is loaded once and sampled per channel
+    // use custom glTF Material Output node in blender for ambient occlusion texture
+    const std::string aoPath{getPath(aiTextureType_LIGHTMAP)};
+    const std::string metallicPath{getPath(aiTextureType_METALNESS)};
+    const std::string roughnessPath{getPath(aiTextureType_DIFFUSE_ROUGHNESS)};
+    std::string ormPath{getPath(aiTextureType_GLTF_METALLIC_ROUGHNESS)};
+    if (ormPath.empty() && metallicPath == roughnessPath)
+        ormPath = metallicPath;
+
+    bool packAO{false};
+    MeshN::Texture orm{};
+    bool hasORM{false};
+    if (ormPath.empty() && (!metallicPath.empty() || !roughnessPath.empty()))
+    {
+        // separate maps are packed into one ORM map (with a separate ao map as occlusion)
+        packAO = !aoPath.empty();
+        hasORM = loadPackedORM(scene, packAO ? aoPath : std::string{}, roughnessPath, metallicPath, orm);
+        if (!hasORM)
+        {
+            Util::beginError();
+            std::cout << "MODEL::LOAD_MATERIAL::ERROR: Failed to pack metallic `" << metallicPath
+                      << "` & roughness `" << roughnessPath << "` into an ORM map";
+            Util::endError();
+            packAO = false;
+        }
+        ormPath = orm.path;
+    }
+    else
+    {
+        hasORM = !ormPath.empty() && loadTexture(scene, ormPath, MeshN::TEXTURE_ORM, orm);
+    }
+    if (hasORM)
+        textures.push_back(orm);
+
+    // occlusion in the ORM map's red channel or in a map of its own
+    if (hasORM && (packAO || aoPath == ormPath))
+    {
+        factors.occlusionInORM = 1.0f;
+    }
+    else
+    {
+        std::vector<MeshN::Texture> aoMaps{loadMaterialTextures(scene, mat, aiTextureType_LIGHTMAP,
+                                                                MeshN::TEXTURE_AO)};
+        textures.insert(textures.end(), aoMaps.begin(), aoMaps.end());
+    }
+
+    // gltf factors, other formats leave metallic to the map (or non metallic without one)
+    aiColor4D baseColor{1.0f, 1.0f, 1.0f, 1.0f};
+    if (mat->Get(AI_MATKEY_BASE_COLOR, baseColor) == AI_SUCCESS)
+        factors.baseColor = glm::vec4{baseColor.r, baseColor.g, baseColor.b, baseColor.a};
+    ai_real value{};
+    factors.metallic = mat->Get(AI_MATKEY_METALLIC_FACTOR, value) == AI_SUCCESS ? value : hasORM ? 1.0f : 0.0f;
+    if (mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, value) == AI_SUCCESS)
+        factors.roughness = value;
+    if (mat->Get(AI_MATKEY_GLTF_TEXTURE_SCALE(aiTextureType_NORMALS, 0), value) == AI_SUCCESS)
+        factors.normalScale = value;
+
+    return m_materialLibrary->create(textures, factors);
 }
 
 std::vector<MeshN::Texture> Model::loadMaterialTextures(const aiScene* scene, const aiMaterial* mat,
@@ -209,147 +355,169 @@ std::vector<MeshN::Texture> Model::loadMaterialTextures(const aiScene* scene, co
     {
         aiString str;
         mat->Get(AI_MATKEY_TEXTURE(type, i), str);
-        bool skip{false};
 
-        // check if we haven't already loaded this texture
-        for (unsigned int j{0}; j < m_loadedTextures.size(); ++j)
-        {
-            // compare
-            if (std::strcmp(m_loadedTextures[j].path.c_str(), str.C_Str()) == 0)
-            {
-                // we found something with the same path
-                // check if texture type is the same, and it isn't embedded (path is *1 or smth)
-                if (m_loadedTextures[j].type == typeName && !m_loadedTextures[j].embedded)
-                {
-                    // push back THAT texture instead
-                    textures.push_back(m_loadedTextures[j]);
-                    skip = true;
-                    break;
-                }
-            }
-        }
+        // don't add bad texture
+        MeshN::Texture texture{};
+        if (loadTexture(scene, str.C_Str(), typeName, texture))
+            textures.push_back(texture);
+    }
 
-        // jump to next iteration if we already loaded this texture
-        if (skip)
-            continue;
+    return textures;
+}
 
-        unsigned int texID;
-        bool success;
+bool Model::loadTexture(const aiScene* scene, const std::string& path, const MeshN::TextureType typeName,
+                        MeshN::Texture& texture)
+{
+    // the cache shares textures between meshes & models
+    TextureCacheN::TextureRef ref{};
+    bool embedded{false};
 
-        // check if texture is embedded in scene or separate
-        if (const aiTexture* texPtr = scene->GetEmbeddedTexture(str.C_Str()))
+    // check if texture is embedded in scene or separate
+    if (const aiTexture* texPtr = scene->GetEmbeddedTexture(path.c_str()))
+    {
+        // if texPtr isn't nullptr, texture can be read from memory
+        embedded = true;
+        const std::size_t size{texPtr->mWidth * (texPtr->mHeight == 0 ? 1 : texPtr->mHeight)};
+        ref = m_textureCache->loadFromMemory(reinterpret_cast<const unsigned char*>(texPtr->pcData), size, typeName,
+                                             true);
+    }
+    else
+    {
+        // get texture path
+        ref = m_textureCache->loadFromFile(directory + '/' + path, typeName, true);
+    }
+
+    if (!ref) // check if texture was loaded successfully
+    {
+        return false;
+    }
+
+    // create texture object
+    texture = MeshN::Texture{ref->id, // texture id (0 until an async load finished)
+                             typeName, // MeshN::TextureType
+                             path, // texture path
+                             embedded, ref};
+    return true;
+}
+
+bool Model::loadPackedORM(const aiScene* scene, const std::string& aoPath, const std::string& roughnessPath,
+                          const std::string& metallicPath, MeshN::Texture& texture)
+{
+    bool embedded{false};
+    const auto getSource{[&](const std::string& path)
+    {
+        ChannelPackN::Source source{};
+        if (path.empty())
+            return source;
+        if (const aiTexture* texPtr = scene->GetEmbeddedTexture(path.c_str()))
         {
-            // if texPtr isn't nullptr, texture can be read from memory
-            texID = loadEmbeddedTexture(texPtr, &success, typeName);
+            embedded = true;
+            source.path = path;
+            source.data = reinterpret_cast<const unsigned char*>(texPtr->pcData);
+            source.size = texPtr->mWidth * (texPtr->mHeight == 0 ? 1 : texPtr->mHeight);
         }
         else
         {
-            // get texture path
-            std::string filename{directory + '/' + str.C_Str()};
-            // load texture id
-            texID = TextureN::loadFromFile(filename.c_str(), nullptr, nullptr, nullptr, &success, typeName);
+            source.path = directory + '/' + path;
         }
+        return source;
+    }};
+    const ChannelPackN::Source occlusion{getSource(aoPath)};
+    const ChannelPackN::Source roughness{getSource(roughnessPath)};
+    const ChannelPackN::Source metallic{getSource(metallicPath)};
+    const std::string name{(metallicPath.empty() ? roughnessPath : metallicPath) + ".orm"};
+
+    // files are baked once & then load like any other compressed texture
+    if (!embedded && BCnN::isSupported(BCnN::FORMAT_BC7))
+    {
+        const std::string bakedName{name + ".ktx2"};
+        const std::string bakedPath{directory + '/' + bakedName};
+        if (!Util::fileExists(bakedPath) && !ChannelPackN::bakeORM(occlusion, roughness, metallic, bakedPath, m_jobs))
+            return false;
+        return loadTexture(scene, bakedName, MeshN::TEXTURE_ORM, texture);
+    }
 
-        if (!success) // check if texture was loaded successfully (don't add bad texture)
-        {
-            continue;
-        }
+    // otherwise the packed image is uploaded as is, keyed by its sources so materials sharing them share it
+    std::string key{"orm:"};
+    for (const ChannelPackN::Source* source : {&occlusion, &roughness, &metallic})
+    {
+        key += source->data != nullptr ? std::to_string(TextureCacheN::hashBytes(source->data, source->size))
+                                       : source->path;
+        key += '|';
+    }
+    TextureCacheN::TextureRef ref{m_textureCache->find(key)};
+    if (!ref)
+    {
+        std::vector<unsigned char> rgba{};
+        int width{0};
+        int height{0};
+        if (!ChannelPackN::packORM(occlusion, roughness, metallic, rgba, width, height, m_jobs))
+            return false;
+        ref = m_textureCache->loadFromPixels(key, rgba.data(), width, height, 4, MeshN::TEXTURE_ORM);
+    }
 
-        // create texture object
-        MeshN::Texture texture{texID, // texture id
-                               typeName, // MeshN::TextureType
-                               str.C_Str(), // texture path
-                               false};
+    // no file of its own, compressed bakes & material arrays skip it like an embedded texture
+    texture = MeshN::Texture{ref->id, MeshN::TEXTURE_ORM, name, true, ref};
+    return true;
+}
 
-        m_loadedTextures.push_back(texture);
-        textures.push_back(texture);
+unsigned int Model::bakeTextures(JobSystem* jobs) const
+{
+    std::set<std::pair<std::string, MeshN::TextureType>> baked{};
+    unsigned int count{0};
+    for (const std::shared_ptr<Material>& material : m_materials)
+    {
+        for (const MeshN::Texture& texture : material->getTextures())
+        {
+            const std::string path{directory + '/' + texture.path};
+            // packed ORM maps are bakes already
+            if (texture.embedded || TextureContainerN::isContainerPath(path) ||
+                !baked.emplace(path, texture.type).second)
+                continue;
+            if (TextureN::bakeCompressed(path.c_str(), texture.type, jobs))
+                ++count;
+        }
     }
-
-    return textures;
+    return count;
 }
 
-// load texture embedded in scene
-unsigned int Model::loadEmbeddedTexture(const aiTexture* texture, bool* success, const MeshN::TextureType materialType)
+unsigned int Model::packMaterials()
 {
-    int imageWidth{0};
-    int imageHeight{0};
-    int imageChannels{0};
-    unsigned char* data{nullptr};
-
-    if (success)
-        *success = true;
-
-    // load texture data from memory
-    // stbi_set_flip_vertically_on_load(true);
-    data = stbi_load_from_memory(
-        // texture data
-        reinterpret_cast<unsigned char*>(texture->pcData),
-        // buffer length
-        static_cast<int>(texture->mWidth * (texture->mHeight == 0 ? 1 : texture->mHeight)), &imageWidth, &imageHeight,
-        &imageChannels, 0);
-
-    // check success
-    if (!data)
-    {
-        std::cout << "MODEL::LOAD_EMBEDDED_TEXTURE::ERROR: Failed to load texture from memory!\n";
-        stbi_image_free(data);
-        if (success)
-            *success = false;
+    MaterialArrays* arrays{m_materialLibrary->getArrays()};
+    if (arrays == nullptr)
         return 0;
+
+    std::vector<MaterialArrayN::Source> sources{};
+    std::vector<Material*> materials{};
+    for (const std::shared_ptr<Material>& material : m_materials)
+    {
+        const std::vector<MeshN::Texture>& textures{material->getTextures()};
+        if (material->getPacked() >= 0 ||
+            std::find(materials.begin(), materials.end(), material.get()) != materials.end() ||
+            std::any_of(textures.begin(), textures.end(), [](const MeshN::Texture& texture) { return texture.embedded; }))
+            continue;
+
+        MaterialArrayN::Source source{};
+        for (const MeshN::Texture& texture : textures)
+            source.paths[texture.type] = directory + '/' + texture.path;
+        sources.push_back(std::move(source));
+        materials.push_back(material.get());
     }
 
-    // get format
-    GLenum internalFormat{0};
-    switch (imageChannels)
-    {
-    case 1: // grayscale
-        internalFormat = GL_RED;
-        break;
-    case 3:
-        internalFormat = GL_RGB;
-        break;
-    case 4:
-        internalFormat = GL_RGBA;
-        break;
-    default:
-        std::cout << "UNKNOWN NUMBER OF CHANNELS: " << imageChannels << std::endl;
-        break;
-    }
-
-    // same as in TextureN::loadFromFile
-    unsigned int texID;
-    glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat), imageWidth, imageHeight, 0, internalFormat,
-                 GL_UNSIGNED_BYTE, data);
-
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    switch (materialType)
-    {
-    case MeshN::TEXTURE_METALLIC:
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_BLUE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_BLUE);
-        break;
-    case MeshN::TEXTURE_ROUGHNESS:
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_GREEN);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_GREEN);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_GREEN);
-        break;
-    default:
-        break;
-    }
-
-    // free texture data
-    stbi_image_free(data);
-
-    // return texture id
-    return texID;
+    const std::vector<int> indices{arrays->pack(sources)};
+    for (std::size_t i{0}; i < materials.size(); ++i)
+    {
+        if (indices[i] >= 0)
+            materials[i]->setPacked(indices[i]);
+    }
+
+    unsigned int count{0};
+    for (const Mesh& mesh : m_meshes)
+    {
+        if (mesh.getMaterial()->getPacked() >= 0)
+            ++count;
+    }
+    return count;
 }
 
 void Model::setDefaultBoneData(MeshN::Vertex& vertex)
@@ -408,8 +576,9 @@ void Model::extractBoneWeights(std::vector<MeshN::Vertex>& vertices, const aiMes
 }
 
 // -------------- Model Manager -------------- //
-ModelManager::ModelManager(EngineObject* parent) :
-    EngineObject{"ModelManager", parent}
+ModelManager::ModelManager(EngineObject* parent, TextureCache* textureCache, MaterialLibrary* materials,
+                           JobSystem* jobs) :
+    EngineObject{"ModelManager", parent}, m_textureCache{textureCache}, m_materialLibrary{materials}, m_jobs{jobs}
 {
 }
 
@@ -417,7 +586,7 @@ ModelManager::ModelManager(EngineObject* parent) :
 void ModelManager::addModel(const std::string& name, const std::string& path, Arena* arena)
 {
     // create new model and add it to arena
-    Model* model{new Model{name, this}};
+    Model* model{new Model{name, this, m_textureCache, m_materialLibrary, m_jobs}};
     arena->addObject(model);
 
     // add model
@@ -1,50 +1,105 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include "culling.hpp"
 #include "engine_types.hpp"
+#include "jobs.hpp"
+#include "material.hpp"
 #include "mesh.hpp"
 #include "shader.hpp"
+#include "texturecache.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+namespace ModelN
+{
+    // node of the imported hierarchy, nodes are stored parents first
+    struct Node
+    {
+        std::string name{};
+        glm::mat4 transform{1.0f}; // relative to parent
+        int parent{-1};
+        std::vector<unsigned int> meshes{}; // indices into the model's meshes
+        CullingN::AABB aabb{}; // local space bounds of the node's meshes
+        CullingN::Sphere boundingSphere{};
+    };
+} // namespace ModelN
+
 class Model final : public EngineObject
 {
 public:
-    explicit Model(const std::string& name, EngineObject* parent);
+    // jobs bakes ORM maps out of separate metallic & roughness maps (can be nullptr)
+    Model(const std::string& name, EngineObject* parent, TextureCache* textureCache, MaterialLibrary* materials,
+          JobSystem* jobs = nullptr);
     ~Model() override;
 
     bool loadModel(const std::string& path);
 
     void render(const Shader* shader) const;
     void renderPBR(const Shader* pbrShader) const;
+    // render only meshes whose world space bounds intersect the frustum, returns number of meshes drawn
+    unsigned int renderPBR(const Shader* pbrShader, const glm::mat4& model, const CullingN::Frustum& frustum) const;
+
+    // render the meshes of a single hierarchy node (without the node transform)
+    void renderNodePBR(const Shader* pbrShader, int node) const;
+
+    // write compressed bakes of the model's texture files (embedded textures are skipped), returns number baked
+    // the bakes are picked up the next time the textures are loaded
+    unsigned int bakeTextures(JobSystem* jobs = nullptr) const;
+    // copy the texture files of every material into the material arrays and draw the meshes from there, returns
+    // number of meshes packed (materials with embedded textures keep their 2D maps)
+    unsigned int packMaterials();
+
+    [[nodiscard]] const std::vector<Mesh>& getMeshes() const { return m_meshes; }
+    [[nodiscard]] const std::vector<ModelN::Node>& getNodes() const { return m_nodes; }
+
+    // local space bounds of all meshes
+    [[nodiscard]] const CullingN::AABB& getAABB() const { return m_aabb; }
+    [[nodiscard]] const CullingN::Sphere& getBoundingSphere() const { return m_boundingSphere; }
     
     [[nodiscard]] std::map<std::string, MeshN::BoneInfo>& getBoneInfoMap() {return m_boneInfoMap;}
     [[nodiscard]] int& getBoneCounter() {return m_boneCounter;}
 
 private:
     std::vector<Mesh> m_meshes{};
+    std::vector<ModelN::Node> m_nodes{};
     std::string directory{};
     std::string m_modelName;
 
-    // loaded mesh textures (to avoid loading the same texture twice)
-    std::vector<MeshN::Texture> m_loadedTextures{};
+    CullingN::AABB m_aabb{};
+    CullingN::Sphere m_boundingSphere{};
+
+    // shared with every other model & texture user
+    TextureCache* m_textureCache{nullptr};
+    MaterialLibrary* m_materialLibrary{nullptr};
+    JobSystem* m_jobs{nullptr};
+    // by scene material index
+    std::vector<std::shared_ptr<Material>> m_materials{};
     
     // bones
     std::map<std::string, MeshN::BoneInfo> m_boneInfoMap{};
     int m_boneCounter{0};
 
-    void processNode(const aiNode* node, const aiScene* scene);
-    Mesh processMesh(const aiMesh* mesh, const aiScene* scene);
+    void processNode(const aiNode* node, const aiScene* scene, int parent = -1);
+    void computeBounds();
+    Mesh processMesh(const aiMesh* mesh);
 
+    std::shared_ptr<Material> loadMaterial(const aiScene* scene, const aiMaterial* mat);
     std::vector<MeshN::Texture> loadMaterialTextures(const aiScene* scene, const aiMaterial* mat, aiTextureType type,
                                                      MeshN::TextureType typeName);
-    static unsigned int loadEmbeddedTexture(const aiTexture* texture, bool* success = nullptr,
-                                            MeshN::TextureType materialType = MeshN::TEXTURE_NONE);
+    // path relative to the model directory, false if the texture failed to load
+    bool loadTexture(const aiScene* scene, const std::string& path, MeshN::TextureType typeName,
+                     MeshN::Texture& texture);
+    // pack separate maps into one ORM map (an empty ao path keeps occlusion white), files are baked to BC7 next to
+    // the metallic map, embedded maps & drivers without BC7 pack in memory
+    bool loadPackedORM(const aiScene* scene, const std::string& aoPath, const std::string& roughnessPath,
+                       const std::string& metallicPath, MeshN::Texture& texture);
 
     static void setDefaultBoneData(MeshN::Vertex& vertex) ;
     static void setVertexBoneData(MeshN::Vertex& vertex, int boneID, float weight);
@@ -55,7 +110,8 @@ private:
 class ModelManager final : public EngineObject
 {
 public:
-    explicit ModelManager(EngineObject* parent);
+    ModelManager(EngineObject* parent, TextureCache* textureCache, MaterialLibrary* materials,
+                 JobSystem* jobs = nullptr);
 
     // load new model
     void addModel(const std::string& name, const std::string& path, Arena* arena);
@@ -67,6 +123,9 @@ public:
     [[nodiscard]] bool modelExists(const std::string& name) const;
 
 private:
+    TextureCache* m_textureCache{nullptr};
+    MaterialLibrary* m_materialLibrary{nullptr};
+    JobSystem* m_jobs{nullptr};
     std::map<std::string, Model*> m_models{};
 };
 
@@ -0,0 +1,323 @@
+#include "occlusion.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+OcclusionCuller::OcclusionCuller(EngineObject* parent) : EngineObject{"OcclusionCuller", parent}
+{
+    setResolution(OcclusionN::DEFAULT_WIDTH, OcclusionN::DEFAULT_HEIGHT);
+}
+
+void OcclusionCuller::setResolution(const int width, const int height)
+{
+    // multiples of 8 so SSE rows and hierarchy levels line up
+    m_width = std::max(8, (width + 7) & ~7);
+    m_height = std::max(8, (height + 7) & ~7);
+
+    m_hiz.clear();
+    m_hizSizes.clear();
+    glm::ivec2 size{m_width, m_height};
+    while (true)
+    {
+        m_hiz.emplace_back(static_cast<std::size_t>(size.x * size.y), 0.0f);
+        m_hizSizes.push_back(size);
+        if (size.x == 1 && size.y == 1)
+            break;
+        size = glm::max(glm::ivec2{1}, (size + 1) / 2);
+    }
+}
+
+int OcclusionCuller::addOccluder(const Model* model, const glm::mat4& transform)
+{
+    m_occluders.push_back(OcclusionN::Occluder{model, transform});
+    return static_cast<int>(m_occluders.size() - 1);
+}
+
+void OcclusionCuller::setOccluderTransform(const int index, const glm::mat4& transform)
+{
+    if (index >= 0 && index < static_cast<int>(m_occluders.size()))
+        m_occluders[index].transform = transform;
+}
+
+void OcclusionCuller::clearOccluders()
+{
+    m_occluders.clear();
+    m_triangles.clear();
+    m_triangleCount = 0;
+}
+
+void OcclusionCuller::render(const glm::mat4& viewProjection, JobSystem* jobs)
+{
+    m_viewProjection = viewProjection;
+    m_triangles.resize(m_occluders.size());
+
+    // transform & set up triangles, one occluder per job
+    jobs->parallelFor(m_occluders.size(), 1, [this](const std::size_t begin, const std::size_t end)
+    {
+        for (std::size_t i{begin}; i < end; ++i)
+            transformOccluder(i);
+    });
+
+    m_triangleCount = 0;
+    for (const std::vector<OcclusionN::Triangle>& triangles : m_triangles)
+        m_triangleCount += static_cast<unsigned int>(triangles.size());
+
+    // rasterize in horizontal bands, every band owns its rows so no synchronization is needed
+    const int numBands{m_height / OcclusionN::BAND_HEIGHT};
+    jobs->parallelFor(static_cast<std::size_t>(numBands), 1, [this](const std::size_t begin, const std::size_t end)
+    {
+        for (std::size_t band{begin}; band < end; ++band)
+        {
+            const int y0{static_cast<int>(band) * OcclusionN::BAND_HEIGHT};
+            rasterizeBand(y0, y0 + OcclusionN::BAND_HEIGHT);
+        }
+    });
+
+    buildHierarchy();
+}
+
+void OcclusionCuller::transformOccluder(const std::size_t index)
+{
+    std::vector<OcclusionN::Triangle>& triangles{m_triangles[index]};
+    triangles.clear();
+
+    const OcclusionN::Occluder& occluder{m_occluders[index]};
+    if (occluder.model == nullptr)
+        return;
+
+    const glm::mat4 mvp{m_viewProjection * occluder.transform};
+    // mirrored transforms flip the winding
+    const bool flipped{glm::determinant(glm::mat3{occluder.transform}) < 0.0f};
+    const glm::vec2 screenSize{static_cast<float>(m_width), static_cast<float>(m_height)};
+
+    thread_local std::vector<glm::vec4> projected{};
+    for (const Mesh& mesh : occluder.model->getMeshes())
+    {
+        const std::vector<MeshN::Vertex>& vertices{mesh.getVertices()};
+        const std::vector<unsigned int>& indices{mesh.getIndices()};
+
+        // project to screen space, w < 0 marks vertices in front of the near plane
+        projected.resize(vertices.size());
+        for (std::size_t i{0}; i < vertices.size(); ++i)
+        {
+            const glm::vec4 clip{mvp * glm::vec4{vertices[i].position, 1.0f}};
+            if (clip.w < OcclusionN::NEAR_W)
+            {
+                projected[i] = glm::vec4{0.0f, 0.0f, 0.0f, -1.0f};
+                continue;
+            }
+            const float invW{1.0f / clip.w};
+            const glm::vec2 ndc{glm::vec2{clip} * invW};
+            projected[i] = glm::vec4{(ndc * 0.5f + 0.5f) * screenSize, invW, 1.0f};
+        }
+
+        for (std::size_t i{0}; i + 2 < indices.size(); i += 3)
+        {
+            const glm::vec4& a{projected[indices[i]]};
+            glm::vec4 b{projected[indices[i + 1]]};
+            glm::vec4 c{projected[indices[i + 2]]};
+
+            // skip triangles crossing the near plane instead of clipping, dropping occluders is always safe
+            if (a.w < 0.0f || b.w < 0.0f || c.w < 0.0f)
+                continue;
+
+            if (flipped)
+                std::swap(b, c);
+
+            // back face & degenerate rejection (counter clockwise is front facing)
+            const float area{(b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)};
+            if (area <= 0.0f)
+                continue;
+
+            // off screen rejection
+            const float minX{std::min(a.x, std::min(b.x, c.x))};
+            const float maxX{std::max(a.x, std::max(b.x, c.x))};
+            const float minY{std::min(a.y, std::min(b.y, c.y))};
+            const float maxY{std::max(a.y, std::max(b.y, c.y))};
+            if (maxX < 0.0f || maxY < 0.0f || minX >= screenSize.x || minY >= screenSize.y)
+                continue;
+
+            triangles.push_back(OcclusionN::Triangle{{glm::vec3{a}, glm::vec3{b}, glm::vec3{c}}});
+        }
+    }
+}
+
+void OcclusionCuller::rasterizeBand(const int y0, const int y1)
+{
+    // clear band
+    std::vector<float>& depth{m_hiz[0]};
+    std::fill(depth.begin() + y0 * m_width, depth.begin() + y1 * m_width, 0.0f);
+
+    for (const std::vector<OcclusionN::Triangle>& triangles : m_triangles)
+    {
+        for (const OcclusionN::Triangle& triangle : triangles)
+            rasterizeTriangle(triangle, y0, y1);
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const OcclusionN::Triangle& triangle, const int y0, const int y1)
+{
+    const glm::vec3& a{triangle.v[0]};
+    const glm::vec3& b{triangle.v[1]};
+    const glm::vec3& c{triangle.v[2]};
+
+    // bounding box clamped to this band
+    const int minY{std::max(y0, static_cast<int>(std::floor(std::min(a.y, std::min(b.y, c.y)))))};
+    const int maxY{std::min(y1 - 1, static_cast<int>(std::ceil(std::max(a.y, std::max(b.y, c.y)))))};
+    if (minY > maxY)
+        return;
+
+    const int minX{std::max(0, static_cast<int>(std::floor(std::min(a.x, std::min(b.x, c.x)))))};
+    const int maxX{std::min(m_width - 1, static_cast<int>(std::ceil(std::max(a.x, std::max(b.x, c.x)))))};
+    if (minX > maxX)
+        return;
+
+    // edge functions E(x, y) = A * x + B * y + C, positive inside a counter clockwise triangle
+    const float edgeA[3]{-(b.y - a.y), -(c.y - b.y), -(a.y - c.y)};
+    const float edgeB[3]{b.x - a.x, c.x - b.x, a.x - c.x};
+    const float edgeC[3]{-(edgeA[0] * a.x + edgeB[0] * a.y), -(edgeA[1] * b.x + edgeB[1] * b.y),
+                         -(edgeA[2] * c.x + edgeB[2] * c.y)};
+
+    // 1/w plane from barycentrics: edge ab weights c, edge bc weights a, edge ca weights b
+    const float area{edgeA[0] * c.x + edgeB[0] * c.y + edgeC[0]};
+    const float invArea{1.0f / area};
+    const float zA{(edgeA[1] * a.z + edgeA[2] * b.z + edgeA[0] * c.z) * invArea};
+    const float zB{(edgeB[1] * a.z + edgeB[2] * b.z + edgeB[0] * c.z) * invArea};
+    const float zC{(edgeC[1] * a.z + edgeC[2] * b.z + edgeC[0] * c.z) * invArea};
+
+    float* depth{m_hiz[0].data()};
+    const int startX{minX & ~3};
+
+#ifdef OCCLUSION_SSE
+    const __m128 laneOffsets{_mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f)};
+    const __m128 zero{_mm_setzero_ps()};
+    const __m128 vEdgeA0{_mm_set1_ps(edgeA[0])}, vEdgeA1{_mm_set1_ps(edgeA[1])}, vEdgeA2{_mm_set1_ps(edgeA[2])};
+    const __m128 vZA{_mm_set1_ps(zA)};
+
+    for (int y{minY}; y <= maxY; ++y)
+    {
+        const float py{static_cast<float>(y) + 0.5f};
+        const __m128 rowE0{_mm_set1_ps(edgeB[0] * py + edgeC[0])};
+        const __m128 rowE1{_mm_set1_ps(edgeB[1] * py + edgeC[1])};
+        const __m128 rowE2{_mm_set1_ps(edgeB[2] * py + edgeC[2])};
+        const __m128 rowZ{_mm_set1_ps(zB * py + zC)};
+
+        float* row{depth + y * m_width};
+        for (int x{startX}; x <= maxX; x += 4)
+        {
+            const __m128 px{_mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets)};
+
+            const __m128 e0{_mm_add_ps(_mm_mul_ps(vEdgeA0, px), rowE0)};
+            const __m128 e1{_mm_add_ps(_mm_mul_ps(vEdgeA1, px), rowE1)};
+            const __m128 e2{_mm_add_ps(_mm_mul_ps(vEdgeA2, px), rowE2)};
+            const __m128 inside{_mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                           _mm_cmpge_ps(e2, zero))};
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+
+            const __m128 z{_mm_add_ps(_mm_mul_ps(vZA, px), rowZ)};
+            const __m128 old{_mm_loadu_ps(row + x)};
+            const __m128 nearest{_mm_max_ps(old, z)};
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+        }
+    }
+#else
+    for (int y{minY}; y <= maxY; ++y)
+    {
+        const float py{static_cast<float>(y) + 0.5f};
+        float* row{depth + y * m_width};
+        for (int x{minX}; x <= maxX; ++x)
+        {
+            const float px{static_cast<float>(x) + 0.5f};
+            if (edgeA[0] * px + edgeB[0] * py + edgeC[0] < 0.0f || edgeA[1] * px + edgeB[1] * py + edgeC[1] < 0.0f ||
+                edgeA[2] * px + edgeB[2] * py + edgeC[2] < 0.0f)
+            {
+                continue;
+            }
+            row[x] = std::max(row[x], zA * px + zB * py + zC);
+        }
+    }
+#endif
+}
+
+void OcclusionCuller::buildHierarchy()
+{
+    for (std::size_t level{1}; level < m_hiz.size(); ++level)
+    {
+        const std::vector<float>& src{m_hiz[level - 1]};
+        std::vector<float>& dst{m_hiz[level]};
+        const glm::ivec2 srcSize{m_hizSizes[level - 1]};
+        const glm::ivec2 dstSize{m_hizSizes[level]};
+
+        for (int y{0}; y < dstSize.y; ++y)
+        {
+            const int sy0{std::min(y * 2, srcSize.y - 1)};
+            const int sy1{std::min(y * 2 + 1, srcSize.y - 1)};
+            for (int x{0}; x < dstSize.x; ++x)
+            {
+                const int sx0{std::min(x * 2, srcSize.x - 1)};
+                const int sx1{std::min(x * 2 + 1, srcSize.x - 1)};
+                // keep the farthest occluder depth so tests stay conservative
+                dst[y * dstSize.x + x] = std::min(std::min(src[sy0 * srcSize.x + sx0], src[sy0 * srcSize.x + sx1]),
+                                                  std::min(src[sy1 * srcSize.x + sx0], src[sy1 * srcSize.x + sx1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::testAABB(const CullingN::AABB& worldBox) const
+{
+    // project corners
+    glm::vec2 screenMin{static_cast<float>(m_width), static_cast<float>(m_height)};
+    glm::vec2 screenMax{0.0f};
+    float nearestInvW{0.0f};
+    const glm::vec2 screenSize{static_cast<float>(m_width), static_cast<float>(m_height)};
+    for (int i{0}; i < 8; ++i)
+    {
+        const glm::vec3 corner{(i & 1) ? worldBox.max.x : worldBox.min.x, (i & 2) ? worldBox.max.y : worldBox.min.y,
+                               (i & 4) ? worldBox.max.z : worldBox.min.z};
+        const glm::vec4 clip{m_viewProjection * glm::vec4{corner, 1.0f}};
+
+        // box crosses the near plane, assume visible
+        if (clip.w < OcclusionN::NEAR_W)
+            return true;
+
+        const float invW{1.0f / clip.w};
+        const glm::vec2 screen{(glm::vec2{clip} * invW * 0.5f + 0.5f) * screenSize};
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearestInvW = std::max(nearestInvW, invW);
+    }
+
+    const int minX{std::max(0, static_cast<int>(std::floor(screenMin.x)))};
+    const int minY{std::max(0, static_cast<int>(std::floor(screenMin.y)))};
+    const int maxX{std::min(m_width - 1, static_cast<int>(std::floor(screenMax.x)))};
+    const int maxY{std::min(m_height - 1, static_cast<int>(std::floor(screenMax.y)))};
+    // off screen, leave it to frustum culling
+    if (minX > maxX || minY > maxY)
+        return true;
+
+    // pick the level where the rect covers at most ~8x8 texels
+    const int size{std::max(maxX - minX, maxY - minY)};
+    std::size_t level{0};
+    while ((size >> level) > 8 && level + 1 < m_hiz.size())
+        ++level;
+
+    const std::vector<float>& hiz{m_hiz[level]};
+    const int levelWidth{m_hizSizes[level].x};
+    for (int y{minY >> level}; y <= (maxY >> level); ++y)
+    {
+        for (int x{minX >> level}; x <= (maxX >> level); ++x)
+        {
+            // an occluder texel at or behind the box's nearest point (or empty) means it may be visible
+            if (hiz[y * levelWidth + x] <= nearestInvW)
+                return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,90 @@
+// CPU software occlusion culling.
+// Designated occluder meshes are rasterized into a small depth buffer (SSE, split into bands across the job system),
+// which is reduced into a hierarchical depth buffer that instance AABBs are tested against before rendering.
+//
+// Depth is stored as 1/w (larger = nearer, 0 = empty), 1/w is linear in screen space and keeps float precision
+// with the engine's very large far plane.
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "culling.hpp"
+#include "engine_types.hpp"
+#include "jobs.hpp"
+#include "model.hpp"
+
+namespace OcclusionN
+{
+    // default depth buffer resolution (rounded up to multiples of 8)
+    constexpr int DEFAULT_WIDTH{256};
+    constexpr int DEFAULT_HEIGHT{128};
+    // rows per rasterization job
+    constexpr int BAND_HEIGHT{8};
+    // clip space w below which geometry is treated as crossing the near plane
+    constexpr float NEAR_W{0.01f};
+
+    struct Occluder
+    {
+        const Model* model{nullptr};
+        glm::mat4 transform{1.0f};
+    };
+
+    // screen space triangle, xy in pixels, z = 1/w
+    struct Triangle
+    {
+        glm::vec3 v[3];
+    };
+} // namespace OcclusionN
+
+class OcclusionCuller final : public EngineObject
+{
+public:
+    explicit OcclusionCuller(EngineObject* parent);
+
+    // tune depth buffer resolution (lower = faster, less accurate)
+    void setResolution(int width, int height);
+
+    // register an occluder, returns its index
+    int addOccluder(const Model* model, const glm::mat4& transform);
+    void setOccluderTransform(int index, const glm::mat4& transform);
+    void clearOccluders();
+
+    // rasterize occluders for this view and build the depth hierarchy
+    void render(const glm::mat4& viewProjection, JobSystem* jobs);
+
+    // false if the box is completely hidden behind rendered occluders
+    [[nodiscard]] bool testAABB(const CullingN::AABB& worldBox) const;
+
+    [[nodiscard]] int getWidth() const { return m_width; }
+    [[nodiscard]] int getHeight() const { return m_height; }
+    [[nodiscard]] bool hasOccluders() const { return !m_occluders.empty(); }
+    [[nodiscard]] unsigned int getTriangleCount() const { return m_triangleCount; }
+    // full resolution 1/w buffer (row 0 = bottom of the screen)
+    [[nodiscard]] const std::vector<float>& getDepthBuffer() const { return m_hiz[0]; }
+
+private:
+    int m_width{0};
+    int m_height{0};
+
+    glm::mat4 m_viewProjection{1.0f};
+
+    std::vector<OcclusionN::Occluder> m_occluders{};
+    // screen space triangles per occluder (written in parallel)
+    std::vector<std::vector<OcclusionN::Triangle>> m_triangles{};
+    unsigned int m_triangleCount{0};
+
+    // depth hierarchy, level 0 is the depth buffer, each level keeps the farthest (min 1/w) of 2x2 texels
+    std::vector<std::vector<float>> m_hiz{};
+    std::vector<glm::ivec2> m_hizSizes{};
+
+    void transformOccluder(std::size_t index);
+    void rasterizeBand(int y0, int y1);
+    void rasterizeTriangle(const OcclusionN::Triangle& triangle, int y0, int y1);
+    void buildHierarchy();
+};
+
+#endif
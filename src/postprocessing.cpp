@@ -1,7 +1,10 @@
 #include "postprocessing.hpp"
 
+#include <algorithm>
+
 #include "engine.hpp"
 #include "engine_types.hpp"
+#include "glext.hpp"
 #include "util.hpp"
 #include "shapes.hpp"
 
@@ -9,140 +12,227 @@ PostProcessor::PostProcessor(EngineObject* parent) : EngineObject{"PostProcessor
 
 PostProcessor::~PostProcessor() { free(); }
 
-// free framebuffer
+// free quad, the targets belong to the pool
 void PostProcessor::free()
 {
     disableBloom();
-    glDeleteTextures(1, &m_TEX);
-    glDeleteRenderbuffers(1, &m_RBO);
-    glDeleteFramebuffers(1, &m_FBO);
-}
-
-// check framebuffer
-bool PostProcessor::check() const
-{
-    // check
-    bool success{true};
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
-    // check framebuffer status
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    {
-        Util::beginError();
-        std::cout << "POST_PROCESSOR::CHECK::ERROR: Framebuffer is not complete!";
-        Util::endError();
-        success = false;
-    }
-    else
-    {
-        std::cout << "Successfully initialized postprocessor!" << std::endl;
-    }
-    // unbind framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    return success;
+    // the pool may already be gone, the history targets are its to delete
+    delete m_temporalAA;
+    m_temporalAA = nullptr;
+    m_temporalAAEnabled = false;
+    delete m_autoExposure;
+    m_autoExposure = nullptr;
+    m_autoExposureEnabled = false;
+    delete m_colorGrading;
+    m_colorGrading = nullptr;
+    glDeleteBuffers(1, &m_VBO);
+    glDeleteVertexArrays(1, &m_VAO);
+    m_VBO = 0;
+    m_VAO = 0;
 }
 
-
-// initialize framebuffer
-void PostProcessor::init(const int width, const int height)
+// initialize quad
+void PostProcessor::init(const int width, const int height, RenderTargetPool* pool)
 {
     m_width = width;
     m_height = height;
-
-    // generate framebuffer
-    generateFramebuffer();
-    generateFramebufferTexture();
-    generateRenderbuffer();
-
-    // check framebuffer
-    if (!check())
-    {
-        Util::beginError();
-        std::cout << "POST_PROCESSOR::INIT::ERROR: Error checking framebuffer!";
-        Util::endError();
-    }
+    m_renderSize = m_dynamicResolution.getSize(std::max(width, 1), std::max(height, 1));
+    m_pool = pool;
 
     // create quad
     generateQuad();
+    m_colorGrading = new ColorGrading{this};
 }
 
-void PostProcessor::render(const Shader* screenShader) const
+void PostProcessor::updateResolution(const double gpuMs)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    glDisable(GL_DEPTH_TEST);
-    // clear buffers
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    m_dynamicResolution.update(gpuMs);
+    const glm::ivec2 size{m_dynamicResolution.getSize(std::max(m_width, 1), std::max(m_height, 1))};
+    if (size == m_renderSize)
+        return;
 
-    screenShader->use();
-    screenShader->setInt("screenTexture", 0);
-    if (m_bloomEnabled)
-    {
-	assert(m_bloomRenderer != nullptr);
-	m_bloomRenderer->renderBloomTexture(m_TEX, 0.005f);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, m_bloomRenderer->bloomTexture());
-	screenShader->use();
-	screenShader->setInt("bloomBlur", 1);
-    }
+    m_renderSize = size;
+    resizeBloom();
+}
 
-    glBindVertexArray(m_VAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_TEX);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-    glEnable(GL_DEPTH_TEST);
+glm::vec2 PostProcessor::nextJitter()
+{
+    if (!m_temporalAAEnabled)
+        return glm::vec2{0.0f};
+    return m_temporalAA->nextJitter(m_renderSize, glm::ivec2{std::max(m_width, 1), std::max(m_height, 1)});
 }
 
-void PostProcessor::generate(const int width, const int height, void* engine)
+void PostProcessor::setCameraMatrices(const glm::mat4& viewProjection, const glm::mat4& previousViewProjection)
 {
-    bool tempBloomEnabled {m_bloomEnabled};
-    free();
-    init(width, height);
-    if (tempBloomEnabled)
-	enableBloom(engine);
+    m_viewProjection = viewProjection;
+    m_previousViewProjection = previousViewProjection;
 }
 
-void PostProcessor::generateFramebuffer()
+glm::ivec2 PostProcessor::getBloomSize() const
 {
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-    m_FBO = framebuffer;
+    return m_temporalAAEnabled ? glm::ivec2{std::max(m_width, 1), std::max(m_height, 1)} : m_renderSize;
 }
 
-void PostProcessor::generateFramebufferTexture()
+void PostProcessor::resizeBloom()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
-    // generate texture
-    unsigned int textureColorBuffer;
-    glGenTextures(1, &textureColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, textureColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    const glm::ivec2 size{getBloomSize()};
+    if (m_bloomEnabled)
+	m_bloomRenderer->resize(static_cast<unsigned int>(size.x), static_cast<unsigned int>(size.y));
+}
 
-    // attach to framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorBuffer, 0);
-    m_TEX = textureColorBuffer;
+PostProcessingN::SceneTargets PostProcessor::addSceneTargets(RenderGraph& graph) const
+{
+    // a minimized window still gets valid (tiny) targets. They always have the window size so the scale can change
+    // every frame without reallocating them, the scene passes only cover the scaled region
+    const int width{std::max(m_width, 1)};
+    const int height{std::max(m_height, 1)};
+    PostProcessingN::SceneTargets targets{
+        graph.createTexture("sceneColor", RenderTargetN::Desc{width, height, PostProcessingN::COLOR_FORMAT},
+                            m_renderSize),
+        graph.createTexture("sceneDepth", RenderTargetN::Desc{width, height, PostProcessingN::DEPTH_FORMAT},
+                            m_renderSize)};
+    if (m_temporalAAEnabled)
+    {
+        targets.velocity = graph.createTexture(
+            "sceneVelocity", RenderTargetN::Desc{width, height, TemporalAAN::VELOCITY_FORMAT}, m_renderSize);
+    }
+    return targets;
 }
 
-void PostProcessor::generateRenderbuffer()
+void PostProcessor::addPasses(RenderGraph& graph, const PostProcessingN::SceneTargets& scene,
+                              const Shader* screenShader)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    // everything after temporal AA works on its full resolution output
+    RenderGraphN::Resource sceneColor{scene.color};
+    if (m_temporalAAEnabled)
+    {
+        sceneColor = m_temporalAA->addPass(graph, scene.color, scene.depth, scene.velocity,
+                                           glm::ivec2{std::max(m_width, 1), std::max(m_height, 1)}, m_viewProjection,
+                                           m_previousViewProjection, m_VAO);
+    }
+
+    // measured before bloom, which doesn't change the average much
+    RenderGraphN::Resource exposure{RenderGraphN::INVALID_RESOURCE};
+    if (m_autoExposureEnabled)
+        exposure = m_autoExposure->addPasses(graph, sceneColor, m_deltaTime, m_VAO);
+
+    RenderGraphN::Resource bloom{RenderGraphN::INVALID_RESOURCE};
+    RenderGraphN::Resource bloomUpSample{RenderGraphN::INVALID_RESOURCE};
+    if (m_bloomEnabled)
+    {
+        assert(m_bloomRenderer != nullptr);
+        // the benchmark alternates both paths, one per frame
+        if (m_bloomBenchmarkFrames > 0)
+        {
+            m_bloomRenderer->setCompute(m_bloomBenchmarkFrames % 2 == 0);
+            if (--m_bloomBenchmarkFrames == 0)
+                m_bloomRenderer->setCompute(m_bloomComputeBeforeBenchmark);
+        }
+        m_bloomRenderer->setSourceSize(graph.getDesc(sceneColor).width, graph.getDesc(sceneColor).height);
+        bloom = graph.createTexture("bloom", m_bloomRenderer->getMipDesc(0));
+
+        RenderGraphN::Pass pass{};
+        pass.reads = {sceneColor};
+        pass.state.depthTest = false;
+        pass.state.depthWrite = false;
+        if (m_bloomRenderer->getCompute())
+        {
+            bloomUpSample = graph.createTexture("bloomUpSample", m_bloomRenderer->getMipDesc(1));
+            pass.name = "bloom (compute)";
+            pass.writes = {bloom, bloomUpSample};
+            pass.execute = [this, sceneColor, bloom, bloomUpSample](const RenderGraph& renderGraph)
+            {
+                m_bloomRenderer->renderBloomCompute(renderGraph.getTexture(sceneColor), renderGraph.getTexture(bloom),
+                                                    renderGraph.getTexture(bloomUpSample),
+                                                    PostProcessingN::BLOOM_FILTER_RADIUS);
+            };
+        }
+        else
+        {
+            pass.name = "bloom";
+            pass.color = bloom;
+            pass.execute = [this, sceneColor, bloom](const RenderGraph& renderGraph)
+            {
+                m_bloomRenderer->renderBloomTexture(renderGraph.getTexture(sceneColor), renderGraph.getTexture(bloom),
+                                                    PostProcessingN::BLOOM_FILTER_RADIUS);
+            };
+        }
+        graph.addPass(std::move(pass));
+    }
 
-    // generate render buffer object
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    RenderGraphN::Pass pass{};
+    pass.name = bloomUpSample != RenderGraphN::INVALID_RESOURCE ? "composite (fused)" : "composite";
+    pass.reads = {sceneColor};
+    if (bloom != RenderGraphN::INVALID_RESOURCE)
+        pass.reads.push_back(bloom);
+    if (bloomUpSample != RenderGraphN::INVALID_RESOURCE)
+        pass.reads.push_back(bloomUpSample);
+    if (exposure != RenderGraphN::INVALID_RESOURCE)
+        pass.reads.push_back(exposure);
+    pass.color = RenderGraphN::BACKBUFFER;
+    pass.clear = true;
+    pass.state.depthTest = false;
+    pass.execute = [this, sceneColor, bloom, bloomUpSample, exposure, screenShader](const RenderGraph& renderGraph)
+    {
+        screenShader->use();
+        screenShader->setInt("screenTexture", 0);
+        // the 2D & 3D samplers may not share a unit, even while unused
+        screenShader->setInt("exposureTexture", 3);
+        screenShader->setInt("gradingLUT", 4);
+        // upscale of the dynamic resolution region
+        const RenderTargetN::Desc& desc{renderGraph.getDesc(sceneColor)};
+        const glm::vec2 textureSize{static_cast<float>(desc.width), static_cast<float>(desc.height)};
+        screenShader->setVec2("sceneUVScale", glm::vec2{renderGraph.getRegion(sceneColor)} / textureSize);
+        screenShader->setVec2("sceneTexelSize", 1.0f / textureSize);
+        screenShader->setFloat("sharpness", m_temporalAAEnabled ? TemporalAAN::SHARPNESS
+                                                                 : m_dynamicResolution.getSharpness());
+        if (bloom != RenderGraphN::INVALID_RESOURCE)
+        {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(bloom));
+            screenShader->setInt("bloomBlur", 1);
+        }
+        // the last bloom upsample step happens here
+        screenShader->setBool("fusedUpSample", bloomUpSample != RenderGraphN::INVALID_RESOURCE);
+        if (bloomUpSample != RenderGraphN::INVALID_RESOURCE)
+        {
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(bloomUpSample));
+            screenShader->setInt("bloomUpSample", 2);
+            screenShader->setFloat("filterRadius", PostProcessingN::BLOOM_FILTER_RADIUS);
+        }
+
+        screenShader->setFloat("exposure", m_exposure);
+        screenShader->setBool("autoExposure", exposure != RenderGraphN::INVALID_RESOURCE);
+        if (exposure != RenderGraphN::INVALID_RESOURCE)
+        {
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(exposure));
+        }
+        // grading, dithering & the rest of the chain run in this pass too, the hdr target is only read once
+        screenShader->setBool("colorGrading", m_colorGrading->getEnabled());
+        if (m_colorGrading->getEnabled())
+        {
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_3D, m_colorGrading->getLUT());
+            screenShader->setFloat("lutSize", static_cast<float>(ColorGradingN::LUT_SIZE));
+        }
+
+        glBindVertexArray(m_VAO);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(sceneColor));
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
+    };
+    graph.addPass(std::move(pass));
+}
 
-    // attach rbo to framebuffer
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-    m_RBO = rbo;
+void PostProcessor::generate(const int width, const int height)
+{
+    m_width = width;
+    m_height = height;
+    m_renderSize = m_dynamicResolution.getSize(std::max(width, 1), std::max(height, 1));
+    resizeBloom();
 }
 
 void PostProcessor::generateQuad()
@@ -166,19 +256,17 @@ void PostProcessor::generateQuad()
     glBindVertexArray(0);
 }
 
-void PostProcessor::enable() const { glBindFramebuffer(GL_FRAMEBUFFER, m_FBO); }
-
-void PostProcessor::disable() const { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
-
 void PostProcessor::enableBloom(void* engine)
 {
     if (m_bloomEnabled)
 	return;
 
     m_bloomRenderer = new BloomRenderer{this};
-    if (!m_bloomRenderer->init(m_width, m_height, engine))
+    const glm::ivec2 size{getBloomSize()};
+    if (!m_bloomRenderer->init(static_cast<unsigned int>(size.x), static_cast<unsigned int>(size.y), engine, m_pool))
     {
 	delete m_bloomRenderer;
+	m_bloomRenderer = nullptr;
 	Util::beginError();
 	std::cout << "POST_PROCESSOR::ENABLE_BLOOM::ERROR: Failed to initialize bloom renderer!" << std::endl;
 	Util::endError();
@@ -198,100 +286,118 @@ void PostProcessor::disableBloom()
     m_bloomEnabled = false;
 }
 
-BloomFBO::BloomFBO(EngineObject* parent)
- : EngineObject{"BloomFBO", parent}
+void PostProcessor::enableTemporalAA(void* engine)
 {
+    if (m_temporalAAEnabled)
+        return;
+
+    m_temporalAA = new TemporalAA{this};
+    if (!m_temporalAA->init(engine, m_pool))
+    {
+        delete m_temporalAA;
+        m_temporalAA = nullptr;
+        Util::beginError();
+        std::cout << "POST_PROCESSOR::ENABLE_TEMPORAL_AA::ERROR: Failed to initialize temporal AA!" << std::endl;
+        Util::endError();
+        return;
+    }
+
+    m_temporalAAEnabled = true;
+    m_dynamicResolution.setMaxScale(TemporalAAN::MAX_RENDER_SCALE);
+    updateResolution(0.0);
+    resizeBloom();
 }
 
-BloomFBO::~BloomFBO()
+void PostProcessor::disableTemporalAA()
 {
-    free();
+    if (!m_temporalAAEnabled)
+        return;
+
+    m_temporalAA->releaseHistory();
+    delete m_temporalAA;
+    m_temporalAA = nullptr;
+    m_temporalAAEnabled = false;
+    m_dynamicResolution.setMaxScale(DynamicResolutionN::MAX_SCALE);
+    updateResolution(0.0);
+    resizeBloom();
 }
 
-// free resources
-void BloomFBO::free()
+void PostProcessor::enableAutoExposure(void* engine)
 {
-    if (!m_init)
-	return;
+    if (m_autoExposureEnabled)
+        return;
 
-    for (std::size_t i{0}; i < m_mipChain.size(); ++i)
+    m_autoExposure = new AutoExposure{this};
+    if (!m_autoExposure->init(engine, m_pool))
     {
-	glDeleteTextures(1, &m_mipChain[i].texture);
+        delete m_autoExposure;
+        m_autoExposure = nullptr;
+        Util::beginError();
+        std::cout << "POST_PROCESSOR::ENABLE_AUTO_EXPOSURE::ERROR: Failed to initialize auto exposure!" << std::endl;
+        Util::endError();
+        return;
     }
-    m_mipChain.clear();
-    glDeleteFramebuffers(1, &m_FBO);
-    m_FBO = 0;
-    m_init = false;
+
+    m_autoExposureEnabled = true;
 }
 
-bool BloomFBO::init(const unsigned int width, const unsigned int height, const unsigned int mipChainLength)
+void PostProcessor::disableAutoExposure()
 {
-    if (m_init)
-	return true;
-
-    glGenFramebuffers(1, &m_FBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    if (!m_autoExposureEnabled)
+        return;
 
-    glm::vec2 mipSize {static_cast<float>(width), static_cast<float>(height)};
-    glm::ivec2 mipIntSize {static_cast<int>(width), static_cast<int>(height)};
-
-    // check for overflow (safety check)
-    if (width > static_cast<unsigned int>(INT_MAX) || height > static_cast<unsigned int>(INT_MAX))
-    {
-	Util::beginError();
-	std::cout << "BLOOM_FBO::INIT::ERROR: Window size conversion overflow - cannot build bloom FBO!" << std::endl;
-	Util::endError();
-	return false;
-    }
+    m_autoExposure->releaseHistory();
+    delete m_autoExposure;
+    m_autoExposure = nullptr;
+    m_autoExposureEnabled = false;
+}
 
-    for (unsigned int i{0}; i < mipChainLength; ++i)
-    {
-	PostProcessingN::BloomMip mip;
-	
-	mipSize *= 0.5f;
-	mipIntSize /= 2;
-	mip.size = mipSize;
-	mip.intSize = mipIntSize;
+void PostProcessor::setColorGrading(const ColorGradingN::Preset preset)
+{
+    if (m_colorGrading != nullptr)
+        m_colorGrading->setPreset(preset);
+}
 
-	glGenTextures(1, &mip.texture);
-	glBindTexture(GL_TEXTURE_2D, mip.texture);
-	// MOTE: hdr color format
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, static_cast<int>(mipSize.x), static_cast<int>(mipSize.y), 0, GL_RGB, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+ColorGradingN::Preset PostProcessor::getColorGrading() const
+{
+    return m_colorGrading != nullptr ? m_colorGrading->getPreset() : ColorGradingN::Preset::NEUTRAL;
+}
 
-	m_mipChain.emplace_back(mip);
-    }
+void PostProcessor::setDynamicResolution(const bool enabled)
+{
+    m_dynamicResolution.setEnabled(enabled);
+    updateResolution(0.0);
+}
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_mipChain[0].texture, 0);
+void PostProcessor::setBloomCompute(const bool value)
+{
+    if (m_bloomEnabled)
+	m_bloomRenderer->setCompute(value);
+}
 
-    // setup attachments
-    unsigned int attachments[1] {GL_COLOR_ATTACHMENT0};
-    glDrawBuffers(1, attachments);
+bool PostProcessor::getBloomCompute() const
+{
+    return m_bloomEnabled && m_bloomRenderer->getCompute();
+}
 
-    // check framebuffer status
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+bool PostProcessor::benchmarkBloom(const unsigned int frames)
+{
+    if (!m_bloomEnabled || !m_bloomRenderer->hasCompute())
     {
 	Util::beginError();
-	std::cout << "BLOOM_FBO::INIT::ERROR: Framebuffer is incomplete!" << std::endl;
+	std::cout << "POSTPROCESSOR::BENCHMARK_BLOOM::ERROR: Compute bloom needs bloom enabled & a GL 4.3 context!";
 	Util::endError();
 	return false;
     }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    m_init = true;
+    if (m_bloomBenchmarkFrames == 0)
+	m_bloomComputeBeforeBenchmark = m_bloomRenderer->getCompute();
+    // even count, both paths get the same number of frames
+    m_bloomBenchmarkFrames = frames + frames % 2;
     return true;
 }
 
-void BloomFBO::bind()
-{
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
-}
-
 BloomRenderer::BloomRenderer(EngineObject* parent)
- : EngineObject{"BloomRenderer", parent}, m_FBO{this}
+ : EngineObject{"BloomRenderer", parent}
 {
 }
 
@@ -305,29 +411,32 @@ void BloomRenderer::free()
     if (!m_init)
 	return;
 
+    // the pool may already be gone, it deletes its textures itself
     glDeleteBuffers(1, &m_quadVBO);
     glDeleteVertexArrays(1, &m_quadVAO);
-    m_FBO.free();
+    m_quadVBO = 0;
+    m_quadVAO = 0;
+    m_mipChain.clear();
     m_init = false;
 }
 
-bool BloomRenderer::init(const unsigned int width, const unsigned int height, void* engine)
+bool BloomRenderer::init(const unsigned int width, const unsigned int height, void* engine, RenderTargetPool* pool)
 {
     if (m_init)
 	return true;
 
-    m_srcViewportSize = glm::ivec2{width, height};
-    m_srcViewportSizeF = glm::vec2{static_cast<float>(width), static_cast<float>(height)};
-    
-    constexpr unsigned int numMips {5};
-    if (!m_FBO.init(width, height, numMips))
+    // check for overflow (safety check)
+    if (width > static_cast<unsigned int>(INT_MAX) || height > static_cast<unsigned int>(INT_MAX))
     {
 	Util::beginError();
-	std::cout << "BLOOM_RENDERER::INIT::ERROR: Failed to create Bloom FBO!" << std::endl;
+	std::cout << "BLOOM_RENDERER::INIT::ERROR: Window size conversion overflow - cannot build bloom mip chain!" << std::endl;
 	Util::endError();
 	return false;
     }
 
+    m_pool = pool;
+    resize(width, height);
+
     const Engine* enginePtr {static_cast<Engine*>(engine)};
     m_downSampleShader = enginePtr->getShader("downSample");
     if (m_downSampleShader == nullptr)
@@ -355,6 +464,25 @@ bool BloomRenderer::init(const unsigned int width, const unsigned int height, vo
     m_upSampleShader->setInt("tex", 0);
     glUseProgram(0);
 
+    // only loaded on GL 4.3+, the fragment path stays the fallback
+    if (GLExtN::hasCompute())
+    {
+	m_downSampleCompute = enginePtr->getShader("downSampleCompute");
+	m_upSampleCompute = enginePtr->getShader("upSampleCompute");
+    }
+    if (hasCompute())
+    {
+	m_downSampleCompute->use();
+	m_downSampleCompute->setInt("srcTexture", 0);
+	for (unsigned int i{0}; i < PostProcessingN::BLOOM_MIPS; ++i)
+	    m_downSampleCompute->setInt("mip" + std::to_string(i), static_cast<int>(i));
+	m_upSampleCompute->use();
+	m_upSampleCompute->setInt("tex", 0);
+	m_upSampleCompute->setInt("dstImage", 0);
+	glUseProgram(0);
+    }
+    m_compute = hasCompute();
+
     // setup quad VAO
     setupQuad();
 
@@ -362,24 +490,133 @@ bool BloomRenderer::init(const unsigned int width, const unsigned int height, vo
     return true;
 }
 
-void BloomRenderer::renderBloomTexture(const unsigned int srcTexture, const float filterRadius)
+void BloomRenderer::resize(const unsigned int width, const unsigned int height)
+{
+    m_srcViewportSize = glm::ivec2{width, height};
+    m_srcViewportSizeF = glm::vec2{static_cast<float>(width), static_cast<float>(height)};
+    setSourceSize(m_srcTextureSize.x, m_srcTextureSize.y);
+
+    m_mipChain.clear();
+
+    glm::vec2 mipSize {m_srcViewportSizeF};
+    glm::ivec2 mipIntSize {m_srcViewportSize};
+    for (unsigned int i{0}; i < PostProcessingN::BLOOM_MIPS; ++i)
+    {
+	PostProcessingN::BloomMip mip{};
+
+	mipSize = glm::max(mipSize * 0.5f, glm::vec2{1.0f});
+	mipIntSize = glm::max(mipIntSize / 2, glm::ivec2{1});
+	mip.size = mipSize;
+	mip.intSize = mipIntSize;
+	mip.texture = 0;
+
+	m_mipChain.emplace_back(mip);
+    }
+}
+
+void BloomRenderer::setSourceSize(const int width, const int height)
+{
+    // the source covers at least the viewport
+    m_srcTextureSize = glm::max(glm::ivec2{width, height}, m_srcViewportSize);
+}
+
+void BloomRenderer::setSourceUniforms(const Shader* shader) const
+{
+    const glm::vec2 textureSize{m_srcTextureSize};
+    shader->setVec2("srcResolution", textureSize);
+    shader->setVec2("srcUVScale", m_srcViewportSizeF / textureSize);
+    shader->setVec2("srcUVMax", (m_srcViewportSizeF - 0.5f) / textureSize);
+}
+
+void BloomRenderer::renderBloomTexture(const unsigned int srcTexture, const unsigned int dstTexture,
+                                       const float filterRadius)
 {
-    m_FBO.bind();
+    // the inner mips only live for this pass, a mip of an unchanged size gets the same texture back
+    m_mipChain[0].texture = dstTexture;
+    for (std::size_t i{1}; i < m_mipChain.size(); ++i)
+    {
+	PostProcessingN::BloomMip& mip {m_mipChain[i]};
+	mip.texture = m_pool->acquire(RenderTargetN::Desc{mip.intSize.x, mip.intSize.y, PostProcessingN::BLOOM_FORMAT});
+    }
 
     renderDownSamples(srcTexture);
     renderUpSamples(filterRadius);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, m_srcViewportSize.x, m_srcViewportSize.y);
+
+    for (PostProcessingN::BloomMip& mip : m_mipChain)
+    {
+	if (mip.texture != dstTexture)
+	    m_pool->release(mip.texture);
+	mip.texture = 0;
+    }
+}
+
+void BloomRenderer::renderBloomCompute(const unsigned int srcTexture, const unsigned int dstTexture,
+                                       const unsigned int upSampleTexture, const float filterRadius)
+{
+    m_mipChain[0].texture = dstTexture;
+    m_mipChain[1].texture = upSampleTexture;
+    for (std::size_t i{2}; i < m_mipChain.size(); ++i)
+    {
+	PostProcessingN::BloomMip& mip {m_mipChain[i]};
+	mip.texture = m_pool->acquire(RenderTargetN::Desc{mip.intSize.x, mip.intSize.y, PostProcessingN::BLOOM_FORMAT});
+    }
+
+    // whole pyramid in one dispatch, a work group per tile of the first mip
+    m_downSampleCompute->use();
+    setSourceUniforms(m_downSampleCompute);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, srcTexture);
+    for (std::size_t i{0}; i < m_mipChain.size(); ++i)
+    {
+	const PostProcessingN::BloomMip& mip {m_mipChain[i]};
+	m_downSampleCompute->setVec2("mipSize[" + std::to_string(i) + "]", glm::vec2{mip.intSize});
+	GLExtN::bindImageTexture(static_cast<unsigned int>(i), mip.texture, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+	                         PostProcessingN::BLOOM_FORMAT);
+    }
+    const glm::ivec2 tiles {(m_mipChain[0].intSize + PostProcessingN::BLOOM_DOWN_TILE - 1) / PostProcessingN::BLOOM_DOWN_TILE};
+    GLExtN::dispatchCompute(static_cast<unsigned int>(tiles.x), static_cast<unsigned int>(tiles.y), 1);
+
+    // upsample in place down to the second mip, the composite shader does the last step
+    m_upSampleCompute->use();
+    m_upSampleCompute->setFloat("filterRadius", filterRadius);
+    for (std::size_t i{m_mipChain.size() - 1}; i > 1; --i)
+    {
+	const PostProcessingN::BloomMip& mip {m_mipChain[i]};
+	const PostProcessingN::BloomMip& nextMip {m_mipChain[i - 1]};
+
+	GLExtN::memoryBarrier(GLExtN::TEXTURE_FETCH_BARRIER_BIT | GLExtN::SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	glBindTexture(GL_TEXTURE_2D, mip.texture);
+	GLExtN::bindImageTexture(0, nextMip.texture, 0, GL_FALSE, 0, GL_READ_WRITE, PostProcessingN::BLOOM_FORMAT);
+	m_upSampleCompute->setVec2("dstSize", glm::vec2{nextMip.intSize});
+	const glm::ivec2 groups {(nextMip.intSize + PostProcessingN::BLOOM_UP_GROUP - 1) / PostProcessingN::BLOOM_UP_GROUP};
+	GLExtN::dispatchCompute(static_cast<unsigned int>(groups.x), static_cast<unsigned int>(groups.y), 1);
+    }
+    glUseProgram(0);
+
+    // the render graph puts the barrier before the composite reads the first two mips
+    for (std::size_t i{0}; i < m_mipChain.size(); ++i)
+    {
+	if (i > 1)
+	    m_pool->release(m_mipChain[i].texture);
+	m_mipChain[i].texture = 0;
+    }
+}
+
+RenderTargetN::Desc BloomRenderer::getMipDesc(const std::size_t mip) const
+{
+    return RenderTargetN::Desc{m_mipChain[mip].intSize.x, m_mipChain[mip].intSize.y, PostProcessingN::BLOOM_FORMAT};
 }
 
 // downsample source texture
 void BloomRenderer::renderDownSamples(const unsigned int srcTexture)
 {
-    const std::vector<PostProcessingN::BloomMip>& mipChain {m_FBO.mipChain()};
+    const std::vector<PostProcessingN::BloomMip>& mipChain {m_mipChain};
 
     m_downSampleShader->use();
-    m_downSampleShader->setVec2("srcResolution", m_srcViewportSizeF);
+    setSourceUniforms(m_downSampleShader);
 
     // bind source texture (HDR color buffer) as initial texture input
     glActiveTexture(GL_TEXTURE0);
@@ -391,14 +628,16 @@ void BloomRenderer::renderDownSamples(const unsigned int srcTexture)
 	m_downSampleShader->setInt("mipLevel", static_cast<int>(i));
 	const PostProcessingN::BloomMip& mip {mipChain[i]};
 	glViewport(0, 0, mip.size.x, mip.size.y);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mip.texture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_pool->getFramebuffer(mip.texture));
 
 	glBindVertexArray(m_quadVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 	glBindVertexArray(0);
 
-	// setup current mip as input for next iteration
+	// setup current mip as input for next iteration, the mips are exactly as large as what they hold
 	m_downSampleShader->setVec2("srcResolution", mip.size);
+	m_downSampleShader->setVec2("srcUVScale", glm::vec2{1.0f});
+	m_downSampleShader->setVec2("srcUVMax", glm::vec2{1.0f});
 	glBindTexture(GL_TEXTURE_2D, mip.texture);
     }
     glUseProgram(0);
@@ -407,7 +646,7 @@ void BloomRenderer::renderDownSamples(const unsigned int srcTexture)
 // upsample source texture
 void BloomRenderer::renderUpSamples(const float filterRadius)
 {
-    const std::vector<PostProcessingN::BloomMip>& mipChain{m_FBO.mipChain()};
+    const std::vector<PostProcessingN::BloomMip>& mipChain{m_mipChain};
 
     m_upSampleShader->use();
     m_upSampleShader->setFloat("filterRadius", filterRadius);
@@ -426,7 +665,7 @@ void BloomRenderer::renderUpSamples(const float filterRadius)
 	glBindTexture(GL_TEXTURE_2D, mip.texture);
 
 	glViewport(0, 0, nextMip.size.x, nextMip.size.y);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, nextMip.texture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_pool->getFramebuffer(nextMip.texture));
 
 	glBindVertexArray(m_quadVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -1,39 +1,47 @@
 #ifndef POSTPROCESSING_H
 #define POSTPROCESSING_H
 
+#include "autoexposure.hpp"
+#include "colorgrading.hpp"
+#include "dynamicresolution.hpp"
 #include "engine_types.hpp"
 #include "glm/ext/vector_int2.hpp"
+#include "rendergraph.hpp"
+#include "rendertargetpool.hpp"
 #include "shader.hpp"
+#include "temporalaa.hpp"
 
 #include <vector>
 
 namespace PostProcessingN
 {
+    // hdr scene color & depth, acquired from the render target pool every frame
+    constexpr GLenum COLOR_FORMAT{GL_RGBA16F};
+    constexpr GLenum DEPTH_FORMAT{GL_DEPTH24_STENCIL8};
+    constexpr GLenum BLOOM_FORMAT{GL_R11F_G11F_B10F};
+    constexpr unsigned int BLOOM_MIPS{5};
+    // upsample tent radius in uv
+    constexpr float BLOOM_FILTER_RADIUS{0.005f};
+    // downSample.comp: texels of the first mip per work group & side, upSample.comp: threads per work group side
+    constexpr int BLOOM_DOWN_TILE{32};
+    constexpr int BLOOM_UP_GROUP{8};
+
     struct BloomMip
     {
 	glm::vec2 size;
 	glm::ivec2 intSize;
 	unsigned int texture;
     };
-}
-
-class BloomFBO final : public EngineObject
-{
-public:
-    explicit BloomFBO(EngineObject* parent);
-    ~BloomFBO() override;
-
-    bool init(unsigned int width, unsigned int height, unsigned int mipChainLength);
-    void bind();
-    void free();  
 
-    [[nodiscard]] const std::vector<PostProcessingN::BloomMip>& mipChain() const {return m_mipChain;}
-
-private:
-    bool m_init{false};
-    unsigned int m_FBO{};
-    std::vector<PostProcessingN::BloomMip> m_mipChain{};
-};
+    // render graph resources the scene passes draw into
+    struct SceneTargets
+    {
+        RenderGraphN::Resource color{RenderGraphN::INVALID_RESOURCE};
+        RenderGraphN::Resource depth{RenderGraphN::INVALID_RESOURCE};
+        // screen space motion (second render target of the scene passes), only with temporal AA
+        RenderGraphN::Resource velocity{RenderGraphN::INVALID_RESOURCE};
+    };
+}
 
 class BloomRenderer final : public EngineObject
 {
@@ -41,24 +49,48 @@ public:
     explicit BloomRenderer(EngineObject* parent);
     ~BloomRenderer();
 
-    bool init(unsigned int width, unsigned int height, void* engine);
+    bool init(unsigned int width, unsigned int height, void* engine, RenderTargetPool* pool);
     void free();
-    void renderBloomTexture(unsigned int srcTexture, float filterRadius);
-
-    [[nodiscard]] unsigned int bloomTexture() const {return m_FBO.mipChain()[0].texture;}
+    // new mip chain sizes for a width x height source region, the pool only allocates the mips whose size changed
+    void resize(unsigned int width, unsigned int height);
+    // size of the whole source texture, the region is in its bottom left corner
+    void setSourceSize(int width, int height);
+    // fragment path: blurred srcTexture into dstTexture (a getMipDesc(0) target), the smaller mips are only held
+    // while it runs
+    void renderBloomTexture(unsigned int srcTexture, unsigned int dstTexture, float filterRadius);
+    // compute path: the whole pyramid in one dispatch & the upsamples down to the second mip. dstTexture gets the
+    // downsampled first mip, upSampleTexture (a getMipDesc(1) target) the blurred second one, the composite adds
+    // the last upsample step
+    void renderBloomCompute(unsigned int srcTexture, unsigned int dstTexture, unsigned int upSampleTexture,
+                            float filterRadius);
+
+    [[nodiscard]] RenderTargetN::Desc getMipDesc(std::size_t mip) const;
+
+    // the compute shaders loaded (needs a GL 4.3 context)
+    [[nodiscard]] bool hasCompute() const { return m_downSampleCompute != nullptr && m_upSampleCompute != nullptr; }
+    // use the compute path when there is one
+    void setCompute(bool value) { m_compute = value && hasCompute(); }
+    [[nodiscard]] bool getCompute() const { return m_compute; }
 
 private:
-    BloomFBO m_FBO;
+    RenderTargetPool* m_pool{nullptr};
+    std::vector<PostProcessingN::BloomMip> m_mipChain{};
 
     bool m_init{false};
     glm::ivec2 m_srcViewportSize{};
     glm::vec2 m_srcViewportSizeF{};
+    glm::ivec2 m_srcTextureSize{};
 
     Shader* m_downSampleShader{nullptr};
     Shader* m_upSampleShader{nullptr};
+    Shader* m_downSampleCompute{nullptr};
+    Shader* m_upSampleCompute{nullptr};
+    bool m_compute{false};
 
     unsigned int m_quadVAO{0}, m_quadVBO{0};
 
+    // resolution & region of the source for the first downsample
+    void setSourceUniforms(const Shader* shader) const;
     void renderDownSamples(unsigned int srcTexture);
     void renderUpSamples(float filterRadius);
 
@@ -74,33 +106,59 @@ public:
 
     // free resources
     void free();
-    // check framebuffer
-    [[nodiscard]] bool check() const;
-
-    // initialize framebuffer and texture
-    void init(int width, int height);
-    // regenerate framebuffer for framebuffer_size_callback()
-    void generate(int width, int height, void* engine);
-
-    // render framebuffer to screen
-    void render(const Shader* screenShader) const;
 
-    // bind framebuffer
-    void enable() const;
-    // unbind framebuffer
-    void disable() const;
+    // set up the quad & the color grading LUT, bloom takes its inner mips from pool
+    void init(int width, int height, RenderTargetPool* pool);
+    // new target size for framebuffer_size_callback(), nothing is allocated until the next frame asks for it
+    void generate(int width, int height);
+
+    // step the dynamic resolution controller with the last measured gpu frame time, bloom follows the new size
+    void updateResolution(double gpuMs);
+    // this frame's projection jitter in ndc, 0 without temporal AA
+    [[nodiscard]] glm::vec2 nextJitter();
+    // unjittered view projection of this & the last frame for the temporal AA reprojection
+    void setCameraMatrices(const glm::mat4& viewProjection, const glm::mat4& previousViewProjection);
+    // time since the last frame, auto exposure adapts by it
+    void setDeltaTime(float seconds) { m_deltaTime = seconds; }
+    // declare this frame's hdr scene color & depth
+    [[nodiscard]] PostProcessingN::SceneTargets addSceneTargets(RenderGraph& graph) const;
+    // temporal AA, auto exposure, bloom (when enabled) & the composite of the scene to the screen
+    void addPasses(RenderGraph& graph, const PostProcessingN::SceneTargets& scene, const Shader* screenShader);
 
     // toggle bloom
     void enableBloom(void* engine);
     void disableBloom();
+    // toggle temporal AA, renders at most at TemporalAAN::MAX_RENDER_SCALE & reconstructs the window size
+    void enableTemporalAA(void* engine);
+    void disableTemporalAA();
+    [[nodiscard]] bool getTemporalAAEnabled() const { return m_temporalAAEnabled; }
+    // toggle auto exposure, the manual exposure still scales on top of it
+    void enableAutoExposure(void* engine);
+    void disableAutoExposure();
+    [[nodiscard]] bool getAutoExposureEnabled() const { return m_autoExposureEnabled; }
+    void setExposure(float exposure) { m_exposure = exposure; }
+    [[nodiscard]] float getExposure() const { return m_exposure; }
+    // grade the composite with a LUT baked from preset, NEUTRAL turns grading off
+    void setColorGrading(ColorGradingN::Preset preset);
+    [[nodiscard]] ColorGradingN::Preset getColorGrading() const;
+
+    // toggle dynamic resolution, off renders at the window size
+    void setDynamicResolution(bool enabled);
+    [[nodiscard]] DynamicResolution& getDynamicResolution() { return m_dynamicResolution; }
+    [[nodiscard]] const DynamicResolution& getDynamicResolution() const { return m_dynamicResolution; }
+
+    // use the compute bloom path when the context has one
+    void setBloomCompute(bool value);
+    [[nodiscard]] bool getBloomCompute() const;
+    // alternate the compute & fragment bloom paths for the next frames, the render graph benchmark records both,
+    // false without a compute path
+    bool benchmarkBloom(unsigned int frames);
 
     // getters
     [[nodiscard]] int getWidth() const { return m_width; }
     [[nodiscard]] int getHeight() const { return m_height; }
-
-    [[nodiscard]] unsigned int getFBO() const { return m_FBO; }
-    [[nodiscard]] unsigned int getRBO() const { return m_RBO; }
-    [[nodiscard]] unsigned int getTEX() const { return m_TEX; }
+    // scaled size the scene is rendered at
+    [[nodiscard]] glm::ivec2 getRenderSize() const { return m_renderSize; }
 
     [[nodiscard]] unsigned int getVAO() const { return m_VAO; }
     [[nodiscard]] unsigned int getVBO() const { return m_VBO; }
@@ -110,10 +168,10 @@ private:
     int m_width{0};
     int m_height{0};
 
-    // framebuffer
-    unsigned int m_FBO{};
-    unsigned int m_RBO{};
-    unsigned int m_TEX{};
+    DynamicResolution m_dynamicResolution{};
+    glm::ivec2 m_renderSize{1};
+
+    RenderTargetPool* m_pool{nullptr};
 
     // simple quad
     unsigned int m_VAO{};
@@ -122,10 +180,24 @@ private:
     bool m_bloomEnabled{false};
     BloomRenderer* m_bloomRenderer{nullptr};
 
-    void generateFramebuffer();
-    void generateFramebufferTexture();
-    void generateRenderbuffer();
+    bool m_temporalAAEnabled{false};
+    TemporalAA* m_temporalAA{nullptr};
+    glm::mat4 m_viewProjection{1.0f};
+    glm::mat4 m_previousViewProjection{1.0f};
+
+    bool m_autoExposureEnabled{false};
+    AutoExposure* m_autoExposure{nullptr};
+    float m_exposure{1.0f};
+    float m_deltaTime{0.0f};
+    ColorGrading* m_colorGrading{nullptr};
+
+    unsigned int m_bloomBenchmarkFrames{0};
+    bool m_bloomComputeBeforeBenchmark{false};
+
     void generateQuad();
+    // bloom blurs the temporal AA output at the window size, otherwise the scaled scene
+    [[nodiscard]] glm::ivec2 getBloomSize() const;
+    void resizeBloom();
 };
 
 #endif
@@ -0,0 +1,367 @@
+#include "radiance.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "glext.hpp"
+#include "util.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RADIANCE_SSE
+#include <emmintrin.h>
+#endif
+#if defined(RADIANCE_SSE) && defined(__F16C__)
+#define RADIANCE_F16C
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // largest finite half, brighter texels are clamped instead of turning into infinity
+    constexpr float HALF_MAX{65504.0f};
+    // 2^28 texels, 1.5 GB of floats
+    constexpr std::size_t MAX_TEXELS{std::size_t{1} << 28};
+
+    struct Layout
+    {
+        int width{0};
+        int height{0};
+        bool bottomUp{false}; // +Y, first scanline is the bottom row
+        bool rle{false};
+        std::vector<std::size_t> rows{}; // offset of every scanline
+    };
+
+    void printError(const char* message)
+    {
+        Util::beginError();
+        std::cout << "RADIANCE::DECODE::ERROR: " << message;
+        Util::endError();
+    }
+
+    bool readLine(const unsigned char* bytes, const std::size_t size, std::size_t& pos, std::string& line)
+    {
+        if (pos >= size)
+            return false;
+        const auto* end{static_cast<const unsigned char*>(std::memchr(bytes + pos, '\n', size - pos))};
+        const std::size_t length{end != nullptr ? static_cast<std::size_t>(end - (bytes + pos)) : size - pos};
+        line.assign(reinterpret_cast<const char*>(bytes + pos), length);
+        pos += length + 1;
+        return true;
+    }
+
+    // header & resolution string, then where every scanline starts
+    bool readLayout(const unsigned char* bytes, const std::size_t size, Layout& layout)
+    {
+        std::size_t pos{0};
+        std::string line{};
+        if (!readLine(bytes, size, pos, line) || (line.rfind("#?RADIANCE", 0) != 0 && line.rfind("#?RGBE", 0) != 0))
+        {
+            printError("Not a Radiance file");
+            return false;
+        }
+        while (readLine(bytes, size, pos, line) && !line.empty())
+        {
+            if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe")
+            {
+                printError("Only 32-bit_rle_rgbe is supported");
+                return false;
+            }
+        }
+
+        char ySign{0}, yAxis{0}, xSign{0}, xAxis{0};
+        if (!readLine(bytes, size, pos, line) ||
+            std::sscanf(line.c_str(), "%c%c %d %c%c %d", &ySign, &yAxis, &layout.height, &xSign, &xAxis,
+                        &layout.width) != 6 ||
+            yAxis != 'Y' || xAxis != 'X' || xSign != '+' || (ySign != '-' && ySign != '+'))
+        {
+            printError("Unsupported resolution string (only -Y/+Y h +X w)");
+            return false;
+        }
+        if (layout.width <= 0 || layout.height <= 0 ||
+            static_cast<std::size_t>(layout.width) * static_cast<std::size_t>(layout.height) > MAX_TEXELS)
+        {
+            printError("Invalid image size");
+            return false;
+        }
+        layout.bottomUp = ySign == '+';
+
+        const auto width{static_cast<std::size_t>(layout.width)};
+        layout.rows.resize(layout.height);
+        // new style RLE scanlines start with 2, 2 & the width, anything else means the file is flat
+        layout.rle = width >= 8 && width < 0x8000 && pos + 4 <= size && bytes[pos] == 2 && bytes[pos + 1] == 2 &&
+                     ((static_cast<std::size_t>(bytes[pos + 2]) << 8) | bytes[pos + 3]) == width;
+        if (!layout.rle)
+        {
+            if (size - std::min(size, pos) < width * layout.height * 4)
+            {
+                printError("Truncated scanlines");
+                return false;
+            }
+            for (int row{0}; row < layout.height; ++row)
+                layout.rows[row] = pos + row * width * 4;
+            return true;
+        }
+
+        // only the run lengths are read, so this pass is cheap next to the expansion
+        for (int row{0}; row < layout.height; ++row)
+        {
+            layout.rows[row] = pos;
+            if (pos + 4 > size || bytes[pos] != 2 || bytes[pos + 1] != 2 ||
+                ((static_cast<std::size_t>(bytes[pos + 2]) << 8) | bytes[pos + 3]) != width)
+            {
+                printError("Invalid RLE scanline header");
+                return false;
+            }
+            pos += 4;
+            for (int channel{0}; channel < 4; ++channel)
+            {
+                for (std::size_t x{0}; x < width;)
+                {
+                    if (pos >= size)
+                    {
+                        printError("Truncated scanlines");
+                        return false;
+                    }
+                    std::size_t count{bytes[pos++]};
+                    const bool run{count > 128};
+                    if (run)
+                        count -= 128;
+                    if (count == 0 || x + count > width)
+                    {
+                        printError("Invalid RLE run");
+                        return false;
+                    }
+                    pos += run ? 1 : count;
+                    x += count;
+                }
+            }
+            if (pos > size)
+            {
+                printError("Truncated scanlines");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // one scanline as R, G, B & E planes of width bytes (the layout pass already checked the bounds)
+    void expandRow(const unsigned char* bytes, std::size_t pos, const Layout& layout, unsigned char* planes)
+    {
+        const auto width{static_cast<std::size_t>(layout.width)};
+        if (!layout.rle)
+        {
+            for (std::size_t x{0}; x < width; ++x, pos += 4)
+            {
+                for (int channel{0}; channel < 4; ++channel)
+                    planes[channel * width + x] = bytes[pos + channel];
+            }
+            return;
+        }
+
+        pos += 4;
+        for (int channel{0}; channel < 4; ++channel)
+        {
+            unsigned char* plane{planes + channel * width};
+            for (std::size_t x{0}; x < width;)
+            {
+                std::size_t count{bytes[pos++]};
+                if (count > 128)
+                {
+                    count -= 128;
+                    std::memset(plane + x, bytes[pos++], count);
+                }
+                else
+                {
+                    std::memcpy(plane + x, bytes + pos, count);
+                    pos += count;
+                }
+                x += count;
+            }
+        }
+    }
+
+    float getScale(const unsigned char exponent)
+    {
+        // mantissa * 2^(e - 128 - 8), exponents this small are below every float normal anyway
+        return exponent > 9 ? std::ldexp(1.0f, exponent - 136) : 0.0f;
+    }
+
+#ifdef RADIANCE_SSE
+    __m128i loadBytes(const unsigned char* bytes)
+    {
+        int value{0};
+        std::memcpy(&value, bytes, 4);
+        const __m128i zero{_mm_setzero_si128()};
+        return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero), zero);
+    }
+
+    // 4 halves (finite, positive input) to out
+    void storeHalves(const __m128 value, std::uint16_t* out)
+    {
+#ifdef RADIANCE_F16C
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+#else
+        // rebias the exponent by multiplying with 2^-112, round at the 13 dropped mantissa bits & shift
+        // (Giesen, "float->half variants"), inputs are clamped so overflow & NaN never happen
+        const __m128i roundMask{_mm_set1_epi32(~0xfff)};
+        const __m128 noSticky{_mm_and_ps(value, _mm_castsi128_ps(roundMask))};
+        const __m128 scaled{_mm_mul_ps(noSticky, _mm_castsi128_ps(_mm_set1_epi32(15 << 23)))};
+        const __m128i biased{_mm_sub_epi32(_mm_castps_si128(scaled), roundMask)};
+        const __m128i halves{_mm_srli_epi32(biased, 13)};
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packs_epi32(halves, halves));
+#endif
+    }
+#endif
+
+    void convertRow(const unsigned char* planes, const int width, float* floats, std::uint16_t* halves)
+    {
+        const unsigned char* r{planes};
+        const unsigned char* g{planes + width};
+        const unsigned char* b{planes + width * 2};
+        const unsigned char* e{planes + width * 3};
+        int x{0};
+#ifdef RADIANCE_SSE
+        const __m128i nine{_mm_set1_epi32(9)};
+        const __m128 halfMax{_mm_set1_ps(HALF_MAX)};
+        for (; x + 4 <= width; x += 4)
+        {
+            // 2^(e - 136) built from its exponent bits, 0 for tiny exponents
+            const __m128i exponent{loadBytes(e + x)};
+            const __m128 scale{_mm_castsi128_ps(_mm_and_si128(_mm_slli_epi32(_mm_sub_epi32(exponent, nine), 23),
+                                                              _mm_cmpgt_epi32(exponent, nine)))};
+            const __m128 rgb[3]{_mm_mul_ps(_mm_cvtepi32_ps(loadBytes(r + x)), scale),
+                                _mm_mul_ps(_mm_cvtepi32_ps(loadBytes(g + x)), scale),
+                                _mm_mul_ps(_mm_cvtepi32_ps(loadBytes(b + x)), scale)};
+            if (floats != nullptr)
+            {
+                alignas(16) float planar[3][4];
+                for (int c{0}; c < 3; ++c)
+                    _mm_store_ps(planar[c], rgb[c]);
+                for (int i{0}; i < 4; ++i)
+                {
+                    for (int c{0}; c < 3; ++c)
+                        floats[(x + i) * 3 + c] = planar[c][i];
+                }
+            }
+            if (halves != nullptr)
+            {
+                alignas(16) std::uint16_t planar[3][8];
+                for (int c{0}; c < 3; ++c)
+                    storeHalves(_mm_min_ps(rgb[c], halfMax), planar[c]);
+                for (int i{0}; i < 4; ++i)
+                {
+                    for (int c{0}; c < 3; ++c)
+                        halves[(x + i) * 3 + c] = planar[c][i];
+                }
+            }
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            const float scale{getScale(e[x])};
+            const float rgb[3]{r[x] * scale, g[x] * scale, b[x] * scale};
+            for (int c{0}; c < 3; ++c)
+            {
+                if (floats != nullptr)
+                    floats[x * 3 + c] = rgb[c];
+                if (halves != nullptr)
+                    halves[x * 3 + c] = glm::packHalf1x16(std::min(rgb[c], HALF_MAX));
+            }
+        }
+    }
+} // namespace
+
+bool RadianceN::decode(const unsigned char* bytes, const std::size_t size, Image& image, const int outputs,
+                       JobSystem* jobs)
+{
+    Layout layout{};
+    if (bytes == nullptr || !readLayout(bytes, size, layout))
+        return false;
+
+    image.width = layout.width;
+    image.height = layout.height;
+    const std::size_t values{static_cast<std::size_t>(layout.width) * layout.height * 3};
+    image.halves.assign(outputs & OUTPUT_HALF ? values : 0, 0);
+    image.floats.assign(outputs & OUTPUT_FLOAT ? values : 0, 0.0f);
+
+    const auto func{[&](const std::size_t begin, const std::size_t end)
+    {
+        std::vector<unsigned char> planes(static_cast<std::size_t>(layout.width) * 4);
+        for (std::size_t row{begin}; row < end; ++row)
+        {
+            expandRow(bytes, layout.rows[row], layout, planes.data());
+            // bottom row first
+            const std::size_t outRow{layout.bottomUp ? row : layout.height - 1 - row};
+            const std::size_t offset{outRow * layout.width * 3};
+            convertRow(planes.data(), layout.width, image.floats.empty() ? nullptr : &image.floats[offset],
+                       image.halves.empty() ? nullptr : &image.halves[offset]);
+        }
+    }};
+    if (jobs != nullptr)
+        jobs->parallelFor(static_cast<std::size_t>(layout.height), ROW_GRAIN, func);
+    else
+        func(0, static_cast<std::size_t>(layout.height));
+    return true;
+}
+
+bool RadianceN::load(const std::string& path, Image& image, const int outputs, JobSystem* jobs)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        Util::beginError();
+        std::cout << "RADIANCE::LOAD::ERROR: File `" << path << "` does not exist.";
+        Util::endError();
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    std::vector<unsigned char> bytes(static_cast<std::size_t>(std::max<std::streamoff>(file.tellg(), 0)));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!decode(bytes.data(), bytes.size(), image, outputs, jobs))
+    {
+        Util::beginError();
+        std::cout << "RADIANCE::LOAD::ERROR: Failed to decode `" << path << "`";
+        Util::endError();
+        return false;
+    }
+    return true;
+}
+
+unsigned int RadianceN::upload(const Image& image)
+{
+    if (image.halves.empty())
+        return 0;
+
+    unsigned int texture{0};
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // rows are 6 bytes per texel
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    if (GLExtN::hasTexStorage())
+    {
+        GLExtN::texStorage2D(GL_TEXTURE_2D, 1, GL_RGB16F, image.width, image.height);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGB, GL_HALF_FLOAT,
+                        image.halves.data());
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, image.width, image.height, 0, GL_RGB, GL_HALF_FLOAT,
+                     image.halves.data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
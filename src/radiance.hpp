@@ -0,0 +1,46 @@
+// Radiance .hdr (RGBE) decoder.
+// One serial pass walks the run lengths to find where every scanline starts, then scanlines are expanded & converted
+// in parallel on the job system. RGBE is turned into floats 4 texels at a time with SSE and straight into half floats
+// (F16C when the compiler targets it, an SSE2 bit conversion otherwise), so the driver gets GL_HALF_FLOAT data it can
+// copy as is.
+
+#ifndef RADIANCE_H
+#define RADIANCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "jobs.hpp"
+
+namespace RadianceN
+{
+    // scanlines per job
+    constexpr std::size_t ROW_GRAIN{16};
+
+    enum Output
+    {
+        OUTPUT_HALF = 1 << 0,
+        OUTPUT_FLOAT = 1 << 1,
+    };
+
+    // RGB texels, bottom row first (like stbi with vertical flip)
+    struct Image
+    {
+        int width{0};
+        int height{0};
+        std::vector<std::uint16_t> halves{}; // OUTPUT_HALF
+        std::vector<float> floats{};         // OUTPUT_FLOAT
+    };
+
+    // outputs: OUTPUT_ flags, jobs can be nullptr (everything runs on the calling thread then)
+    bool decode(const unsigned char* bytes, std::size_t size, Image& image, int outputs = OUTPUT_HALF,
+                JobSystem* jobs = nullptr);
+    bool load(const std::string& path, Image& image, int outputs = OUTPUT_HALF, JobSystem* jobs = nullptr);
+
+    // immutable GL_RGB16F texture (storage allocated once when the context has it) from the halves, clamped & linear
+    unsigned int upload(const Image& image);
+} // namespace RadianceN
+
+#endif
@@ -0,0 +1,509 @@
+#include "rendergraph.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <utility>
+
+#include "glext.hpp"
+#include "util.hpp"
+
+RenderGraph::RenderGraph(EngineObject* parent) : EngineObject{"RenderGraph", parent} {}
+
+RenderGraph::~RenderGraph() { free(); }
+
+void RenderGraph::init(RenderTargetPool* pool)
+{
+    m_pool = pool;
+    reset(0, 0);
+}
+
+void RenderGraph::free()
+{
+    for (const PendingQuery& query : m_queries)
+        m_freeQueries.push_back(query.query);
+    m_queries.clear();
+    if (!m_freeQueries.empty())
+        glDeleteQueries(static_cast<int>(m_freeQueries.size()), m_freeQueries.data());
+    m_freeQueries.clear();
+}
+
+void RenderGraph::reset(const int width, const int height)
+{
+    m_passes.clear();
+    m_order.clear();
+    m_resources.clear();
+    m_resources.emplace_back(
+        ResourceEntry{"backbuffer", RenderTargetN::Desc{width, height, GL_RGBA8}, glm::ivec2{width, height}});
+}
+
+RenderGraphN::Resource RenderGraph::createTexture(const std::string& name, const RenderTargetN::Desc& desc,
+                                                  const glm::ivec2& region)
+{
+    const bool whole{region.x <= 0 || region.y <= 0};
+    m_resources.emplace_back(ResourceEntry{
+        name, desc,
+        whole ? glm::ivec2{desc.width, desc.height}
+              : glm::ivec2{std::min(region.x, desc.width), std::min(region.y, desc.height)}});
+    return static_cast<RenderGraphN::Resource>(m_resources.size() - 1);
+}
+
+RenderGraphN::Resource RenderGraph::importTexture(const std::string& name, const unsigned int texture,
+                                                  const RenderTargetN::Desc& desc, const glm::ivec2& region)
+{
+    const RenderGraphN::Resource resource{createTexture(name, desc, region)};
+    m_resources[resource].texture = texture;
+    m_resources[resource].imported = true;
+    return resource;
+}
+
+void RenderGraph::addPass(RenderGraphN::Pass pass)
+{
+    const auto valid{[this](const RenderGraphN::Resource resource)
+    {
+        return resource >= 0 && resource < static_cast<RenderGraphN::Resource>(m_resources.size());
+    }};
+
+    bool success{true};
+    for (const RenderGraphN::Resource resource : pass.reads)
+    {
+        // a texture can't be sampled while it is rendered to
+        if (!valid(resource) || resource == RenderGraphN::BACKBUFFER || resource == pass.color ||
+            resource == pass.depth)
+            success = false;
+    }
+    if ((pass.color != RenderGraphN::INVALID_RESOURCE && !valid(pass.color)) ||
+        (pass.depth != RenderGraphN::INVALID_RESOURCE && (!valid(pass.depth) || pass.depth == RenderGraphN::BACKBUFFER)))
+        success = false;
+    // the default framebuffer has its own depth buffer
+    if (pass.color == RenderGraphN::BACKBUFFER && pass.depth != RenderGraphN::INVALID_RESOURCE)
+        success = false;
+    if (!pass.extraColors.empty() &&
+        (pass.color == RenderGraphN::INVALID_RESOURCE || pass.color == RenderGraphN::BACKBUFFER ||
+         pass.extraColors.size() >= RenderTargetN::MAX_COLOR_ATTACHMENTS))
+        success = false;
+    for (const RenderGraphN::Resource resource : pass.extraColors)
+    {
+        if (!valid(resource) || resource == RenderGraphN::BACKBUFFER || resource == pass.color ||
+            resource == pass.depth)
+            success = false;
+        for (const RenderGraphN::Resource read : pass.reads)
+        {
+            if (read == resource)
+                success = false;
+        }
+    }
+    for (const RenderGraphN::Resource resource : pass.writes)
+    {
+        if (!valid(resource) || resource == RenderGraphN::BACKBUFFER || resource == pass.color ||
+            resource == pass.depth)
+            success = false;
+        for (const RenderGraphN::Resource read : pass.reads)
+        {
+            if (read == resource)
+                success = false;
+        }
+    }
+    if (!pass.execute)
+        success = false;
+
+    if (!success)
+    {
+        Util::beginError();
+        std::cout << "RENDER_GRAPH::ADD_PASS::ERROR: Pass `" << pass.name << "` has invalid resources!";
+        Util::endError();
+        return;
+    }
+    m_passes.emplace_back(std::move(pass));
+}
+
+void RenderGraph::execute()
+{
+    readQueries();
+    compile();
+
+    // same order as the passes run, smoothed values carry over by name
+    std::vector<RenderGraphN::Timing> timings{};
+    timings.reserve(m_order.size());
+    for (const std::size_t index : m_order)
+    {
+        const RenderGraphN::Timing* timing{findTiming(m_passes[index].name)};
+        timings.emplace_back(timing != nullptr ? *timing : RenderGraphN::Timing{m_passes[index].name});
+    }
+    m_timings = std::move(timings);
+
+    // nothing is known about the state other code left behind
+    applyState(RenderGraphN::State{}, true);
+    for (ResourceEntry& resource : m_resources)
+        resource.imageWritten = false;
+    for (std::size_t position{0}; position < m_order.size(); ++position)
+        runPass(position);
+    if (!m_order.empty())
+        m_queries.back().lastInFrame = true;
+
+    // leave the defaults for whatever draws after the graph
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, m_resources[RenderGraphN::BACKBUFFER].region.x, m_resources[RenderGraphN::BACKBUFFER].region.y);
+    applyState(RenderGraphN::State{}, false);
+
+    if (m_benchmarkFrames > 0 && --m_benchmarkFrames == 0)
+        m_benchmark.report();
+}
+
+unsigned int RenderGraph::getTexture(const RenderGraphN::Resource resource) const
+{
+    if (resource <= RenderGraphN::BACKBUFFER || resource >= static_cast<RenderGraphN::Resource>(m_resources.size()))
+        return 0;
+    return m_resources[resource].texture;
+}
+
+const RenderTargetN::Desc& RenderGraph::getDesc(const RenderGraphN::Resource resource) const
+{
+    if (resource < 0 || resource >= static_cast<RenderGraphN::Resource>(m_resources.size()))
+        return m_resources[RenderGraphN::BACKBUFFER].desc;
+    return m_resources[resource].desc;
+}
+
+glm::ivec2 RenderGraph::getRegion(const RenderGraphN::Resource resource) const
+{
+    if (resource < 0 || resource >= static_cast<RenderGraphN::Resource>(m_resources.size()))
+        return m_resources[RenderGraphN::BACKBUFFER].region;
+    return m_resources[resource].region;
+}
+
+void RenderGraph::printTimings() const
+{
+    std::cout << "RENDER_GRAPH::TIMINGS:\n" << std::fixed << std::setprecision(3);
+    for (const RenderGraphN::Timing& timing : m_timings)
+    {
+        std::cout << "  " << std::left << std::setw(24) << timing.name << std::right << " cpu: " << timing.cpuMs
+                  << "ms | gpu: " << timing.gpuMs << "ms\n";
+    }
+    for (const std::string& name : m_culled)
+        std::cout << "  " << std::left << std::setw(24) << name << std::right << " culled\n";
+    std::cout << std::defaultfloat;
+}
+
+void RenderGraph::benchmark(const unsigned int frames)
+{
+    if (m_benchmarkFrames > 0 || frames == 0)
+        return;
+
+    m_benchmark.clear();
+    m_benchmarkFrames = frames;
+    std::cout << "RENDER_GRAPH::BENCHMARK: Recording " << frames << " frames\n";
+}
+
+void RenderGraph::compile()
+{
+    const std::size_t passCount{m_passes.size()};
+    const std::size_t resourceCount{m_resources.size()};
+
+    std::vector<std::vector<std::size_t>> writers(resourceCount);
+    std::vector<std::vector<std::size_t>> readers(resourceCount);
+    for (std::size_t i{0}; i < passCount; ++i)
+    {
+        const RenderGraphN::Pass& pass{m_passes[i]};
+        if (pass.color != RenderGraphN::INVALID_RESOURCE)
+            writers[pass.color].push_back(i);
+        if (pass.depth != RenderGraphN::INVALID_RESOURCE)
+            writers[pass.depth].push_back(i);
+        for (const RenderGraphN::Resource resource : pass.extraColors)
+            writers[resource].push_back(i);
+        for (const RenderGraphN::Resource resource : pass.writes)
+            writers[resource].push_back(i);
+        for (const RenderGraphN::Resource resource : pass.reads)
+            readers[resource].push_back(i);
+    }
+
+    // passes that have to run before every pass
+    std::vector<std::vector<std::size_t>> before(passCount);
+    for (std::size_t r{0}; r < resourceCount; ++r)
+    {
+        for (std::size_t i{1}; i < writers[r].size(); ++i)
+            before[writers[r][i]].push_back(writers[r][i - 1]);
+        for (const std::size_t reader : readers[r])
+        {
+            for (const std::size_t writer : writers[r])
+                before[reader].push_back(writer);
+        }
+    }
+
+    // cull: walk back from the screen & passes with side effects
+    std::vector<char> needed(passCount, 0);
+    std::vector<std::size_t> stack{};
+    for (std::size_t i{0}; i < passCount; ++i)
+    {
+        if (m_passes[i].sideEffects || m_passes[i].color == RenderGraphN::BACKBUFFER)
+        {
+            needed[i] = 1;
+            stack.push_back(i);
+        }
+    }
+    while (!stack.empty())
+    {
+        const std::size_t pass{stack.back()};
+        stack.pop_back();
+        for (const std::size_t dependency : before[pass])
+        {
+            if (!needed[dependency])
+            {
+                needed[dependency] = 1;
+                stack.push_back(dependency);
+            }
+        }
+    }
+
+    // order: topological, lowest declaration index first
+    std::vector<std::size_t> pending(passCount, 0);
+    std::vector<std::vector<std::size_t>> after(passCount);
+    std::size_t neededCount{0};
+    m_culled.clear();
+    for (std::size_t i{0}; i < passCount; ++i)
+    {
+        if (!needed[i])
+        {
+            m_culled.push_back(m_passes[i].name);
+            continue;
+        }
+        ++neededCount;
+        pending[i] = before[i].size();
+        for (const std::size_t dependency : before[i])
+            after[dependency].push_back(i);
+    }
+
+    std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<>> ready{};
+    for (std::size_t i{0}; i < passCount; ++i)
+    {
+        if (needed[i] && pending[i] == 0)
+            ready.push(i);
+    }
+    m_order.clear();
+    while (!ready.empty())
+    {
+        const std::size_t pass{ready.top()};
+        ready.pop();
+        m_order.push_back(pass);
+        for (const std::size_t next : after[pass])
+        {
+            if (--pending[next] == 0)
+                ready.push(next);
+        }
+    }
+    if (m_order.size() != neededCount)
+    {
+        Util::beginError();
+        std::cout << "RENDER_GRAPH::COMPILE::ERROR: Passes depend on each other, running them in declaration order!";
+        Util::endError();
+        m_order.clear();
+        for (std::size_t i{0}; i < passCount; ++i)
+        {
+            if (needed[i])
+                m_order.push_back(i);
+        }
+    }
+
+    // lifetimes, a texture is only held from its first to its last pass
+    for (ResourceEntry& resource : m_resources)
+    {
+        resource.firstUse = -1;
+        resource.lastUse = -1;
+    }
+    const auto use{[this](const RenderGraphN::Resource resource, const int position)
+    {
+        if (resource == RenderGraphN::INVALID_RESOURCE)
+            return;
+        ResourceEntry& entry{m_resources[resource]};
+        if (entry.firstUse < 0)
+            entry.firstUse = position;
+        entry.lastUse = position;
+    }};
+    for (std::size_t position{0}; position < m_order.size(); ++position)
+    {
+        const RenderGraphN::Pass& pass{m_passes[m_order[position]]};
+        for (const RenderGraphN::Resource resource : pass.reads)
+            use(resource, static_cast<int>(position));
+        for (const RenderGraphN::Resource resource : pass.writes)
+            use(resource, static_cast<int>(position));
+        for (const RenderGraphN::Resource resource : pass.extraColors)
+            use(resource, static_cast<int>(position));
+        use(pass.color, static_cast<int>(position));
+        use(pass.depth, static_cast<int>(position));
+    }
+}
+
+void RenderGraph::runPass(const std::size_t position)
+{
+    const RenderGraphN::Pass& pass{m_passes[m_order[position]]};
+    const int current{static_cast<int>(position)};
+
+    for (std::size_t r{RenderGraphN::BACKBUFFER + 1}; r < m_resources.size(); ++r)
+    {
+        if (m_resources[r].firstUse == current && !m_resources[r].imported)
+            m_resources[r].texture = m_pool->acquire(m_resources[r].desc);
+    }
+
+    // framebuffer & viewport of the outputs
+    const RenderGraphN::Resource target{pass.color != RenderGraphN::INVALID_RESOURCE ? pass.color : pass.depth};
+    if (target != RenderGraphN::INVALID_RESOURCE)
+    {
+        RenderTargetN::Colors colors{getTexture(pass.color)};
+        for (std::size_t i{0}; i < pass.extraColors.size(); ++i)
+            colors[i + 1] = getTexture(pass.extraColors[i]);
+        const unsigned int framebuffer{
+            pass.color == RenderGraphN::BACKBUFFER ? 0 : m_pool->getFramebuffer(colors, getTexture(pass.depth))};
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, m_resources[target].region.x, m_resources[target].region.y);
+    }
+
+    if (pass.clear && target != RenderGraphN::INVALID_RESOURCE)
+    {
+        GLbitfield bits{0};
+        if (pass.color != RenderGraphN::INVALID_RESOURCE)
+        {
+            glClearColor(pass.clearColor.r, pass.clearColor.g, pass.clearColor.b, pass.clearColor.a);
+            bits |= GL_COLOR_BUFFER_BIT;
+        }
+        if (pass.depth != RenderGraphN::INVALID_RESOURCE)
+        {
+            // depth writes off would mask the clear
+            if (!m_state.depthWrite)
+            {
+                glDepthMask(GL_TRUE);
+                m_state.depthWrite = true;
+            }
+            bits |= GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT;
+        }
+        glClear(bits);
+    }
+    applyState(pass.state, false);
+
+    // image stores are only visible to later passes after a barrier
+    bool barrier{false};
+    const auto check{[this, &barrier](const RenderGraphN::Resource resource)
+    {
+        if (resource > RenderGraphN::BACKBUFFER && m_resources[resource].imageWritten)
+            barrier = true;
+    }};
+    for (const RenderGraphN::Resource resource : pass.reads)
+        check(resource);
+    for (const RenderGraphN::Resource resource : pass.writes)
+        check(resource);
+    for (const RenderGraphN::Resource resource : pass.extraColors)
+        check(resource);
+    check(pass.color);
+    check(pass.depth);
+    if (barrier)
+    {
+        GLExtN::memoryBarrier(GLExtN::TEXTURE_FETCH_BARRIER_BIT | GLExtN::SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                              GLExtN::FRAMEBUFFER_BARRIER_BIT);
+        for (ResourceEntry& resource : m_resources)
+            resource.imageWritten = false;
+    }
+
+    PendingQuery query{pass.name};
+    if (m_freeQueries.empty())
+    {
+        glGenQueries(1, &query.query);
+    }
+    else
+    {
+        query.query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query.query);
+    {
+        BenchmarkN::ScopedTimer timer{query.cpuMs};
+        pass.execute(*this);
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    m_queries.push_back(query);
+    for (const RenderGraphN::Resource resource : pass.writes)
+        m_resources[resource].imageWritten = true;
+
+    RenderGraphN::Timing& timing{m_timings[position]};
+    timing.cpuMs = timing.cpuMs == 0.0 ? query.cpuMs
+                                       : timing.cpuMs * RenderGraphN::TIMING_SMOOTHING +
+                                             query.cpuMs * (1.0 - RenderGraphN::TIMING_SMOOTHING);
+
+    // the memory is free for later passes from here on
+    for (std::size_t r{RenderGraphN::BACKBUFFER + 1}; r < m_resources.size(); ++r)
+    {
+        if (m_resources[r].lastUse == current && !m_resources[r].imported)
+        {
+            m_pool->release(m_resources[r].texture);
+            m_resources[r].texture = 0;
+        }
+    }
+}
+
+void RenderGraph::applyState(const RenderGraphN::State& state, const bool force)
+{
+    if (force || state.depthTest != m_state.depthTest)
+    {
+        if (state.depthTest)
+            glEnable(GL_DEPTH_TEST);
+        else
+            glDisable(GL_DEPTH_TEST);
+    }
+    if (force || state.depthWrite != m_state.depthWrite)
+        glDepthMask(state.depthWrite ? GL_TRUE : GL_FALSE);
+    if (force || state.depthFunc != m_state.depthFunc)
+        glDepthFunc(state.depthFunc);
+    if (force || state.blend != m_state.blend)
+    {
+        if (state.blend)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+    }
+    if (force || state.blendSrc != m_state.blendSrc || state.blendDst != m_state.blendDst)
+        glBlendFunc(state.blendSrc, state.blendDst);
+    m_state = state;
+}
+
+void RenderGraph::readQueries()
+{
+    while (!m_queries.empty())
+    {
+        const PendingQuery query{m_queries.front()};
+        GLint available{0};
+        glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 ns{0};
+        glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &ns);
+        const double gpuMs{static_cast<double>(ns) / 1.0e6};
+        RenderGraphN::Timing* timing{findTiming(query.name)};
+        if (timing != nullptr)
+        {
+            timing->gpuMs = timing->gpuMs == 0.0 ? gpuMs
+                                                 : timing->gpuMs * RenderGraphN::TIMING_SMOOTHING +
+                                                       gpuMs * (1.0 - RenderGraphN::TIMING_SMOOTHING);
+        }
+        if (m_benchmarkFrames > 0)
+            m_benchmark.addSample(query.name, BenchmarkN::Sample{query.cpuMs, gpuMs, 0});
+        m_gpuFrameAccumMs += gpuMs;
+        if (query.lastInFrame)
+        {
+            m_gpuFrameMs = m_gpuFrameAccumMs;
+            m_gpuFrameAccumMs = 0.0;
+        }
+
+        m_freeQueries.push_back(query.query);
+        m_queries.pop_front();
+    }
+}
+
+RenderGraphN::Timing* RenderGraph::findTiming(const std::string& name)
+{
+    for (RenderGraphN::Timing& timing : m_timings)
+    {
+        if (timing.name == name)
+            return &timing;
+    }
+    return nullptr;
+}
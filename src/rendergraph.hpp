@@ -0,0 +1,173 @@
+// Render graph for the frame.
+// Passes declare the textures they read & write instead of binding framebuffers themselves, and the graph is
+// compiled again every frame before it runs: passes whose outputs nothing uses are culled, the rest are ordered by
+// their dependencies (declaration order breaks ties), transient textures are acquired from the render target pool
+// right before their first use and handed back after their last, so passes whose lifetimes don't overlap share
+// memory (imported textures like history buffers are left alone), and only the GL state that differs from the
+// previous pass is changed (plus a memory barrier before a pass uses what a compute pass wrote). Every pass that runs
+// is timed on the cpu and with GL_TIME_ELAPSED queries.
+
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "engine_types.hpp"
+#include "glm/ext/vector_int2.hpp"
+#include "glm/vec4.hpp"
+#include "rendertargetpool.hpp"
+
+class RenderGraph;
+
+namespace RenderGraphN
+{
+    using Resource = int;
+    constexpr Resource INVALID_RESOURCE{-1};
+    // the default framebuffer, a color output that keeps its pass alive
+    constexpr Resource BACKBUFFER{0};
+
+    // weight of the previous value when smoothing pass timings
+    constexpr double TIMING_SMOOTHING{0.9};
+
+    // fixed function state a pass runs with, the graph only changes what differs from the previous pass
+    struct State
+    {
+        bool depthTest{true};
+        bool depthWrite{true};
+        GLenum depthFunc{GL_LEQUAL};
+        bool blend{false};
+        GLenum blendSrc{GL_ONE};
+        GLenum blendDst{GL_ONE};
+    };
+
+    // A texture is written by its writers in declaration order and read once all of them are done.
+    struct Pass
+    {
+        std::string name{};
+        // textures sampled by the pass
+        std::vector<Resource> reads{};
+        // render targets, the viewport covers their region
+        Resource color{INVALID_RESOURCE};
+        Resource depth{INVALID_RESOURCE};
+        // more render targets after color (GL_COLOR_ATTACHMENT1...), as large as color
+        std::vector<Resource> extraColors{};
+        // written as images (compute passes), no framebuffer is bound for them
+        std::vector<Resource> writes{};
+        // clear all render targets before execute
+        bool clear{false};
+        glm::vec4 clearColor{0.0f, 0.0f, 0.0f, 1.0f};
+        State state{};
+        // never culled, even if nothing reads the outputs
+        bool sideEffects{false};
+        // passes may change GL state as long as the State fields are back to what they were when they return
+        std::function<void(const RenderGraph&)> execute{};
+    };
+
+    struct Timing
+    {
+        std::string name{};
+        double cpuMs{0.0};
+        double gpuMs{0.0};
+    };
+} // namespace RenderGraphN
+
+class RenderGraph final : public EngineObject
+{
+public:
+    explicit RenderGraph(EngineObject* parent);
+    ~RenderGraph() override;
+
+    void init(RenderTargetPool* pool);
+    void free();
+
+    // start declaring a frame that ends up in a width x height default framebuffer
+    void reset(int width, int height);
+    // transient texture, only allocated if a pass that survives culling uses it. Passes rendering to it only cover
+    // region (from the bottom left corner), zero means the whole texture
+    RenderGraphN::Resource createTexture(const std::string& name, const RenderTargetN::Desc& desc,
+                                         const glm::ivec2& region = glm::ivec2{0});
+    // texture that outlives the frame (a persistent pool target), the graph never acquires or releases it
+    RenderGraphN::Resource importTexture(const std::string& name, unsigned int texture, const RenderTargetN::Desc& desc,
+                                         const glm::ivec2& region = glm::ivec2{0});
+    void addPass(RenderGraphN::Pass pass);
+
+    // compile & run the declared passes, leaves the default framebuffer & state bound
+    void execute();
+
+    // texture behind resource, valid inside the execute() of a pass that declared it
+    [[nodiscard]] unsigned int getTexture(RenderGraphN::Resource resource) const;
+    [[nodiscard]] const RenderTargetN::Desc& getDesc(RenderGraphN::Resource resource) const;
+    [[nodiscard]] glm::ivec2 getRegion(RenderGraphN::Resource resource) const;
+
+    // smoothed timings of the passes that ran last frame, in execution order
+    [[nodiscard]] const std::vector<RenderGraphN::Timing>& getTimings() const { return m_timings; }
+    [[nodiscard]] const std::vector<std::string>& getCulledPasses() const { return m_culled; }
+    void printTimings() const;
+    // unsmoothed gpu time of all passes of the newest frame whose queries are done, 0 until there is one
+    [[nodiscard]] double getGpuFrameMs() const { return m_gpuFrameMs; }
+
+    // record every pass for the next frames & print the series
+    void benchmark(unsigned int frames);
+    [[nodiscard]] bool getBenchmarkRunning() const { return m_benchmarkFrames > 0; }
+
+private:
+    struct ResourceEntry
+    {
+        std::string name{};
+        RenderTargetN::Desc desc{};
+        glm::ivec2 region{0};
+        unsigned int texture{0};
+        // positions in m_order, -1 while unused
+        int firstUse{-1};
+        int lastUse{-1};
+        // image stores a later pass has to wait for
+        bool imageWritten{false};
+        bool imported{false};
+    };
+
+    struct PendingQuery
+    {
+        std::string name{};
+        unsigned int query{0};
+        double cpuMs{0.0};
+        // the frame's gpu time is complete once this one is read
+        bool lastInFrame{false};
+    };
+
+    RenderTargetPool* m_pool{nullptr};
+
+    std::vector<ResourceEntry> m_resources{};
+    std::vector<RenderGraphN::Pass> m_passes{};
+    // indices into m_passes, in execution order
+    std::vector<std::size_t> m_order{};
+
+    // GL state as last set by the graph
+    RenderGraphN::State m_state{};
+
+    std::vector<RenderGraphN::Timing> m_timings{};
+    std::vector<std::string> m_culled{};
+    std::deque<PendingQuery> m_queries{};
+    std::vector<unsigned int> m_freeQueries{};
+    double m_gpuFrameMs{0.0};
+    double m_gpuFrameAccumMs{0.0};
+
+    Benchmark m_benchmark{"Render graph passes"};
+    unsigned int m_benchmarkFrames{0};
+
+    // cull, order & find the lifetimes of the resources
+    void compile();
+    void runPass(std::size_t position);
+    void applyState(const RenderGraphN::State& state, bool force);
+    // read back finished timer queries, never waits
+    void readQueries();
+    // nullptr if the pass didn't run last frame
+    [[nodiscard]] RenderGraphN::Timing* findTiming(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,310 @@
+#include "rendertargetpool.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "glext.hpp"
+#include "util.hpp"
+
+bool RenderTargetN::isDepthFormat(const GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::size_t RenderTargetN::getTexelBytes(const GLenum internalFormat, const int samples)
+{
+    std::size_t bytes{4};
+    switch (internalFormat)
+    {
+    case GL_R8:
+        bytes = 1;
+        break;
+    case GL_R16F:
+    case GL_RG8:
+    case GL_DEPTH_COMPONENT16:
+        bytes = 2;
+        break;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+        bytes = 8;
+        break;
+    case GL_RGBA32F:
+        bytes = 16;
+        break;
+    default:
+        break;
+    }
+    return bytes * static_cast<std::size_t>(std::max(samples, 1));
+}
+
+RenderTargetPool::RenderTargetPool(EngineObject* parent) : EngineObject{"RenderTargetPool", parent} {}
+
+RenderTargetPool::~RenderTargetPool() { free(); }
+
+void RenderTargetPool::free()
+{
+    for (const Framebuffer& framebuffer : m_framebuffers)
+        glDeleteFramebuffers(1, &framebuffer.FBO);
+    m_framebuffers.clear();
+
+    for (const Target& target : m_targets)
+        glDeleteTextures(1, &target.texture);
+    m_targets.clear();
+    m_bytes = 0;
+}
+
+unsigned int RenderTargetPool::acquire(const RenderTargetN::Desc& desc)
+{
+    if (desc.width <= 0 || desc.height <= 0 || desc.samples < 0)
+    {
+        Util::beginError();
+        std::cout << "RENDER_TARGET_POOL::ACQUIRE::ERROR: Invalid render target " << desc.width << "x" << desc.height
+                  << " with " << desc.samples << " samples!";
+        Util::endError();
+        return 0;
+    }
+
+    // reuse a target of the same key whose last user is done with it
+    for (Target& target : m_targets)
+    {
+        if (!target.acquired && target.desc == desc)
+        {
+            target.acquired = true;
+            target.lastFrame = m_frame;
+            return target.texture;
+        }
+    }
+
+    const unsigned int texture{createTexture(desc)};
+    if (texture == 0)
+        return 0;
+    m_targets.emplace_back(Target{desc, texture, true, m_frame});
+    m_bytes += static_cast<std::size_t>(desc.width) * desc.height *
+               RenderTargetN::getTexelBytes(desc.internalFormat, desc.samples);
+    ++m_allocations;
+    return texture;
+}
+
+void RenderTargetPool::release(const unsigned int texture)
+{
+    for (Target& target : m_targets)
+    {
+        if (target.texture == texture)
+        {
+            target.acquired = false;
+            return;
+        }
+    }
+}
+
+unsigned int RenderTargetPool::acquirePersistent(const RenderTargetN::Desc& desc)
+{
+    const unsigned int texture{acquire(desc)};
+    for (Target& target : m_targets)
+    {
+        if (target.texture == texture)
+            target.persistent = true;
+    }
+    return texture;
+}
+
+void RenderTargetPool::releasePersistent(const unsigned int texture)
+{
+    for (Target& target : m_targets)
+    {
+        if (target.texture == texture)
+        {
+            target.persistent = false;
+            target.acquired = false;
+            return;
+        }
+    }
+}
+
+void RenderTargetPool::endFrame()
+{
+    std::size_t kept{0};
+    for (Target& target : m_targets)
+    {
+        target.acquired = target.persistent;
+        if (target.persistent)
+            target.lastFrame = m_frame;
+        if (m_frame - target.lastFrame >= RenderTargetN::KEEP_FRAMES)
+        {
+            removeFramebuffers(target.texture);
+            glDeleteTextures(1, &target.texture);
+            m_bytes -= static_cast<std::size_t>(target.desc.width) * target.desc.height *
+                       RenderTargetN::getTexelBytes(target.desc.internalFormat, target.desc.samples);
+            continue;
+        }
+        m_targets[kept++] = target;
+    }
+    m_targets.resize(kept);
+    ++m_frame;
+}
+
+unsigned int RenderTargetPool::getFramebuffer(const unsigned int color, const unsigned int depth)
+{
+    return getFramebuffer(RenderTargetN::Colors{color}, depth);
+}
+
+unsigned int RenderTargetPool::getFramebuffer(const RenderTargetN::Colors& colors, const unsigned int depth)
+{
+    for (const Framebuffer& framebuffer : m_framebuffers)
+    {
+        if (framebuffer.colors == colors && framebuffer.depth == depth)
+            return framebuffer.FBO;
+    }
+
+    const auto findTarget{[this](const unsigned int texture) -> const Target*
+    {
+        for (const Target& target : m_targets)
+        {
+            if (target.texture == texture)
+                return &target;
+        }
+        return nullptr;
+    }};
+    std::array<const Target*, RenderTargetN::MAX_COLOR_ATTACHMENTS> colorTargets{};
+    std::size_t colorCount{0};
+    bool found{true};
+    while (colorCount < colors.size() && colors[colorCount] != 0)
+    {
+        colorTargets[colorCount] = findTarget(colors[colorCount]);
+        found = found && colorTargets[colorCount] != nullptr;
+        ++colorCount;
+    }
+    const Target* depthTarget{findTarget(depth)};
+    if (!found || (depth != 0 && depthTarget == nullptr))
+    {
+        Util::beginError();
+        std::cout << "RENDER_TARGET_POOL::GET_FRAMEBUFFER::ERROR: Texture is not a pooled render target!";
+        Util::endError();
+        return 0;
+    }
+
+    int previous{0};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+
+    Framebuffer framebuffer{colors, depth, 0};
+    glGenFramebuffers(1, &framebuffer.FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.FBO);
+    std::array<GLenum, RenderTargetN::MAX_COLOR_ATTACHMENTS> drawBuffers{};
+    for (std::size_t i{0}; i < colorCount; ++i)
+    {
+        drawBuffers[i] = static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, drawBuffers[i],
+                               colorTargets[i]->desc.samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D,
+                               colors[i], 0);
+    }
+    if (colorCount > 1)
+    {
+        glDrawBuffers(static_cast<int>(colorCount), drawBuffers.data());
+    }
+    else if (colorCount == 0)
+    {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    if (depthTarget != nullptr)
+    {
+        const GLenum format{depthTarget->desc.internalFormat};
+        const bool stencil{format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8};
+        const GLenum attachment{stencil ? static_cast<GLenum>(GL_DEPTH_STENCIL_ATTACHMENT)
+                                        : static_cast<GLenum>(GL_DEPTH_ATTACHMENT)};
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment,
+                               depthTarget->desc.samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D, depth, 0);
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        Util::beginError();
+        std::cout << "RENDER_TARGET_POOL::GET_FRAMEBUFFER::ERROR: Framebuffer is not complete!";
+        Util::endError();
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<unsigned int>(previous));
+        glDeleteFramebuffers(1, &framebuffer.FBO);
+        return 0;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<unsigned int>(previous));
+    m_framebuffers.emplace_back(framebuffer);
+    return framebuffer.FBO;
+}
+
+unsigned int RenderTargetPool::createTexture(const RenderTargetN::Desc& desc)
+{
+    unsigned int texture{0};
+    glGenTextures(1, &texture);
+
+    if (desc.samples > 0)
+    {
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, desc.samples, desc.internalFormat, desc.width,
+                                desc.height, GL_TRUE);
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+        return texture;
+    }
+
+    const bool depth{RenderTargetN::isDepthFormat(desc.internalFormat)};
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (GLExtN::hasTexStorage())
+    {
+        GLExtN::texStorage2D(GL_TEXTURE_2D, 1, desc.internalFormat, desc.width, desc.height);
+    }
+    else
+    {
+        // any valid transfer format will do, nothing is uploaded
+        GLenum format{GL_RGBA};
+        GLenum type{GL_FLOAT};
+        if (desc.internalFormat == GL_DEPTH24_STENCIL8)
+        {
+            format = GL_DEPTH_STENCIL;
+            type = GL_UNSIGNED_INT_24_8;
+        }
+        else if (desc.internalFormat == GL_DEPTH32F_STENCIL8)
+        {
+            format = GL_DEPTH_STENCIL;
+            type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+        }
+        else if (depth)
+        {
+            format = GL_DEPTH_COMPONENT;
+        }
+        glTexImage2D(GL_TEXTURE_2D, 0, static_cast<int>(desc.internalFormat), desc.width, desc.height, 0, format,
+                     type, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void RenderTargetPool::removeFramebuffers(const unsigned int texture)
+{
+    std::size_t kept{0};
+    for (const Framebuffer& framebuffer : m_framebuffers)
+    {
+        if (std::find(framebuffer.colors.begin(), framebuffer.colors.end(), texture) != framebuffer.colors.end() ||
+            framebuffer.depth == texture)
+        {
+            glDeleteFramebuffers(1, &framebuffer.FBO);
+            continue;
+        }
+        m_framebuffers[kept++] = framebuffer;
+    }
+    m_framebuffers.resize(kept);
+}
@@ -0,0 +1,109 @@
+// Render target pool for the post processing passes.
+// Targets are textures keyed by size, internal format & sample count. Passes acquire them for the current frame and
+// hand them back when their output has been consumed, so a later pass asking for the same key reuses the memory of
+// a target whose lifetime already ended. Everything still out is returned at the end of the frame, and targets
+// nobody asked for in a few frames (like the old size after a resize) are deleted, so a resize only allocates the
+// keys that actually changed. Persistent targets (history buffers) stay with their owner across frames until they
+// are released explicitly.
+
+#ifndef RENDER_TARGET_POOL_H
+#define RENDER_TARGET_POOL_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "engine_types.hpp"
+
+namespace RenderTargetN
+{
+    // frames an unused target is kept before its memory is released
+    constexpr unsigned int KEEP_FRAMES{3};
+    // color attachments of one pooled framebuffer
+    constexpr std::size_t MAX_COLOR_ATTACHMENTS{4};
+    using Colors = std::array<unsigned int, MAX_COLOR_ATTACHMENTS>;
+
+    struct Desc
+    {
+        int width{0};
+        int height{0};
+        GLenum internalFormat{GL_RGBA16F};
+        // 0 = GL_TEXTURE_2D, otherwise GL_TEXTURE_2D_MULTISAMPLE with that many samples
+        int samples{0};
+
+        bool operator==(const Desc& other) const
+        {
+            return width == other.width && height == other.height && internalFormat == other.internalFormat &&
+                   samples == other.samples;
+        }
+    };
+
+    [[nodiscard]] bool isDepthFormat(GLenum internalFormat);
+    // bytes of one texel (times the samples), an estimate for formats the pool doesn't know
+    [[nodiscard]] std::size_t getTexelBytes(GLenum internalFormat, int samples);
+} // namespace RenderTargetN
+
+class RenderTargetPool final : public EngineObject
+{
+public:
+    explicit RenderTargetPool(EngineObject* parent);
+    ~RenderTargetPool() override;
+
+    // delete every target & framebuffer
+    void free();
+
+    // texture for desc, owned by the caller until release() or the end of the frame, 0 if desc is invalid
+    unsigned int acquire(const RenderTargetN::Desc& desc);
+    // hand a texture back early, later passes of this frame with the same desc reuse it
+    void release(unsigned int texture);
+    // return everything still acquired & delete targets that were not used for KEEP_FRAMES frames
+    void endFrame();
+
+    // texture for desc that is kept across frames until releasePersistent(), 0 if desc is invalid
+    unsigned int acquirePersistent(const RenderTargetN::Desc& desc);
+    // back to a normal target, deleted once nobody acquires it for KEEP_FRAMES frames
+    void releasePersistent(unsigned int texture);
+
+    // framebuffer with color (and depth) attached, cached until one of the textures is deleted
+    unsigned int getFramebuffer(unsigned int color, unsigned int depth = 0);
+    // the same with multiple render targets, colors[i] goes to GL_COLOR_ATTACHMENTi up to the first 0
+    unsigned int getFramebuffer(const RenderTargetN::Colors& colors, unsigned int depth);
+
+    // getters
+    [[nodiscard]] std::size_t getTargetCount() const { return m_targets.size(); }
+    [[nodiscard]] std::size_t getBytes() const { return m_bytes; }
+    // textures created since the pool was made, stays flat while sizes don't change
+    [[nodiscard]] unsigned int getAllocationCount() const { return m_allocations; }
+
+private:
+    struct Target
+    {
+        RenderTargetN::Desc desc{};
+        unsigned int texture{0};
+        bool acquired{false};
+        unsigned int lastFrame{0};
+        bool persistent{false};
+    };
+
+    struct Framebuffer
+    {
+        RenderTargetN::Colors colors{};
+        unsigned int depth{0};
+        unsigned int FBO{0};
+    };
+
+    std::vector<Target> m_targets{};
+    std::vector<Framebuffer> m_framebuffers{};
+
+    unsigned int m_frame{0};
+    unsigned int m_allocations{0};
+    std::size_t m_bytes{0};
+
+    unsigned int createTexture(const RenderTargetN::Desc& desc);
+    // drop cached framebuffers that reference texture
+    void removeFramebuffers(unsigned int texture);
+};
+
+#endif
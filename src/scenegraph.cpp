@@ -0,0 +1,333 @@
+#include "scenegraph.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+#include "util.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SCENEGRAPH_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    // returned for invalid handles
+    const glm::mat4 IDENTITY{1.0f};
+} // namespace
+
+void SceneGraphN::multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef SCENEGRAPH_SSE
+    // column j of the result is a's columns weighted by column j of b
+    const __m128 a0{_mm_loadu_ps(&a[0][0])};
+    const __m128 a1{_mm_loadu_ps(&a[1][0])};
+    const __m128 a2{_mm_loadu_ps(&a[2][0])};
+    const __m128 a3{_mm_loadu_ps(&a[3][0])};
+    for (int j{0}; j < 4; ++j)
+    {
+        const float* column{&b[j][0]};
+        __m128 result{_mm_mul_ps(a0, _mm_set1_ps(column[0]))};
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+        // out may alias b, so column j of b is fully read before it is written
+        _mm_storeu_ps(&out[j][0], result);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+SceneGraph::SceneGraph(EngineObject* parent) : EngineObject{"SceneGraph", parent} {}
+
+SceneGraphN::Handle SceneGraph::createNode(const SceneGraphN::Handle parent, const glm::mat4& local)
+{
+    int parentIndex{-1};
+    std::size_t level{0};
+    if (parent != SceneGraphN::INVALID_HANDLE)
+    {
+        if (!isValid(parent))
+        {
+            Util::beginError();
+            std::cout << "SCENE_GRAPH::CREATE_NODE::ERROR: Invalid parent handle `" << parent << "`";
+            Util::endError();
+            return SceneGraphN::INVALID_HANDLE;
+        }
+        parentIndex = m_indices[parent];
+        level = getLevel(static_cast<std::size_t>(parentIndex)) + 1;
+    }
+
+    if (level == m_levelStart.size())
+    {
+        m_levelStart.push_back(m_local.size());
+        m_levelDirty.push_back(0);
+    }
+
+    // append to the end of its level, shifting deeper levels up by one
+    const std::size_t index{getLevelEnd(level)};
+    const auto offset{static_cast<std::ptrdiff_t>(index)};
+    m_local.insert(m_local.begin() + offset, local);
+    m_world.insert(m_world.begin() + offset, local);
+    // a new node didn't move
+    m_previousWorld.insert(m_previousWorld.begin() + offset,
+                           parentIndex >= 0 ? m_world[static_cast<std::size_t>(parentIndex)] * local : local);
+    m_parent.insert(m_parent.begin() + offset, parentIndex);
+    m_dirty.insert(m_dirty.begin() + offset, 0);
+    m_renderables.insert(m_renderables.begin() + offset, SceneGraphN::Renderable{});
+
+    for (std::size_t i{level + 1}; i < m_levelStart.size(); ++i)
+    {
+        ++m_levelStart[i];
+    }
+
+    // allocate handle
+    SceneGraphN::Handle handle{};
+    if (!m_freeHandles.empty())
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<SceneGraphN::Handle>(m_indices.size());
+        m_indices.push_back(-1);
+    }
+    m_handles.insert(m_handles.begin() + offset, handle);
+
+    // fix up shifted nodes
+    for (std::size_t i{index}; i < m_local.size(); ++i)
+    {
+        if (m_parent[i] >= static_cast<int>(index) && i != index)
+            ++m_parent[i];
+        m_indices[m_handles[i]] = static_cast<int>(i);
+    }
+
+    markDirty(index);
+    return handle;
+}
+
+void SceneGraph::destroyNode(const SceneGraphN::Handle handle)
+{
+    if (!isValid(handle))
+        return;
+
+    // parents come before children, so one pass finds the whole subtree
+    const std::size_t first{static_cast<std::size_t>(m_indices[handle])};
+    std::vector<std::uint8_t> removed(m_local.size(), 0);
+    removed[first] = 1;
+    for (std::size_t i{first + 1}; i < m_local.size(); ++i)
+    {
+        removed[i] = m_parent[i] >= 0 && removed[m_parent[i]];
+    }
+
+    // compact, remapping parent indices
+    std::vector<int> remap(m_local.size(), -1);
+    std::size_t count{0};
+    for (std::size_t i{0}; i < m_local.size(); ++i)
+    {
+        if (removed[i])
+        {
+            m_indices[m_handles[i]] = -1;
+            m_freeHandles.push_back(m_handles[i]);
+            continue;
+        }
+
+        remap[i] = static_cast<int>(count);
+        m_local[count] = m_local[i];
+        m_world[count] = m_world[i];
+        m_previousWorld[count] = m_previousWorld[i];
+        m_parent[count] = m_parent[i] >= 0 ? remap[m_parent[i]] : -1;
+        m_dirty[count] = m_dirty[i];
+        m_renderables[count] = m_renderables[i];
+        m_handles[count] = m_handles[i];
+        m_indices[m_handles[count]] = static_cast<int>(count);
+        ++count;
+    }
+    m_local.resize(count);
+    m_world.resize(count);
+    m_previousWorld.resize(count);
+    m_parent.resize(count);
+    m_dirty.resize(count);
+    m_renderables.resize(count);
+    m_handles.resize(count);
+
+    // level starts move down by the number of removed nodes before them
+    std::size_t removedBefore{0};
+    std::size_t scanned{0};
+    for (std::size_t& start : m_levelStart)
+    {
+        for (; scanned < start; ++scanned)
+            removedBefore += removed[scanned];
+        start -= removedBefore;
+    }
+    while (!m_levelStart.empty() && m_levelStart.back() == count)
+    {
+        m_levelStart.pop_back();
+        m_levelDirty.pop_back();
+    }
+}
+
+void SceneGraph::clear()
+{
+    m_local.clear();
+    m_world.clear();
+    m_previousWorld.clear();
+    m_parent.clear();
+    m_dirty.clear();
+    m_renderables.clear();
+    m_handles.clear();
+    m_levelStart.clear();
+    m_levelDirty.clear();
+    m_indices.clear();
+    m_freeHandles.clear();
+    m_updatedCount = 0;
+}
+
+SceneGraphN::Handle SceneGraph::instantiate(const Model* model, const SceneGraphN::Handle parent,
+                                            const glm::mat4& local)
+{
+    const SceneGraphN::Handle root{createNode(parent, local)};
+    if (model == nullptr || root == SceneGraphN::INVALID_HANDLE)
+        return root;
+
+    const std::vector<ModelN::Node>& nodes{model->getNodes()};
+    std::vector<SceneGraphN::Handle> handles(nodes.size(), SceneGraphN::INVALID_HANDLE);
+    for (std::size_t i{0}; i < nodes.size(); ++i)
+    {
+        const SceneGraphN::Handle nodeParent{nodes[i].parent >= 0 ? handles[nodes[i].parent] : root};
+        handles[i] = createNode(nodeParent, nodes[i].transform);
+        if (!nodes[i].meshes.empty())
+            setRenderable(handles[i], model, static_cast<int>(i));
+    }
+    return root;
+}
+
+void SceneGraph::setLocalTransform(const SceneGraphN::Handle handle, const glm::mat4& local)
+{
+    if (!isValid(handle))
+        return;
+
+    const std::size_t index{static_cast<std::size_t>(m_indices[handle])};
+    m_local[index] = local;
+    markDirty(index);
+}
+
+void SceneGraph::setRenderable(const SceneGraphN::Handle handle, const Model* model, const int node)
+{
+    if (!isValid(handle))
+        return;
+
+    m_renderables[m_indices[handle]] = SceneGraphN::Renderable{model, node};
+}
+
+void SceneGraph::update(JobSystem* jobs)
+{
+    m_updatedCount = 0;
+    bool anyDirty{false};
+
+    for (std::size_t level{0}; level < m_levelStart.size(); ++level)
+    {
+        if (!m_levelDirty[level])
+            continue;
+        m_levelDirty[level] = 0;
+        anyDirty = true;
+
+        // every node in a level only reads its parent from the previous level, so levels split freely
+        const std::size_t begin{m_levelStart[level]};
+        const std::size_t end{getLevelEnd(level)};
+        std::size_t updated{0};
+        if (jobs != nullptr && end - begin > SceneGraphN::UPDATE_GRAIN)
+        {
+            std::atomic<std::size_t> count{0};
+            jobs->parallelFor(end - begin, SceneGraphN::UPDATE_GRAIN,
+                              [this, begin, &count](const std::size_t first, const std::size_t last)
+                              { count.fetch_add(updateRange(begin + first, begin + last), std::memory_order_relaxed); });
+            updated = count.load();
+        }
+        else
+        {
+            updated = updateRange(begin, end);
+        }
+
+        // children of recomputed nodes have to be recomputed too
+        if (updated > 0 && level + 1 < m_levelStart.size())
+            m_levelDirty[level + 1] = 1;
+        m_updatedCount += updated;
+    }
+
+    if (anyDirty)
+        std::fill(m_dirty.begin(), m_dirty.end(), 0);
+    m_worldChanged = m_worldChanged || m_updatedCount > 0;
+}
+
+void SceneGraph::storePreviousTransforms()
+{
+    if (!m_worldChanged)
+        return;
+    m_previousWorld = m_world;
+    m_worldChanged = false;
+}
+
+std::size_t SceneGraph::updateRange(const std::size_t begin, const std::size_t end)
+{
+    std::size_t count{0};
+    for (std::size_t i{begin}; i < end; ++i)
+    {
+        const int parent{m_parent[i]};
+        if (!m_dirty[i] && (parent < 0 || !m_dirty[parent]))
+            continue;
+
+        if (parent < 0)
+            m_world[i] = m_local[i];
+        else
+            SceneGraphN::multiply(m_world[parent], m_local[i], m_world[i]);
+
+        // keep the flag until the end of update() so children see it
+        m_dirty[i] = 1;
+        ++count;
+    }
+    return count;
+}
+
+bool SceneGraph::isValid(const SceneGraphN::Handle handle) const
+{
+    return handle < m_indices.size() && m_indices[handle] >= 0;
+}
+
+const glm::mat4& SceneGraph::getLocalTransform(const SceneGraphN::Handle handle) const
+{
+    return isValid(handle) ? m_local[m_indices[handle]] : IDENTITY;
+}
+
+const glm::mat4& SceneGraph::getWorldTransform(const SceneGraphN::Handle handle) const
+{
+    return isValid(handle) ? m_world[m_indices[handle]] : IDENTITY;
+}
+
+SceneGraphN::Handle SceneGraph::getParent(const SceneGraphN::Handle handle) const
+{
+    if (!isValid(handle))
+        return SceneGraphN::INVALID_HANDLE;
+
+    const int parent{m_parent[m_indices[handle]]};
+    return parent >= 0 ? m_handles[parent] : SceneGraphN::INVALID_HANDLE;
+}
+
+std::size_t SceneGraph::getLevelEnd(const std::size_t level) const
+{
+    return level + 1 < m_levelStart.size() ? m_levelStart[level + 1] : m_local.size();
+}
+
+std::size_t SceneGraph::getLevel(const std::size_t index) const
+{
+    const auto it{std::upper_bound(m_levelStart.begin(), m_levelStart.end(), index)};
+    return static_cast<std::size_t>(it - m_levelStart.begin()) - 1;
+}
+
+void SceneGraph::markDirty(const std::size_t index)
+{
+    m_dirty[index] = 1;
+    m_levelDirty[getLevel(index)] = 1;
+}
@@ -0,0 +1,110 @@
+// Transform hierarchy.
+// Nodes are stored structure-of-arrays, sorted by depth so every parent is updated before its children.
+// Local transform changes only mark the node dirty, update() then recomputes the dirty subtrees level by level,
+// splitting every level across the job system.
+//
+// Nodes are referenced through handles, dense indices move around when nodes are created or destroyed.
+
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "culling.hpp"
+#include "engine_types.hpp"
+#include "jobs.hpp"
+#include "model.hpp"
+
+namespace SceneGraphN
+{
+    using Handle = unsigned int;
+    constexpr Handle INVALID_HANDLE{0xFFFFFFFF};
+
+    // nodes per update job
+    constexpr std::size_t UPDATE_GRAIN{256};
+
+    // what a node draws with its world transform
+    struct Renderable
+    {
+        const Model* model{nullptr};
+        int node{-1}; // model hierarchy node, -1 draws the whole model
+    };
+
+    // out = a * b (SSE when available)
+    void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out);
+} // namespace SceneGraphN
+
+class SceneGraph final : public EngineObject
+{
+public:
+    explicit SceneGraph(EngineObject* parent);
+
+    SceneGraphN::Handle createNode(SceneGraphN::Handle parent = SceneGraphN::INVALID_HANDLE,
+                                   const glm::mat4& local = glm::mat4{1.0f});
+    // destroy node & all its descendants
+    void destroyNode(SceneGraphN::Handle handle);
+    void clear();
+
+    // mirror a model's node hierarchy, returns the handle of the model's root node
+    SceneGraphN::Handle instantiate(const Model* model, SceneGraphN::Handle parent = SceneGraphN::INVALID_HANDLE,
+                                    const glm::mat4& local = glm::mat4{1.0f});
+
+    void setLocalTransform(SceneGraphN::Handle handle, const glm::mat4& local);
+    void setRenderable(SceneGraphN::Handle handle, const Model* model, int node = -1);
+
+    // recompute world transforms of dirty subtrees (jobs can be nullptr to update on this thread)
+    void update(JobSystem* jobs);
+    // start of a frame: the world transforms drawn last frame become the previous ones (motion vectors)
+    void storePreviousTransforms();
+
+    [[nodiscard]] bool isValid(SceneGraphN::Handle handle) const;
+    [[nodiscard]] const glm::mat4& getLocalTransform(SceneGraphN::Handle handle) const;
+    // world transform as of the last update()
+    [[nodiscard]] const glm::mat4& getWorldTransform(SceneGraphN::Handle handle) const;
+    [[nodiscard]] SceneGraphN::Handle getParent(SceneGraphN::Handle handle) const;
+
+    [[nodiscard]] std::size_t getNodeCount() const { return m_local.size(); }
+    [[nodiscard]] std::size_t getLevelCount() const { return m_levelStart.size(); }
+    // nodes recomputed by the last update()
+    [[nodiscard]] std::size_t getUpdatedCount() const { return m_updatedCount; }
+
+    // dense arrays, index i of each belongs to the same node
+    [[nodiscard]] const std::vector<glm::mat4>& getWorldTransforms() const { return m_world; }
+    [[nodiscard]] const std::vector<glm::mat4>& getPreviousWorldTransforms() const { return m_previousWorld; }
+    [[nodiscard]] const std::vector<SceneGraphN::Renderable>& getRenderables() const { return m_renderables; }
+    [[nodiscard]] SceneGraphN::Handle getHandle(const std::size_t index) const { return m_handles[index]; }
+
+private:
+    // ----- dense node data (depth order) ----- //
+    std::vector<glm::mat4> m_local{};
+    std::vector<glm::mat4> m_world{};
+    std::vector<glm::mat4> m_previousWorld{}; // as of the last storePreviousTransforms()
+    std::vector<int> m_parent{}; // dense index of the parent, -1 for roots
+    std::vector<std::uint8_t> m_dirty{};
+    std::vector<SceneGraphN::Renderable> m_renderables{};
+    std::vector<SceneGraphN::Handle> m_handles{}; // dense index -> handle
+
+    // first dense index of every depth level
+    std::vector<std::size_t> m_levelStart{};
+    // levels holding dirty nodes
+    std::vector<std::uint8_t> m_levelDirty{};
+
+    // handle -> dense index, -1 for free handles
+    std::vector<int> m_indices{};
+    std::vector<SceneGraphN::Handle> m_freeHandles{};
+
+    std::size_t m_updatedCount{0};
+    // world transforms changed since the last storePreviousTransforms()
+    bool m_worldChanged{false};
+
+    [[nodiscard]] std::size_t getLevelEnd(std::size_t level) const;
+    [[nodiscard]] std::size_t getLevel(std::size_t index) const;
+    void markDirty(std::size_t index);
+    // recompute world transforms of the dirty nodes in [begin, end), returns the number of recomputed nodes
+    std::size_t updateRange(std::size_t begin, std::size_t end);
+};
+
+#endif
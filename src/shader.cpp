@@ -1,5 +1,6 @@
 #include <glad/glad.h>
 
+#include "glext.hpp"
 #include "shader.hpp"
 #include "util.hpp"
 
@@ -148,6 +149,66 @@ bool Shader::loadFromFile(const char* fragPath, const char* vertPath)
     return shaderSuccess;
 }
 
+bool Shader::loadComputeFromFile(const char* compPath)
+{
+    std::string compCode;
+    std::ifstream compFile;
+    compFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        compFile.open(compPath);
+        std::stringstream compStream;
+        compStream << compFile.rdbuf();
+        compFile.close();
+        compCode = compStream.str();
+    }
+    catch ([[maybe_unused]] std::ifstream::failure& e)
+    {
+        Util::beginError();
+        std::cout << "SHADER::LOAD_COMPUTE_FROM_FILE::ERROR: Could not read source file `" << compPath << "`";
+        Util::endError();
+        return false;
+    }
+
+    const char* cShaderCode{compCode.c_str()};
+    int success;
+    char infoLog[512]; // for errors
+
+    const unsigned int compute{glCreateShader(GLExtN::COMPUTE_SHADER)};
+    glShaderSource(compute, 1, &cShaderCode, nullptr);
+    glCompileShader(compute);
+    glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        Util::beginError();
+        glGetShaderInfoLog(compute, 512, nullptr, infoLog);
+        std::cout << "SHADER::LOAD_COMPUTE_FROM_FILE::ERROR: Compute shader compilation failed." << std::endl
+                  << infoLog;
+        Util::endError();
+        glDeleteShader(compute);
+        return false;
+    }
+
+    const unsigned int id{glCreateProgram()};
+    glAttachShader(id, compute);
+    glLinkProgram(id);
+    glDeleteShader(compute);
+    glGetProgramiv(id, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        Util::beginError();
+        glGetProgramInfoLog(id, 512, nullptr, infoLog);
+        std::cout << "SHADER::LOAD_COMPUTE_FROM_FILE::ERROR: Shader linking failed." << std::endl << infoLog;
+        Util::endError();
+        glDeleteProgram(id);
+        return false;
+    }
+
+    m_ID = id;
+    std::cout << "Loaded *" << m_shaderName << "* compute shader from file: `" << compPath << "`\n";
+    return true;
+}
+
 void Shader::use() const { glUseProgram(m_ID); }
 
 // initialize all samplers to avoid different type samplers using the same texture
@@ -174,6 +235,9 @@ void Shader::initializeSamplers(const unsigned int id) const
         case (GL_SAMPLER_2D):
         case (GL_SAMPLER_3D):
         case (GL_SAMPLER_CUBE):
+        case (GL_SAMPLER_2D_ARRAY):
+        case (GL_SAMPLER_BUFFER):
+        case (GL_UNSIGNED_INT_SAMPLER_BUFFER):
             {
                 // get uniform location
                 GLint texLoc{glGetUniformLocation(id, name)};
@@ -264,6 +328,11 @@ void Shader::setMat4(const std::string& name, const glm::mat4& value) const
     glUniformMatrix4fv(glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &value[0][0]);
 }
 
+void Shader::setMat4Array(const std::string& name, const glm::mat4* values, const int count) const
+{
+    glUniformMatrix4fv(glGetUniformLocation(m_ID, name.c_str()), count, GL_FALSE, &values[0][0][0]);
+}
+
 // ------ Shader manager ------
 ShaderManager::ShaderManager(EngineObject* parent) : EngineObject{"ShaderManager", parent} {}
 
@@ -288,6 +357,20 @@ void ShaderManager::addShader(const std::string& name, const char* fragPath, con
     getShader(name)->loadFromFile(fragPath, vertPath);
 }
 
+void ShaderManager::addComputeShader(const std::string& name, const char* compPath, Arena* arena)
+{
+    Shader* shader{new Shader{name, this}};
+    arena->addObject(shader);
+    if (!shader->loadComputeFromFile(compPath))
+    {
+        Util::beginError();
+        std::cout << "SHADER_MANAGER::ADD_COMPUTE_SHADER::ERROR: Failed to add shader `" << name << "`";
+        Util::endError();
+        return;
+    }
+    m_shaders.insert(std::pair{name, shader});
+}
+
 Shader* ShaderManager::getShader(const std::string& name) const
 {
     if (shaderExists(name))
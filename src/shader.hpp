@@ -16,6 +16,8 @@ public:
     ~Shader() override;
 
     bool loadFromFile(const char* fragPath, const char* vertPath);
+    // compute program, only call when GLExtN::hasCompute()
+    bool loadComputeFromFile(const char* compPath);
 
     void use() const;
 
@@ -42,6 +44,8 @@ public:
     void setMat2(const std::string& name, const glm::mat2& value) const;
     void setMat3(const std::string& name, const glm::mat3& value) const;
     void setMat4(const std::string& name, const glm::mat4& value) const;
+    // count matrices of a uniform array, from its first element on
+    void setMat4Array(const std::string& name, const glm::mat4* values, int count) const;
 
     [[nodiscard]] std::string_view getShaderName() const { return m_shaderName; }
 
@@ -57,6 +61,7 @@ public:
 
     // load new shader
     void addShader(const std::string& name, const char* fragPath, const char* vertPath, Arena* arena);
+    void addComputeShader(const std::string& name, const char* compPath, Arena* arena);
 
     [[nodiscard]] Shader* getShader(const std::string& name) const;
 
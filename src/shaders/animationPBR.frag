@@ -1,6 +1,8 @@
 #version 410 core
 
 out vec4 FragColor;
+// screen space motion since the last frame in uv, only kept when the pass binds a second render target
+layout(location = 1) out vec2 Velocity;
 
 in VS_OUT
 {
@@ -10,6 +12,8 @@ in VS_OUT
     vec3 TangentViewPos;
     vec3 TangentFragPos;
     mat3 TBN;
+    vec4 CurrentClip;
+    vec4 PreviousClip;
 }
 fs_in;
 
@@ -17,13 +21,35 @@ uniform vec3 lightColor;
 
 // textures
 uniform sampler2D albedoMap;
-uniform sampler2D metallicMap;
-uniform sampler2D roughnessMap;
 uniform sampler2D aoMap;
+uniform sampler2D ormMap; // occlusion (r), roughness (g), metallic (b)
 uniform sampler2D normalMap;
 
+// scalar factors of the bound material (MaterialLibrary)
+layout(std140) uniform MaterialFactors
+{
+    vec4 baseColorFactor;
+    vec4 materialFactors; // metallic, roughness, normal scale, occlusion from ormMap (1) or aoMap (0)
+};
+
+// packed materials (MaterialArrays), materialIndex < 0 samples the maps above
+uniform int materialIndex;
+uniform sampler2DArray albedoArray;
+uniform sampler2DArray aoArray;
+uniform sampler2DArray ormArray;
+uniform sampler2DArray normalArray;
+// layers of albedo, ao, orm & normal (-1 = slot unused)
+layout(std140) uniform Materials
+{
+    ivec4 materialLayers[256];
+};
+
 // IBL
-uniform samplerCube irradianceMap;
+// diffuse irradiance / PI as L2 spherical harmonics (rgb, see SHN::Irradiance)
+layout(std140) uniform IrradianceSH
+{
+    vec4 irradianceSH[9];
+};
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
 
@@ -32,6 +58,16 @@ uniform vec3 lightPos;
 
 const float PI = 3.14159265359;
 
+vec3 shIrradiance(vec3 n)
+{
+    vec3 result = irradianceSH[0].rgb
+        + irradianceSH[1].rgb * n.y + irradianceSH[2].rgb * n.z + irradianceSH[3].rgb * n.x
+        + irradianceSH[4].rgb * (n.x * n.y) + irradianceSH[5].rgb * (n.y * n.z)
+        + irradianceSH[6].rgb * (3.0 * n.z * n.z - 1.0) + irradianceSH[7].rgb * (n.x * n.z)
+        + irradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
 // F0 = surface reflection at zero incidence
 vec3 fresnelSchlick(float cosTheta, vec3 F0, float roughness)
 {
@@ -82,16 +118,27 @@ float geomSmith(vec3 norm, vec3 view, vec3 light, float roughness)
     return ggx1 * ggx2;
 }
 
+// slot order matches MeshN::TextureType, unused slots of packed materials return neutral
+vec4 sampleMaterial(sampler2D map, sampler2DArray pages, int slot, vec4 neutral)
+{
+    if (materialIndex < 0)
+        return texture(map, fs_in.TexCoords);
+    int layer = materialLayers[materialIndex][slot];
+    return layer < 0 ? neutral : texture(pages, vec3(fs_in.TexCoords, float(layer)));
+}
+
 void main()
 {
     // albedo with g.c
-    vec3 albedo = pow(texture(albedoMap, fs_in.TexCoords).rgb, vec3(2.2));
-    float metallic = texture(metallicMap, fs_in.TexCoords).r;
-    float roughness = texture(roughnessMap, fs_in.TexCoords).r;
-    float ao = texture(aoMap, fs_in.TexCoords).r;
-
-    vec3 norm = texture(normalMap, fs_in.TexCoords).rgb;
-    norm = normalize(norm * 2.0 - 1.0); // normal in tangent space
+    vec4 orm = sampleMaterial(ormMap, ormArray, 2, vec4(1.0));
+    vec3 albedo = pow(sampleMaterial(albedoMap, albedoArray, 0, vec4(1.0)).rgb, vec3(2.2)) * baseColorFactor.rgb;
+    float metallic = orm.b * materialFactors.x;
+    float roughness = orm.g * materialFactors.y;
+    float ao = materialFactors.w > 0.5 ? orm.r : sampleMaterial(aoMap, aoArray, 1, vec4(1.0)).r;
+
+    // normal in tangent space, z is rebuilt so two channel (BC5) normal maps work too
+    vec2 normXY = (sampleMaterial(normalMap, normalArray, 3, vec4(0.5, 0.5, 1.0, 1.0)).rg * 2.0 - 1.0) * materialFactors.z;
+    vec3 norm = normalize(vec3(normXY, sqrt(max(1.0 - dot(normXY, normXY), 0.0))));
     // norm = Normal;
     vec3 V = normalize(fs_in.TangentViewPos - fs_in.TangentFragPos);
 
@@ -144,11 +191,12 @@ void main()
     vec2 brdf = texture(brdfLUT, vec2(max(dot(normWS, viewWS), 0.0), roughness)).rg;
     vec3 spec = prefilteredColor * (fresnel * brdf.x + brdf.y);
 
-    vec3 irradiance = texture(irradianceMap, normWS).rgb;
+    vec3 irradiance = shIrradiance(normWS);
     vec3 diffuse = irradiance * albedo;
     vec3 ambient = (diffuse * kD + spec) * ao;
     // final color
     vec3 color = ambient + Lo;
 
     FragColor = vec4(color, 1.0);
+    Velocity = (fs_in.CurrentClip.xy / fs_in.CurrentClip.w - fs_in.PreviousClip.xy / fs_in.PreviousClip.w) * 0.5;
 }
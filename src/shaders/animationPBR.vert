@@ -16,6 +16,9 @@ out VS_OUT
     vec3 TangentViewPos;
     vec3 TangentFragPos;
     mat3 TBN;
+    // unjittered clip positions of this & the previous frame for the velocity
+    vec4 CurrentClip;
+    vec4 PreviousClip;
 }
 vs_out;
 
@@ -25,6 +28,11 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 normalMat;
 
+// motion vectors
+uniform mat4 currentViewProjection;
+uniform mat4 previousViewProjection;
+uniform mat4 previousModel;
+
 // for normal mapping
 uniform vec3 lightPos;
 uniform vec3 viewPos;
@@ -32,11 +40,14 @@ uniform vec3 viewPos;
 const int MAX_BONES = 100;
 const int MAX_BONE_INFLUENCE = 4;
 uniform mat4 finalBonesMatrices[MAX_BONES];
+// the pose of the previous frame, for skinned motion
+uniform mat4 previousBonesMatrices[MAX_BONES];
 
 void main()
 {
     // calculate bone influence
     vec4 totalPosition = vec4(0.0);
+    vec4 previousPosition = vec4(0.0);
     vec3 localNormal = aNormal;
     for (uint i = 0; i < MAX_BONE_INFLUENCE; ++i)
     {
@@ -45,11 +56,13 @@ void main()
 	if (aBoneIDs[i] >= MAX_BONES)
 	{
 	    totalPosition = vec4(aPos, 1.0);
+	    previousPosition = vec4(aPos, 1.0);
 	    break;
 	}
 	
 	vec4 localPosition = finalBonesMatrices[aBoneIDs[i]] * vec4(aPos, 1.0);
 	totalPosition += localPosition * aWeights[i];
+	previousPosition += previousBonesMatrices[aBoneIDs[i]] * vec4(aPos, 1.0) * aWeights[i];
 	localNormal = mat3(finalBonesMatrices[aBoneIDs[i]]) * aNormal;
     }
 
@@ -71,5 +84,8 @@ void main()
     vs_out.TangentFragPos = TBN * vs_out.FragPos;
     vs_out.TBN = TBN;
 
+    vs_out.CurrentClip = currentViewProjection * model * totalPosition;
+    vs_out.PreviousClip = previousViewProjection * previousModel * previousPosition;
+
     gl_Position = projection * view * model * totalPosition;
 }
@@ -1,4 +1,5 @@
-// Post processing shader that applies HDR and gamma correction.
+// Composite of the frame in a single pass over the hdr scene: upscale & sharpening, bloom, exposure, tone mapping,
+// gamma correction, 3D LUT color grading and dithering.
 
 #version 410 core
 
@@ -11,6 +12,28 @@ uniform sampler2D screenTexture;
 uniform sampler2D bloomBlur;
 uniform float bloomStrength = 0.04f;
 
+// compute bloom leaves the last upsample step to this shader: bloomBlur then only holds the downsampled first mip
+// and bloomUpSample the blurred second one
+uniform bool fusedUpSample = false;
+uniform sampler2D bloomUpSample;
+uniform float filterRadius;
+
+// dynamic resolution: the scene only covers sceneUVScale of its texture and is upscaled here, sharpening brings back
+// some of what the bilinear filter blurs
+uniform vec2 sceneUVScale = vec2(1.0);
+uniform vec2 sceneTexelSize;
+uniform float sharpness = 0.0;
+
+// manual exposure, times the adapted one in exposureTexture with auto exposure
+uniform float exposure = 1.0;
+uniform bool autoExposure = false;
+uniform sampler2D exposureTexture;
+
+// grading of the tone mapped, gamma encoded color, lutSize lattice points per axis
+uniform bool colorGrading = false;
+uniform sampler3D gradingLUT;
+uniform float lutSize;
+
 const float gamma = 2.2;
 
 // https://github.com/KhronosGroup/ToneMapping/tree/main/PBR_Neutral
@@ -35,22 +58,84 @@ vec3 PBRNeutralToneMapping(vec3 color)
     return mix(color, newPeak * vec3(1, 1, 1), g);
 }
 
+// same 9 tap tent as upSample.frag
+vec3 upSample(vec2 uv)
+{
+    float x = filterRadius;
+    float y = filterRadius;
+
+    vec3 a = texture(bloomUpSample, vec2(uv.x - x, uv.y + y)).rgb;
+    vec3 b = texture(bloomUpSample, vec2(uv.x, uv.y + y)).rgb;
+    vec3 c = texture(bloomUpSample, vec2(uv.x + x, uv.y + y)).rgb;
+
+    vec3 d = texture(bloomUpSample, vec2(uv.x - x, uv.y)).rgb;
+    vec3 e = texture(bloomUpSample, vec2(uv.x, uv.y)).rgb;
+    vec3 f = texture(bloomUpSample, vec2(uv.x + x, uv.y)).rgb;
+
+    vec3 g = texture(bloomUpSample, vec2(uv.x - x, uv.y - y)).rgb;
+    vec3 h = texture(bloomUpSample, vec2(uv.x, uv.y - y)).rgb;
+    vec3 i = texture(bloomUpSample, vec2(uv.x + x, uv.y - y)).rgb;
+
+    vec3 result = e * 4.0;
+    result += (b + d + f + h) * 2.0;
+    result += (a + c + g + i);
+    return result * 0.0625;
+}
+
+vec3 scene(vec2 uv)
+{
+    // texels past the rendered region are left over from other resolutions
+    vec2 uvMax = sceneUVScale - 0.5 * sceneTexelSize;
+    vec2 sceneUV = min(uv * sceneUVScale, uvMax);
+    vec3 center = texture(screenTexture, sceneUV).rgb;
+    if (sharpness <= 0.0)
+        return center;
+
+    vec3 n = texture(screenTexture, min(sceneUV + vec2(0.0, sceneTexelSize.y), uvMax)).rgb;
+    vec3 s = texture(screenTexture, sceneUV - vec2(0.0, sceneTexelSize.y)).rgb;
+    vec3 e = texture(screenTexture, min(sceneUV + vec2(sceneTexelSize.x, 0.0), uvMax)).rgb;
+    vec3 w = texture(screenTexture, sceneUV - vec2(sceneTexelSize.x, 0.0)).rgb;
+
+    // unsharp mask, clamped to the neighbourhood so edges don't ring
+    vec3 sharpened = center + (4.0 * center - (n + s + e + w)) * (0.25 * sharpness);
+    return clamp(sharpened, min(center, min(min(n, s), min(e, w))), max(center, max(max(n, s), max(e, w))));
+}
+
 vec3 bloom()
 {
-    vec3 hdrColor = texture(screenTexture, TexCoords).rgb;
+    vec3 hdrColor = scene(TexCoords);
     vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
+    if (fusedUpSample)
+        bloomColor += upSample(TexCoords);
     return mix(hdrColor, bloomColor, bloomStrength);
 }
 
+// in [0, 1)
+float hash(vec2 p)
+{
+    vec3 p3 = fract(vec3(p.xyx) * 0.1031);
+    p3 += dot(p3, p3.yzx + 33.33);
+    return fract((p3.x + p3.y) * p3.z);
+}
+
 void main()
 {
-    vec3 hdrColor = bloom(); 
+    vec3 hdrColor = bloom() * exposure;
+    if (autoExposure)
+        hdrColor *= texelFetch(exposureTexture, ivec2(0), 0).r;
 
     // Khronos PBR neutral note mapping
     vec3 mapped = PBRNeutralToneMapping(hdrColor);
 
     // gamma correction
-    mapped = pow(mapped, vec3(1.0 / gamma));
+    mapped = clamp(pow(mapped, vec3(1.0 / gamma)), 0.0, 1.0);
+
+    // lattice points sit at texel centers
+    if (colorGrading)
+        mapped = texture(gradingLUT, mapped * ((lutSize - 1.0) / lutSize) + 0.5 / lutSize).rgb;
+
+    // triangular noise of one 8 bit step hides the banding of smooth gradients
+    mapped += (hash(gl_FragCoord.xy) - hash(gl_FragCoord.xy + vec2(17.0, 59.0))) / 255.0;
 
     FragColor = vec4(mapped, 1.0);
 }
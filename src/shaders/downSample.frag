@@ -6,6 +6,9 @@ layout(location = 0) out vec3 downSample;
 uniform sampler2D tex;
 uniform vec2 srcResolution;
 uniform int mipLevel;
+// the source may only cover part of its texture (dynamic resolution), taps past that region are clamped to it
+uniform vec2 srcUVScale = vec2(1.0);
+uniform vec2 srcUVMax = vec2(1.0);
 
 vec3 PowVec3(vec3 v, float p)
 {
@@ -27,29 +30,35 @@ float KarisAverage(vec3 col)
     return 1.0f / (1.0f + luma);
 }
 
+vec3 source(vec2 uv)
+{
+    return texture(tex, min(uv, srcUVMax)).rgb;
+}
+
 void main()
 {
+    vec2 uv = TexCoord * srcUVScale;
     vec2 srcTexelSize = 1.0 / srcResolution;
     float x = srcTexelSize.x;
     float y = srcTexelSize.y;
     
     // take 13 samples around current texel
-    vec3 a = texture(tex, vec2(TexCoord.x - 2 * x, TexCoord.y + 2 * y)).rgb;
-    vec3 b = texture(tex, vec2(TexCoord.x, TexCoord.y + 2 * y)).rgb;
-    vec3 c = texture(tex, vec2(TexCoord.x + 2 * x, TexCoord.y + 2 * y)).rgb; 
+    vec3 a = source(vec2(uv.x - 2 * x, uv.y + 2 * y));
+    vec3 b = source(vec2(uv.x, uv.y + 2 * y));
+    vec3 c = source(vec2(uv.x + 2 * x, uv.y + 2 * y)); 
 
-    vec3 d = texture(tex, vec2(TexCoord.x - 2 * x, TexCoord.y)).rgb;
-    vec3 e = texture(tex, vec2(TexCoord.x, TexCoord.y)).rgb;
-    vec3 f = texture(tex, vec2(TexCoord.x + 2 * x, TexCoord.y)).rgb; 
+    vec3 d = source(vec2(uv.x - 2 * x, uv.y));
+    vec3 e = source(vec2(uv.x, uv.y));
+    vec3 f = source(vec2(uv.x + 2 * x, uv.y)); 
 
-    vec3 g = texture(tex, vec2(TexCoord.x - 2 * x, TexCoord.y - 2 * y)).rgb;
-    vec3 h = texture(tex, vec2(TexCoord.x, TexCoord.y - 2 * y)).rgb;
-    vec3 i = texture(tex, vec2(TexCoord.x + 2 * x, TexCoord.y - 2 * y)).rgb; 
+    vec3 g = source(vec2(uv.x - 2 * x, uv.y - 2 * y));
+    vec3 h = source(vec2(uv.x, uv.y - 2 * y));
+    vec3 i = source(vec2(uv.x + 2 * x, uv.y - 2 * y)); 
 
-    vec3 j = texture(tex, vec2(TexCoord.x - x, TexCoord.y + y)).rgb;
-    vec3 k = texture(tex, vec2(TexCoord.x + x, TexCoord.y + y)).rgb;
-    vec3 l = texture(tex, vec2(TexCoord.x - x, TexCoord.y - y)).rgb; 
-    vec3 m = texture(tex, vec2(TexCoord.x + x, TexCoord.y - y)).rgb; 
+    vec3 j = source(vec2(uv.x - x, uv.y + y));
+    vec3 k = source(vec2(uv.x + x, uv.y + y));
+    vec3 l = source(vec2(uv.x - x, uv.y - y)); 
+    vec3 m = source(vec2(uv.x + x, uv.y - y)); 
 
     // apply weighted distrobution
     vec3 groups[5];
@@ -0,0 +1,43 @@
+// Auto exposure without compute shaders: the mean of the exposureLuminance.frag grid sets the target exposure, the
+// stored one moves toward it over time. Rendered to a single texel.
+
+#version 410 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D luminance;
+uniform sampler2D previousExposure;
+
+uniform float keyValue;
+uniform float minExposure;
+uniform float maxExposure;
+// share of the way to the target covered this frame, toward a lower (brighter scene) & a higher exposure
+uniform float adaptBrighten;
+uniform float adaptDarken;
+uniform bool historyValid;
+
+float adapt(float target)
+{
+    float current = texelFetch(previousExposure, ivec2(0), 0).r;
+    if (!historyValid || current <= 0.0)
+        return target;
+    float rate = target < current ? adaptBrighten : adaptDarken;
+    return exp2(mix(log2(current), log2(target), rate));
+}
+
+void main()
+{
+    ivec2 size = textureSize(luminance, 0);
+    float sum = 0.0;
+    for (int y = 0; y < size.y; ++y)
+    {
+        for (int x = 0; x < size.x; ++x)
+            sum += texelFetch(luminance, ivec2(x, y), 0).r;
+    }
+    float averageLogLuminance = sum / float(size.x * size.y);
+
+    float target = clamp(keyValue / exp2(averageLogLuminance), minExposure, maxExposure);
+    FragColor = vec4(adapt(target), 0.0, 0.0, 1.0);
+}
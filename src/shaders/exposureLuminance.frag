@@ -0,0 +1,35 @@
+// Auto exposure without compute shaders: every texel of the small output holds the average log luminance of its
+// tile of the scene, from a 4x4 grid of bilinear taps.
+
+#version 410 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sceneColor;
+// the scene covers sceneUVScale of its texture (dynamic resolution)
+uniform vec2 sceneUVScale;
+// output texels per side
+uniform float gridSize;
+
+uniform float minLogLuminance;
+uniform float maxLogLuminance;
+
+void main()
+{
+    vec2 tile = sceneUVScale / gridSize;
+    vec2 origin = floor(gl_FragCoord.xy) * tile;
+
+    float sum = 0.0;
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            vec3 color = texture(sceneColor, origin + (vec2(x, y) + 0.5) * 0.25 * tile).rgb;
+            float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+            sum += clamp(log2(max(luminance, 1e-5)), minLogLuminance, maxLogLuminance);
+        }
+    }
+    FragColor = vec4(sum / 16.0, 0.0, 0.0, 1.0);
+}
@@ -5,6 +5,10 @@ in vec3 localPos;
 
 uniform samplerCube environmentMap;
 uniform float roughness;
+// filtered importance sampling: every sample reads the environment mip whose texels cover its share of the lobe,
+// so a few dozen samples give what thousands of base level samples would
+uniform int sampleCount;
+uniform float envResolution; // base level face size
 
 const float PI = 3.14159265359;
 // ----------------------------------------------------------------------------
@@ -67,7 +71,7 @@ void main()
     vec3 R = N;
     vec3 V = R;
 
-    const uint SAMPLE_COUNT = 4096u;
+    uint SAMPLE_COUNT = uint(max(sampleCount, 1));
     vec3 prefilteredColor = vec3(0.0);
     float totalWeight = 0.0;
 
@@ -85,12 +89,12 @@ void main()
             float HdotV = max(dot(H, V), 0.0);
             float pdf = D * NdotH / (4.0 * HdotV) + 0.0001; 
 
-            const float resolution = 512.0;
-	    float saTexel  = 4.0 * PI / (6.0 * resolution * resolution);
+            float saTexel  = 4.0 * PI / (6.0 * envResolution * envResolution);
             float saSample = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.0001);
 
-            float mipLevel = roughness == 0.0 ? 0.0 : 0.5 * log2(saSample / saTexel); 
-	    mipLevel = max(0.0, mipLevel);
+            // +1 level: the sample footprint overlaps its neighbours (Colbert & Krivanek, GPU Gems 3 ch. 20)
+            float mipLevel = roughness == 0.0 ? 0.0 : 0.5 * log2(saSample / saTexel) + 1.0;
+            mipLevel = max(0.0, mipLevel);
             
             prefilteredColor += textureLod(environmentMap, L, mipLevel).rgb * NdotL;
             totalWeight += NdotL;
@@ -0,0 +1,99 @@
+// Temporal anti-aliasing resolve: the jittered low resolution scene is accumulated into the full resolution history.
+
+#version 410 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sceneColor;
+uniform sampler2D sceneDepth;
+uniform sampler2D velocity;
+uniform sampler2D history;
+
+// the scene covers sceneUVScale of its textures (dynamic resolution)
+uniform vec2 sceneUVScale;
+uniform vec2 sceneTexelSize;
+// projection offset of this frame in ndc
+uniform vec2 jitter;
+
+uniform bool historyValid;
+// weight of the new frame
+uniform float blendFactor;
+
+// reprojection of the background, nothing writes its velocity
+uniform mat4 inverseViewProjection;
+uniform mat4 previousViewProjection;
+
+vec3 RGBToYCoCg(vec3 c)
+{
+    return vec3(0.25 * c.r + 0.5 * c.g + 0.25 * c.b, 0.5 * c.r - 0.5 * c.b, -0.25 * c.r + 0.5 * c.g - 0.25 * c.b);
+}
+
+vec3 YCoCgToRGB(vec3 c)
+{
+    return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+float luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main()
+{
+    vec2 uvMin = 0.5 * sceneTexelSize;
+    vec2 uvMax = sceneUVScale - 0.5 * sceneTexelSize;
+    // the jitter moved the image by half of it in uv, undo that to sample where this pixel's center was rendered
+    vec2 sceneUV = clamp((TexCoords + 0.5 * jitter) * sceneUVScale, uvMin, uvMax);
+
+    // 3x3 neighbourhood of the new samples: color bounds & the closest depth, whose velocity is used so edges of
+    // moving objects carry their motion
+    vec3 current = texture(sceneColor, sceneUV).rgb;
+    vec3 minColor = vec3(1e30);
+    vec3 maxColor = vec3(-1e30);
+    float closestDepth = 1.0;
+    vec2 closestUV = sceneUV;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            vec2 uv = clamp(sceneUV + vec2(x, y) * sceneTexelSize, uvMin, uvMax);
+            vec3 c = RGBToYCoCg(texture(sceneColor, uv).rgb);
+            minColor = min(minColor, c);
+            maxColor = max(maxColor, c);
+            float depth = texture(sceneDepth, uv).r;
+            if (depth < closestDepth)
+            {
+                closestDepth = depth;
+                closestUV = uv;
+            }
+        }
+    }
+
+    vec2 motion = texture(velocity, closestUV).rg;
+    if (closestDepth >= 1.0)
+    {
+        // background only moves with the camera
+        vec4 world = inverseViewProjection * vec4(TexCoords * 2.0 - 1.0, 1.0, 1.0);
+        vec4 previous = previousViewProjection * vec4(world.xyz / world.w, 1.0);
+        motion = TexCoords - (previous.xy / previous.w * 0.5 + 0.5);
+    }
+
+    vec2 historyUV = TexCoords - motion;
+    float alpha = blendFactor;
+    vec3 result = current;
+    if (historyValid && all(greaterThanEqual(historyUV, vec2(0.0))) && all(lessThanEqual(historyUV, vec2(1.0))))
+    {
+        // history outside the new samples' bounds belongs to something that is no longer there
+        vec3 previousColor = texture(history, historyUV).rgb;
+        previousColor = YCoCgToRGB(clamp(RGBToYCoCg(previousColor), minColor, maxColor));
+
+        // weighted by inverse luminance so single bright samples don't flicker
+        float currentWeight = alpha / (1.0 + luminance(current));
+        float historyWeight = (1.0 - alpha) / (1.0 + luminance(previousColor));
+        result = (current * currentWeight + previousColor * historyWeight) / (currentWeight + historyWeight);
+    }
+
+    FragColor = vec4(max(result, vec3(0.0)), 1.0);
+}
@@ -1,6 +1,8 @@
 #version 410 core
 
 out vec4 FragColor;
+// screen space motion since the last frame in uv, only kept when the pass binds a second render target
+layout(location = 1) out vec2 Velocity;
 
 in VS_OUT
 {
@@ -10,6 +12,8 @@ in VS_OUT
     vec3 TangentViewPos;
     vec3 TangentFragPos;
     mat3 TBN;
+    vec4 CurrentClip;
+    vec4 PreviousClip;
 }
 fs_in;
 
@@ -17,21 +21,64 @@ uniform vec3 lightColor;
 
 // textures
 uniform sampler2D albedoMap;
-uniform sampler2D metallicMap;
-uniform sampler2D roughnessMap;
 uniform sampler2D aoMap;
+uniform sampler2D ormMap; // occlusion (r), roughness (g), metallic (b)
 uniform sampler2D normalMap;
 
+// scalar factors of the bound material (MaterialLibrary)
+layout(std140) uniform MaterialFactors
+{
+    vec4 baseColorFactor;
+    vec4 materialFactors; // metallic, roughness, normal scale, occlusion from ormMap (1) or aoMap (0)
+};
+
+// packed materials (MaterialArrays), materialIndex < 0 samples the maps above
+uniform int materialIndex;
+uniform sampler2DArray albedoArray;
+uniform sampler2DArray aoArray;
+uniform sampler2DArray ormArray;
+uniform sampler2DArray normalArray;
+// layers of albedo, ao, orm & normal (-1 = slot unused)
+layout(std140) uniform Materials
+{
+    ivec4 materialLayers[256];
+};
+
 // IBL
-uniform samplerCube irradianceMap;
+// diffuse irradiance / PI as L2 spherical harmonics (rgb, see SHN::Irradiance)
+layout(std140) uniform IrradianceSH
+{
+    vec4 irradianceSH[9];
+};
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
 
+// clustered point & spot lights in world space (ClusteredLighting)
+uniform bool clusteredLights;
+uniform samplerBuffer lightData; // (position, range), (color, spot scale), (direction, spot offset) per light
+uniform usamplerBuffer clusterGrid; // first index & light count per cluster
+uniform usamplerBuffer clusterIndices;
+uniform vec2 clusterTileScale; // tiles per pixel of the scene target
+// depth slice = log2(view depth) * scale + bias
+uniform float clusterSliceScale;
+uniform float clusterSliceBias;
+const ivec3 CLUSTERS = ivec3(16, 9, 24); // ClusteredLightingN::CLUSTER_X, CLUSTER_Y & CLUSTER_Z
+
 uniform vec3 viewPos;
 uniform vec3 lightPos;
 
 const float PI = 3.14159265359;
 
+vec3 shIrradiance(vec3 n)
+{
+    vec3 result = irradianceSH[0].rgb
+        + irradianceSH[1].rgb * n.y + irradianceSH[2].rgb * n.z + irradianceSH[3].rgb * n.x
+        + irradianceSH[4].rgb * (n.x * n.y) + irradianceSH[5].rgb * (n.y * n.z)
+        + irradianceSH[6].rgb * (3.0 * n.z * n.z - 1.0) + irradianceSH[7].rgb * (n.x * n.z)
+        + irradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
 // F0 = surface reflection at zero incidence
 vec3 fresnelSchlick(float cosTheta, vec3 F0, float roughness)
 {
@@ -82,20 +129,71 @@ float geomSmith(vec3 norm, vec3 view, vec3 light, float roughness)
     return ggx1 * ggx2;
 }
 
+// Cook-Torrance over the lights of this fragment's cluster
+vec3 clusteredRadiance(vec3 N, vec3 V, vec3 albedo, float metallic, float roughness, vec3 F0)
+{
+    // the lights fade out to zero at their range, so the jitter moving a fragment across a tile edge doesn't show
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterTileScale), CLUSTERS.xy - 1);
+    // gl_FragCoord.w is 1 / view depth with a perspective projection
+    int slice = clamp(int(log2(1.0 / gl_FragCoord.w) * clusterSliceScale + clusterSliceBias), 0, CLUSTERS.z - 1);
+    uvec2 range = texelFetch(clusterGrid, tile.x + CLUSTERS.x * (tile.y + CLUSTERS.y * slice)).rg;
+
+    vec3 Lo = vec3(0.0);
+    for (uint i = 0u; i < range.y; ++i)
+    {
+        int light = int(texelFetch(clusterIndices, int(range.x + i)).r) * 3; // ClusteredLightingN::LIGHT_TEXELS
+        vec4 positionRange = texelFetch(lightData, light);
+        vec4 colorScale = texelFetch(lightData, light + 1);
+        vec4 directionOffset = texelFetch(lightData, light + 2);
+
+        vec3 toLight = positionRange.xyz - fs_in.FragPos;
+        float distance2 = max(dot(toLight, toLight), 0.0001);
+        vec3 L = toLight * inversesqrt(distance2);
+        float NdotL = max(dot(N, L), 0.0);
+        // inverse square, windowed to reach zero at the range
+        float ratio = distance2 / (positionRange.w * positionRange.w);
+        float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+        // cone falloff, point lights have scale 0 & offset 1
+        float spot = clamp(dot(-L, directionOffset.xyz) * colorScale.w + directionOffset.w, 0.0, 1.0);
+        float attenuation = window * window * spot * spot / distance2;
+        if (attenuation * NdotL <= 0.0)
+            continue;
+
+        vec3 H = normalize(V + L);
+        vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0, roughness);
+        vec3 specular = distroGGX(N, H, roughness) * geomSmith(N, V, L, roughness) * F
+            / (4.0 * max(dot(N, V), 0.0) * NdotL + 0.0001);
+        vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
+        Lo += (kD * albedo / PI + specular) * colorScale.rgb * attenuation * NdotL;
+    }
+    return Lo;
+}
+
+// slot order matches MeshN::TextureType, unused slots of packed materials return neutral
+vec4 sampleMaterial(sampler2D map, sampler2DArray pages, int slot, vec4 neutral)
+{
+    if (materialIndex < 0)
+        return texture(map, fs_in.TexCoords);
+    int layer = materialLayers[materialIndex][slot];
+    return layer < 0 ? neutral : texture(pages, vec3(fs_in.TexCoords, float(layer)));
+}
+
 void main()
 {
     // albedo with g.c
-    // vec3 albedo = pow(texture(albedoMap, fs_in.TexCoords).rgb, vec3(2.2));
-    // float metallic = texture(metallicMap, fs_in.TexCoords).r;
-    // float roughness = texture(roughnessMap, fs_in.TexCoords).r;
-    // float ao = texture(aoMap, fs_in.TexCoords).r;
+    // vec4 orm = sampleMaterial(ormMap, ormArray, 2, vec4(1.0));
+    // vec3 albedo = pow(sampleMaterial(albedoMap, albedoArray, 0, vec4(1.0)).rgb, vec3(2.2)) * baseColorFactor.rgb;
+    // float metallic = orm.b * materialFactors.x;
+    // float roughness = orm.g * materialFactors.y;
+    // float ao = materialFactors.w > 0.5 ? orm.r : sampleMaterial(aoMap, aoArray, 1, vec4(1.0)).r;
     vec3 albedo = vec3(1.0, 0.0, 0.0);
     float metallic = 1.0;
     float roughness = 0.2;
     float ao = 1.0;
 
-    vec3 norm = texture(normalMap, fs_in.TexCoords).rgb;
-    norm = normalize(norm * 2.0 - 1.0); // normal in tangent space
+    // normal in tangent space, z is rebuilt so two channel (BC5) normal maps work too
+    vec2 normXY = (sampleMaterial(normalMap, normalArray, 3, vec4(0.5, 0.5, 1.0, 1.0)).rg * 2.0 - 1.0) * materialFactors.z;
+    vec3 norm = normalize(vec3(normXY, sqrt(max(1.0 - dot(normXY, normXY), 0.0))));
     // norm = Normal;
     vec3 V = normalize(fs_in.TangentViewPos - fs_in.TangentFragPos);
 
@@ -148,11 +246,15 @@ void main()
     vec2 brdf = texture(brdfLUT, vec2(max(dot(normWS, viewWS), 0.0), roughness)).rg;
     vec3 spec = prefilteredColor * (fresnel * brdf.x + brdf.y);
 
-    vec3 irradiance = texture(irradianceMap, normWS).rgb;
+    if (clusteredLights)
+        Lo += clusteredRadiance(normWS, viewWS, albedo, metallic, roughness, F0);
+
+    vec3 irradiance = shIrradiance(normWS);
     vec3 diffuse = irradiance * albedo;
     vec3 ambient = (diffuse * kD + spec) * ao;
     // final color
     vec3 color = ambient + Lo;
 
     FragColor = vec4(color, 1.0);
+    Velocity = (fs_in.CurrentClip.xy / fs_in.CurrentClip.w - fs_in.PreviousClip.xy / fs_in.PreviousClip.w) * 0.5;
 }
@@ -14,6 +14,9 @@ out VS_OUT
     vec3 TangentViewPos;
     vec3 TangentFragPos;
     mat3 TBN;
+    // unjittered clip positions of this & the previous frame for the velocity
+    vec4 CurrentClip;
+    vec4 PreviousClip;
 }
 vs_out;
 
@@ -23,6 +26,11 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 normalMat;
 
+// motion vectors
+uniform mat4 currentViewProjection;
+uniform mat4 previousViewProjection;
+uniform mat4 previousModel;
+
 // for normal mapping
 uniform vec3 lightPos;
 uniform vec3 viewPos;
@@ -47,5 +55,8 @@ void main()
     vs_out.TangentFragPos = TBN * vs_out.FragPos;
     vs_out.TBN = TBN;
 
+    vs_out.CurrentClip = currentViewProjection * model * vec4(aPos, 1.0);
+    vs_out.PreviousClip = previousViewProjection * previousModel * vec4(aPos, 1.0);
+
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
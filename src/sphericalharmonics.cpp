@@ -0,0 +1,159 @@
+#include "sphericalharmonics.hpp"
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SPHERICAL_HARMONICS_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr double PI{3.14159265358979323846};
+    // red, green & blue sums per basis function
+    constexpr int SUM_COUNT{SHN::COEFFICIENT_COUNT * 3};
+
+    // normalization of every basis function
+    constexpr float BASIS[SHN::COEFFICIENT_COUNT]{0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f,
+                                                  1.092548f, 0.315392f, 1.092548f, 0.546274f};
+    // clamped cosine convolution per band over pi: 1, 2/3, 1/4
+    constexpr float COSINE[SHN::COEFFICIENT_COUNT]{1.0f,  2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f,
+                                                   0.25f, 0.25f,       0.25f,       0.25f};
+
+    // the polynomial terms, without the normalization
+    void getTerms(const float x, const float y, const float z, float* terms)
+    {
+        terms[0] = 1.0f;
+        terms[1] = y;
+        terms[2] = z;
+        terms[3] = x;
+        terms[4] = x * y;
+        terms[5] = y * z;
+        terms[6] = 3.0f * z * z - 1.0f;
+        terms[7] = x * z;
+        terms[8] = x * x - y * y;
+    }
+
+    // weighted radiance * terms of one row, added to sums
+    void projectRow(const float* rgb, const int width, const float* cosPhi, const float* sinPhi, const float y,
+                    const float cosTheta, const float weight, double* sums)
+    {
+        int x{0};
+        float terms[SHN::COEFFICIENT_COUNT]{};
+#ifdef SPHERICAL_HARMONICS_SSE
+        __m128 acc[SUM_COUNT];
+        for (__m128& value : acc)
+            value = _mm_setzero_ps();
+
+        const __m128 dirY{_mm_set1_ps(y)};
+        const __m128 rowCos{_mm_set1_ps(cosTheta)};
+        const __m128 one{_mm_set1_ps(1.0f)};
+        const __m128 three{_mm_set1_ps(3.0f)};
+        for (; x + 4 <= width; x += 4)
+        {
+            const __m128 dirX{_mm_mul_ps(rowCos, _mm_loadu_ps(cosPhi + x))};
+            const __m128 dirZ{_mm_mul_ps(rowCos, _mm_loadu_ps(sinPhi + x))};
+            const __m128 term[SHN::COEFFICIENT_COUNT]{
+                one,
+                dirY,
+                dirZ,
+                dirX,
+                _mm_mul_ps(dirX, dirY),
+                _mm_mul_ps(dirY, dirZ),
+                _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(dirZ, dirZ)), one),
+                _mm_mul_ps(dirX, dirZ),
+                _mm_sub_ps(_mm_mul_ps(dirX, dirX), _mm_mul_ps(dirY, dirY))};
+
+            const float* texel{rgb + static_cast<std::size_t>(x) * 3};
+            const __m128 color[3]{_mm_setr_ps(texel[0], texel[3], texel[6], texel[9]),
+                                  _mm_setr_ps(texel[1], texel[4], texel[7], texel[10]),
+                                  _mm_setr_ps(texel[2], texel[5], texel[8], texel[11])};
+            for (int k{0}; k < SHN::COEFFICIENT_COUNT; ++k)
+            {
+                for (int c{0}; c < 3; ++c)
+                    acc[k * 3 + c] = _mm_add_ps(acc[k * 3 + c], _mm_mul_ps(term[k], color[c]));
+            }
+        }
+
+        for (int i{0}; i < SUM_COUNT; ++i)
+        {
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, acc[i]);
+            sums[i] += (static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3]) * weight;
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            getTerms(cosTheta * cosPhi[x], y, cosTheta * sinPhi[x], terms);
+            const float* texel{rgb + static_cast<std::size_t>(x) * 3};
+            for (int k{0}; k < SHN::COEFFICIENT_COUNT; ++k)
+            {
+                for (int c{0}; c < 3; ++c)
+                    sums[k * 3 + c] += static_cast<double>(terms[k] * texel[c]) * weight;
+            }
+        }
+    }
+} // namespace
+
+SHN::Irradiance SHN::projectEquirect(const float* rgb, const int width, const int height, JobSystem* jobs)
+{
+    Irradiance irradiance{};
+    if (rgb == nullptr || width <= 0 || height <= 0)
+        return irradiance;
+
+    // u = atan(z, x) / 2pi + 0.5, so every column has a fixed azimuth
+    std::vector<float> cosPhi(width);
+    std::vector<float> sinPhi(width);
+    for (int x{0}; x < width; ++x)
+    {
+        const double phi{((x + 0.5) / width - 0.5) * 2.0 * PI};
+        cosPhi[x] = static_cast<float>(std::cos(phi));
+        sinPhi[x] = static_cast<float>(std::sin(phi));
+    }
+
+    // per row sums, added up in order afterwards so the result doesn't depend on the thread count
+    std::vector<double> rowSums(static_cast<std::size_t>(height) * SUM_COUNT, 0.0);
+    const double texelAngle{(2.0 * PI / width) * (PI / height)};
+    const auto func{[&](const std::size_t begin, const std::size_t end)
+    {
+        for (std::size_t row{begin}; row < end; ++row)
+        {
+            // v = asin(y) / pi + 0.5, a texel covers cos(latitude) * dlatitude * dazimuth
+            const double latitude{((row + 0.5) / height - 0.5) * PI};
+            const auto cosTheta{static_cast<float>(std::cos(latitude))};
+            projectRow(rgb + row * width * 3, width, cosPhi.data(), sinPhi.data(),
+                       static_cast<float>(std::sin(latitude)), cosTheta,
+                       static_cast<float>(cosTheta * texelAngle), &rowSums[row * SUM_COUNT]);
+        }
+    }};
+    if (jobs != nullptr)
+        jobs->parallelFor(static_cast<std::size_t>(height), ROW_GRAIN, func);
+    else
+        func(0, static_cast<std::size_t>(height));
+
+    double sums[SUM_COUNT]{};
+    for (int row{0}; row < height; ++row)
+    {
+        for (int i{0}; i < SUM_COUNT; ++i)
+            sums[i] += rowSums[static_cast<std::size_t>(row) * SUM_COUNT + i];
+    }
+
+    // projection & evaluation both multiply by the normalization
+    for (int k{0}; k < COEFFICIENT_COUNT; ++k)
+    {
+        const double scale{static_cast<double>(BASIS[k]) * BASIS[k] * COSINE[k]};
+        irradiance[k] = glm::vec3{sums[k * 3] * scale, sums[k * 3 + 1] * scale, sums[k * 3 + 2] * scale};
+    }
+    return irradiance;
+}
+
+glm::vec3 SHN::evaluate(const Irradiance& irradiance, const glm::vec3& n)
+{
+    float terms[COEFFICIENT_COUNT]{};
+    getTerms(n.x, n.y, n.z, terms);
+    glm::vec3 result{0.0f};
+    for (int k{0}; k < COEFFICIENT_COUNT; ++k)
+        result += irradiance[k] * terms[k];
+    return glm::max(result, glm::vec3{0.0f});
+}
@@ -0,0 +1,38 @@
+// Spherical harmonics diffuse irradiance.
+// The equirectangular environment is projected onto the 9 real SH basis functions up to band 2 (every texel weighted
+// by its solid angle) and convolved with the clamped cosine lobe. Nine RGB coefficients then give the irradiance for
+// any normal with a short polynomial, replacing the irradiance cubemap and its texture fetch. Rows are split across
+// the job system and 4 texels are projected at a time with SSE.
+
+#ifndef SPHERICAL_HARMONICS_H
+#define SPHERICAL_HARMONICS_H
+
+#include <array>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "jobs.hpp"
+
+namespace SHN
+{
+    constexpr int COEFFICIENT_COUNT{9};
+    // uniform buffer binding of the `IrradianceSH` block
+    constexpr unsigned int BUFFER_BINDING{3};
+    // rows per job
+    constexpr std::size_t ROW_GRAIN{8};
+
+    // irradiance / pi (what the PBR shaders multiply with albedo) for a unit normal n is
+    // c0 + c1 n.y + c2 n.z + c3 n.x + c4 n.x n.y + c5 n.y n.z + c6 (3 n.z^2 - 1) + c7 n.x n.z + c8 (n.x^2 - n.y^2)
+    // (basis constants & the cosine convolution are folded into the coefficients)
+    using Irradiance = std::array<glm::vec3, COEFFICIENT_COUNT>;
+
+    // rgb: width * height RGB float texels, bottom row first (like the flipped HDR loads), mapped to directions the
+    // same way as erCubeMapConvert.frag. jobs can be nullptr, everything runs on the calling thread then
+    [[nodiscard]] Irradiance projectEquirect(const float* rgb, int width, int height, JobSystem* jobs = nullptr);
+
+    // the polynomial above, for checking against a convolved map
+    [[nodiscard]] glm::vec3 evaluate(const Irradiance& irradiance, const glm::vec3& n);
+} // namespace SHN
+
+#endif
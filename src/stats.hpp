@@ -0,0 +1,19 @@
+// Per-frame render statistics, reset by Engine::update() and shown in the window title.
+
+#ifndef STATS_H
+#define STATS_H
+
+namespace StatsN
+{
+    struct FrameStats
+    {
+        unsigned int drawCalls{0}; // instances actually submitted
+        unsigned int visibleInstances{0}; // instances that passed frustum culling
+        unsigned int culledInstances{0}; // instances rejected by frustum culling
+        unsigned int occludedInstances{0}; // frustum visible instances rejected by occlusion culling
+        double cullTimeMs{0.0}; // cpu time spent culling instances
+        double submitTimeMs{0.0}; // cpu time spent submitting draws
+    };
+} // namespace StatsN
+
+#endif
@@ -0,0 +1,148 @@
+#include "temporalaa.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "engine.hpp"
+#include "util.hpp"
+
+float TemporalAAN::halton(unsigned int index, const unsigned int base)
+{
+    float fraction{1.0f};
+    float result{0.0f};
+    while (index > 0)
+    {
+        fraction /= static_cast<float>(base);
+        result += fraction * static_cast<float>(index % base);
+        index /= base;
+    }
+    return result;
+}
+
+TemporalAA::TemporalAA(EngineObject* parent) : EngineObject{"TemporalAA", parent} {}
+
+TemporalAA::~TemporalAA() { free(); }
+
+void TemporalAA::free()
+{
+    m_history = {};
+    m_historyDesc = {};
+    m_historyValid = false;
+    m_init = false;
+}
+
+void TemporalAA::releaseHistory()
+{
+    for (unsigned int& texture : m_history)
+    {
+        if (texture != 0)
+            m_pool->releasePersistent(texture);
+        texture = 0;
+    }
+    m_historyDesc = {};
+    m_historyValid = false;
+}
+
+bool TemporalAA::init(void* engine, RenderTargetPool* pool)
+{
+    if (m_init)
+        return true;
+
+    const Engine* enginePtr{static_cast<Engine*>(engine)};
+    m_resolveShader = enginePtr->getShader("taaResolve");
+    if (m_resolveShader == nullptr)
+    {
+        Util::beginError();
+        std::cout << "TEMPORAL_AA::INIT::ERROR: Could not find the resolve shader!";
+        Util::endError();
+        return false;
+    }
+
+    m_resolveShader->use();
+    m_resolveShader->setInt("sceneColor", 0);
+    m_resolveShader->setInt("sceneDepth", 1);
+    m_resolveShader->setInt("velocity", 2);
+    m_resolveShader->setInt("history", 3);
+    glUseProgram(0);
+
+    m_pool = pool;
+    m_init = true;
+    return true;
+}
+
+glm::vec2 TemporalAA::nextJitter(const glm::ivec2& renderSize, const glm::ivec2& outputSize)
+{
+    // about 8 samples end up in every output pixel per cycle
+    const float ratio{static_cast<float>(outputSize.x) / static_cast<float>(std::max(renderSize.x, 1))};
+    const auto phases{std::clamp(static_cast<unsigned int>(std::ceil(8.0f * ratio * ratio)),
+                                 TemporalAAN::MIN_JITTER_PHASES, TemporalAAN::MAX_JITTER_PHASES)};
+    m_frame = (m_frame + 1) % phases;
+
+    // pixel offset in [-0.5, 0.5), 2 / size per pixel in ndc
+    const glm::vec2 offset{TemporalAAN::halton(m_frame + 1, 2) - 0.5f, TemporalAAN::halton(m_frame + 1, 3) - 0.5f};
+    m_jitter = 2.0f * offset / glm::vec2{glm::max(renderSize, glm::ivec2{1})};
+    return m_jitter;
+}
+
+void TemporalAA::resizeHistory(const glm::ivec2& size)
+{
+    releaseHistory();
+    m_historyDesc = RenderTargetN::Desc{size.x, size.y, TemporalAAN::HISTORY_FORMAT};
+    for (unsigned int& texture : m_history)
+        texture = m_pool->acquirePersistent(m_historyDesc);
+    m_current = 0;
+}
+
+RenderGraphN::Resource TemporalAA::addPass(RenderGraph& graph, const RenderGraphN::Resource color,
+                                           const RenderGraphN::Resource depth, const RenderGraphN::Resource velocity,
+                                           const glm::ivec2& outputSize, const glm::mat4& viewProjection,
+                                           const glm::mat4& previousViewProjection, const unsigned int quadVAO)
+{
+    const glm::ivec2 size{glm::max(outputSize, glm::ivec2{1})};
+    if (m_historyDesc.width != size.x || m_historyDesc.height != size.y)
+        resizeHistory(size);
+
+    const RenderGraphN::Resource history{graph.importTexture("taaHistory", m_history[m_current ^ 1], m_historyDesc)};
+    const RenderGraphN::Resource output{graph.importTexture("taaOutput", m_history[m_current], m_historyDesc)};
+
+    RenderGraphN::Pass pass{};
+    pass.name = "taa resolve";
+    pass.reads = {color, depth, velocity, history};
+    pass.color = output;
+    pass.state.depthTest = false;
+    pass.state.depthWrite = false;
+    pass.execute = [this, color, depth, velocity, history, historyValid = m_historyValid, jitter = m_jitter,
+                    inverseViewProjection = glm::inverse(viewProjection), previousViewProjection,
+                    quadVAO](const RenderGraph& renderGraph)
+    {
+        const RenderTargetN::Desc& desc{renderGraph.getDesc(color)};
+        const glm::vec2 textureSize{static_cast<float>(desc.width), static_cast<float>(desc.height)};
+
+        m_resolveShader->use();
+        m_resolveShader->setVec2("sceneUVScale", glm::vec2{renderGraph.getRegion(color)} / textureSize);
+        m_resolveShader->setVec2("sceneTexelSize", 1.0f / textureSize);
+        m_resolveShader->setVec2("jitter", jitter);
+        m_resolveShader->setBool("historyValid", historyValid);
+        m_resolveShader->setFloat("blendFactor", TemporalAAN::BLEND_FACTOR);
+        m_resolveShader->setMat4("inverseViewProjection", inverseViewProjection);
+        m_resolveShader->setMat4("previousViewProjection", previousViewProjection);
+
+        const std::array<RenderGraphN::Resource, 4> inputs{color, depth, velocity, history};
+        for (std::size_t i{0}; i < inputs.size(); ++i)
+        {
+            glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + i));
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(inputs[i]));
+        }
+
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    };
+    graph.addPass(std::move(pass));
+
+    m_current ^= 1;
+    m_historyValid = true;
+    return output;
+}
@@ -0,0 +1,86 @@
+// Temporal anti-aliasing & upscaling.
+// The scene is rendered at a fraction of the window with the projection moved by a Halton sequence, so consecutive
+// frames sample different sub-pixel positions. The resolve reprojects last frame's full resolution output through
+// the velocity buffer, clamps it to the neighbourhood of the new samples so disoccluded & changed pixels don't ghost,
+// and blends a bit of the new frame in. Its output is the next frame's history, two persistent pool targets take
+// turns.
+
+#ifndef TEMPORAL_AA_H
+#define TEMPORAL_AA_H
+
+#include <glad/glad.h>
+
+#include <array>
+
+#include "engine_types.hpp"
+#include "glm/ext/vector_int2.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include "rendergraph.hpp"
+#include "rendertargetpool.hpp"
+#include "shader.hpp"
+
+namespace TemporalAAN
+{
+    constexpr GLenum VELOCITY_FORMAT{GL_RG16F};
+    constexpr GLenum HISTORY_FORMAT{GL_RGBA16F};
+
+    // jitter positions per cycle, more when every output pixel gets fewer samples per frame
+    constexpr unsigned int MIN_JITTER_PHASES{8};
+    constexpr unsigned int MAX_JITTER_PHASES{32};
+
+    // weight of the new frame in the history
+    constexpr float BLEND_FACTOR{0.1f};
+    // upper bound of the render scale while temporal upscaling is on
+    constexpr float MAX_RENDER_SCALE{0.7f};
+    // sharpening of the resolved image in the composite
+    constexpr float SHARPNESS{0.4f};
+
+    // index-th element (from 1) of the radical inverse sequence in base
+    [[nodiscard]] float halton(unsigned int index, unsigned int base);
+} // namespace TemporalAAN
+
+class TemporalAA final : public EngineObject
+{
+public:
+    explicit TemporalAA(EngineObject* parent);
+    ~TemporalAA() override;
+
+    bool init(void* engine, RenderTargetPool* pool);
+    // the history targets are the pool's, free() leaves them to it
+    void free();
+    // hand the history targets back to the pool (while it still exists)
+    void releaseHistory();
+
+    // advance the sequence, returns this frame's projection jitter in ndc for renderSize pixels upscaled to
+    // outputSize
+    glm::vec2 nextJitter(const glm::ivec2& renderSize, const glm::ivec2& outputSize);
+    [[nodiscard]] glm::vec2 getJitter() const { return m_jitter; }
+    // start over without history (camera cuts)
+    void invalidate() { m_historyValid = false; }
+
+    // resolve color (with its depth & velocity) into an outputSize history, returns the output
+    RenderGraphN::Resource addPass(RenderGraph& graph, RenderGraphN::Resource color, RenderGraphN::Resource depth,
+                                   RenderGraphN::Resource velocity, const glm::ivec2& outputSize,
+                                   const glm::mat4& viewProjection, const glm::mat4& previousViewProjection,
+                                   unsigned int quadVAO);
+
+private:
+    RenderTargetPool* m_pool{nullptr};
+    Shader* m_resolveShader{nullptr};
+    bool m_init{false};
+
+    std::array<unsigned int, 2> m_history{};
+    RenderTargetN::Desc m_historyDesc{};
+    // the history written this frame, the other one is read
+    std::size_t m_current{0};
+    bool m_historyValid{false};
+
+    unsigned int m_frame{0};
+    glm::vec2 m_jitter{0.0f};
+
+    // (re)allocate the history for size, drops its contents
+    void resizeHistory(const glm::ivec2& size);
+};
+
+#endif
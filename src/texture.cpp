@@ -3,10 +3,67 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <STB/stb_image.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "bcn.hpp"
+#include "mipgen.hpp"
+#include "radiance.hpp"
 #include "texture.hpp"
+#include "texturecontainer.hpp"
 #include "util.hpp"
 #include "mesh.hpp"
 
+void TextureN::setTextureParameters([[maybe_unused]] const MeshN::TextureType materialType)
+{
+    // tex wrap params
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // tex filtering params
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+namespace
+{
+    // upload 8 bit image data with mipmaps
+    unsigned int uploadImage(const unsigned char* data, const int width, const int height, const int numChannels,
+                             const MeshN::TextureType materialType)
+    {
+        // get internal format for tex. data
+        GLenum internalFormat{0};
+        switch (numChannels)
+        {
+        case 1: // grayscale
+            internalFormat = GL_RED;
+            break;
+        case 3:
+            internalFormat = GL_RGB;
+            break;
+        case 4:
+            internalFormat = GL_RGBA;
+            break;
+        default:
+            std::cout << "UNKNOWN NUMBER OF CHANNELS: " << numChannels << std::endl;
+            break;
+        }
+
+        unsigned int tex;
+        // load opengl texture
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat), width, height, 0, internalFormat,
+                     GL_UNSIGNED_BYTE, data);
+
+        glGenerateMipmap(GL_TEXTURE_2D);
+        TextureN::setTextureParameters(materialType);
+
+        return tex;
+    }
+} // namespace
+
 unsigned int TextureN::loadFromFile(const char* path, int* width, int* height, int* numChannels, bool* success,
                                     MeshN::TextureType materialType)
 {
@@ -44,62 +101,8 @@ unsigned int TextureN::loadFromFile(const char* path, int* width, int* height, i
         return 0;
     }
 
-    // get internal format for tex. data
-    GLenum internalFormat{0};
-    switch (imageChannels)
-    {
-    case 1: // grayscale
-        internalFormat = GL_RED;
-        break;
-    case 3:
-        internalFormat = GL_RGB;
-        break;
-    case 4:
-        internalFormat = GL_RGBA;
-        break;
-    default:
-        std::cout << "UNKNOWN NUMBER OF CHANNELS: " << imageChannels << std::endl;
-        break;
-    }
-
     // texture ID
-    unsigned int tex;
-    // load opengl texture
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat), imageWidth, imageHeight, 0, internalFormat,
-                 GL_UNSIGNED_BYTE, data);
-
-    glGenerateMipmap(GL_TEXTURE_2D);
-    // tex wrap params
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // tex filtering params
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // check if texture is roughness or metallic map
-    // gltf combines roughness and metallic maps, with metallic in b-channel and roughness in g-channel
-    // so the texture needs to be swizzled
-    if (materialType != MeshN::TEXTURE_NONE)
-    {
-        switch (materialType)
-        {
-        case MeshN::TEXTURE_METALLIC:
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_BLUE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_BLUE);
-            break;
-        case MeshN::TEXTURE_ROUGHNESS:
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_GREEN);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_GREEN);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_GREEN);
-            break;
-        default:
-            break;
-        }
-    }
+    const unsigned int tex{uploadImage(data, imageWidth, imageHeight, imageChannels, materialType)};
 
     std::cout << "Successfully loaded texture from `" << path << "`\n";
 
@@ -118,55 +121,210 @@ unsigned int TextureN::loadFromFile(const char* path, int* width, int* height, i
     return tex;
 }
 
+unsigned int TextureN::loadFromMemory(const unsigned char* buffer, const int length, int* width, int* height,
+                                      int* numChannels, bool* success, const MeshN::TextureType materialType)
+{
+    int imageWidth{0};
+    int imageHeight{0};
+    int imageChannels{0};
+
+    if (success)
+        *success = true;
+
+    // embedded textures are stored the way gl expects them
+    stbi_set_flip_vertically_on_load(false);
+    unsigned char* data{stbi_load_from_memory(buffer, length, &imageWidth, &imageHeight, &imageChannels, 0)};
+
+    // check success
+    if (!data)
+    {
+        std::cout << "TEXTURE::LOAD_FROM_MEMORY::ERROR: Failed to load texture from memory!\n";
+        if (success)
+            *success = false;
+        return 0;
+    }
+
+    const unsigned int tex{uploadImage(data, imageWidth, imageHeight, imageChannels, materialType)};
+
+    // free texture data
+    stbi_image_free(data);
+
+    if (width)
+        *width = imageWidth;
+    if (height)
+        *height = imageHeight;
+    if (numChannels)
+        *numChannels = imageChannels;
+
+    return tex;
+}
+
+unsigned int TextureN::loadFromPixels(const unsigned char* data, const int width, const int height,
+                                      const int numChannels, const MeshN::TextureType materialType)
+{
+    return uploadImage(data, width, height, numChannels, materialType);
+}
+
 // load hdr irradiance map
-unsigned int TextureN::loadHDRMap(const char* path, bool* success)
+unsigned int TextureN::loadHDRMap(const char* path, bool* success, JobSystem* jobs)
 {
-    if (!Util::fileExists(path))
+    RadianceN::Image image{};
+    if (!RadianceN::load(path, image, RadianceN::OUTPUT_HALF, jobs))
+    {
+        *success = false;
+        return 0;
+    }
+
+    const unsigned int hdrTexture{RadianceN::upload(image)};
+    *success = hdrTexture != 0;
+    return hdrTexture;
+}
+
+unsigned int TextureN::loadDDS(const char* path, bool* success)
+{
+    return loadCompressed(path, nullptr, nullptr, nullptr, nullptr, success);
+}
+
+void TextureN::setCompressedTextureParameters(const MeshN::TextureType materialType, const BCnN::Format format,
+                                              const int levelCount)
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    setTextureParameters(materialType);
+    if (levelCount == 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // single channel bakes already hold the material's channel in red
+    if (format == BCnN::FORMAT_BC4)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+}
+
+unsigned int TextureN::loadCompressed(const char* path, int* width, int* height, int* numChannels, std::size_t* bytes,
+                                      bool* success, const MeshN::TextureType materialType)
+{
+    if (success)
+        *success = false;
+
+    TextureContainerN::Image image{};
+    if (!TextureContainerN::load(path, image))
+        return 0;
+
+    if (!BCnN::isSupported(image.format))
     {
         Util::beginError();
-        std::cout << "TEXTUREN::LOAD_HDR_MAP::ERROR: File `" << path << "` does not exist." << std::endl;
+        std::cout << "TEXTURE::LOAD_COMPRESSED::ERROR: " << BCnN::getName(image.format)
+                  << " isn't supported by the driver, can't load `" << path << "`";
         Util::endError();
-        *success = false;
         return 0;
     }
 
+    unsigned int tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+
+    // upload the stored mips as they are
+    std::size_t totalBytes{0};
+    const auto levels{static_cast<int>(image.levels.size())};
+    for (int level{0}; level < levels; ++level)
+    {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, BCnN::getGLFormat(image.format), std::max(1, image.width >> level),
+                               std::max(1, image.height >> level), 0,
+                               static_cast<GLsizei>(image.levels[level].size()), image.levels[level].data());
+        totalBytes += image.levels[level].size();
+    }
+    setCompressedTextureParameters(materialType, image.format, levels);
+
+    std::cout << "Successfully loaded " << BCnN::getName(image.format) << " texture from `" << path << "`\n";
+
+    if (success)
+        *success = true;
+    if (width)
+        *width = image.width;
+    if (height)
+        *height = image.height;
+    if (numChannels)
+        *numChannels = BCnN::getChannelCount(image.format);
+    if (bytes)
+        *bytes = totalBytes;
+
+    return tex;
+}
+
+namespace
+{
+    constexpr const char* MATERIAL_NAMES[MeshN::TEXTURE_NONE + 1]{"albedo", "ao", "orm", "normal", "none"};
+} // namespace
+
+std::string TextureN::getBakedPath(const std::string& path, const MeshN::TextureType materialType)
+{
+    return path + '.' + MATERIAL_NAMES[materialType] + ".ktx2";
+}
+
+bool TextureN::bakeCompressed(const char* path, const MeshN::TextureType materialType, JobSystem* jobs)
+{
     int width{0};
     int height{0};
     int numChannels{0};
+    // same orientation as loadFromFile
     stbi_set_flip_vertically_on_load(true);
-    float* data = stbi_loadf(path, &width, &height, &numChannels, 0);
-
-    unsigned int hdrTexture;
-    if (data)
+    unsigned char* data{stbi_load(path, &width, &height, &numChannels, 4)};
+    if (!data)
     {
-        glGenTextures(1, &hdrTexture);
-        glBindTexture(GL_TEXTURE_2D, hdrTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
+        Util::beginError();
+        std::cout << "TEXTURE::BAKE_COMPRESSED::ERROR: Failed to load image `" << path << "`";
+        Util::endError();
+        return false;
+    }
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    std::vector<unsigned char> level{data, data + static_cast<std::size_t>(width) * height * 4};
+    stbi_image_free(data);
 
-        *success = true;
-    }
-    else
+    bool hasAlpha{false};
+    for (std::size_t i{3}; i < level.size(); i += 4)
+        hasAlpha |= level[i] < 255;
+
+    TextureContainerN::Image image{BCnN::chooseFormat(materialType, hasAlpha), width, height};
+
+    // full mip chain down to 1x1, filtered on the cpu so nothing is generated at runtime
+    const std::vector<std::vector<unsigned char>> levels{
+        MipGenN::generate(level.data(), width, height, MipGenN::getOptions(materialType, level.data(), width, height),
+                          jobs)};
+    std::size_t compressedBytes{0};
+    for (std::size_t i{0}; i < levels.size(); ++i)
     {
-        *success = false;
-        hdrTexture = 0;
+        const int levelWidth{std::max(1, width >> i)};
+        const int levelHeight{std::max(1, height >> i)};
+        image.levels.push_back(BCnN::encode(levels[i].data(), levelWidth, levelHeight, image.format, jobs));
+        compressedBytes += image.levels.back().size();
     }
 
-    stbi_image_free(data);
-    return hdrTexture;
+    const std::string bakedPath{getBakedPath(path, materialType)};
+    if (!TextureContainerN::writeKTX2(bakedPath, image))
+        return false;
+
+    std::cout << "TEXTURE::BAKE_COMPRESSED: `" << path << "` -> `" << bakedPath << "` ("
+              << BCnN::getName(image.format) << ", " << image.levels.size() << " levels, " << compressedBytes / 1024
+              << " KB instead of " << static_cast<std::size_t>(width) * height * numChannels * 4 / 3 / 1024
+              << " KB)\n";
+    return true;
 }
 
 Texture::Texture(const std::string& name, EngineObject* manager) : EngineObject{("TEXTURE " + name).c_str(), manager} {}
 
-bool Texture::loadFromFile(const char* path)
+bool Texture::loadFromFile(const char* path, TextureCache* cache)
 {
-    bool success;
-    m_TEX = TextureN::loadFromFile(path, &m_width, &m_height, &m_numChannels, &success);
-    return success;
+    m_ref = cache->loadFromFile(path);
+    if (!m_ref)
+        return false;
+
+    m_TEX = m_ref->id;
+    m_width = m_ref->width;
+    m_height = m_ref->height;
+    m_numChannels = m_ref->numChannels;
+    return true;
 }
 
 // activate gl texture
@@ -179,7 +337,10 @@ void Texture::activate(const int slot) const
 }
 
 // ------- Texture Manager ------- //
-TextureManager::TextureManager(EngineObject* parent) : EngineObject{"TextureManager", parent} {}
+TextureManager::TextureManager(EngineObject* parent, TextureCache* cache) :
+    EngineObject{"TextureManager", parent}, m_cache{cache}
+{
+}
 
 // generate vertex buffers and stuff
 void TextureManager::generateBuffers()
@@ -232,7 +393,7 @@ void TextureManager::addTexture(const char* path, const char* name, Arena* arena
     arena->addObject(texture);
 
     // load texture
-    if (!texture->loadFromFile(path))
+    if (!texture->loadFromFile(path, m_cache))
     {
         Util::beginError();
         std::cout << "TEXTURE_MANAGER::ADD_TEXTURE::ERROR: Failed to add texture `" << name << "`!";
@@ -1,12 +1,17 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <cstddef>
 #include <map>
 #include <string>
 
 #include "arena.hpp"
+#include "bcn.hpp"
 #include "engine_types.hpp"
 #include "mesh.hpp"
+#include "texturecache.hpp"
+
+class JobSystem;
 
 namespace TextureN
 {
@@ -14,11 +19,35 @@ namespace TextureN
     unsigned int loadFromFile(const char* path, int* width = nullptr, int* height = nullptr, int* numChannels = nullptr,
                               bool* success = nullptr, MeshN::TextureType materialType = MeshN::TEXTURE_NONE);
 
-    // load hdr irradiance map (for IBL)
-    unsigned int loadHDRMap(const char* path, bool* success);
+    // wrap & filter state of the bound GL_TEXTURE_2D (ORM maps are sampled per channel, no material is swizzled)
+    void setTextureParameters(MeshN::TextureType materialType);
+    // setTextureParameters() for a block compressed texture with levelCount stored mips
+    void setCompressedTextureParameters(MeshN::TextureType materialType, BCnN::Format format, int levelCount);
+
+    // decode an image from memory (embedded model textures)
+    unsigned int loadFromMemory(const unsigned char* buffer, int length, int* width = nullptr, int* height = nullptr,
+                                int* numChannels = nullptr, bool* success = nullptr,
+                                MeshN::TextureType materialType = MeshN::TEXTURE_NONE);
+
+    // upload decoded 8 bit pixels with mipmaps (images the engine built itself, e.g. packed ORM maps)
+    unsigned int loadFromPixels(const unsigned char* data, int width, int height, int numChannels,
+                                MeshN::TextureType materialType = MeshN::TEXTURE_NONE);
+
+    // load a Radiance .hdr map as immutable RGB16F (for IBL), scanlines are decoded on jobs if given
+    unsigned int loadHDRMap(const char* path, bool* success, JobSystem* jobs = nullptr);
 
     // load dds texture with mipmaps (for IBL)
     unsigned int loadDDS(const char* path, bool* success);
+
+    // load a block compressed .ktx2 / .dds file with its mips, bytes is the gpu memory it takes
+    unsigned int loadCompressed(const char* path, int* width = nullptr, int* height = nullptr,
+                                int* numChannels = nullptr, std::size_t* bytes = nullptr, bool* success = nullptr,
+                                MeshN::TextureType materialType = MeshN::TEXTURE_NONE);
+
+    // where the compressed bake of an image for a material type lives (next to the image)
+    std::string getBakedPath(const std::string& path, MeshN::TextureType materialType);
+    // encode an image with mips to the BCn format of its material type and write it to getBakedPath()
+    bool bakeCompressed(const char* path, MeshN::TextureType materialType, JobSystem* jobs = nullptr);
 } // namespace TextureN
 
 // Basic texture wrapper class.
@@ -27,8 +56,8 @@ class Texture final : public EngineObject
 public:
     explicit Texture(const std::string& name, EngineObject* manager = nullptr);
 
-    // Loads texture data from path using stbi_image.h.
-    bool loadFromFile(const char* path);
+    // Loads texture data from path through the texture cache.
+    bool loadFromFile(const char* path, TextureCache* cache);
 
     // Activates texture at slot (GL_TEXTURE0 + slot).
     void activate(int slot) const;
@@ -44,6 +73,7 @@ public:
     [[nodiscard]] int getNumChannels() const { return m_numChannels; }
 
 private:
+    TextureCacheN::TextureRef m_ref{};
     unsigned int m_TEX{0};
     int m_width{0};
     int m_height{0};
@@ -54,7 +84,7 @@ private:
 class TextureManager final : public EngineObject
 {
 public:
-    explicit TextureManager(EngineObject* parent);
+    TextureManager(EngineObject* parent, TextureCache* cache);
 
     // generate VAO & VBO, etc
     void generateBuffers();
@@ -79,6 +109,7 @@ public:
     [[nodiscard]] unsigned int getEBO() const { return m_EBO; }
 
 private:
+    TextureCache* m_cache{nullptr};
     std::map<std::string, Texture*> m_textures{};
     unsigned int m_VAO{}, m_VBO{}, m_EBO{};
 };
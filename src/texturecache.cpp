@@ -0,0 +1,255 @@
+#include "texturecache.hpp"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#include "texture.hpp"
+#include "texturecontainer.hpp"
+#include "texturestream.hpp"
+#include "textureupload.hpp"
+#include "util.hpp"
+
+TextureCacheN::Entry::~Entry()
+{
+    if (id != 0)
+        glDeleteTextures(1, &id);
+}
+
+std::uint64_t TextureCacheN::hashBytes(const void* data, const std::size_t size)
+{
+    std::uint64_t hash{14695981039346656037ull};
+    const auto* bytes{static_cast<const unsigned char*>(data)};
+    for (std::size_t i{0}; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+namespace
+{
+    // same file through different relative paths should share one texture
+    std::string canonicalPath(const std::string& path)
+    {
+        std::error_code error{};
+        const std::filesystem::path canonical{std::filesystem::weakly_canonical(path, error)};
+        return error ? path : canonical.generic_string();
+    }
+
+    // approximate gpu memory of an uncompressed texture
+    std::size_t getImageBytes(const int width, const int height, const int numChannels,
+                              const std::size_t bytesPerChannel, const bool mipmapped)
+    {
+        const std::size_t bytes{static_cast<std::size_t>(width) * height * numChannels * bytesPerChannel};
+        // full mip chain is ~4/3 of the base level
+        return mipmapped ? bytes * 4 / 3 : bytes;
+    }
+} // namespace
+
+TextureCache::TextureCache(EngineObject* parent) : EngineObject{"TextureCache", parent}
+{
+    // neutral texel per material type
+    constexpr unsigned char colors[MeshN::TEXTURE_NONE + 1][4]{
+        {255, 255, 255, 255}, // albedo
+        {255, 255, 255, 255}, // ao
+        {255, 255, 0, 255}, // orm, rough & non metallic
+        {128, 128, 255, 255}, // normal
+        {128, 128, 128, 255}, // none
+    };
+
+    glGenTextures(MeshN::TEXTURE_NONE + 1, m_placeholders);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i{0}; i <= MeshN::TEXTURE_NONE; ++i)
+    {
+        glBindTexture(GL_TEXTURE_2D, m_placeholders[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colors[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+TextureCache::~TextureCache() { glDeleteTextures(MeshN::TEXTURE_NONE + 1, m_placeholders); }
+
+TextureCacheN::TextureRef TextureCache::loadFromFile(const std::string& path, const MeshN::TextureType type,
+                                                     const bool async)
+{
+    const std::string key{"file:" + canonicalPath(path) + '|' + std::to_string(type)};
+    if (TextureCacheN::TextureRef texture{lookup(key)})
+        return texture;
+
+    // compressed files (or a compressed bake of the image) skip decoding, they're loaded right away
+    const bool isContainer{TextureContainerN::isContainerPath(path)};
+    const std::string compressedPath{isContainer ? path : TextureN::getBakedPath(path, type)};
+    if (isContainer || Util::fileExists(compressedPath))
+    {
+        if (m_streamer != nullptr)
+        {
+            if (std::shared_ptr<TextureCacheN::Entry> entry{m_streamer->open(key, compressedPath, type)})
+            {
+                m_entries[key] = entry;
+                return entry;
+            }
+        }
+
+        int width{0}, height{0}, numChannels{0};
+        std::size_t bytes{0};
+        bool success{false};
+        const unsigned int id{TextureN::loadCompressed(compressedPath.c_str(), &width, &height, &numChannels, &bytes,
+                                                       &success, type)};
+        if (success)
+            return insert(key, id, width, height, numChannels, bytes);
+        // otherwise fall back to the source image (e.g. the driver can't sample BC7)
+        if (isContainer)
+            return nullptr;
+    }
+
+    if (async && m_uploader != nullptr)
+    {
+        std::shared_ptr<TextureCacheN::Entry> entry{insertPending(key, type)};
+        m_uploader->enqueue(entry, path, type);
+        return entry;
+    }
+
+    int width{0}, height{0}, numChannels{0};
+    bool success{false};
+    const unsigned int id{TextureN::loadFromFile(path.c_str(), &width, &height, &numChannels, &success, type)};
+    if (!success)
+        return nullptr;
+
+    return insert(key, id, width, height, numChannels, getImageBytes(width, height, numChannels, 1, true));
+}
+
+TextureCacheN::TextureRef TextureCache::loadFromMemory(const unsigned char* data, const std::size_t size,
+                                                       const MeshN::TextureType type, const bool async)
+{
+    std::stringstream ss{};
+    ss << "mem:" << std::hex << TextureCacheN::hashBytes(data, size) << std::dec << ':' << size << '|' << type;
+    const std::string key{ss.str()};
+    if (TextureCacheN::TextureRef texture{lookup(key)})
+        return texture;
+
+    if (async && m_uploader != nullptr)
+    {
+        // the source (e.g. an aiScene) is gone by the time the job runs
+        std::shared_ptr<TextureCacheN::Entry> entry{insertPending(key, type)};
+        m_uploader->enqueue(entry, std::vector<unsigned char>{data, data + size}, type);
+        return entry;
+    }
+
+    int width{0}, height{0}, numChannels{0};
+    bool success{false};
+    const unsigned int id{TextureN::loadFromMemory(data, static_cast<int>(size), &width, &height, &numChannels,
+                                                   &success, type)};
+    if (!success)
+        return nullptr;
+
+    return insert(key, id, width, height, numChannels, getImageBytes(width, height, numChannels, 1, true));
+}
+
+TextureCacheN::TextureRef TextureCache::loadFromPixels(const std::string& key, const unsigned char* data,
+                                                       const int width, const int height, const int numChannels,
+                                                       const MeshN::TextureType type)
+{
+    if (TextureCacheN::TextureRef texture{lookup(key)})
+        return texture;
+
+    const unsigned int id{TextureN::loadFromPixels(data, width, height, numChannels, type)};
+    return insert(key, id, width, height, numChannels, getImageBytes(width, height, numChannels, 1, true));
+}
+
+TextureCacheN::TextureRef TextureCache::loadHDRMap(const std::string& path, JobSystem* jobs)
+{
+    const std::string key{"hdr:" + canonicalPath(path)};
+    if (TextureCacheN::TextureRef texture{lookup(key)})
+        return texture;
+
+    bool success{false};
+    const unsigned int id{TextureN::loadHDRMap(path.c_str(), &success, jobs)};
+    if (!success)
+        return nullptr;
+
+    int width{0}, height{0};
+    glBindTexture(GL_TEXTURE_2D, id);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    // RGB16F without mips
+    return insert(key, id, width, height, 3, getImageBytes(width, height, 3, 2, false));
+}
+
+TextureCacheN::TextureRef TextureCache::find(const std::string& key) const
+{
+    const auto it{m_entries.find(key)};
+    return it != m_entries.end() ? it->second.lock() : nullptr;
+}
+
+void TextureCache::collect()
+{
+    for (auto it{m_entries.begin()}; it != m_entries.end();)
+    {
+        if (it->second.expired())
+            it = m_entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+std::size_t TextureCache::getResidentCount() const
+{
+    std::size_t count{0};
+    for (const auto& [key, entry] : m_entries)
+        count += !entry.expired();
+    return count;
+}
+
+std::size_t TextureCache::getResidentBytes() const
+{
+    std::size_t bytes{0};
+    for (const auto& [key, entry] : m_entries)
+    {
+        if (const TextureCacheN::TextureRef texture{entry.lock()})
+            bytes += texture->bytes;
+    }
+    return bytes;
+}
+
+TextureCacheN::TextureRef TextureCache::lookup(const std::string& key)
+{
+    TextureCacheN::TextureRef texture{find(key)};
+    if (texture)
+        ++m_hits;
+    else
+        ++m_misses;
+    return texture;
+}
+
+TextureCacheN::TextureRef TextureCache::insert(const std::string& key, const unsigned int id, const int width,
+                                               const int height, const int numChannels, const std::size_t bytes)
+{
+    auto entry{std::make_shared<TextureCacheN::Entry>()};
+    entry->id = id;
+    entry->width = width;
+    entry->height = height;
+    entry->numChannels = numChannels;
+    entry->bytes = bytes;
+    entry->key = key;
+
+    m_entries[key] = entry;
+    return entry;
+}
+
+std::shared_ptr<TextureCacheN::Entry> TextureCache::insertPending(const std::string& key,
+                                                                 const MeshN::TextureType type)
+{
+    auto entry{std::make_shared<TextureCacheN::Entry>()};
+    entry->key = key;
+    entry->ready = false;
+    entry->placeholder = m_placeholders[type];
+
+    m_entries[key] = entry;
+    return entry;
+}
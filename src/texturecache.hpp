@@ -0,0 +1,107 @@
+// Engine wide texture cache.
+// Textures are keyed by canonical file path (or a hash of the encoded bytes for embedded textures) plus the
+// material type, which picks the compressed bake & mip filtering. Users hold TextureRefs, the gl texture is deleted
+// as soon as the last reference goes away - the cache itself only keeps weak references and never extends a lifetime.
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "engine_types.hpp"
+#include "mesh.hpp"
+
+class JobSystem;
+class TextureStreamer;
+class TextureUploader;
+
+namespace TextureCacheN
+{
+    struct Entry
+    {
+        unsigned int id{0}; // gl texture
+        int width{0};
+        int height{0};
+        int numChannels{0};
+        std::size_t bytes{0}; // approximate gpu memory including mips
+        std::string key{};
+        bool ready{true}; // false while an async load is still decoding / uploading
+        unsigned int placeholder{0}; // bound instead of id until ready
+
+        Entry() = default;
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+        // deletes the gl texture
+        ~Entry();
+
+        // texture to bind right now
+        [[nodiscard]] unsigned int getBindable() const { return ready ? id : placeholder; }
+    };
+
+    using TextureRef = std::shared_ptr<const Entry>;
+
+    // 64 bit FNV-1a
+    std::uint64_t hashBytes(const void* data, std::size_t size);
+} // namespace TextureCacheN
+
+class TextureCache final : public EngineObject
+{
+public:
+    explicit TextureCache(EngineObject* parent);
+    ~TextureCache() override;
+
+    // enables async loads
+    void setUploader(TextureUploader* uploader) { m_uploader = uploader; }
+    // compressed files stream their mips instead of loading all of them
+    void setStreamer(TextureStreamer* streamer) { m_streamer = streamer; }
+
+    // nullptr if the texture failed to load
+    // .ktx2 / .dds files and images with a compressed bake (TextureN::getBakedPath) load the compressed data
+    // async loads return immediately and bind a flat placeholder until the uploader finished the texture
+    TextureCacheN::TextureRef loadFromFile(const std::string& path, MeshN::TextureType type = MeshN::TEXTURE_NONE,
+                                           bool async = false);
+    // encoded image in memory (embedded textures), keyed by content
+    TextureCacheN::TextureRef loadFromMemory(const unsigned char* data, std::size_t size,
+                                             MeshN::TextureType type = MeshN::TEXTURE_NONE, bool async = false);
+    // decoded 8 bit pixels the caller built, keyed by the caller (find() first to skip building them again)
+    TextureCacheN::TextureRef loadFromPixels(const std::string& key, const unsigned char* data, int width, int height,
+                                             int numChannels, MeshN::TextureType type = MeshN::TEXTURE_NONE);
+    // floating point equirectangular maps (IBL), scanlines are decoded on jobs if given
+    TextureCacheN::TextureRef loadHDRMap(const std::string& path, JobSystem* jobs = nullptr);
+
+    // nullptr if nothing with key is resident
+    [[nodiscard]] TextureCacheN::TextureRef find(const std::string& key) const;
+
+    // forget textures that were released by all users
+    void collect();
+
+    [[nodiscard]] std::size_t getResidentCount() const;
+    [[nodiscard]] std::size_t getResidentBytes() const;
+    [[nodiscard]] unsigned int getHits() const { return m_hits; }
+    [[nodiscard]] unsigned int getMisses() const { return m_misses; }
+
+    // 1x1 texture with the neutral value of a material type (white albedo, flat normal, ...)
+    [[nodiscard]] unsigned int getPlaceholder(MeshN::TextureType type) const { return m_placeholders[type]; }
+
+private:
+    TextureUploader* m_uploader{nullptr};
+    TextureStreamer* m_streamer{nullptr};
+    unsigned int m_placeholders[MeshN::TEXTURE_NONE + 1]{};
+
+    std::unordered_map<std::string, std::weak_ptr<const TextureCacheN::Entry>> m_entries{};
+    unsigned int m_hits{0};
+    unsigned int m_misses{0};
+
+    // cache lookup, counts hits & misses
+    TextureCacheN::TextureRef lookup(const std::string& key);
+    TextureCacheN::TextureRef insert(const std::string& key, unsigned int id, int width, int height, int numChannels,
+                                     std::size_t bytes);
+    // not ready entry for the uploader to fill in
+    std::shared_ptr<TextureCacheN::Entry> insertPending(const std::string& key, MeshN::TextureType type);
+};
+
+#endif
@@ -0,0 +1,513 @@
+#include "texturecontainer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "util.hpp"
+
+namespace
+{
+    constexpr unsigned char KTX2_IDENTIFIER[12]{0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    constexpr std::size_t KTX2_HEADER_BYTES{80};
+    constexpr std::size_t KTX2_LEVEL_BYTES{24};
+
+    constexpr std::size_t DDS_HEADER_BYTES{128}; // magic + header
+    constexpr std::size_t DDS_DX10_BYTES{20};
+    constexpr std::uint32_t DDS_MIPMAPCOUNT{0x20000};
+    constexpr std::uint32_t DDS_FOURCC{0x4};
+    constexpr std::uint32_t DDS_CUBEMAP{0x200};
+    constexpr std::uint32_t DDS_DIMENSION_TEXTURE2D{3};
+    constexpr std::uint32_t DDS_MISC_TEXTURECUBE{0x4};
+
+    // more than a 2^31 texture could have, guards against garbage headers
+    constexpr std::uint32_t MAX_LEVELS{32};
+    // enough for either header with MAX_LEVELS level index entries
+    constexpr std::size_t HEADER_READ_BYTES{KTX2_HEADER_BYTES + MAX_LEVELS * KTX2_LEVEL_BYTES};
+
+    bool fail(const char* method, const std::string& path, const char* reason)
+    {
+        Util::beginError();
+        std::cout << "TEXTURE_CONTAINER::" << method << "::ERROR: `" << path << "` " << reason;
+        Util::endError();
+        return false;
+    }
+
+    bool readFile(const std::string& path, std::vector<unsigned char>& bytes)
+    {
+        std::ifstream file{path, std::ios::binary};
+        if (!file)
+            return false;
+        bytes.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+        return true;
+    }
+
+    std::uint32_t readU32(const std::vector<unsigned char>& bytes, const std::size_t offset)
+    {
+        std::uint32_t value{0};
+        for (std::size_t i{0}; i < 4; ++i)
+            value |= static_cast<std::uint32_t>(bytes[offset + i]) << (i * 8);
+        return value;
+    }
+
+    std::uint64_t readU64(const std::vector<unsigned char>& bytes, const std::size_t offset)
+    {
+        return readU32(bytes, offset) | static_cast<std::uint64_t>(readU32(bytes, offset + 4)) << 32;
+    }
+
+    void writeU32(std::vector<unsigned char>& bytes, const std::size_t offset, const std::uint32_t value)
+    {
+        for (std::size_t i{0}; i < 4; ++i)
+            bytes[offset + i] = static_cast<unsigned char>(value >> (i * 8) & 0xFF);
+    }
+
+    void writeU64(std::vector<unsigned char>& bytes, const std::size_t offset, const std::uint64_t value)
+    {
+        writeU32(bytes, offset, static_cast<std::uint32_t>(value));
+        writeU32(bytes, offset + 4, static_cast<std::uint32_t>(value >> 32));
+    }
+
+    void appendU32(std::vector<unsigned char>& bytes, const std::uint32_t value)
+    {
+        bytes.resize(bytes.size() + 4);
+        writeU32(bytes, bytes.size() - 4, value);
+    }
+
+    // lowercase, including the dot
+    std::string getExtension(const std::string& path)
+    {
+        const std::size_t dot{path.find_last_of('.')};
+        std::string extension{dot == std::string::npos ? "" : path.substr(dot)};
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension;
+    }
+
+    std::size_t alignUp(const std::size_t value, const std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    constexpr std::uint32_t fourCC(const char (&code)[5])
+    {
+        return static_cast<std::uint32_t>(code[0]) | static_cast<std::uint32_t>(code[1]) << 8 |
+            static_cast<std::uint32_t>(code[2]) << 16 | static_cast<std::uint32_t>(code[3]) << 24;
+    }
+
+    // srgb variants load as unorm, the shaders linearize albedo themselves
+    bool fromVkFormat(const std::uint32_t vkFormat, BCnN::Format& format)
+    {
+        switch (vkFormat)
+        {
+        case 131: // BC1_RGB_UNORM
+        case 132: // BC1_RGB_SRGB
+        case 133: // BC1_RGBA_UNORM
+        case 134: // BC1_RGBA_SRGB
+            format = BCnN::FORMAT_BC1;
+            return true;
+        case 137: // BC3_UNORM
+        case 138: // BC3_SRGB
+            format = BCnN::FORMAT_BC3;
+            return true;
+        case 139: // BC4_UNORM
+            format = BCnN::FORMAT_BC4;
+            return true;
+        case 141: // BC5_UNORM
+            format = BCnN::FORMAT_BC5;
+            return true;
+        case 145: // BC7_UNORM
+        case 146: // BC7_SRGB
+            format = BCnN::FORMAT_BC7;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    std::uint32_t toVkFormat(const BCnN::Format format)
+    {
+        constexpr std::uint32_t formats[]{131, 137, 139, 141, 145};
+        return formats[format];
+    }
+
+    bool fromDXGIFormat(const std::uint32_t dxgiFormat, BCnN::Format& format)
+    {
+        switch (dxgiFormat)
+        {
+        case 70: // BC1_TYPELESS
+        case 71: // BC1_UNORM
+        case 72: // BC1_UNORM_SRGB
+            format = BCnN::FORMAT_BC1;
+            return true;
+        case 76: // BC3_TYPELESS
+        case 77: // BC3_UNORM
+        case 78: // BC3_UNORM_SRGB
+            format = BCnN::FORMAT_BC3;
+            return true;
+        case 79: // BC4_TYPELESS
+        case 80: // BC4_UNORM
+            format = BCnN::FORMAT_BC4;
+            return true;
+        case 82: // BC5_TYPELESS
+        case 83: // BC5_UNORM
+            format = BCnN::FORMAT_BC5;
+            return true;
+        case 97: // BC7_TYPELESS
+        case 98: // BC7_UNORM
+        case 99: // BC7_UNORM_SRGB
+            format = BCnN::FORMAT_BC7;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool fromFourCC(const std::uint32_t code, BCnN::Format& format)
+    {
+        if (code == fourCC("DXT1"))
+            format = BCnN::FORMAT_BC1;
+        else if (code == fourCC("DXT5"))
+            format = BCnN::FORMAT_BC3;
+        else if (code == fourCC("ATI1") || code == fourCC("BC4U"))
+            format = BCnN::FORMAT_BC4;
+        else if (code == fourCC("ATI2") || code == fourCC("BC5U"))
+            format = BCnN::FORMAT_BC5;
+        else
+            return false;
+        return true;
+    }
+
+    // level index of a file whose levels are stored back to back
+    void addSequentialLevels(std::size_t offset, const int levelCount, TextureContainerN::Layout& layout)
+    {
+        for (int level{0}; level < levelCount; ++level)
+        {
+            const std::size_t size{BCnN::getLevelBytes(layout.format, std::max(1, layout.width >> level),
+                                                       std::max(1, layout.height >> level))};
+            layout.levels.push_back({offset, size});
+            offset += size;
+        }
+    }
+
+    // header must hold at least the fixed header & level index, fileSize is checked against the level index
+    bool parseKTX2(const std::string& path, const std::vector<unsigned char>& header, const std::size_t fileSize,
+                   TextureContainerN::Layout& layout)
+    {
+        if (header.size() < KTX2_HEADER_BYTES ||
+            std::memcmp(header.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+            return fail("LOAD_KTX2", path, "is not a KTX2 file");
+
+        const std::uint32_t vkFormat{readU32(header, 12)};
+        const std::uint32_t depth{readU32(header, 28)};
+        const std::uint32_t layers{readU32(header, 32)};
+        const std::uint32_t faces{readU32(header, 36)};
+        // 0 levels asks the loader to generate mips, the base level is still stored
+        const std::uint32_t levelCount{std::max(1u, readU32(header, 40))};
+        const std::uint32_t supercompression{readU32(header, 44)};
+
+        if (!fromVkFormat(vkFormat, layout.format))
+            return fail("LOAD_KTX2", path, "has a format that isn't BC1/3/4/5/7");
+        if (depth > 1 || layers > 1 || faces != 1)
+            return fail("LOAD_KTX2", path, "is not a single 2D image");
+        if (supercompression != 0)
+            return fail("LOAD_KTX2", path, "is supercompressed");
+        if (levelCount > MAX_LEVELS)
+            return fail("LOAD_KTX2", path, "has a broken level index");
+        if (header.size() < KTX2_HEADER_BYTES + levelCount * KTX2_LEVEL_BYTES)
+            return fail("LOAD_KTX2", path, "is truncated");
+
+        layout.width = static_cast<int>(readU32(header, 20));
+        layout.height = static_cast<int>(std::max(1u, readU32(header, 24)));
+        layout.levels.clear();
+        for (std::uint32_t level{0}; level < levelCount; ++level)
+        {
+            const std::size_t entry{KTX2_HEADER_BYTES + level * KTX2_LEVEL_BYTES};
+            const std::uint64_t offset{readU64(header, entry)};
+            const std::uint64_t length{readU64(header, entry + 8)};
+            const std::size_t expected{BCnN::getLevelBytes(layout.format, std::max(1, layout.width >> level),
+                                                           std::max(1, layout.height >> level))};
+            if (length != expected || offset + length > fileSize)
+                return fail("LOAD_KTX2", path, "has a broken level index");
+
+            layout.levels.push_back({static_cast<std::size_t>(offset), static_cast<std::size_t>(length)});
+        }
+        return true;
+    }
+
+    bool parseDDS(const std::string& path, const std::vector<unsigned char>& header, const std::size_t fileSize,
+                  TextureContainerN::Layout& layout)
+    {
+        if (header.size() < DDS_HEADER_BYTES || readU32(header, 0) != fourCC("DDS ") || readU32(header, 4) != 124)
+            return fail("LOAD_DDS", path, "is not a DDS file");
+
+        const std::uint32_t flags{readU32(header, 8)};
+        const std::uint32_t pixelFlags{readU32(header, 80)};
+        const std::uint32_t code{readU32(header, 84)};
+        const std::uint32_t caps2{readU32(header, 112)};
+        if ((pixelFlags & DDS_FOURCC) == 0)
+            return fail("LOAD_DDS", path, "is not block compressed");
+        if ((caps2 & DDS_CUBEMAP) != 0)
+            return fail("LOAD_DDS", path, "is a cubemap");
+
+        std::size_t offset{DDS_HEADER_BYTES};
+        if (code == fourCC("DX10"))
+        {
+            if (header.size() < DDS_HEADER_BYTES + DDS_DX10_BYTES)
+                return fail("LOAD_DDS", path, "is truncated");
+            if (!fromDXGIFormat(readU32(header, 128), layout.format))
+                return fail("LOAD_DDS", path, "has a format that isn't BC1/3/4/5/7");
+            if (readU32(header, 132) != DDS_DIMENSION_TEXTURE2D || (readU32(header, 136) & DDS_MISC_TEXTURECUBE) != 0 ||
+                readU32(header, 140) > 1)
+                return fail("LOAD_DDS", path, "is not a single 2D image");
+            offset += DDS_DX10_BYTES;
+        }
+        else if (!fromFourCC(code, layout.format))
+        {
+            return fail("LOAD_DDS", path, "has a format that isn't BC1/3/4/5");
+        }
+
+        layout.height = static_cast<int>(readU32(header, 12));
+        layout.width = static_cast<int>(readU32(header, 16));
+        const int levelCount{(flags & DDS_MIPMAPCOUNT) != 0 ? std::max(1, static_cast<int>(readU32(header, 28))) : 1};
+        if (levelCount > static_cast<int>(MAX_LEVELS))
+            return fail("LOAD_DDS", path, "has a broken mip count");
+
+        layout.levels.clear();
+        addSequentialLevels(offset, levelCount, layout);
+        if (layout.levels.back().offset + layout.levels.back().size > fileSize)
+            return fail("LOAD_DDS", path, "is truncated");
+        return true;
+    }
+
+    bool parse(const std::string& path, const std::vector<unsigned char>& header, const std::size_t fileSize,
+               TextureContainerN::Layout& layout)
+    {
+        const std::string extension{getExtension(path)};
+        if (extension == ".ktx2")
+            return parseKTX2(path, header, fileSize, layout);
+        if (extension == ".dds")
+            return parseDDS(path, header, fileSize, layout);
+        return fail("LOAD", path, "is neither a .ktx2 nor a .dds file");
+    }
+
+    // whole file already in memory
+    void copyLevels(const std::vector<unsigned char>& bytes, const TextureContainerN::Layout& layout,
+                    TextureContainerN::Image& image)
+    {
+        image.format = layout.format;
+        image.width = layout.width;
+        image.height = layout.height;
+        image.levels.clear();
+        for (const TextureContainerN::Level& level : layout.levels)
+        {
+            image.levels.emplace_back(bytes.begin() + static_cast<std::ptrdiff_t>(level.offset),
+                                      bytes.begin() + static_cast<std::ptrdiff_t>(level.offset + level.size));
+        }
+    }
+
+    // basic data format descriptor (required by the KTX2 spec, ignored when loading)
+    std::vector<unsigned char> makeDescriptor(const BCnN::Format format)
+    {
+        struct Sample
+        {
+            std::uint32_t bitOffset;
+            std::uint32_t bitLength;
+            std::uint32_t channel;
+        };
+
+        std::vector<Sample> samples{};
+        std::uint8_t colorModel{0};
+        switch (format)
+        {
+        case BCnN::FORMAT_BC1:
+            colorModel = 128;
+            samples = {{0, 64, 0}};
+            break;
+        case BCnN::FORMAT_BC3:
+            colorModel = 130;
+            samples = {{0, 64, 15}, {64, 64, 0}}; // alpha block, then color block
+            break;
+        case BCnN::FORMAT_BC4:
+            colorModel = 131;
+            samples = {{0, 64, 0}};
+            break;
+        case BCnN::FORMAT_BC5:
+            colorModel = 132;
+            samples = {{0, 64, 0}, {64, 64, 1}};
+            break;
+        case BCnN::FORMAT_BC7:
+            colorModel = 134;
+            samples = {{0, 128, 0}};
+            break;
+        }
+
+        const auto blockSize{static_cast<std::uint32_t>(24 + 16 * samples.size())};
+        std::vector<unsigned char> descriptor{};
+        appendU32(descriptor, 4 + blockSize); // total size
+        appendU32(descriptor, 0); // khronos vendor, basic descriptor type
+        appendU32(descriptor, 2 | blockSize << 16); // version 2
+        // model, bt709 primaries, linear transfer, straight alpha
+        appendU32(descriptor, colorModel | 1u << 8 | 1u << 16);
+        appendU32(descriptor, 3 | 3u << 8); // 4x4 blocks
+        appendU32(descriptor, static_cast<std::uint32_t>(BCnN::getBlockBytes(format)));
+        appendU32(descriptor, 0);
+        for (const Sample& sample : samples)
+        {
+            appendU32(descriptor, sample.bitOffset | (sample.bitLength - 1) << 16 | sample.channel << 24);
+            appendU32(descriptor, 0); // sample position
+            appendU32(descriptor, 0); // lower
+            appendU32(descriptor, 0xFFFFFFFF); // upper
+        }
+        return descriptor;
+    }
+
+    void appendKeyValue(std::vector<unsigned char>& bytes, const std::string& key, const std::string& value)
+    {
+        appendU32(bytes, static_cast<std::uint32_t>(key.size() + value.size() + 2));
+        bytes.insert(bytes.end(), key.begin(), key.end());
+        bytes.push_back(0);
+        bytes.insert(bytes.end(), value.begin(), value.end());
+        bytes.push_back(0);
+        bytes.resize(alignUp(bytes.size(), 4), 0);
+    }
+} // namespace
+
+bool TextureContainerN::isContainerPath(const std::string& path)
+{
+    const std::string extension{getExtension(path)};
+    return extension == ".ktx2" || extension == ".dds";
+}
+
+bool TextureContainerN::load(const std::string& path, Image& image)
+{
+    std::vector<unsigned char> bytes{};
+    if (!readFile(path, bytes))
+        return fail("LOAD", path, "could not be opened");
+
+    Layout layout{};
+    if (!parse(path, bytes, bytes.size(), layout))
+        return false;
+    copyLevels(bytes, layout, image);
+    return true;
+}
+
+bool TextureContainerN::loadKTX2(const std::string& path, Image& image)
+{
+    std::vector<unsigned char> bytes{};
+    if (!readFile(path, bytes))
+        return fail("LOAD_KTX2", path, "could not be opened");
+
+    Layout layout{};
+    if (!parseKTX2(path, bytes, bytes.size(), layout))
+        return false;
+    copyLevels(bytes, layout, image);
+    return true;
+}
+
+bool TextureContainerN::loadDDS(const std::string& path, Image& image)
+{
+    std::vector<unsigned char> bytes{};
+    if (!readFile(path, bytes))
+        return fail("LOAD_DDS", path, "could not be opened");
+
+    Layout layout{};
+    if (!parseDDS(path, bytes, bytes.size(), layout))
+        return false;
+    copyLevels(bytes, layout, image);
+    return true;
+}
+
+bool TextureContainerN::loadLayout(const std::string& path, Layout& layout)
+{
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file)
+        return fail("LOAD_LAYOUT", path, "could not be opened");
+
+    // the headers & level index sit at the start, no need to read any texels
+    const auto fileSize{static_cast<std::size_t>(file.tellg())};
+    std::vector<unsigned char> header(std::min(fileSize, HEADER_READ_BYTES));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(header.data()), static_cast<std::streamsize>(header.size())))
+        return fail("LOAD_LAYOUT", path, "could not be read");
+
+    return parse(path, header, fileSize, layout);
+}
+
+bool TextureContainerN::readLevel(const std::string& path, const Layout& layout, const int level,
+                                  std::vector<unsigned char>& data)
+{
+    if (level < 0 || level >= static_cast<int>(layout.levels.size()))
+        return fail("READ_LEVEL", path, "has no such level");
+
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+        return fail("READ_LEVEL", path, "could not be opened");
+
+    const Level& entry{layout.levels[level]};
+    data.resize(entry.size);
+    file.seekg(static_cast<std::streamoff>(entry.offset));
+    if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(entry.size)))
+        return fail("READ_LEVEL", path, "is truncated");
+    return true;
+}
+
+bool TextureContainerN::writeKTX2(const std::string& path, const Image& image)
+{
+    const std::size_t levelCount{image.levels.size()};
+    const std::vector<unsigned char> descriptor{makeDescriptor(image.format)};
+    std::vector<unsigned char> keyValues{};
+    appendKeyValue(keyValues, "KTXorientation", "ru"); // rows bottom up
+    appendKeyValue(keyValues, "KTXwriter", "mix_simulator");
+
+    const std::size_t descriptorOffset{KTX2_HEADER_BYTES + levelCount * KTX2_LEVEL_BYTES};
+    const std::size_t keyValueOffset{descriptorOffset + descriptor.size()};
+    const std::size_t blockBytes{BCnN::getBlockBytes(image.format)};
+
+    // levels are stored smallest first, each aligned to the block size
+    std::vector<std::size_t> levelOffsets(levelCount);
+    std::size_t end{keyValueOffset + keyValues.size()};
+    for (std::size_t level{levelCount}; level-- > 0;)
+    {
+        levelOffsets[level] = alignUp(end, blockBytes);
+        end = levelOffsets[level] + image.levels[level].size();
+    }
+
+    std::vector<unsigned char> bytes(end, 0);
+    std::memcpy(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    writeU32(bytes, 12, toVkFormat(image.format));
+    writeU32(bytes, 16, 1); // type size
+    writeU32(bytes, 20, static_cast<std::uint32_t>(image.width));
+    writeU32(bytes, 24, static_cast<std::uint32_t>(image.height));
+    writeU32(bytes, 28, 0); // depth
+    writeU32(bytes, 32, 0); // layers
+    writeU32(bytes, 36, 1); // faces
+    writeU32(bytes, 40, static_cast<std::uint32_t>(levelCount));
+    writeU32(bytes, 44, 0); // no supercompression
+    writeU32(bytes, 48, static_cast<std::uint32_t>(descriptorOffset));
+    writeU32(bytes, 52, static_cast<std::uint32_t>(descriptor.size()));
+    writeU32(bytes, 56, static_cast<std::uint32_t>(keyValueOffset));
+    writeU32(bytes, 60, static_cast<std::uint32_t>(keyValues.size()));
+    writeU64(bytes, 64, 0);
+    writeU64(bytes, 72, 0);
+
+    for (std::size_t level{0}; level < levelCount; ++level)
+    {
+        const std::size_t entry{KTX2_HEADER_BYTES + level * KTX2_LEVEL_BYTES};
+        writeU64(bytes, entry, levelOffsets[level]);
+        writeU64(bytes, entry + 8, image.levels[level].size());
+        writeU64(bytes, entry + 16, image.levels[level].size());
+        std::copy(image.levels[level].begin(), image.levels[level].end(),
+                  bytes.begin() + static_cast<std::ptrdiff_t>(levelOffsets[level]));
+    }
+    std::copy(descriptor.begin(), descriptor.end(), bytes.begin() + static_cast<std::ptrdiff_t>(descriptorOffset));
+    std::copy(keyValues.begin(), keyValues.end(), bytes.begin() + static_cast<std::ptrdiff_t>(keyValueOffset));
+
+    std::ofstream file{path, std::ios::binary};
+    if (!file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+        return fail("WRITE_KTX2", path, "could not be written");
+    return true;
+}
@@ -0,0 +1,58 @@
+// Compressed texture files.
+// Reads KTX2 (without supercompression) and DDS (FourCC & DX10 headers) files holding BCn data with precomputed
+// mips, and writes the KTX2 files the texture baker produces. Single 2D images only, no arrays, cubemaps or
+// volumes. Rows are uploaded in file order: baked files store them bottom up like the flipped stbi loads (and say so
+// with KTXorientation "ru"), files from other tools usually don't.
+
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "bcn.hpp"
+
+namespace TextureContainerN
+{
+    struct Image
+    {
+        BCnN::Format format{BCnN::FORMAT_BC1};
+        int width{0};
+        int height{0};
+        std::vector<std::vector<unsigned char>> levels{}; // base level first
+    };
+
+    // where a level's data sits in the file
+    struct Level
+    {
+        std::size_t offset{0};
+        std::size_t size{0};
+    };
+
+    // header of a file without its texel data (streaming reads levels on demand)
+    struct Layout
+    {
+        BCnN::Format format{BCnN::FORMAT_BC1};
+        int width{0};
+        int height{0};
+        std::vector<Level> levels{}; // base level first
+    };
+
+    // .ktx2 or .dds
+    [[nodiscard]] bool isContainerPath(const std::string& path);
+
+    // picks the reader by extension
+    bool load(const std::string& path, Image& image);
+    bool loadKTX2(const std::string& path, Image& image);
+    bool loadDDS(const std::string& path, Image& image);
+
+    // only reads the headers, picks the reader by extension
+    bool loadLayout(const std::string& path, Layout& layout);
+    // one level of a file described by loadLayout() (thread safe)
+    bool readLevel(const std::string& path, const Layout& layout, int level, std::vector<unsigned char>& data);
+
+    bool writeKTX2(const std::string& path, const Image& image);
+} // namespace TextureContainerN
+
+#endif
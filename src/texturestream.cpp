@@ -0,0 +1,302 @@
+#include "texturestream.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+#include "bcn.hpp"
+#include "texture.hpp"
+#include "util.hpp"
+
+namespace
+{
+    // closest a mesh is assumed to be, the camera inside a bounding sphere asks for the base level
+    constexpr float NEAR_DISTANCE{0.01f};
+} // namespace
+
+TextureStreamer::TextureStreamer(EngineObject* parent, JobSystem* jobs) :
+    EngineObject{"TextureStreamer", parent}, m_jobs{jobs}
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // read jobs reference this (the job system drains its queue before it is destroyed)
+    while (!m_reading.done())
+        std::this_thread::yield();
+}
+
+std::shared_ptr<TextureCacheN::Entry> TextureStreamer::open(const std::string& key, const std::string& path,
+                                                            const MeshN::TextureType type)
+{
+    TextureContainerN::Layout layout{};
+    if (!TextureContainerN::loadLayout(path, layout) || !BCnN::isSupported(layout.format))
+        return nullptr;
+
+    // finest level that is small enough to always keep
+    const auto levelCount{static_cast<int>(layout.levels.size())};
+    int minimumLevel{0};
+    while (minimumLevel < levelCount - 1 &&
+           std::max(layout.width >> minimumLevel, layout.height >> minimumLevel) > TextureStreamN::RESIDENT_SIZE)
+        ++minimumLevel;
+
+    auto entry{std::make_shared<TextureCacheN::Entry>()};
+    glGenTextures(1, &entry->id);
+    glBindTexture(GL_TEXTURE_2D, entry->id);
+
+    // levels below the base level stay unspecified until they're streamed in
+    std::size_t bytes{0};
+    std::vector<unsigned char> data{};
+    for (int level{levelCount - 1}; level >= minimumLevel; --level)
+    {
+        if (!TextureContainerN::readLevel(path, layout, level, data))
+        {
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return nullptr;
+        }
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, BCnN::getGLFormat(layout.format),
+                               std::max(1, layout.width >> level), std::max(1, layout.height >> level), 0,
+                               static_cast<GLsizei>(data.size()), data.data());
+        bytes += data.size();
+    }
+    TextureN::setCompressedTextureParameters(type, layout.format, levelCount);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, minimumLevel);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    entry->width = layout.width;
+    entry->height = layout.height;
+    entry->numChannels = BCnN::getChannelCount(layout.format);
+    entry->bytes = bytes;
+    entry->key = key;
+
+    // a released entry's stream stays until update() drops it, a new entry can get the same address before that
+    TextureStreamN::Stream& stream{m_streams[entry.get()]};
+    m_residentBytes -= stream.residentBytes;
+    stream = TextureStreamN::Stream{};
+    stream.id = m_nextId++;
+    stream.entry = entry;
+    stream.path = path;
+    stream.layout = std::move(layout);
+    stream.residentLevel = minimumLevel;
+    stream.minimumLevel = minimumLevel;
+    stream.wantedLevel = minimumLevel;
+    stream.lastUsed = m_frame;
+    stream.residentBytes = bytes;
+    m_residentBytes += bytes;
+
+    std::cout << "Streaming " << BCnN::getName(stream.layout.format) << " texture from `" << path << "` ("
+              << levelCount - minimumLevel << '/' << levelCount << " levels resident)\n";
+    return entry;
+}
+
+void TextureStreamer::setView(const glm::vec3& position, const float fovY, const int viewportHeight)
+{
+    m_viewPosition = position;
+    m_pixelSize = 2.0f * std::tan(fovY * 0.5f) / static_cast<float>(std::max(1, viewportHeight));
+}
+
+void TextureStreamer::request(const Mesh& mesh, const glm::mat4& transform)
+{
+    if (m_streams.empty() || mesh.getUVDensity() <= 0.0f)
+        return;
+
+    // largest axis scale, so stretched meshes rather ask for too much detail than too little
+    const float scale{std::sqrt(std::max({glm::dot(glm::vec3{transform[0]}, glm::vec3{transform[0]}),
+                                          glm::dot(glm::vec3{transform[1]}, glm::vec3{transform[1]}),
+                                          glm::dot(glm::vec3{transform[2]}, glm::vec3{transform[2]})}))};
+    if (scale <= 0.0f)
+        return;
+
+    // distance to the nearest point of the bounding sphere
+    const CullingN::Sphere& sphere{mesh.getBoundingSphere()};
+    const glm::vec3 center{transform * glm::vec4{sphere.center, 1.0f}};
+    const float distance{std::max(glm::length(center - m_viewPosition) - sphere.radius * scale, NEAR_DISTANCE)};
+    // uv units one pixel covers there
+    const float uvPerPixel{mesh.getUVDensity() / scale * distance * m_pixelSize};
+
+    for (const MeshN::Texture& texture : mesh.getTextures())
+    {
+        const auto it{m_streams.find(texture.ref.get())};
+        if (it == m_streams.end())
+            continue;
+
+        TextureStreamN::Stream& stream{it->second};
+        // base level texels per pixel, every level halves them
+        const float texels{uvPerPixel * static_cast<float>(std::max(stream.layout.width, stream.layout.height))};
+        const int level{texels > 1.0f ? static_cast<int>(std::log2(texels)) : 0};
+        stream.wantedLevel = std::min(stream.wantedLevel, level);
+        stream.lastUsed = m_frame;
+    }
+}
+
+void TextureStreamer::update(const float dt)
+{
+    // textures released by every user already deleted their gl texture
+    for (auto it{m_streams.begin()}; it != m_streams.end();)
+    {
+        if (it->second.entry.expired())
+        {
+            m_residentBytes -= it->second.residentBytes;
+            it = m_streams.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    std::vector<TextureStreamN::LoadedLevel> loaded{};
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        loaded.swap(m_loaded);
+    }
+    for (TextureStreamN::LoadedLevel& level : loaded)
+    {
+        --m_loading;
+        const auto it{m_streams.find(level.key)};
+        if (it == m_streams.end() || it->second.id != level.id)
+            continue;
+
+        TextureStreamN::Stream& stream{it->second};
+        stream.loading = false;
+        if (!level.success)
+            continue;
+
+        // levels dropped while reading make this one useless
+        const std::shared_ptr<TextureCacheN::Entry> entry{stream.entry.lock()};
+        if (entry && level.level == stream.residentLevel - 1 && makeRoom(level.data.size(), &stream))
+            uploadLevel(stream, *entry, level.level, level.data);
+    }
+
+    for (auto& [key, stream] : m_streams)
+    {
+        if (stream.fade <= 0.0f)
+            continue;
+
+        const std::shared_ptr<TextureCacheN::Entry> entry{stream.entry.lock()};
+        stream.fade = std::max(0.0f, stream.fade - dt / TextureStreamN::FADE_TIME);
+        glBindTexture(GL_TEXTURE_2D, entry->id);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, stream.fade);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // the budget may have been lowered
+    makeRoom(0, nullptr);
+
+    // start reads for the blurriest textures that were drawn last frame
+    std::vector<std::pair<int, const TextureCacheN::Entry*>> candidates{};
+    for (const auto& [key, stream] : m_streams)
+    {
+        if (!stream.loading && stream.lastUsed == m_frame && stream.wantedLevel < stream.residentLevel)
+            candidates.emplace_back(stream.residentLevel - stream.wantedLevel, key);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (const auto& [missing, key] : candidates)
+    {
+        if (m_loading >= TextureStreamN::MAX_LOADS)
+            break;
+
+        TextureStreamN::Stream& stream{m_streams.at(key)};
+        if (makeRoom(stream.layout.levels[stream.residentLevel - 1].size, &stream))
+            submitLoad(stream, key);
+    }
+
+    // requests of the next frame
+    for (auto& [key, stream] : m_streams)
+        stream.wantedLevel = stream.minimumLevel;
+    ++m_frame;
+}
+
+void TextureStreamer::submitLoad(TextureStreamN::Stream& stream, const TextureCacheN::Entry* key)
+{
+    stream.loading = true;
+    ++m_loading;
+
+    // the stream may be gone by the time the job runs
+    m_jobs->submit(
+        [this, key, id = stream.id, level = stream.residentLevel - 1, path = stream.path, layout = stream.layout]
+        {
+            TextureStreamN::LoadedLevel loaded{key, id, level};
+            loaded.success = TextureContainerN::readLevel(path, layout, level, loaded.data);
+
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_loaded.push_back(std::move(loaded));
+        },
+        &m_reading, JobsN::Priority::BACKGROUND);
+}
+
+void TextureStreamer::uploadLevel(TextureStreamN::Stream& stream, TextureCacheN::Entry& entry, const int level,
+                                  const std::vector<unsigned char>& data)
+{
+    glBindTexture(GL_TEXTURE_2D, entry.id);
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, BCnN::getGLFormat(stream.layout.format),
+                           std::max(1, stream.layout.width >> level), std::max(1, stream.layout.height >> level), 0,
+                           static_cast<GLsizei>(data.size()), data.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    // the new level starts out sampled like the previous one and sharpens over FADE_TIME
+    stream.fade = 1.0f;
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, stream.fade);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    stream.residentLevel = level;
+    stream.residentBytes += data.size();
+    m_residentBytes += data.size();
+    entry.bytes = stream.residentBytes;
+}
+
+void TextureStreamer::dropLevel(TextureStreamN::Stream& stream, TextureCacheN::Entry& entry)
+{
+    const int level{stream.residentLevel};
+    const std::size_t size{stream.layout.levels[level].size};
+
+    glBindTexture(GL_TEXTURE_2D, entry.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    // an empty image releases the level's memory
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, BCnN::getGLFormat(stream.layout.format), 0, 0, 0, 0, nullptr);
+    stream.fade = 0.0f;
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, stream.fade);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    stream.residentLevel = level + 1;
+    stream.residentBytes -= size;
+    m_residentBytes -= size;
+    entry.bytes = stream.residentBytes;
+}
+
+bool TextureStreamer::makeRoom(const std::size_t bytes, const TextureStreamN::Stream* keep)
+{
+    while (m_residentBytes + bytes > m_budget)
+    {
+        // levels finer than wanted last frame go first (least recently used first), levels that are still needed
+        // only when the budget itself is exceeded (keep == nullptr)
+        TextureStreamN::Stream* victim{nullptr};
+        bool victimNeeded{true};
+        for (auto& [key, stream] : m_streams)
+        {
+            if (&stream == keep || stream.residentLevel >= stream.minimumLevel)
+                continue;
+
+            const bool needed{stream.lastUsed == m_frame && stream.residentLevel >= stream.wantedLevel};
+            if (needed && keep != nullptr)
+                continue;
+
+            if (victim == nullptr || (!needed && victimNeeded) ||
+                (needed == victimNeeded && stream.lastUsed < victim->lastUsed))
+            {
+                victim = &stream;
+                victimNeeded = needed;
+            }
+        }
+        if (victim == nullptr)
+            return false;
+
+        const std::shared_ptr<TextureCacheN::Entry> entry{victim->entry.lock()};
+        dropLevel(*victim, *entry);
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+// Mip streaming for block compressed textures.
+// Streamed textures are opened with only their small mips resident. Every drawn mesh reports the finest mip it
+// needs, derived from its uv density and how large it is on screen. update() reads missing levels from the file on
+// the job system, uploads them one at a time (lowering GL_TEXTURE_BASE_LEVEL and fading them in with
+// GL_TEXTURE_MIN_LOD) and drops levels again to stay within the memory budget - first ones finer than currently
+// needed, then the least recently used. Levels are specified one by one instead of with immutable storage, so a
+// dropped level really gives its memory back.
+
+#ifndef TEXTURE_STREAM_H
+#define TEXTURE_STREAM_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "engine_types.hpp"
+#include "jobs.hpp"
+#include "mesh.hpp"
+#include "texturecache.hpp"
+#include "texturecontainer.hpp"
+
+namespace TextureStreamN
+{
+    constexpr std::size_t DEFAULT_BUDGET_BYTES{256 * 1024 * 1024};
+    // levels up to this size are loaded when the texture is opened and never dropped
+    constexpr int RESIDENT_SIZE{128};
+    // level reads in flight at once
+    constexpr int MAX_LOADS{4};
+    // seconds a new level takes to fade in
+    constexpr float FADE_TIME{0.25f};
+
+    struct Stream
+    {
+        std::uint64_t id{0}; // tells loads for an old stream at a reused address apart
+        std::weak_ptr<TextureCacheN::Entry> entry{};
+        std::string path{};
+        TextureContainerN::Layout layout{};
+        int residentLevel{0}; // finest level with data
+        int minimumLevel{0}; // always resident, levels are never dropped past this
+        int wantedLevel{0}; // finest level requested this frame
+        std::uint64_t lastUsed{0}; // frame
+        std::size_t residentBytes{0};
+        float fade{0.0f}; // current GL_TEXTURE_MIN_LOD
+        bool loading{false};
+    };
+
+    // level read by a job, waiting to be uploaded
+    struct LoadedLevel
+    {
+        const TextureCacheN::Entry* key{nullptr};
+        std::uint64_t id{0};
+        int level{0};
+        std::vector<unsigned char> data{};
+        bool success{false};
+    };
+} // namespace TextureStreamN
+
+class TextureStreamer final : public EngineObject
+{
+public:
+    TextureStreamer(EngineObject* parent, JobSystem* jobs);
+    ~TextureStreamer() override;
+
+    // texture with only its smallest levels resident, nullptr if path can't be streamed
+    std::shared_ptr<TextureCacheN::Entry> open(const std::string& key, const std::string& path,
+                                               MeshN::TextureType type);
+
+    // camera for request(), fovY in radians
+    void setView(const glm::vec3& position, float fovY, int viewportHeight);
+    // mesh is drawn with transform this frame, asks for the mips its textures need
+    void request(const Mesh& mesh, const glm::mat4& transform);
+
+    // upload finished levels, start new reads & drop levels over budget, call once per frame on the gl thread
+    void update(float dt);
+
+    void setBudget(const std::size_t bytes) { m_budget = bytes; }
+    [[nodiscard]] std::size_t getBudget() const { return m_budget; }
+
+    [[nodiscard]] std::size_t getResidentBytes() const { return m_residentBytes; }
+    [[nodiscard]] std::size_t getStreamCount() const { return m_streams.size(); }
+    [[nodiscard]] int getLoadCount() const { return m_loading; }
+
+private:
+    JobSystem* m_jobs{nullptr};
+    std::size_t m_budget{TextureStreamN::DEFAULT_BUDGET_BYTES};
+    std::size_t m_residentBytes{0};
+
+    std::unordered_map<const TextureCacheN::Entry*, TextureStreamN::Stream> m_streams{};
+    std::uint64_t m_nextId{1};
+    std::uint64_t m_frame{1};
+
+    // view
+    glm::vec3 m_viewPosition{0.0f};
+    float m_pixelSize{0.0f}; // world size of a pixel at distance 1
+
+    // read jobs push here
+    std::mutex m_mutex{};
+    std::vector<TextureStreamN::LoadedLevel> m_loaded{};
+    JobsN::Counter m_reading{};
+    int m_loading{0};
+
+    void submitLoad(TextureStreamN::Stream& stream, const TextureCacheN::Entry* key);
+    void uploadLevel(TextureStreamN::Stream& stream, TextureCacheN::Entry& entry, int level,
+                     const std::vector<unsigned char>& data);
+    // drops the finest resident level
+    void dropLevel(TextureStreamN::Stream& stream, TextureCacheN::Entry& entry);
+    // drop levels of other streams until bytes fit into the budget, false if that isn't possible
+    bool makeRoom(std::size_t bytes, const TextureStreamN::Stream* keep);
+};
+
+#endif
@@ -0,0 +1,302 @@
+#include "textureupload.hpp"
+
+#include <STB/stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#include "benchmark.hpp"
+#include "glext.hpp"
+#include "texture.hpp"
+#include "util.hpp"
+
+namespace
+{
+    GLenum getFormat(const int numChannels)
+    {
+        switch (numChannels)
+        {
+        case 1:
+            return GL_RED;
+        case 2:
+            return GL_RG;
+        case 3:
+            return GL_RGB;
+        default:
+            return GL_RGBA;
+        }
+    }
+
+    GLenum getSizedFormat(const int numChannels)
+    {
+        switch (numChannels)
+        {
+        case 1:
+            return GL_R8;
+        case 2:
+            return GL_RG8;
+        case 3:
+            return GL_RGB8;
+        default:
+            return GL_RGBA8;
+        }
+    }
+} // namespace
+
+TextureUploader::TextureUploader(EngineObject* parent, JobSystem* jobs) :
+    EngineObject{"TextureUploader", parent}, m_jobs{jobs}
+{
+    constexpr GLsizeiptr size{TextureUploadN::RING_SLOTS * TextureUploadN::SLOT_BYTES};
+
+    glGenBuffers(1, &m_PBO);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PBO);
+    if (GLExtN::hasBufferStorage())
+    {
+        // map once, fences guard every slot
+        constexpr GLbitfield flags{GL_MAP_WRITE_BIT | GLExtN::MAP_PERSISTENT_BIT | GLExtN::MAP_COHERENT_BIT};
+        GLExtN::bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+        m_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+    }
+    else
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureUploader::~TextureUploader()
+{
+    // decode jobs reference this (the job system drains its queue before it is destroyed)
+    while (!m_decoding.done())
+        std::this_thread::yield();
+
+    for (TextureUploadN::Upload& upload : m_decoded)
+        stbi_image_free(upload.pixels);
+    for (TextureUploadN::Upload& upload : m_uploads)
+        stbi_image_free(upload.pixels);
+
+    for (TextureUploadN::Slot& slot : m_slots)
+    {
+        if (slot.fence != nullptr)
+            glDeleteSync(slot.fence);
+    }
+
+    if (m_mapped != nullptr)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PBO);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &m_PBO);
+}
+
+void TextureUploader::enqueue(std::shared_ptr<TextureCacheN::Entry> entry, const std::string& path,
+                              const MeshN::TextureType type)
+{
+    submitDecode(std::move(entry), nullptr, path, type);
+}
+
+void TextureUploader::enqueue(std::shared_ptr<TextureCacheN::Entry> entry, std::vector<unsigned char> encoded,
+                              const MeshN::TextureType type)
+{
+    submitDecode(std::move(entry), std::make_shared<std::vector<unsigned char>>(std::move(encoded)), "", type);
+}
+
+void TextureUploader::submitDecode(std::shared_ptr<TextureCacheN::Entry> entry,
+                                   std::shared_ptr<std::vector<unsigned char>> encoded, const std::string& path,
+                                   const MeshN::TextureType type)
+{
+    m_jobs->submit(
+        [this, entry = std::move(entry), encoded = std::move(encoded), path, type]
+        {
+            TextureUploadN::Upload upload{entry, type};
+            // files are flipped like TextureN::loadFromFile, embedded textures like TextureN::loadFromMemory
+            if (encoded)
+            {
+                stbi_set_flip_vertically_on_load_thread(0);
+                upload.pixels = stbi_load_from_memory(encoded->data(), static_cast<int>(encoded->size()),
+                                                      &upload.width, &upload.height, &upload.numChannels, 0);
+            }
+            else
+            {
+                stbi_set_flip_vertically_on_load_thread(1);
+                upload.pixels = stbi_load(path.c_str(), &upload.width, &upload.height, &upload.numChannels, 0);
+            }
+
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_decoded.push_back(std::move(upload));
+        },
+        &m_decoding, JobsN::Priority::BACKGROUND);
+}
+
+void TextureUploader::update()
+{
+    const double start{BenchmarkN::nowMs()};
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        while (!m_decoded.empty())
+        {
+            m_uploads.push_back(std::move(m_decoded.front()));
+            m_decoded.pop_front();
+        }
+    }
+
+    while (!m_uploads.empty())
+    {
+        TextureUploadN::Upload& upload{m_uploads.front()};
+
+        // failed decodes keep their placeholder, released textures are dropped
+        if (upload.pixels == nullptr || upload.entry.use_count() == 1)
+        {
+            if (upload.pixels == nullptr)
+            {
+                Util::beginError();
+                std::cout << "TEXTURE_UPLOADER::UPDATE::ERROR: Failed to decode `" << upload.entry->key << "`";
+                Util::endError();
+            }
+            stbi_image_free(upload.pixels);
+            m_uploads.pop_front();
+            continue;
+        }
+
+        // ring slot still in flight, try again next frame
+        if (!uploadStep(upload))
+            break;
+
+        if (upload.nextRow >= upload.height)
+        {
+            finish(upload);
+            m_uploads.pop_front();
+        }
+
+        if (BenchmarkN::nowMs() - start >= m_budgetMs)
+            break;
+    }
+}
+
+void TextureUploader::flush()
+{
+    m_jobs->wait(m_decoding);
+
+    const double budget{m_budgetMs};
+    m_budgetMs = std::numeric_limits<double>::infinity();
+    while (getPendingCount() > 0)
+    {
+        update();
+        // blocked on the ring, wait for the gpu
+        if (m_slots[m_slot].fence != nullptr)
+            glClientWaitSync(m_slots[m_slot].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    }
+    m_budgetMs = budget;
+}
+
+std::size_t TextureUploader::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_decoded.size() + m_uploads.size() + static_cast<std::size_t>(m_decoding.pending.load());
+}
+
+bool TextureUploader::uploadStep(TextureUploadN::Upload& upload)
+{
+    TextureCacheN::Entry& entry{*upload.entry};
+    const GLenum format{getFormat(upload.numChannels)};
+
+    // allocate every level up front
+    if (entry.id == 0)
+    {
+        const GLenum sizedFormat{getSizedFormat(upload.numChannels)};
+        const int levels{1 + static_cast<int>(std::floor(std::log2(std::max(upload.width, upload.height))))};
+
+        glGenTextures(1, &entry.id);
+        glBindTexture(GL_TEXTURE_2D, entry.id);
+        if (GLExtN::hasTexStorage())
+        {
+            GLExtN::texStorage2D(GL_TEXTURE_2D, levels, sizedFormat, upload.width, upload.height);
+        }
+        else
+        {
+            for (int level{0}; level < levels; ++level)
+            {
+                glTexImage2D(GL_TEXTURE_2D, level, static_cast<GLint>(sizedFormat), std::max(1, upload.width >> level),
+                             std::max(1, upload.height >> level), 0, format, GL_UNSIGNED_BYTE, nullptr);
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, entry.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    const std::size_t rowBytes{static_cast<std::size_t>(upload.width) * upload.numChannels};
+    const unsigned char* source{upload.pixels + rowBytes * upload.nextRow};
+
+    // rows wider than a slot can't go through the ring
+    if (rowBytes > TextureUploadN::SLOT_BYTES)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload.nextRow, upload.width, upload.height - upload.nextRow, format,
+                        GL_UNSIGNED_BYTE, source);
+        upload.nextRow = upload.height;
+        return true;
+    }
+
+    TextureUploadN::Slot& slot{m_slots[m_slot]};
+    if (slot.fence != nullptr)
+    {
+        if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            return false;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+
+    const int rows{std::min(upload.height - upload.nextRow, static_cast<int>(TextureUploadN::SLOT_BYTES / rowBytes))};
+    const std::size_t bytes{rowBytes * rows};
+    const std::size_t offset{m_slot * TextureUploadN::SLOT_BYTES};
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PBO);
+    if (m_mapped != nullptr)
+    {
+        std::memcpy(m_mapped + offset, source, bytes);
+    }
+    else
+    {
+        // the slot's fence already passed, so no need to let the driver synchronize
+        void* destination{glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(offset),
+                                           static_cast<GLsizeiptr>(bytes),
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT)};
+        std::memcpy(destination, source, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload.nextRow, upload.width, rows, format, GL_UNSIGNED_BYTE,
+                    reinterpret_cast<const void*>(offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_slot = (m_slot + 1) % TextureUploadN::RING_SLOTS;
+    upload.nextRow += rows;
+    return true;
+}
+
+void TextureUploader::finish(TextureUploadN::Upload& upload)
+{
+    TextureCacheN::Entry& entry{*upload.entry};
+
+    glBindTexture(GL_TEXTURE_2D, entry.id);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    TextureN::setTextureParameters(upload.type);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    entry.width = upload.width;
+    entry.height = upload.height;
+    entry.numChannels = upload.numChannels;
+    entry.bytes = static_cast<std::size_t>(upload.width) * upload.height * upload.numChannels * 4 / 3;
+    entry.ready = true;
+
+    stbi_image_free(upload.pixels);
+    upload.pixels = nullptr;
+}
@@ -0,0 +1,97 @@
+// Asynchronous texture loading.
+// Images are decoded on the job system, then streamed to the gpu from the main thread through a ring of pixel
+// buffer slots guarded by fences, a few rows at a time within a per frame time budget. With GL 4.4 the ring is
+// persistently mapped, otherwise every slot is mapped unsynchronized (the fences keep that safe).
+
+#ifndef TEXTURE_UPLOAD_H
+#define TEXTURE_UPLOAD_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "engine_types.hpp"
+#include "jobs.hpp"
+#include "mesh.hpp"
+#include "texturecache.hpp"
+
+namespace TextureUploadN
+{
+    constexpr std::size_t RING_SLOTS{4};
+    constexpr std::size_t SLOT_BYTES{4 * 1024 * 1024};
+    // main thread time spent uploading per frame
+    constexpr double DEFAULT_BUDGET_MS{2.0};
+
+    // decoded image waiting for (or in the middle of) its upload
+    struct Upload
+    {
+        std::shared_ptr<TextureCacheN::Entry> entry{};
+        MeshN::TextureType type{MeshN::TEXTURE_NONE};
+        unsigned char* pixels{nullptr}; // stbi allocated
+        int width{0};
+        int height{0};
+        int numChannels{0};
+        int nextRow{0};
+    };
+
+    struct Slot
+    {
+        GLsync fence{nullptr};
+    };
+} // namespace TextureUploadN
+
+class TextureUploader final : public EngineObject
+{
+public:
+    TextureUploader(EngineObject* parent, JobSystem* jobs);
+    ~TextureUploader() override;
+
+    // decode on the job system, entry becomes ready once uploaded
+    void enqueue(std::shared_ptr<TextureCacheN::Entry> entry, const std::string& path, MeshN::TextureType type);
+    void enqueue(std::shared_ptr<TextureCacheN::Entry> entry, std::vector<unsigned char> encoded,
+                 MeshN::TextureType type);
+
+    // stream decoded images until the budget is spent, call once per frame on the gl thread
+    void update();
+    // block until every queued texture is uploaded
+    void flush();
+
+    void setBudget(const double milliseconds) { m_budgetMs = milliseconds; }
+    [[nodiscard]] double getBudget() const { return m_budgetMs; }
+
+    // textures still decoding or uploading
+    [[nodiscard]] std::size_t getPendingCount() const;
+    [[nodiscard]] bool getPersistentlyMapped() const { return m_mapped != nullptr; }
+
+private:
+    JobSystem* m_jobs{nullptr};
+    double m_budgetMs{TextureUploadN::DEFAULT_BUDGET_MS};
+
+    // pixel buffer ring
+    unsigned int m_PBO{0};
+    unsigned char* m_mapped{nullptr}; // persistent mapping (GL 4.4)
+    TextureUploadN::Slot m_slots[TextureUploadN::RING_SLOTS]{};
+    std::size_t m_slot{0};
+
+    // decode jobs push here
+    mutable std::mutex m_mutex{};
+    std::deque<TextureUploadN::Upload> m_decoded{};
+    JobsN::Counter m_decoding{};
+
+    // main thread only
+    std::deque<TextureUploadN::Upload> m_uploads{};
+
+    void submitDecode(std::shared_ptr<TextureCacheN::Entry> entry, std::shared_ptr<std::vector<unsigned char>> encoded,
+                      const std::string& path, MeshN::TextureType type);
+    // allocate storage on the first call, then upload one slot of rows, false if the ring is still busy
+    bool uploadStep(TextureUploadN::Upload& upload);
+    void finish(TextureUploadN::Upload& upload);
+};
+
+#endif